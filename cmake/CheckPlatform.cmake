@@ -71,3 +71,16 @@ check_cxx_source_compiles("
 if(HAVE_GLIBC)
   add_definitions(-DHAVE_GLIBC=1)
 endif()
+
+# io_uring is used through the system calls, so only the kernel headers are
+# needed. Multishot poll requests and extended arguments are required.
+check_cxx_source_compiles("
+  #include <linux/io_uring.h>\n
+  int main(){\n
+      return IORING_POLL_ADD_MULTI | IORING_ENTER_EXT_ARG | IORING_FEAT_RSRC_TAGS;\n
+  }\n"
+  HAVE_IO_URING)
+
+if(HAVE_IO_URING)
+  add_definitions(-DHAVE_IO_URING=1)
+endif()
@@ -81,6 +81,8 @@ struct servlistener;
  *
  *      reauthenticate  Reauthenticate a user
  *
+ *      statistics_json Return statistics about the authenticator, optional
+ *
  * @endverbatim
  *
  * This forms the "module object" for authenticator modules within the gateway.
@@ -125,6 +127,18 @@ typedef struct mxs_authenticator
                            uint8_t* output,
                            size_t   output_len);                /**< Hashed client password used by backend
                                                                  * protocols */
+
+    /**
+     * @brief Return statistics about the authenticator
+     *
+     * This entry point is optional. The statistics are shown separately from
+     * the diagnostic information returned by `diagnostic_json`.
+     *
+     * @params Listener object
+     *
+     * @return JSON object with the statistics or NULL if there are none
+     */
+    json_t*  (*statistics_json)(const struct servlistener* listener);
 } MXS_AUTHENTICATOR;
 
 /** Return values for extract and authenticate entry points */
@@ -138,6 +152,10 @@ typedef struct mxs_authenticator
 #define MXS_AUTH_NO_SESSION            7
 #define MXS_AUTH_BAD_HANDSHAKE         8/**< Malformed client packet */
 #define MXS_AUTH_FAILED_WRONG_PASSWORD 9/**< Client provided wrong password */
+#define MXS_AUTH_PENDING               10/**< Waiting for a background operation, the
+                                          * authenticator triggers a read event on the
+                                          * client DCB and the same data is processed
+                                          * again once it completes */
 
 /** Return values for the loadusers entry point */
 #define MXS_AUTH_LOADUSERS_OK    0  /**< Users loaded successfully */
@@ -211,7 +229,7 @@ typedef enum
  * the MXS_AUTHENTICATOR structure is changed. See the rules defined in modinfo.h
  * that define how these numbers should change.
  */
-#define MXS_AUTHENTICATOR_VERSION {2, 1, 0}
+#define MXS_AUTHENTICATOR_VERSION {2, 2, 0}
 
 
 bool        authenticator_init(void** instance, const char* authenticator, const char* options);
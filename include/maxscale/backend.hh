@@ -39,7 +39,8 @@ public:
     enum close_type
     {
         CLOSE_NORMAL,
-        CLOSE_FATAL
+        CLOSE_FATAL,
+        CLOSE_RELEASE   /**< Return the connection to the persistent pool of the server */
     };
 
     /**
@@ -87,6 +88,17 @@ public:
      */
     uint64_t complete_session_command();
 
+    /**
+     * @brief Remove a session command that has not yet been executed
+     *
+     * The command that is currently being executed is never removed.
+     *
+     * @param position Position of the session command to remove
+     *
+     * @return True if the command was found and removed
+     */
+    bool discard_session_command(uint64_t position);
+
     /**
      * @brief Get number of session commands
      *
@@ -164,10 +176,28 @@ public:
     /**
      * @brief Close the backend
      *
-     * This will close all active connections created by the backend.
+     * This will close all active connections created by the backend. With
+     * CLOSE_RELEASE the connection is put into the persistent pool of the
+     * server, from where connect() can later take it or another idle
+     * connection back into use.
      */
     virtual void close(close_type type = CLOSE_NORMAL);
 
+    /**
+     * @brief Take over the buffers of the backend
+     *
+     * Called in the new worker after the session has been moved to another worker.
+     */
+    virtual void take_ownership();
+
+    /**
+     * @brief Check if the connection can be returned to the connection pool
+     *
+     * @return True if the backend is in use, idle and its server has a
+     *         persistent connection pool
+     */
+    bool can_release() const;
+
     /**
      * @brief Get a pointer to the internal DCB
      *
@@ -74,10 +74,13 @@ typedef enum
 typedef enum
 {
     GWBUF_INFO_NONE   = 0x0,
-    GWBUF_INFO_PARSED = 0x1
+    GWBUF_INFO_PARSED = 0x1,
+    GWBUF_INFO_INLINE = 0x2,    /*< Allocated in the same chunk as the GWBUF preceding it */
+    GWBUF_INFO_SPLIT  = 0x4     /*< Parts of the data are referred to by different buffers */
 } gwbuf_info_t;
 
-#define GWBUF_IS_PARSED(b) (b->sbuf->info & GWBUF_INFO_PARSED)
+// The parsing information is per part of the data, see gwbuf_get_buffer_object_data()
+#define GWBUF_IS_PARSED(b) (gwbuf_get_buffer_object_data(b, GWBUF_PARSING_INFO) != NULL)
 
 /**
  * A structure for cleaning up memory allocations of structures which are
@@ -87,7 +90,8 @@ typedef enum
  */
 typedef enum
 {
-    GWBUF_PARSING_INFO
+    GWBUF_PARSING_INFO,
+    GWBUF_REPLY_INFO
 } bufobj_id_t;
 
 typedef struct buffer_object_st buffer_object_t;
@@ -98,6 +102,8 @@ struct buffer_object_st
     void*            bo_data;
     void             (* bo_donefun_fp)(void*);
     buffer_object_t* bo_next;
+    void*            bo_start;  /*< The data the object was added for, see GWBUF_INFO_SPLIT */
+    void*            bo_end;
 };
 
 /**
@@ -209,6 +215,18 @@ extern GWBUF* gwbuf_alloc_and_load(unsigned int size, const void* data);
  */
 extern void gwbuf_free(GWBUF* buf);
 
+/**
+ * Make the calling routing worker the owner of a chain of gateway buffers
+ *
+ * A buffer may be used only by the worker that created it. When a session
+ * is moved to another worker, the buffers the session keeps must be taken
+ * over by the new worker before they are used there. The memory itself
+ * can be freed by any worker.
+ *
+ * @param buf  The head of the list of buffers, may be NULL
+ */
+extern void gwbuf_take_ownership(GWBUF* buf);
+
 /**
  * Clone a GWBUF. Note that if the GWBUF is actually a list of
  * GWBUFs, then every GWBUF in the list will be cloned. Note that but
@@ -335,7 +353,8 @@ extern size_t gwbuf_copy_data(const GWBUF* buffer, size_t offset, size_t bytes,
  * @brief Split a buffer in two
  *
  * The returned value will be @c length bytes long. If the length of @c buf
- * exceeds @c length, the remaining buffers are stored in @buf.
+ * exceeds @c length, the remaining buffers are stored in @buf. The data is
+ * not copied, a buffer split in the middle is shared by both parts.
  *
  * @param buf Buffer chain to split
  * @param length Number of bytes that the returned buffer should contain
@@ -400,6 +419,9 @@ void gwbuf_add_buffer_object(GWBUF* buf,
 /**
  * Search buffer object which matches with the id.
  *
+ * If the shared buffer has been split with gwbuf_split(), only the objects
+ * that were added for the same part of the data are found.
+ *
  * @param buf  GWBUF to be searched
  * @param id   Identifier for the object
  *
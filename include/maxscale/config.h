@@ -44,6 +44,12 @@ MXS_BEGIN_DECLS
 #define DEFAULT_ADMIN_HTTP_PORT 8989
 #define DEFAULT_ADMIN_HOST      "127.0.0.1"
 
+/** Default load difference in percent at which sessions are moved between workers */
+#define DEFAULT_REBALANCE_THRESHOLD 20
+
+/** Default size in bytes below which data is sent uncompressed over compressed connections */
+#define DEFAULT_COMPRESSION_THRESHOLD 50
+
 #define RELEASE_STR_LENGTH 256
 #define SYSNAME_LEN        256
 #define MAX_ADMIN_USER_LEN 1024
@@ -104,14 +110,19 @@ extern const char CN_ARG_MIN[];
 extern const char CN_ATTRIBUTES[];
 extern const char CN_AUTHENTICATOR[];
 extern const char CN_AUTHENTICATOR_DIAGNOSTICS[];
+extern const char CN_AUTHENTICATOR_STATISTICS[];
 extern const char CN_AUTHENTICATOR_OPTIONS[];
 extern const char CN_AUTH_ALL_SERVERS[];
 extern const char CN_AUTH_CONNECT_TIMEOUT[];
 extern const char CN_AUTH_READ_TIMEOUT[];
 extern const char CN_AUTH_WRITE_TIMEOUT[];
 extern const char CN_AUTO[];
+extern const char CN_BACKEND_COMPRESSION[];
+extern const char CN_CACHE_PERSIST[];
 extern const char CN_CACHE_SIZE[];
 extern const char CN_CLASSIFY[];
+extern const char CN_CLIENT_COMPRESSION[];
+extern const char CN_COMPRESSION_THRESHOLD[];
 extern const char CN_CONNECTION_TIMEOUT[];
 extern const char CN_DATA[];
 extern const char CN_DEFAULT[];
@@ -157,17 +168,22 @@ extern const char CN_PARAMETERS[];
 extern const char CN_PARSE_RESULT[];
 extern const char CN_PASSIVE[];
 extern const char CN_PASSWORD[];
+extern const char CN_POLL_BACKEND[];
 extern const char CN_POLL_SLEEP[];
 extern const char CN_PORT[];
 extern const char CN_PROTOCOL[];
 extern const char CN_QUERY_CLASSIFIER[];
 extern const char CN_QUERY_CLASSIFIER_ARGS[];
+extern const char CN_QUERY_CLASSIFIER_CACHE_PERSIST[];
 extern const char CN_QUERY_CLASSIFIER_CACHE_SIZE[];
 extern const char CN_QUERY_RETRIES[];
 extern const char CN_QUERY_RETRY_TIMEOUT[];
+extern const char CN_REBALANCE_PERIOD[];
+extern const char CN_REBALANCE_THRESHOLD[];
 extern const char CN_RELATIONSHIPS[];
 extern const char CN_REQUIRED[];
 extern const char CN_RETAIN_LAST_STATEMENTS[];
+extern const char CN_REUSEPORT[];
 extern const char CN_RETRY_ON_FAILURE[];
 extern const char CN_ROUTER[];
 extern const char CN_ROUTER_DIAGNOSTICS[];
@@ -298,6 +314,13 @@ typedef struct
     char             peer_password[MAX_ADMIN_HOST_LEN]; /**< Password for maxscale-to-maxscale traffic */
     mxb_log_target_t log_target;                        /**< Log type */
     bool             load_persisted_configs;            /**< Load persisted configuration files on startup */
+    bool             reuseport;                         /**< Give each worker its own listening socket */
+    bool             io_uring;                          /**< Let the workers use io_uring if available */
+    int              rebalance_period;                  /**< Seconds between worker rebalancing, 0 if off */
+    int              rebalance_threshold;               /**< Load difference that triggers rebalancing */
+    bool             client_compression;                /**< Offer the compressed protocol to clients */
+    bool             backend_compression;               /**< Request the compressed protocol from servers */
+    uint64_t         compression_threshold;             /**< Data smaller than this is not compressed */
 } MXS_CONFIG;
 
 /**
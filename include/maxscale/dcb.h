@@ -45,7 +45,7 @@ struct dcb;
 typedef struct dcbstats
 {
     int n_reads;        /*< Number of reads on this descriptor */
-    int n_writes;       /*< Number of writes on this descriptor */
+    int n_writes;       /*< Number of write system calls on this descriptor */
     int n_accepts;      /*< Number of accepts on this descriptor */
     int n_buffered;     /*< Number of buffered writes */
     int n_high_water;   /*< Number of crosses of high water mark */
@@ -145,6 +145,18 @@ typedef struct dcb_callback
     struct dcb_callback* next;          /*< Next callback for this DCB */
 } DCB_CALLBACK;
 
+/**
+ * A listening socket owned by a single routing worker. Used when the
+ * listener has one SO_REUSEPORT socket per worker.
+ */
+typedef struct dcb_worker_listener
+{
+    MXB_POLL_DATA poll;         /*< Poll data of the socket */
+    struct dcb*   dcb;          /*< The listener DCB the socket belongs to */
+    int           fd;           /*< The listening socket */
+    uint64_t      n_accepts;    /*< Number of connections accepted from the socket */
+} DCB_WORKER_LISTENER;
+
 /**
  * State of SSL connection
  */
@@ -157,6 +169,53 @@ typedef enum
     SSL_HANDSHAKE_FAILED            /*< The SSL handshake failed */
 } SSL_STATE;
 
+/**
+ * Sizes of the buffers in which a DCB stores the remote, user and protoname
+ * strings that fit in them, so that they need not be allocated separately.
+ */
+#define DCB_REMOTE_BUFLEN    (INET6_ADDRSTRLEN + 1)
+#define DCB_USER_BUFLEN      64
+#define DCB_PROTONAME_BUFLEN 32
+
+/**
+ * A transformation of the byte stream of a DCB, for instance the compression
+ * of the MySQL protocol. The data read from the socket is decoded before the
+ * protocol module sees it and the data given to dcb_write() is encoded before
+ * it is queued for writing.
+ */
+typedef struct dcb_codec
+{
+    /**
+     * Decode data read from the socket
+     *
+     * @param codec  The codec
+     * @param dcb    The DCB the data was read from
+     * @param raw    The data as it was read, consumed by the call
+     * @param error  Set to true if the data could not be decoded
+     *
+     * @return The decoded data or NULL if no complete unit of data has arrived
+     */
+    GWBUF* (*decode)(struct dcb_codec* codec, struct dcb* dcb, GWBUF* raw, bool* error);
+
+    /**
+     * Encode data to be written to the socket
+     *
+     * @param codec  The codec
+     * @param dcb    The DCB the data is written to
+     * @param plain  The data to encode, consumed by the call
+     *
+     * @return The encoded data or NULL on error
+     */
+    GWBUF* (*encode)(struct dcb_codec* codec, struct dcb* dcb, GWBUF* plain);
+
+    /**
+     * Free the codec
+     *
+     * @param codec  The codec
+     */
+    void (*free)(struct dcb_codec* codec);
+} DCB_CODEC;
+
 /**
  * Descriptor Control Block
  *
@@ -202,7 +261,6 @@ typedef struct dcb
     uint32_t fake_event;                                /**< Fake event to be delivered to handler */
 
     DCBSTATS    stats;                      /**< DCB related statistics */
-    struct dcb* nextpersistent;             /**< Next DCB in the persistent pool for SERVER */
     time_t      persistentstart;            /**<    0: Not in the persistent pool.
                                              *      -1: Evicted from the persistent pool and being closed.
                                              *   non-0: Time when placed in the persistent pool.
@@ -212,6 +270,7 @@ typedef struct dcb
     void*           authenticator_data;     /**< The authenticator data for this DCB */
     DCB_CALLBACK*   callbacks;              /**< The list of callbacks for the DCB */
     int64_t         last_read;              /*< Last time the DCB received data */
+    uint64_t        idle_timer;             /*< Delayed call checking the idle timeout, 0 if none */
     struct server*  server;                 /**< The associated backend server */
     SSL*            ssl;                    /*< SSL struct for connection */
     bool            ssl_read_want_read;     /*< Flag */
@@ -219,6 +278,9 @@ typedef struct dcb
     bool            ssl_write_want_read;    /*< Flag */
     bool            ssl_write_want_write;   /*< Flag */
     bool            was_persistent;         /**< Whether this DCB was in the persistent pool */
+    uint64_t        pool_capabilities;      /**< The protocol capabilities a pooled connection must have to
+                                             * be used for the session, set by the protocol module. For a
+                                             * backend DCB, the capabilities it was created with. */
     bool            high_water_reached;     /** High water mark reached, to determine whether need release
                                              * throttle */
     struct
@@ -229,7 +291,18 @@ typedef struct dcb
     uint32_t n_close;           /** How many times dcb_close has been called. */
     char*    path;              /** If a Unix socket, the path it was bound to. */
 
+    DCB_WORKER_LISTENER* worker_listeners;  /**< Per-worker sockets of a listener, indexed by
+                                             * worker id, or NULL if the listener has only one socket */
+    int n_worker_listeners;                 /**< Number of per-worker sockets */
+
     uint64_t m_uid; /**< Unique identifier for this DCB */
+
+    DCB_CODEC* codec;                           /**< Transformation of the byte stream, or NULL */
+    size_t protocol_size;                       /**< Size of the protocol state if it was allocated
+                                                 * with dcb_alloc_protocol(), otherwise 0 */
+    char remote_buf[DCB_REMOTE_BUFLEN];         /**< Storage of a short remote */
+    char user_buf[DCB_USER_BUFLEN];             /**< Storage of a short user */
+    char protoname_buf[DCB_PROTONAME_BUFLEN];   /**< Storage of a short protoname */
 } DCB;
 
 /**
@@ -265,10 +338,65 @@ DCB* dcb_accept(DCB* listener);
 DCB* dcb_alloc(dcb_role_t, struct servlistener*);
 DCB* dcb_connect(struct server*, struct session*, const char*);
 int  dcb_read(DCB*, GWBUF**, int);
+
+/**
+ * Set the codec of a DCB
+ *
+ * Once set, the data read from and written to the DCB passes through the codec.
+ * Data already in the read queue of the DCB is decoded with the new codec. A
+ * previous codec of the DCB is freed.
+ *
+ * @param dcb    The DCB
+ * @param codec  The codec, owned by the DCB from now on, or NULL for none
+ *
+ * @return False, if the data in the read queue could not be decoded
+ */
+bool dcb_set_codec(DCB* dcb, DCB_CODEC* codec);
 int  dcb_bytes_readable(DCB* dcb);
 int  dcb_drain_writeq(DCB*);
 void dcb_close(DCB*);
 
+/**
+ * @brief Close a backend DCB and return the connection to the persistent pool
+ *
+ * Unlike with dcb_close(), the connection goes into the persistent pool of its
+ * server even though the session it belongs to is not closing. The caller must
+ * make sure that the connection is idle, i.e. that no replies are expected and
+ * that there is no state on the connection that the session still depends on.
+ * If the connection does not qualify for the pool, it is closed.
+ *
+ * @param dcb  A backend DCB
+ */
+void dcb_release(DCB* dcb);
+
+/**
+ * @brief Set the user of a DCB
+ *
+ * A user that fits in the DCB is stored in it, otherwise a copy is allocated.
+ * Any previous user of the DCB is freed. The user must only be set with this
+ * function.
+ *
+ * @param dcb   The DCB
+ * @param user  The user, or NULL to clear it
+ *
+ * @return True, if the user could be set
+ */
+bool dcb_set_user(DCB* dcb, const char* user);
+
+/**
+ * @brief Allocate the protocol state of a DCB
+ *
+ * The memory is zero-filled, assigned to @c dcb->protocol and taken from the
+ * protocol object pool of the calling routing worker, to which it is returned
+ * when the DCB is freed.
+ *
+ * @param dcb   The DCB
+ * @param size  Size of the protocol state
+ *
+ * @return The protocol state or NULL on allocation failure
+ */
+void* dcb_alloc_protocol(DCB* dcb, size_t size);
+
 /**
  * @brief Close DCB in the thread that owns it.
  *
@@ -297,15 +425,14 @@ void dcb_printf(DCB*, const char*, ...) __attribute__ ((format(printf, 2, 3)));
 int dcb_add_callback(DCB*, DCB_REASON, int (*)(struct dcb*, DCB_REASON, void*), void*);
 int dcb_remove_callback(DCB*, DCB_REASON, int (*)(struct dcb*, DCB_REASON, void*), void*);
 int dcb_count_by_usage(DCB_USAGE);                      /* Return counts of DCBs */
-int      dcb_persistent_clean_count(DCB*, int, bool);   /* Clean persistent and return count */
+int      dcb_persistent_clean_count(struct server*, int, bool); /* Clean persistent and return count */
 void     dcb_hangup_foreach(struct server* server);
 uint64_t dcb_get_session_id(DCB* dcb);
 char*    dcb_role_name(DCB*);               /* Return the name of a role */
 int      dcb_accept_SSL(DCB* dcb);
 int      dcb_connect_SSL(DCB* dcb);
 int      dcb_listen(DCB* listener, const char* config, const char* protocol_name);
-void     dcb_enable_session_timeouts();
-void     dcb_process_idle_sessions(int thr);
+void     dcb_reset_idle_timeouts(struct service* service);
 
 /**
  * @brief Append a buffer the DCB's readqueue
@@ -444,6 +571,19 @@ int dcb_get_port(const DCB* dcb);
  */
 DCB* dcb_get_current();
 
+/**
+ * @brief Check whether a DCB of the calling worker is still open
+ *
+ * This can be used to check a DCB that may have been closed and freed while
+ * an asynchronous operation was in progress.
+ *
+ * @param dcb DCB to check, the pointer is not dereferenced if it is not valid
+ * @param uid The unique ID of the DCB when the operation was started
+ *
+ * @return True if the DCB is still open
+ */
+bool dcb_is_open(DCB* dcb, uint64_t uid);
+
 /**
  * Get JSON representation of the DCB
  *
@@ -456,8 +596,9 @@ json_t* dcb_to_json(DCB* dcb);
 /**
  * DCB flags values
  */
-#define DCBF_HUNG    0x0002     /*< Hangup has been dispatched */
-#define DCBF_REPLIED 0x0004     /*< DCB was written to */
+#define DCBF_HUNG     0x0002    /*< Hangup has been dispatched */
+#define DCBF_REPLIED  0x0004    /*< DCB was written to */
+#define DCBF_RELEASED 0x0008    /*< DCB was released to the persistent pool by the router */
 
 #define DCB_REPLIED(d) ((d)->flags & DCBF_REPLIED)
 
@@ -32,6 +32,18 @@ struct service;
  * that should be loaded to support the client connection and the port that the
  * protocol should use to listen for incoming client connections.
  */
+/**
+ * Statistics of the compression of the connections of a listener. The values
+ * are updated atomically by all routing workers.
+ */
+typedef struct listener_compression_stats
+{
+    uint64_t plain_bytes;       /**< Bytes compressed or decompressed, as seen by MaxScale */
+    uint64_t wire_bytes;        /**< The same data as sent over the network, with the headers */
+    uint64_t compress_ns;       /**< Nanoseconds spent compressing */
+    uint64_t decompress_ns;     /**< Nanoseconds spent decompressing */
+} LISTENER_COMPRESSION_STATS;
+
 typedef struct servlistener
 {
     char*          name;            /**< Name of the listener */
@@ -48,6 +60,9 @@ typedef struct servlistener
     struct service*       service;  /**< The service which used by this listener */
     pthread_mutex_t       lock;
     int                   active;   /**< True if the port has not been deleted */
+    LISTENER_COMPRESSION_STATS client_compression;  /**< Compression of the client connections */
+    LISTENER_COMPRESSION_STATS backend_compression; /**< Compression of the backend connections
+                                                     * of the sessions of the listener */
     struct  servlistener* next;     /**< Next service protocol */
 } SERV_LISTENER;                    // TODO: Rename to LISTENER
 
@@ -26,5 +26,48 @@ namespace maxscale
 
 std::string extract_sql(GWBUF* buffer, size_t len = -1);
 
+/**
+ * Get the canonical form of a query
+ *
+ * In the canonical form, literals are replaced with question marks, comments are removed and
+ * whitespace is collapsed.
+ *
+ * @param querybuf A COM_QUERY or COM_STMT_PREPARE packet
+ *
+ * @return The canonical form of the query
+ */
 std::string get_canonical(GWBUF* querybuf);
+
+/**
+ * Get the canonical form and its digest
+ *
+ * @param querybuf A COM_QUERY or COM_STMT_PREPARE packet
+ * @param digest   If not NULL, the digest of the canonical form is stored here
+ *
+ * @return The canonical form of the query
+ */
+std::string get_canonical(GWBUF* querybuf, uint64_t* digest);
+
+/**
+ * Get the canonical form and its digest from an SQL string
+ *
+ * @param sql    The SQL, does not need to be null-terminated
+ * @param len    Length of the SQL
+ * @param digest If not NULL, the digest of the canonical form is stored here
+ *
+ * @return The canonical form of the SQL
+ */
+std::string get_canonical(const char* sql, size_t len, uint64_t* digest = nullptr);
+
+/**
+ * Calculate the digest of a canonical form
+ *
+ * This returns the same value as the digest calculated by get_canonical().
+ *
+ * @param canonical The canonical form
+ * @param len       Length of the canonical form
+ *
+ * @return The 64-bit digest
+ */
+uint64_t canonical_digest(const char* canonical, size_t len);
 }
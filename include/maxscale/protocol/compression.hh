@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2018 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2022-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+#pragma once
+
+/**
+ * The compressed MySQL protocol
+ *
+ * Once compression has been negotiated, every unit of data sent over the
+ * connection is preceded by a 7 byte header that contains the length of the
+ * payload, a sequence number and the length of the payload once decompressed,
+ * or 0 if the payload was sent as such. A payload may contain any number of
+ * MySQL packets, or parts of them.
+ *
+ * The compression is done by the DCB codec installed by enable_mysql_compression(),
+ * so the routers and filters only ever see plain MySQL packets.
+ */
+
+#include <maxscale/ccdefs.hh>
+#include <maxscale/dcb.h>
+
+namespace maxscale
+{
+
+/**
+ * A compression algorithm
+ *
+ * A codec instance is only used by the thread that created it, so it may
+ * keep state, such as initialized compression streams, between calls.
+ */
+class CompressionCodec
+{
+public:
+    CompressionCodec(const CompressionCodec&) = delete;
+    CompressionCodec& operator=(const CompressionCodec&) = delete;
+
+    virtual ~CompressionCodec()
+    {
+    }
+
+    /**
+     * @return The name of the algorithm.
+     */
+    virtual const char* name() const = 0;
+
+    /**
+     * Get the size of the buffer needed for compressing data
+     *
+     * @param len  Length of the data to compress
+     *
+     * @return The maximum length of the compressed data
+     */
+    virtual size_t compress_bound(size_t len) = 0;
+
+    /**
+     * Compress data
+     *
+     * @param pIn      The data to compress
+     * @param in_len   Length of the data
+     * @param pOut     Buffer for the compressed data
+     * @param out_len  Length of the buffer
+     *
+     * @return The length of the compressed data or 0 on error
+     */
+    virtual size_t compress(const uint8_t* pIn, size_t in_len, uint8_t* pOut, size_t out_len) = 0;
+
+    /**
+     * Decompress data
+     *
+     * @param pIn      The compressed data
+     * @param in_len   Length of the compressed data
+     * @param pOut     Buffer for the decompressed data
+     * @param out_len  The exact length of the decompressed data
+     *
+     * @return True, if the data could be decompressed and its length was @c out_len
+     */
+    virtual bool decompress(const uint8_t* pIn, size_t in_len, uint8_t* pOut, size_t out_len) = 0;
+
+protected:
+    CompressionCodec()
+    {
+    }
+};
+
+/**
+ * A function that creates a codec, returning NULL on failure.
+ */
+typedef CompressionCodec* (* CompressionCodecFactory)();
+
+/**
+ * Register a compression codec
+ *
+ * The codec "zlib", used by the compressed MySQL protocol, is always available.
+ *
+ * @param zName    The name of the codec
+ * @param factory  Function that creates an instance of the codec
+ *
+ * @return True, if the codec was registered, false if the name is already taken
+ */
+bool register_compression_codec(const char* zName, CompressionCodecFactory factory);
+
+/**
+ * Get the codec instance of the calling thread
+ *
+ * @param zName  The name of the codec
+ *
+ * @return The codec or NULL, if there is no codec by that name or it could not be created
+ */
+CompressionCodec* get_compression_codec(const char* zName);
+
+/**
+ * Switch a MySQL connection to the compressed protocol
+ *
+ * To be called once the authentication has completed and the final OK
+ * packet has been sent or received, as that is the last uncompressed packet.
+ *
+ * @param dcb     A client or backend DCB
+ * @param zCodec  The codec to use
+ *
+ * @return True, if the compression was enabled
+ */
+bool enable_mysql_compression(DCB* dcb, const char* zCodec = "zlib");
+}
@@ -150,6 +150,7 @@ typedef struct mysql_session
     bool     correct_authenticator;                 /*< is session using mysql_native_password? */
     uint8_t  next_sequence;                         /*< Next packet sequence */
     bool     auth_switch_sent;                      /*< Expecting a response to AuthSwitchRequest? */
+    bool     users_refreshed;                       /*< Were the users loaded for this client? */
 } MYSQL_session;
 
 /** Protocol packing macros. */
@@ -318,6 +319,57 @@ static const mxs_mysql_cmd_t MXS_COM_UNDEFINED = (mxs_mysql_cmd_t) -1;
  */
 static const char* const MXS_LAST_GTID = "last_gtid";
 
+/** The state of a reply from a server */
+typedef enum reply_state
+{
+    REPLY_STATE_START,          /**< Query sent to backend */
+    REPLY_STATE_DONE,           /**< Complete reply received */
+    REPLY_STATE_RSET_COLDEF,    /**< Resultset response, waiting for column definitions */
+    REPLY_STATE_RSET_COLDEF_EOF,/**< Resultset response, waiting for EOF for column definitions */
+    REPLY_STATE_RSET_ROWS,      /**< Resultset response, waiting for rows */
+    REPLY_STATE_PS_DEFS         /**< Prepared statement response, waiting for the definitions */
+} reply_state_t;
+
+/**
+ * The number of bytes at the start of a packet that are needed to classify
+ * it: the command byte, two length-encoded integers, the server status and
+ * the warning count of an OK packet.
+ */
+#define MXS_REPLY_PREFIX_LEN 23
+
+/**
+ * The reply to a command, parsed as it arrives
+ *
+ * The data is fed to mxs_mysql_reply_process() in the order it is read. Every
+ * byte is looked at only once and a packet that is split between reads is
+ * continued where it was left off, so the buffers need not contain complete
+ * packets. Only the first bytes of a packet are copied, the rest is skipped.
+ */
+typedef struct mxs_mysql_reply
+{
+    reply_state_t state;
+    uint8_t       command;          /**< The command the reply is for */
+    bool          opening_cursor;   /**< A COM_STMT_EXECUTE that opens a cursor */
+    bool          local_infile;     /**< The server requested a LOAD DATA LOCAL INFILE */
+    bool          error;            /**< The reply ended in an error */
+    uint16_t      error_code;       /**< The error code, if the reply ended in an error */
+    uint16_t      server_status;    /**< The status in the latest OK or EOF packet */
+    uint32_t      warnings;         /**< The number of warnings in all results */
+    uint64_t      columns;          /**< The number of columns in the latest result set */
+    uint64_t      rows;             /**< The number of rows in all result sets */
+    uint32_t      results;          /**< The number of completed results */
+    uint64_t      size;             /**< The number of bytes processed */
+
+    /** The parsing state */
+    uint8_t  packet[MYSQL_HEADER_LEN + MXS_REPLY_PREFIX_LEN];   /**< Start of the current packet */
+    uint32_t have;                  /**< Bytes of the current packet in @c packet */
+    uint32_t want;                  /**< Bytes of the payload to copy into @c packet */
+    uint32_t skip;                  /**< Bytes of the current packet left to skip */
+    uint64_t defs_left;             /**< Column or parameter definitions still to come */
+    bool     skip_next;             /**< The next packet continues a large packet */
+    bool     ps_out_params;         /**< The result set contains PS OUT parameters */
+} MXS_MYSQL_REPLY;
+
 /**
  * MySQL Protocol specific state data.
  *
@@ -346,6 +398,11 @@ typedef struct
                                              * packet type */
     bool large_query;                       /*< Whether to ignore the command byte of the next
                                              * packet*/
+    bool compress;                          /*< Whether the compressed protocol was negotiated */
+    uint64_t acquire_start;                 /*< When the connection was requested for a session, in
+                                             * nanoseconds of the monotonic clock. 0 once it is ready. */
+    MXS_MYSQL_REPLY reply;                  /*< The reply to the current command, tracked for
+                                             * collected results */
 } MySQLProtocol;
 
 typedef struct
@@ -690,6 +747,99 @@ uint32_t mxs_mysql_extract_ps_id(GWBUF* buffer);
  */
 bool mxs_mysql_command_will_respond(uint8_t cmd);
 
+/**
+ * Get the capabilities that a pooled backend connection must have to be used for a session
+ *
+ * The capabilities are negotiated when the connection is created and resetting
+ * it with COM_CHANGE_USER does not change them, so a pooled connection can only
+ * be given to a session whose connections would be created with the same ones.
+ *
+ * @param client_capabilities   The capabilities of the client
+ * @param extra_capabilities    The MariaDB 10.2 capabilities of the client
+ * @param service_capabilities  The routing capabilities of the service
+ *
+ * @return The capabilities of the backend connections of the session
+ */
+uint64_t mxs_mysql_pool_capabilities(uint32_t client_capabilities,
+                                     uint32_t extra_capabilities,
+                                     uint64_t service_capabilities);
+
+/**
+ * Start tracking the reply to a command
+ *
+ * @param reply           The reply state
+ * @param cmd             The command that was sent to the server
+ * @param opening_cursor  True, if the command is a COM_STMT_EXECUTE that opens
+ *                        a cursor, in which case no rows are sent
+ */
+void mxs_mysql_reply_start(MXS_MYSQL_REPLY* reply, uint8_t cmd, bool opening_cursor);
+
+/**
+ * Process more of a reply
+ *
+ * @param reply   The reply state
+ * @param buffer  The data that follows what has already been processed
+ * @param offset  Where in @c buffer the new data starts
+ */
+void mxs_mysql_reply_process(MXS_MYSQL_REPLY* reply, GWBUF* buffer, size_t offset);
+
+/**
+ * @return True, if the whole reply has been processed
+ */
+static inline bool mxs_mysql_reply_is_complete(const MXS_MYSQL_REPLY* reply)
+{
+    return reply->state == REPLY_STATE_DONE;
+}
+
+/**
+ * Get the parsed reply of a collected result
+ *
+ * When a statement based router collects a complete result, the backend
+ * protocol stores the reply it tracked with the result so that the router
+ * and the filters on the reply path do not need to parse it again.
+ *
+ * @param buffer  A buffer with GWBUF_TYPE_RESULT set
+ *
+ * @return The reply or NULL if the reply was not tracked
+ */
+static inline const MXS_MYSQL_REPLY* mxs_mysql_get_reply(GWBUF* buffer)
+{
+    return (const MXS_MYSQL_REPLY*)gwbuf_get_buffer_object_data(buffer, GWBUF_REPLY_INFO);
+}
+
+/**
+ * @return True, if the reply left errors or warnings that SHOW WARNINGS or
+ *         SHOW ERRORS would return on the same connection
+ */
+static inline bool mxs_mysql_reply_has_diagnostics(const MXS_MYSQL_REPLY* reply)
+{
+    return reply->error || reply->warnings > 0;
+}
+
+/** How long a statement ties the session to the connection it was executed on */
+typedef enum mxs_mysql_binding
+{
+    MXS_BINDING_NONE,       /**< The next statement can use any connection */
+    MXS_BINDING_NEXT,       /**< The next statement may depend on the state left by this one */
+    MXS_BINDING_SESSION     /**< The state lasts until the connection is reset */
+} mxs_mysql_binding_t;
+
+/**
+ * Find out how a statement ties the session to its backend connection
+ *
+ * The connection state that is not restored on another connection is the one
+ * the next statement can read: LAST_INSERT_ID() after a write, FOUND_ROWS() after
+ * SQL_CALC_FOUND_ROWS and ROW_COUNT(). Named locks taken with GET_LOCK() and
+ * LOCK TABLES are held until the connection is reset. The warnings and errors
+ * a statement leaves are found in the reply, see mxs_mysql_reply_has_diagnostics().
+ *
+ * @param buffer  Buffer containing a complete command
+ * @param type    The query type mask of the command
+ *
+ * @return How long the connection must be kept
+ */
+mxs_mysql_binding_t mxs_mysql_get_binding(GWBUF* buffer, uint32_t type);
+
 /* Type of the kill-command sent by client. */
 typedef enum kill_type
 {
@@ -12,27 +12,138 @@
  */
 #pragma once
 
-#include <map>
+#include <list>
 #include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 #include <maxscale/backend.hh>
 #include <maxscale/modutil.h>
+#include <maxscale/protocol/mysql.h>
 #include <maxscale/response_stat.hh>
 
 namespace maxscale
 {
 
-/** Enum for tracking client reply state */
-enum reply_state_t
+typedef std::unordered_map<uint32_t, uint32_t> BackendHandleMap;    /** Internal ID to external ID */
+
+/**
+ * The prepared statements of one backend connection
+ *
+ * When the client closes a statement, the statement is kept prepared on the
+ * server so that the next COM_STMT_PREPARE of the same text can use it. A
+ * server handle is only used by one client statement at a time. Statements
+ * that have used cursors or COM_STMT_SEND_LONG_DATA are never reused.
+ */
+class PSCache
 {
-    REPLY_STATE_START,          /**< Query sent to backend */
-    REPLY_STATE_DONE,           /**< Complete reply received */
-    REPLY_STATE_RSET_COLDEF,    /**< Resultset response, waiting for column definitions */
-    REPLY_STATE_RSET_COLDEF_EOF,/**< Resultset response, waiting for EOF for column definitions */
-    REPLY_STATE_RSET_ROWS       /**< Resultset response, waiting for rows */
-};
+    PSCache(const PSCache&);
+    PSCache& operator=(const PSCache&);
+
+public:
+
+    /**
+     * Create a new cache
+     *
+     * @param max_idle Maximum number of closed statements kept prepared
+     */
+    PSCache(size_t max_idle);
+    ~PSCache();
+
+    /**
+     * Add a statement that was prepared on the server
+     *
+     * @param handle   The server handle of the statement
+     * @param sql      The text of the statement
+     * @param response The response to the COM_STMT_PREPARE, copied
+     */
+    void add(uint32_t handle, const std::string& sql, GWBUF* response);
+
+    /**
+     * Prevent a statement from being reused
+     *
+     * @param handle The server handle of the statement
+     */
+    void taint(uint32_t handle);
+
+    /**
+     * Release a statement that the client closed
+     *
+     * @param handle The server handle of the statement
+     *
+     * @return The handles that must be closed on the server. If the released
+     *         statement is not kept, its handle is the first one.
+     */
+    std::vector<uint32_t> release(uint32_t handle);
+
+    /**
+     * Take a closed statement into use
+     *
+     * @param sql        The text of the statement
+     * @param ppResponse If not NULL, a copy of the COM_STMT_PREPARE response is
+     *                   stored here
+     *
+     * @return The server handle of the statement or 0 if the statement is not
+     *         in the cache
+     */
+    uint32_t acquire(const std::string& sql, GWBUF** ppResponse = NULL);
+
+    /**
+     * Check whether a closed statement can be taken into use
+     *
+     * @param sql The text of the statement
+     *
+     * @return True if the statement is in the cache
+     */
+    bool contains(const std::string& sql) const
+    {
+        return m_idle.find(sql) != m_idle.end();
+    }
+
+    /**
+     * Remove all closed statements
+     *
+     * @return The handles that must be closed on the server
+     */
+    std::vector<uint32_t> clear_idle();
+
+    /**
+     * Forget all statements
+     *
+     * Used when the connection is closed.
+     */
+    void clear();
+
+    /**
+     * Take over the stored responses after the session moved to another worker
+     */
+    void take_ownership();
+
+    /**
+     * @return Number of closed statements in the cache
+     */
+    size_t size() const
+    {
+        return m_idle.size();
+    }
 
-typedef std::map<uint32_t, uint32_t> BackendHandleMap;      /** Internal ID to external ID */
+private:
+    struct Statement
+    {
+        std::string                   sql;
+        GWBUF*                        response;
+        bool                          reusable;
+        std::list<uint32_t>::iterator lru;      /**< Position in m_lru if closed */
+    };
+
+    void erase_idle(std::unordered_map<uint32_t, Statement>::iterator it);
+
+    std::unordered_map<uint32_t, Statement>    m_stmts;     /**< Statements with a known text */
+    std::unordered_map<std::string, uint32_t>  m_idle;      /**< Closed statements by text */
+    std::list<uint32_t>                        m_lru;       /**< Closed statements, oldest first */
+    size_t                                     m_max_idle;
+};
 
 class RWBackend;
 typedef std::shared_ptr<RWBackend> SRWBackend;
@@ -52,12 +163,23 @@ public:
 
     inline reply_state_t get_reply_state() const
     {
-        return m_reply_state;
+        return m_reply.state;
+    }
+
+    /**
+     * The reply to the latest command
+     *
+     * @return The number of results, columns and rows and the error, if any,
+     *         of the reply processed so far
+     */
+    const MXS_MYSQL_REPLY& reply() const
+    {
+        return m_reply;
     }
 
     const char* reply_state_str() const
     {
-        switch (m_reply_state)
+        switch (m_reply.state)
         {
         case REPLY_STATE_START:
             return "START";
@@ -74,6 +196,9 @@ public:
         case REPLY_STATE_RSET_ROWS:
             return "ROWS";
 
+        case REPLY_STATE_PS_DEFS:
+            return "PS_DEFS";
+
         default:
             return "UNKNOWN";
         }
@@ -82,9 +207,56 @@ public:
     void     add_ps_handle(uint32_t id, uint32_t handle);
     uint32_t get_ps_handle(uint32_t id) const;
 
+    /**
+     * Add a prepared statement that can be reused after the client closes it
+     *
+     * @param id       Internal ID of the statement
+     * @param handle   The server handle of the statement
+     * @param sql      The text of the statement
+     * @param response The response to the COM_STMT_PREPARE
+     */
+    void add_ps_handle(uint32_t id, uint32_t handle, const std::string& sql, GWBUF* response);
+
+    /**
+     * Check whether a statement is prepared and unused on this connection
+     *
+     * @param sql The text of the statement
+     *
+     * @return True if a COM_STMT_PREPARE of the statement can reuse it
+     */
+    bool can_reuse_prepared(const std::string& sql) const
+    {
+        return m_ps_cache.contains(sql);
+    }
+
+    /**
+     * Complete the next COM_STMT_PREPARE with a statement that is already prepared
+     *
+     * The session command is completed without sending it to the server.
+     *
+     * @return A copy of the original response to the COM_STMT_PREPARE or NULL
+     *         if no statement could be reused. The caller must free the buffer.
+     */
+    GWBUF* reuse_prepared();
+
+    /**
+     * Execute the next session command
+     *
+     * Commands that do not generate a response are completed immediately and
+     * the execution continues with the next one. When this returns, either a
+     * response is expected or no session commands are left.
+     *
+     * @return True if the commands were written successfully
+     */
     bool execute_session_command();
     bool continue_session_command(GWBUF* buffer);
 
+    /**
+     * Take over the buffers of the backend, including the responses of the
+     * prepared statements that can be reused
+     */
+    void take_ownership();
+
     /**
      * Write a query to the backend
      *
@@ -116,9 +288,6 @@ public:
 
     void close(close_type type = CLOSE_NORMAL);
 
-    // For COM_STMT_FETCH processing
-    bool consume_fetched_rows(GWBUF* buffer);
-
     inline uint8_t current_command() const
     {
         return m_command;
@@ -126,9 +295,16 @@ public:
 
     bool local_infile_requested() const
     {
-        return m_local_infile_requested;
+        return m_reply.local_infile;
     }
 
+    /**
+     * Process a possibly partial response from the backend
+     *
+     * The data is processed only once, even if a packet is split between calls.
+     *
+     * @param buffer  Buffer containing the next part of the response
+     */
     void process_reply(GWBUF* buffer);
 
     /**
@@ -138,39 +314,18 @@ public:
      */
     bool reply_is_complete() const
     {
-        return m_reply_state == REPLY_STATE_DONE;
+        return mxs_mysql_reply_is_complete(&m_reply);
     }
 
-    void process_packets(GWBUF* buffer);
-    void process_reply_start(mxs::Buffer::iterator it);
-
     // Controlled by the session
     ResponseStat& response_stat();
 private:
-    reply_state_t    m_reply_state;
+    bool close_ps_handles(const std::vector<uint32_t>& handles);
+
+    MXS_MYSQL_REPLY  m_reply;           /**< The reply to the latest command */
     BackendHandleMap m_ps_handles;      /**< Internal ID to backend PS handle mapping */
-    modutil_state    m_modutil_state;   /**< @see modutil_count_signal_packets */
+    PSCache          m_ps_cache;        /**< Reusable statements by text */
     uint8_t          m_command;
-    bool             m_opening_cursor;          /**< Whether we are opening a cursor */
-    uint32_t         m_expected_rows;           /**< Number of rows a COM_STMT_FETCH is retrieving */
-    bool             m_local_infile_requested;  /**< Whether a LOCAL INFILE was requested */
     ResponseStat     m_response_stat;
-    uint64_t         m_num_coldefs = 0;
-    bool             m_skip_next = false;
-
-    inline bool is_opening_cursor() const
-    {
-        return m_opening_cursor;
-    }
-
-    inline void set_cursor_opened()
-    {
-        m_opening_cursor = false;
-    }
-
-    inline void set_reply_state(reply_state_t state)
-    {
-        m_reply_state = state;
-    }
 };
 }
@@ -428,6 +428,10 @@ typedef struct query_classifier
      * Dups the provided info object. After having been dupped, the info object
      * can be stored on another GWBUF.
      *
+     * The cache shares info objects between threads, so dupping and closing must
+     * be thread-safe. An info object that has been parsed using @c QC_COLLECT_ALL
+     * must not be modified afterwards.
+     *
      * @param info  The info to be dupped.
      *
      * @return The same info that was provided as argument.
@@ -449,6 +453,7 @@ typedef struct query_classifier
 typedef struct QC_CACHE_PROPERTIES
 {
     int64_t max_size;   /** The maximum size of the cache. */
+    bool    persist;    /** Whether the most used statements are saved and classified after a restart. */
 } QC_CACHE_PROPERTIES;
 
 /**
@@ -456,11 +461,12 @@ typedef struct QC_CACHE_PROPERTIES
  */
 typedef struct QC_CACHE_STATS
 {
-    int64_t size;       /** The current size of the cache. */
-    int64_t inserts;    /** The number of inserts. */
-    int64_t hits;       /** The number of hits. */
-    int64_t misses;     /** The number of misses. */
-    int64_t evictions;  /** The number of evictions. */
+    int64_t size;           /** The current size of the cache. */
+    int64_t inserts;        /** The number of inserts. */
+    int64_t hits;           /** The number of hits. */
+    int64_t misses;         /** The number of misses. */
+    int64_t evictions;      /** The number of evictions. */
+    int64_t shared_hits;    /** The number of hits that were found in the shared cache. */
 } QC_CACHE_STATS;
 
 /**
@@ -943,6 +949,18 @@ bool qc_get_cache_stats(QC_CACHE_STATS* stats);
  */
 json_t* qc_get_cache_stats_as_json();
 
+/**
+ * Get statistics of the cache shared by all threads.
+ *
+ * The hits and misses are those of the lookups that were made after a miss
+ * in the cache of the calling thread.
+ *
+ * @param stats[out]  Cache statistics, @c shared_hits is not used.
+ *
+ * @return True, if caching is enabled, false otherwise.
+ */
+bool qc_get_shared_cache_stats(QC_CACHE_STATS* stats);
+
 /**
  * String represenation for the parse result.
  *
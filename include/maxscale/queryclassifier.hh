@@ -198,6 +198,11 @@ public:
         m_large_query = large_query;
     }
 
+    bool have_tmp_tables() const
+    {
+        return m_have_tmp_tables;
+    }
+
     load_data_state_t load_data_state() const
     {
         return m_load_data_state;
@@ -289,11 +294,6 @@ private:
         m_load_data_sent = 0;
     }
 
-    bool have_tmp_tables() const
-    {
-        return m_have_tmp_tables;
-    }
-
     void set_have_tmp_tables(bool have_tmp_tables)
     {
         m_have_tmp_tables = have_tmp_tables;
@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2018 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2022-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+#pragma once
+
+/**
+ * Asynchronous reverse DNS lookups
+ *
+ * Reverse lookups are done by dedicated resolver threads so that the routing
+ * workers never block on DNS. The results, including failed lookups, are kept
+ * in a process-wide cache for a limited time.
+ */
+
+#include <maxscale/ccdefs.hh>
+
+#include <chrono>
+#include <functional>
+#include <string>
+
+namespace maxscale
+{
+
+/**
+ * Function that does a blocking reverse lookup
+ *
+ * @param address  IP address to look up
+ * @param hostname Where the hostname is stored
+ *
+ * @return True if the address resolved to a hostname
+ */
+using ReverseLookup = std::function<bool (const std::string& address, std::string* hostname)>;
+
+/**
+ * Get the hostname of an address from the cache
+ *
+ * @param address  IP address to look up
+ * @param hostname Where the hostname is stored. Set to an empty string if the
+ *                 address has no hostname.
+ *
+ * @return True if the address was in the cache and the entry has not expired
+ */
+bool cached_hostname(const std::string& address, std::string* hostname);
+
+/**
+ * Resolve the hostname of an address in the background
+ *
+ * The result is stored in the cache after which @c callback is executed on the
+ * routing worker that called this function. If the function was not called from
+ * a worker, the callback is executed on the resolver thread. Concurrent lookups
+ * of the same address are done only once.
+ *
+ * @param address  IP address to look up
+ * @param callback Function to call once the result is in the cache
+ */
+void resolve_hostname(const std::string& address, std::function<void ()> callback);
+
+/**
+ * Set how long lookup results are cached
+ *
+ * @param found     How long a resolved hostname is cached
+ * @param not_found How long a failed lookup is cached
+ */
+void set_hostname_cache_ttl(std::chrono::seconds found, std::chrono::seconds not_found);
+
+/**
+ * Replace the function that does the lookups
+ *
+ * This is intended for testing. The cache is cleared when the function is replaced.
+ *
+ * @param func The new lookup function, an empty function restores the default
+ *             one that uses getaddrinfo() and getnameinfo()
+ */
+void set_reverse_lookup(ReverseLookup func);
+}
@@ -234,6 +234,21 @@ typedef struct mxs_router_object
      *         instance should not be modified.
      */
     bool (* configureInstance)(MXS_ROUTER* instance, MXS_CONFIG_PARAMETER* params);
+
+    /**
+     * @brief Called when a session has been moved to another routing worker
+     *
+     * This function is called in the new worker before any data of the session
+     * is processed there. The router must take over any buffers the router
+     * session keeps, see gwbuf_take_ownership(), and replace any references to
+     * data of the old worker. Only sessions of routers that declare the
+     * RCAP_TYPE_MOVABLE_SESSIONS capability are moved. The function may be NULL
+     * if the router sessions keep nothing that is specific to a worker.
+     *
+     * @param instance       Router instance
+     * @param router_session Router session
+     */
+    void (* sessionMoved)(MXS_ROUTER* instance, MXS_ROUTER_SESSION* router_session);
 } MXS_ROUTER_OBJECT;
 
 /**
@@ -241,7 +256,7 @@ typedef struct mxs_router_object
  * must update these versions numbers in accordance with the rules in
  * modinfo.h.
  */
-#define MXS_ROUTER_VERSION {4, 0, 0}
+#define MXS_ROUTER_VERSION {4, 1, 0}
 
 /**
  * Specifies capabilities specific for routers. Common capabilities
@@ -259,6 +274,8 @@ typedef enum router_capability
                                              *  users when the service is started */
     RCAP_TYPE_NO_AUTH        = 0x00040000,  /**< No `user` or `password` parameter required */
     RCAP_TYPE_RUNTIME_CONFIG = 0x00080000,  /**< Router supports runtime cofiguration */
+    RCAP_TYPE_MOVABLE_SESSIONS = 0x00100000,/**< Sessions can be moved to another worker,
+                                             *  see sessionMoved */
 } mxs_router_capability_t;
 
 typedef enum
@@ -71,6 +71,12 @@ public:
                      mxs_error_action_t action,
                      bool* pSuccess);
 
+    /**
+     * Called in the new worker when the session has been moved to another worker.
+     * The router must declare RCAP_TYPE_MOVABLE_SESSIONS for this to be called.
+     */
+    void moved();
+
 protected:
     RouterSession(MXS_SESSION* pSession);
 
@@ -217,6 +223,13 @@ public:
         MXS_EXCEPTION_GUARD(pRouter_session->handleError(pMessage, pProblem, action, pSuccess));
     }
 
+    static void sessionMoved(MXS_ROUTER*, MXS_ROUTER_SESSION* pData)
+    {
+        RouterSessionType* pRouter_session = static_cast<RouterSessionType*>(pData);
+
+        MXS_EXCEPTION_GUARD(pRouter_session->moved());
+    }
+
     static uint64_t getCapabilities(MXS_ROUTER* pInstance)
     {
         uint64_t rv = 0;
@@ -270,5 +283,6 @@ MXS_ROUTER_OBJECT Router<RouterType, RouterSessionType>::s_object =
     &Router<RouterType, RouterSessionType>::getCapabilities,
     &Router<RouterType, RouterSessionType>::destroyInstance,
     &Router<RouterType, RouterSessionType>::configure,
+    &Router<RouterType, RouterSessionType>::sessionMoved,
 };
 }
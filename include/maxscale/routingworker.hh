@@ -98,6 +98,29 @@ public:
      */
     static bool remove_shared_fd(int fd);
 
+    /**
+     * Add a listening socket to the epoll instance of this worker. Unlike
+     * with @c add_fd, the descriptor will be level-triggered. This is intended
+     * for listening sockets that are private to one worker, as is the case
+     * when each worker has its own SO_REUSEPORT socket bound to the same port.
+     *
+     * @param fd      The file descriptor to be added.
+     * @param events  Mask of epoll event types.
+     * @param pData   The poll data associated with the descriptor.
+     *
+     * @return True, if the descriptor could be added, false otherwise.
+     */
+    bool add_listener_fd(int fd, uint32_t events, MXB_POLL_DATA* pData);
+
+    /**
+     * Remove a listening socket added with @c add_listener_fd.
+     *
+     * @param fd  The file descriptor to be removed.
+     *
+     * @return True on success, false on failure.
+     */
+    bool remove_listener_fd(int fd);
+
     /**
      * Returns the id of the routing worker
      *
@@ -323,10 +346,66 @@ public:
     /**
      * Get next worker
      *
+     * Of two workers taken in round-robin order, the one that had the lower
+     * load during the last second is returned.
+     *
      * @return The worker where work should be assigned
      */
     static RoutingWorker* pick_worker();
 
+    /**
+     * Get the load of the worker during the last second. Unlike @c load(),
+     * this can be called from any thread.
+     *
+     * @return The load in percent
+     */
+    int last_second_load() const
+    {
+        return mxb::atomic::load(&m_last_second_load, mxb::atomic::RELAXED);
+    }
+
+    /**
+     * @return The number of sessions moved to this worker from other workers.
+     */
+    uint64_t sessions_moved_in() const
+    {
+        return m_sessions_moved_in;
+    }
+
+    /**
+     * @return The number of sessions moved from this worker to other workers.
+     */
+    uint64_t sessions_moved_out() const
+    {
+        return m_sessions_moved_out;
+    }
+
+    /**
+     * Move a session with its client and backend DCBs to another worker.
+     * Must be called in the worker that owns the session, and only for a
+     * session for which session_is_movable() returns true.
+     *
+     * @param pSession  The session to move
+     * @param pTo       The worker to move the session to
+     *
+     * @return True, if the session is on its way to the other worker
+     */
+    bool move_session(MXS_SESSION* pSession, RoutingWorker* pTo);
+
+    /**
+     * Move idle sessions to a less loaded worker. Must be called in this worker.
+     *
+     * The sessions are assumed to cause load in proportion to the rate at which
+     * their clients have sent data, so sessions are moved, busiest first, until
+     * they are estimated to account for @c load of the load of this worker.
+     *
+     * @param pTo   The worker to move the sessions to
+     * @param load  The amount of load, in percent, to move
+     *
+     * @return The number of sessions moved
+     */
+    int rebalance(RoutingWorker* pTo, int load);
+
     /**
      * Worker local storage
      */
@@ -508,6 +587,11 @@ private:
     void post_run();    // override
     void epoll_tick();  // override
 
+    bool balance_workers(Call::action_t action);
+    void balance_workers();
+
+    bool clean_persistent_pools(Call::action_t action);
+
     void delete_zombies();
     void check_systemd_watchdog();
     void start_watchdog_workaround();
@@ -520,6 +604,9 @@ private:
     static maxbase::TimePoint s_watchdog_next_check;  /*< Next time to notify systemd. */
     std::atomic<bool>         m_alive;                /*< Set to true in epoll_tick(), false on notification. */
     WatchdogNotifier*         m_pWatchdog_notifier;   /*< Watchdog notifier, if systemd enabled. */
+    int                       m_last_second_load;     /*< Load of the last second, for other threads. */
+    uint64_t                  m_sessions_moved_in;    /*< Sessions moved here from other workers. */
+    uint64_t                  m_sessions_moved_out;   /*< Sessions moved from here to other workers. */
 };
 
 using WatchdogWorkaround = RoutingWorker::WatchdogWorkaround;
@@ -76,6 +76,10 @@ typedef struct
     uint64_t n_new_conn;    /**< Times the current pool was empty */
     uint64_t n_from_pool;   /**< Times when a connection was available from the pool */
     uint64_t packets;       /**< Number of packets routed to this server */
+    uint64_t n_waits;       /**< Connections that became ready for use */
+    uint64_t wait_ns;       /**< Total time spent waiting for connections to become ready */
+    uint64_t n_resets;      /**< Pooled connections that were reset for a new session */
+    uint64_t reset_ns;      /**< Total time spent resetting pooled connections */
 } SERVER_STATS;
 
 /**
@@ -145,7 +149,6 @@ typedef struct server
     bool          is_active;        /**< Server is active and has not been "destroyed" */
     void*         auth_instance;    /**< Authenticator instance data */
     SSL_LISTENER* server_ssl;       /**< SSL data */
-    DCB**         persistent;       /**< List of unused persistent connections to the server */
     uint8_t       charset;          /**< Server character set. Read from backend and sent to client. */
     // Statistics and events
     SERVER_STATS stats;         /**< The server statistics, e.g. number of connections */
@@ -496,6 +499,17 @@ bool server_set_disk_space_threshold(SERVER* server, const char* disk_space_thre
  */
 void server_add_response_average(SERVER* server, double ave, int num_samples);
 
+/**
+ * @brief Record the time it took for a connection to become ready for use
+ *
+ * @param server  The server.
+ * @param ns      Nanoseconds from the request of the connection to the moment
+ *                it could be used.
+ * @param reset   True, if the connection was taken from the persistent pool and
+ *                the time was spent resetting it.
+ */
+void server_add_connection_wait(SERVER* server, uint64_t ns, bool reset);
+
 extern int     server_free(SERVER* server);
 extern SERVER* server_find_by_unique_name(const char* name);
 extern int     server_find_by_unique_names(char** server_names, int size, SERVER*** output);
@@ -512,6 +526,7 @@ extern DCB*    server_get_persistent(SERVER* server,
                                      const char* user,
                                      const char* ip,
                                      const char* protocol,
+                                     uint64_t capabilities,
                                      int id);
 extern void     server_update_address(SERVER* server, const char* address);
 extern void     server_update_port(SERVER* server, unsigned short port);
@@ -56,6 +56,7 @@ typedef struct
     int    n_failed_starts; /**< Number of times this service has failed to start */
     int    n_sessions;      /**< Number of sessions created on service since start */
     int    n_current;       /**< Current number of sessions */
+    int    n_idle_timeouts; /**< Number of sessions closed due to connection_timeout */
 } SERVICE_STATS;
 
 typedef struct server_ref_t
@@ -130,7 +130,9 @@ typedef enum
  */
 typedef struct
 {
-    time_t connect;         /**< Time when the session was started */
+    time_t   connect;       /**< Time when the session was started */
+    uint64_t packets;       /**< Client packets routed one at a time */
+    uint64_t copied;        /**< Client packets that were copied to make them contiguous */
 } MXS_SESSION_STATS;
 
 /**
@@ -471,6 +473,30 @@ static inline bool session_set_autocommit(MXS_SESSION* ses, bool autocommit)
  */
 MXS_SESSION* session_get_by_id(uint64_t id);
 
+/**
+ * @brief Call a function for each backend DCB of a session
+ *
+ * Must be called in the routing worker that owns the session.
+ *
+ * @param session  The session
+ * @param func     Function to call, iteration stops if it returns false
+ * @param data     Data passed to the function
+ */
+void session_foreach_backend_dcb(MXS_SESSION* session, bool (* func)(DCB* dcb, void* data), void* data);
+
+/**
+ * @brief Check whether a session is being moved to another worker
+ *
+ * While a session is being moved, neither worker may handle it. A task that
+ * concerns the session and finds it moving, or owned by some other worker,
+ * should be posted again to the owner of @c session->client_dcb.
+ *
+ * @param session  The session
+ *
+ * @return True, if the session is being moved
+ */
+bool session_is_moving(const MXS_SESSION* session);
+
 /**
  * Get the next available unique (assuming no overflow) session id number.
  *
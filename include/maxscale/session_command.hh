@@ -90,6 +90,11 @@ public:
      */
     void mark_as_duplicate(const SessionCommand& rhs);
 
+    /**
+     * Take over the buffer after the session moved to another worker
+     */
+    void take_ownership();
+
 private:
     mxs::Buffer m_buffer;       /**< The buffer containing the command */
     uint8_t     m_command;      /**< The command being executed */
@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2018 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2022-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+#pragma once
+
+/**
+ * Threads for work that would block the routing workers
+ */
+
+#include <maxscale/ccdefs.hh>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <maxbase/worker.hh>
+
+namespace maxscale
+{
+
+/**
+ * A pool of threads that execute blocking tasks, e.g. DNS lookups, loading of
+ * users or PAM authentications, on behalf of the routing workers. The results
+ * are usually passed back to the worker that submitted the task with post().
+ *
+ * The threads are started when the first task is submitted. All pools are
+ * stopped with stop_all() when MaxScale shuts down, before the routing workers,
+ * so that no results are posted to workers that no longer exist.
+ */
+class ThreadPool
+{
+public:
+    using Task = std::function<void ()>;
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * Create a new pool
+     *
+     * @param n_threads Number of threads
+     */
+    ThreadPool(int n_threads);
+
+    /**
+     * Stops the pool
+     */
+    ~ThreadPool();
+
+    /**
+     * Execute a task in a thread of the pool
+     *
+     * @param task The task to execute
+     *
+     * @return True if the task was queued, false if the pool has been stopped
+     */
+    bool execute(Task task);
+
+    /**
+     * Stop the pool
+     *
+     * The tasks in progress are completed, the queued ones are discarded.
+     */
+    void stop();
+
+    /**
+     * Pass a result to a routing worker
+     *
+     * @param pWorker  The worker that executes @c callback, typically the value
+     *                 of mxb::Worker::get_current() when the task was submitted.
+     *                 If NULL, @c callback is executed in the calling thread.
+     * @param callback Function to execute
+     */
+    static void post(mxb::Worker* pWorker, Task callback);
+
+    /**
+     * Stop all pools, no tasks can be executed after this
+     *
+     * Called when MaxScale shuts down, before the routing workers are stopped.
+     */
+    static void stop_all();
+
+private:
+    void run();
+
+    std::mutex               m_lock;
+    std::condition_variable  m_cond;
+    std::vector<std::thread> m_threads;
+    std::deque<Task>         m_tasks;
+    const int                m_n_threads;
+    bool                     m_stop {false};
+};
+}
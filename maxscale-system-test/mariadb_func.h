@@ -327,6 +327,11 @@ public:
         return r.empty() ? std::string() : r[idx];
     }
 
+    MYSQL_STMT* stmt()
+    {
+        return mysql_stmt_init(m_conn);
+    }
+
     const char* error() const
     {
         return mysql_error(m_conn);
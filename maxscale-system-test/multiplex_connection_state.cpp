@@ -0,0 +1,68 @@
+/**
+ * Connection state with multiplex_connections
+ *
+ * Checks that a session keeps its backend connection while the next statement
+ * may depend on state that only lives on that connection: LAST_INSERT_ID() after
+ * an insert, FOUND_ROWS() after SQL_CALC_FOUND_ROWS, SHOW WARNINGS after a
+ * statement that caused warnings and named locks taken with GET_LOCK(). Another
+ * session runs queries between the statements so that any connection that was
+ * released to the pool is taken into use, and reset, by it.
+ */
+
+#include "testconnections.h"
+
+using namespace std;
+
+void test_state(TestConnections& test, Connection& c1, Connection& c2, bool found_rows)
+{
+    test.expect(c1.query("INSERT INTO test.mux (a) VALUES (1)"), "INSERT failed: %s", c1.error());
+    test.expect(c2.query("INSERT INTO test.mux (a) VALUES (2)"), "INSERT failed: %s", c2.error());
+    string id = c1.field("SELECT LAST_INSERT_ID()");
+    test.expect(id != "" && id != "0", "LAST_INSERT_ID() should not be reset: %s", id.c_str());
+
+    if (found_rows)
+    {
+        test.expect(c1.query("SELECT SQL_CALC_FOUND_ROWS * FROM test.mux LIMIT 1"),
+                    "SELECT failed: %s", c1.error());
+        c2.field("SELECT 1");
+        string rows = c1.field("SELECT FOUND_ROWS()");
+        test.expect(rows != "" && rows != "1", "FOUND_ROWS() should count all rows: %s", rows.c_str());
+    }
+
+    test.expect(c1.query("SELECT 1/0"), "SELECT failed: %s", c1.error());
+    c2.field("SELECT 1");
+    string code = c1.field("SHOW WARNINGS", 1);
+    test.expect(code == "1365", "SHOW WARNINGS should return the division by zero: %s", code.c_str());
+
+    test.expect(c1.field("SELECT GET_LOCK('mux_lock', 0)") == "1", "GET_LOCK() failed: %s", c1.error());
+    c2.field("SELECT 1");
+    test.expect(execute_query_check_one(test.repl->nodes[0], "SELECT IS_FREE_LOCK('mux_lock')", "0") == 0,
+                "The lock should still be held");
+    test.expect(c1.field("SELECT RELEASE_LOCK('mux_lock')") == "1",
+                "RELEASE_LOCK() should release the lock of the session: %s", c1.error());
+}
+
+int main(int argc, char* argv[])
+{
+    TestConnections test(argc, argv);
+    test.repl->connect();
+    execute_query(test.repl->nodes[0], "CREATE OR REPLACE TABLE test.mux (id INT AUTO_INCREMENT PRIMARY KEY, a INT)");
+    test.repl->sync_slaves();
+
+    test.tprintf("Testing readwritesplit");
+    Connection rw1 = test.maxscales->rwsplit();
+    Connection rw2 = test.maxscales->rwsplit();
+    test.expect(rw1.connect() && rw2.connect(), "Failed to connect to readwritesplit");
+    test_state(test, rw1, rw2, false);
+
+    test.tprintf("Testing readconnroute");
+    Connection rc1 = test.maxscales->readconn_master();
+    Connection rc2 = test.maxscales->readconn_master();
+    test.expect(rc1.connect() && rc2.connect(), "Failed to connect to readconnroute");
+    test_state(test, rc1, rc2, true);
+
+    execute_query(test.repl->nodes[0], "DROP TABLE test.mux");
+    test.repl->disconnect();
+
+    return test.global_result;
+}
@@ -0,0 +1,99 @@
+/**
+ * Lazy preparation and reuse of binary protocol prepared statements
+ *
+ * Prepares, executes and closes the same statements repeatedly with
+ * lazy_prepare=true and checks that the servers prepare them only once per
+ * connection. Also checks that the statements are routed correctly and that
+ * statements are not reused after the default database changes.
+ */
+
+#include "testconnections.h"
+
+using namespace std;
+
+int count_prepares(TestConnections& test)
+{
+    int total = 0;
+
+    for (int i = 0; i < test.repl->N; i++)
+    {
+        Row row = get_row(test.repl->nodes[i], "SHOW GLOBAL STATUS LIKE 'Com_stmt_prepare'");
+        test.expect(row.size() == 2, "Failed to read Com_stmt_prepare from node %d", i);
+
+        if (row.size() == 2)
+        {
+            total += atoi(row[1].c_str());
+        }
+    }
+
+    return total;
+}
+
+string execute(TestConnections& test, MYSQL* conn, const char* query)
+{
+    MYSQL_STMT* stmt = mysql_stmt_init(conn);
+    char buffer[100] = "";
+    my_bool err = false;
+    my_bool isnull = false;
+    MYSQL_BIND bind = {};
+
+    bind.buffer_type = MYSQL_TYPE_STRING;
+    bind.buffer_length = sizeof(buffer);
+    bind.buffer = buffer;
+    bind.error = &err;
+    bind.is_null = &isnull;
+
+    test.expect(mysql_stmt_prepare(stmt, query, strlen(query)) == 0,
+                "Failed to prepare: %s", mysql_stmt_error(stmt));
+    test.expect(mysql_stmt_execute(stmt) == 0, "Failed to execute: %s", mysql_stmt_error(stmt));
+    test.expect(mysql_stmt_bind_result(stmt, &bind) == 0, "Failed to bind result: %s", mysql_stmt_error(stmt));
+    test.expect(mysql_stmt_fetch(stmt) == 0, "Failed to fetch result: %s", mysql_stmt_error(stmt));
+    mysql_stmt_close(stmt);
+
+    return buffer;
+}
+
+int main(int argc, char** argv)
+{
+    TestConnections test(argc, argv);
+    test.repl->connect();
+    string master_id = to_string(test.repl->get_server_id(0));
+
+    test.maxscales->connect_rwsplit(0);
+    MYSQL* conn = test.maxscales->conn_rwsplit[0];
+    const char* write_query = "SELECT @@server_id, @@last_insert_id";
+    const char* read_query = "SELECT @@server_id";
+
+    test.tprintf("Prepare, execute and close the same statements repeatedly");
+    int before = count_prepares(test);
+
+    for (int i = 0; i < 100 && test.ok(); i++)
+    {
+        test.set_timeout(20);
+        string id = execute(test, conn, write_query);
+        test.expect(id == master_id, "Expected the master's server_id '%s', got '%s'",
+                    master_id.c_str(), id.c_str());
+        id = execute(test, conn, read_query);
+        test.expect(id != master_id, "Expected a slave server_id, got the master's '%s'", id.c_str());
+    }
+
+    test.stop_timeout();
+    int prepares = count_prepares(test) - before;
+    test.tprintf("Statements prepared on the servers: %d", prepares);
+    test.expect(prepares > 0 && prepares <= 4,
+                "Each statement should be prepared once on each connection, not %d times", prepares);
+
+    test.tprintf("Changing the default database closes the statements");
+    test.try_query(conn, "USE test");
+    before = count_prepares(test);
+    test.expect(execute(test, conn, write_query) == master_id, "Wrong result after USE");
+    test.expect(count_prepares(test) > before, "The statement should be prepared again after USE");
+
+    test.maxscales->close_rwsplit(0);
+    test.repl->disconnect();
+
+    test.log_excludes(0, "Closing unknown prepared statement");
+    test.log_excludes(0, "differs from master's response");
+
+    return test.global_result;
+}
@@ -0,0 +1,112 @@
+/**
+ * Moving sessions that keep buffers between workers
+ *
+ * Some busy connections make the loads of the routing threads uneven, so that
+ * the idle sessions are moved between the threads. The idle sessions have a
+ * session command history, retained statements and reusable prepared
+ * statements, all of which must be taken over by the new thread. The sessions
+ * must keep working after they have been moved and MaxScale must survive the
+ * closing of the moved sessions.
+ */
+
+#include "testconnections.h"
+#include <atomic>
+#include <thread>
+
+using namespace std;
+
+int sessions_moved(TestConnections& test)
+{
+    auto res = test.maxscales->ssh_output("maxctrl api get maxscale/threads "
+                                          "| grep -o 'sessions_moved_in\": *[0-9]*' "
+                                          "| awk -F: '{s += $2} END {print s + 0}'");
+    return atoi(res.second.c_str());
+}
+
+int main(int argc, char** argv)
+{
+    TestConnections test(argc, argv);
+    const int N_IDLE = 40;
+    const int N_BUSY = 4;
+
+    vector<Connection> idle;
+
+    for (int i = 0; i < N_IDLE; i++)
+    {
+        test.set_timeout(30);
+        idle.push_back(test.maxscales->rwsplit());
+        Connection& c = idle.back();
+        test.expect(c.connect(), "Connect should work: %s", c.error());
+
+        // Session commands that stay in the history
+        test.expect(c.query("SET @a = " + to_string(i)), "SET should work: %s", c.error());
+        test.expect(c.query("USE test"), "USE should work: %s", c.error());
+        test.expect(c.query("PREPARE ps FROM 'SELECT @a'"), "PREPARE should work: %s", c.error());
+
+        // A reusable binary protocol statement
+        MYSQL_STMT* stmt = c.stmt();
+        const char* query = "SELECT 1";
+        test.expect(mysql_stmt_prepare(stmt, query, strlen(query)) == 0,
+                    "Prepare should work: %s", mysql_stmt_error(stmt));
+        mysql_stmt_close(stmt);
+    }
+
+    test.stop_timeout();
+    test.tprintf("Generating uneven load");
+
+    std::atomic<bool> running {true};
+    vector<thread> busy;
+
+    for (int i = 0; i < N_BUSY; i++)
+    {
+        busy.emplace_back([&]() {
+                              Connection c = test.maxscales->rwsplit();
+                              c.connect();
+
+                              while (running)
+                              {
+                                  c.query("SELECT REPEAT('a', 100000)");
+                              }
+                          });
+    }
+
+    for (int round = 0; round < 30 && test.ok(); round++)
+    {
+        test.set_timeout(30);
+        sleep(1);
+
+        for (int i = 0; i < N_IDLE; i++)
+        {
+            Connection& c = idle[i];
+            auto row = c.row("EXECUTE ps");
+            test.expect(!row.empty() && row[0] == to_string(i),
+                        "Session %d should have kept its variable after being moved, got '%s': %s",
+                        i, row.empty() ? "" : row[0].c_str(), c.error());
+
+            row = c.row("SELECT DATABASE()");
+            test.expect(!row.empty() && row[0] == "test", "Session %d should have kept its database", i);
+        }
+    }
+
+    running = false;
+
+    for (auto& t : busy)
+    {
+        t.join();
+    }
+
+    test.stop_timeout();
+
+    int moved = sessions_moved(test);
+    test.tprintf("%d sessions were moved", moved);
+    test.expect(moved > 0, "Some sessions should have been moved");
+
+    test.tprintf("Closing the moved sessions");
+    test.maxscales->ssh_output("maxctrl list sessions");
+    idle.clear();
+    sleep(2);
+
+    test.check_maxscale_alive();
+
+    return test.global_result;
+}
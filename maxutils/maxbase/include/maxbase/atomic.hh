@@ -70,5 +70,21 @@ void store(T* t, R v, int mode = SEQ_CST)
 {
     __atomic_store_n(t, v, mode);
 }
+
+/**
+ * Perform atomic compare-and-exchange operation
+ *
+ * @param t         Variable to compare and exchange
+ * @param expected  The expected value, updated to the current value on failure
+ * @param desired   The value to store if @c t equals @c expected
+ * @param mode      Memory ordering
+ *
+ * @return True, if the value was exchanged
+ */
+template<class T, class R>
+bool compare_exchange(T* t, T* expected, R desired, int mode = SEQ_CST)
+{
+    return __atomic_compare_exchange_n(t, expected, desired, false, mode, __ATOMIC_RELAXED);
+}
 }
 }
@@ -13,6 +13,7 @@
 #pragma once
 
 #include <maxbase/ccdefs.hh>
+#include <atomic>
 #include <maxbase/poll.hh>
 
 namespace maxbase
@@ -105,7 +106,11 @@ public:
 
 /**
  * The class @c MessageQueue provides a cross thread message queue implemented
- * on top of a pipe.
+ * as a bounded lock-free multi-producer/single-consumer ring. The consumer,
+ * that is, the worker the queue has been added to, is woken up using an
+ * eventfd. The eventfd is written to only when the queue goes from idle to
+ * non-empty, so while the worker is processing messages, posting a message
+ * does not cause any system calls.
  */
 class MessageQueue : private mxb::PollData
 {
@@ -133,7 +138,7 @@ public:
     /**
      * Destructor
      *
-     * Removes itself If still added to a worker and closes the pipe.
+     * Removes itself If still added to a worker and closes the eventfd.
      */
     ~MessageQueue();
 
@@ -146,7 +151,8 @@ public:
      *
      * @return True if the message could be posted, false otherwise. Note that
      *         a return value of true only means that the message could successfully
-     *         be posted, not that it has reached the handler.
+     *         be posted, not that it has reached the handler. False is returned
+     *         if the queue remains full despite a few retries.
      *
      * @attention Note that the message queue must have been added to a worker
      *            before a message can be posted.
@@ -181,16 +187,35 @@ private:
     static void finish();
 
 private:
-    MessageQueue(Handler* pHandler, int read_fd, int write_fd);
+    struct Cell;
 
+    MessageQueue(Handler* pHandler, int event_fd, Cell* pCells);
+
+    bool     push(const Message& message) const;
+    bool     pop(Message* pMessage);
+    bool     empty() const;
+    void     signal() const;
     uint32_t handle_poll_events(Worker* pWorker, uint32_t events);
 
     static uint32_t poll_handler(MXB_POLL_DATA* pData, MXB_WORKER* worker, uint32_t events);
 
 private:
+    enum
+    {
+        CACHE_LINE_SIZE = 64
+    };
+
     Handler& m_handler;
-    int      m_read_fd;
-    int      m_write_fd;
+    int      m_event_fd;
     Worker*  m_pWorker;
+    Cell*    m_pCells;
+
+    // The producers and the consumer modify different members, so they are kept
+    // on different cache lines.
+    char                          m_pad1[CACHE_LINE_SIZE];
+    mutable std::atomic<uint64_t> m_tail;       // Next position to push to, shared by the producers.
+    mutable std::atomic<bool>     m_signaled;   // Whether the consumer has been, or is being, woken up.
+    char                          m_pad2[CACHE_LINE_SIZE];
+    uint64_t                      m_head;       // Next position to pop from, only used by the consumer.
 };
 }
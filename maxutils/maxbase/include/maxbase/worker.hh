@@ -16,11 +16,13 @@
 
 #include <array>
 #include <cstring>
+#include <deque>
 #include <functional>
 #include <map>
 #include <memory>
 #include <thread>
 #include <unordered_map>
+#include <vector>
 
 #include <maxbase/assert.h>
 #include <maxbase/atomic.h>
@@ -33,6 +35,8 @@
 namespace maxbase
 {
 
+class URing;
+
 struct WORKER_STATISTICS
 {
     enum
@@ -322,13 +326,21 @@ public:
         MAX_EVENTS = 1000
     };
 
+    enum poll_backend_t
+    {
+        POLL_BACKEND_EPOLL,     /**< Wait for events using epoll */
+        POLL_BACKEND_IO_URING   /**< Wait for events using io_uring */
+    };
+
     /**
      * Constructs a worker.
      *
      * @param max_events  The maximum number of events that can be returned by
      *                    one call to epoll_wait.
+     * @param backend     How to wait for events. If io_uring is requested but
+     *                    is not available, epoll is used.
      */
-    Worker(int max_events = MAX_EVENTS);
+    Worker(int max_events = MAX_EVENTS, poll_backend_t backend = POLL_BACKEND_EPOLL);
 
     virtual ~Worker();
 
@@ -349,6 +361,16 @@ public:
         return m_state;
     }
 
+    /**
+     * Returns how the worker waits for events.
+     *
+     * @return The poll backend actually in use.
+     */
+    poll_backend_t poll_backend() const
+    {
+        return m_pRing ? POLL_BACKEND_IO_URING : POLL_BACKEND_EPOLL;
+    }
+
     /**
      * Returns statistics for this worker.
      *
@@ -570,9 +592,9 @@ public:
      *            case the return value is ignored and the function will not
      *            be called again.
      */
-    uint32_t delayed_call(int32_t delay, bool (* pFunction)(Worker::Call::action_t action))
+    uint64_t delayed_call(int32_t delay, bool (* pFunction)(Worker::Call::action_t action))
     {
-        return add_delayed_call(new DelayedCallFunctionVoid(delay, next_delayed_call_id(), pFunction));
+        return add_delayed_call(new DelayedCallFunctionVoid(delay, pFunction));
     }
 
     /**
@@ -596,11 +618,11 @@ public:
      *            be called again.
      */
     template<class D>
-    uint32_t delayed_call(int32_t delay,
+    uint64_t delayed_call(int32_t delay,
                           bool (* pFunction)(Worker::Call::action_t action, D data),
                           D data)
     {
-        return add_delayed_call(new DelayedCallFunction<D>(delay, next_delayed_call_id(), pFunction, data));
+        return add_delayed_call(new DelayedCallFunction<D>(delay, pFunction, data));
     }
 
     /**
@@ -623,11 +645,11 @@ public:
      *            be called again.
      */
     template<class T>
-    uint32_t delayed_call(int32_t delay,
+    uint64_t delayed_call(int32_t delay,
                           bool (T::* pMethod)(Worker::Call::action_t action),
                           T* pT)
     {
-        return add_delayed_call(new DelayedCallMethodVoid<T>(delay, next_delayed_call_id(), pMethod, pT));
+        return add_delayed_call(new DelayedCallMethodVoid<T>(delay, pMethod, pT));
     }
 
     /**
@@ -651,16 +673,12 @@ public:
      *            be called again.
      */
     template<class T, class D>
-    uint32_t delayed_call(int32_t delay,
+    uint64_t delayed_call(int32_t delay,
                           bool (T::* pMethod)(Worker::Call::action_t action, D data),
                           T* pT,
                           D data)
     {
-        return add_delayed_call(new DelayedCallMethod<T, D>(delay,
-                                                            next_delayed_call_id(),
-                                                            pMethod,
-                                                            pT,
-                                                            data));
+        return add_delayed_call(new DelayedCallMethod<T, D>(delay, pMethod, pT, data));
     }
 
     /**
@@ -674,7 +692,7 @@ public:
      *
      * @return True, if the id represented an existing delayed call.
      */
-    bool cancel_delayed_call(uint32_t id);
+    bool cancel_delayed_call(uint64_t id);
 
 protected:
     const int m_epoll_fd;               /*< The epoll file descriptor. */
@@ -734,14 +752,6 @@ private:
     class DelayedCall;
     friend class DelayedCall;
 
-    uint32_t next_delayed_call_id()
-    {
-        // Called in single-thread context. Wrapping does not matter
-        // as it is unlikely there would be 4 billion pending delayed
-        // calls.
-        return ++m_next_delayed_call_id;
-    }
-
     class DelayedCall
     {
         DelayedCall(const DelayedCall&) = delete;
@@ -752,14 +762,18 @@ private:
         {
         }
 
+        // The delayed calls are allocated from a per-thread pool.
+        static void* operator new(size_t size);
+        static void  operator delete(void* pCall, size_t size);
+
         int32_t delay() const
         {
             return m_delay;
         }
 
-        uint32_t id() const
+        uint32_t index() const
         {
-            return m_id;
+            return m_index;
         }
 
         int64_t at() const
@@ -779,10 +793,13 @@ private:
         }
 
     protected:
-        DelayedCall(int32_t delay, int32_t id)
-            : m_id(id)
+        DelayedCall(int32_t delay)
+            : m_index(0)
             , m_delay(delay)
             , m_at(get_at(delay))
+            , m_pNext(nullptr)
+            , m_pPrev(nullptr)
+            , m_ppSlot(nullptr)
         {
             mxb_assert(delay > 0);
         }
@@ -802,9 +819,14 @@ private:
         }
 
     private:
-        uint32_t m_id;      // The id of the delayed call.
-        int32_t  m_delay;   // The delay in milliseconds.
-        int64_t  m_at;      // The next time the function should be invoked.
+        friend class Worker;
+
+        uint32_t      m_index;  // The index of the call in the handle table.
+        int32_t       m_delay;  // The delay in milliseconds.
+        int64_t       m_at;     // The next time the function should be invoked.
+        DelayedCall*  m_pNext;  // The next call in the same timing wheel slot.
+        DelayedCall*  m_pPrev;  // The previous call in the same timing wheel slot.
+        DelayedCall** m_ppSlot; // The timing wheel slot, NULL if not in the wheel.
     };
 
     template<class D>
@@ -815,10 +837,9 @@ private:
 
     public:
         DelayedCallFunction(int32_t delay,
-                            int32_t id,
                             bool (*pFunction)(Worker::Call::action_t action, D data),
                             D data)
-            : DelayedCall(delay, id)
+            : DelayedCall(delay)
             , m_pFunction(pFunction)
             , m_data(data)
         {
@@ -843,9 +864,8 @@ private:
 
     public:
         DelayedCallFunctionVoid(int32_t delay,
-                                int32_t id,
                                 bool (*pFunction)(Worker::Call::action_t action))
-            : DelayedCall(delay, id)
+            : DelayedCall(delay)
             , m_pFunction(pFunction)
         {
         }
@@ -868,11 +888,10 @@ private:
 
     public:
         DelayedCallMethod(int32_t delay,
-                          int32_t id,
                           bool (T::* pMethod)(Worker::Call::action_t action, D data),
                           T* pT,
                           D data)
-            : DelayedCall(delay, id)
+            : DelayedCall(delay)
             , m_pMethod(pMethod)
             , m_pT(pT)
             , m_data(data)
@@ -899,10 +918,9 @@ private:
 
     public:
         DelayedCallMethodVoid(int32_t delay,
-                              int32_t id,
                               bool (T::* pMethod)(Worker::Call::action_t),
                               T* pT)
-            : DelayedCall(delay, id)
+            : DelayedCall(delay)
             , m_pMethod(pMethod)
             , m_pT(pT)
         {
@@ -919,8 +937,13 @@ private:
         T* m_pT;
     };
 
-    uint32_t add_delayed_call(DelayedCall* pDelayed_call);
-    void     adjust_timer();
+    uint64_t add_delayed_call(DelayedCall* pDelayed_call);
+    void     adjust_timer(int64_t now);
+
+    void    wheel_add(DelayedCall* pCall);
+    void    wheel_remove(DelayedCall* pCall);
+    void    wheel_cascade(int level, int64_t now);
+    int64_t wheel_next_event() const;
 
     void handle_message(MessageQueue& queue, const MessageQueue::Message& msg);     // override
 
@@ -930,35 +953,53 @@ private:
 
     void tick();
 private:
-    class LaterAt : public std::binary_function<const DelayedCall*, const DelayedCall*, bool>
+    void run(mxb::Semaphore* pSem);
+
+    typedef DelegatingTimer<Worker> PrivateTimer;
+
+    /**
+     * The delayed calls are kept in a hierarchical timing wheel. Level 0 has
+     * one slot per millisecond and each higher level has slots that are 256
+     * times longer than the level below, so four levels cover every possible
+     * delay. When the wheel reaches a slot of a higher level, the calls in it
+     * are moved to the lower levels. Adding and removing a call is O(1).
+     */
+    enum
     {
-    public:
-        bool operator()(const DelayedCall* pLhs, const DelayedCall* pRhs)
-        {
-            return pLhs->at() > pRhs->at();
-        }
+        WHEEL_BITS   = 8,
+        WHEEL_SIZE   = 1 << WHEEL_BITS,
+        WHEEL_MASK   = WHEEL_SIZE - 1,
+        WHEEL_LEVELS = 4
     };
 
-    void run(mxb::Semaphore* pSem);
+    // The id of a delayed call is an index into this table combined with the
+    // generation of the entry, so that the call can be found without a lookup.
+    // The generation is bumped each time the entry is taken into use, so a
+    // stale id does not match the call that later reuses the entry.
+    struct CallHandle
+    {
+        DelayedCall* pCall;
+        uint32_t     generation;
+    };
 
-    typedef DelegatingTimer<Worker>                    PrivateTimer;
-    typedef std::multimap<int64_t, DelayedCall*>       DelayedCallsByTime;
-    typedef std::unordered_map<uint32_t, DelayedCall*> DelayedCallsById;
-
-    uint32_t           m_max_events;            /*< Maximum numer of events in each epoll_wait call. */
-    STATISTICS         m_statistics;            /*< Worker statistics. */
-    MessageQueue*      m_pQueue;                /*< The message queue of the worker. */
-    std::thread        m_thread;                /*< The thread object of the worker. */
-    bool               m_started;               /*< Whether the thread has been started or not. */
-    bool               m_should_shutdown;       /*< Whether shutdown should be performed. */
-    bool               m_shutdown_initiated;    /*< Whether shutdown has been initated. */
-    uint32_t           m_nCurrent_descriptors;  /*< Current number of descriptors. */
-    uint64_t           m_nTotal_descriptors;    /*< Total number of descriptors. */
-    Load               m_load;                  /*< The worker load. */
-    PrivateTimer*      m_pTimer;                /*< The worker's own timer. */
-    DelayedCallsByTime m_sorted_calls;          /*< Current delayed calls sorted by time. */
-    DelayedCallsById   m_calls;                 /*< Current delayed calls indexed by id. */
-
-    int32_t m_next_delayed_call_id;     /*< The next delayed call id. */
+    uint32_t                  m_max_events;                      /*< Maximum numer of events in each epoll_wait call. */
+    URing*                    m_pRing;                           /*< The io_uring backend, NULL if epoll is used. */
+    STATISTICS                m_statistics;                      /*< Worker statistics. */
+    MessageQueue*             m_pQueue;                          /*< The message queue of the worker. */
+    std::thread               m_thread;                          /*< The thread object of the worker. */
+    bool                      m_started;                         /*< Whether the thread has been started or not. */
+    bool                      m_should_shutdown;                 /*< Whether shutdown should be performed. */
+    bool                      m_shutdown_initiated;              /*< Whether shutdown has been initated. */
+    uint32_t                  m_nCurrent_descriptors;            /*< Current number of descriptors. */
+    uint64_t                  m_nTotal_descriptors;              /*< Total number of descriptors. */
+    Load                      m_load;                            /*< The worker load. */
+    PrivateTimer*             m_pTimer;                          /*< The worker's own timer. */
+    DelayedCall*              m_wheel[WHEEL_LEVELS][WHEEL_SIZE]; /*< The timing wheel. */
+    uint32_t                  m_wheel_count[WHEEL_LEVELS];       /*< Number of calls on each level. */
+    int64_t                   m_wheel_time;                      /*< The next millisecond the wheel will process. */
+    int64_t                   m_timer_at;                        /*< When the timer will fire, 0 if not armed. */
+    std::vector<DelayedCall*> m_repeating_calls;                 /*< Calls to be added back after a tick. */
+    std::vector<CallHandle>   m_call_handles;                    /*< Delayed calls indexed by id. */
+    std::deque<uint32_t>      m_free_handles;                    /*< Free indexes of m_call_handles, oldest first. */
 };
 }
@@ -13,10 +13,10 @@
 
 #include <maxbase/messagequeue.hh>
 #include <errno.h>
-#include <fcntl.h>
+#include <sched.h>
 #include <string.h>
 #include <unistd.h>
-#include <fstream>
+#include <sys/eventfd.h>
 #include <maxbase/assert.h>
 #include <maxbase/log.h>
 #include <maxbase/string.h>
@@ -25,53 +25,66 @@
 namespace
 {
 
+/**
+ * The number of messages a queue can hold. Must be a power of two. With 32 bytes
+ * per cell, a queue takes 1MB, the same as a pipe buffer of the default maximum
+ * size (fs.pipe-max-size).
+ */
+const uint64_t QUEUE_CAPACITY = 32768;
+const uint64_t QUEUE_MASK = QUEUE_CAPACITY - 1;
+
 static struct
 {
     bool initialized;
-    int  pipe_max_size;
 } this_unit =
 {
     false
 };
-
-int get_pipe_max_size()
-{
-    int size = 65536;   // Default value from pipe(7)
-    std::ifstream file("/proc/sys/fs/pipe-max-size");
-
-    if (file.good())
-    {
-        file >> size;
-    }
-
-    return size;
-}
 }
 
 namespace maxbase
 {
 
-MessageQueue::MessageQueue(Handler* pHandler, int read_fd, int write_fd)
+/**
+ * A slot in the ring. The sequence number tells whether the cell is free to be
+ * pushed to at a particular position or whether it contains a message that can
+ * be popped. See "Bounded MPMC queue" by Dmitry Vyukov.
+ */
+struct MessageQueue::Cell
+{
+    std::atomic<uint64_t> seq;
+    Message               message;
+};
+
+MessageQueue::MessageQueue(Handler* pHandler, int event_fd, Cell* pCells)
     : mxb::PollData(&MessageQueue::poll_handler)
     , m_handler(*pHandler)
-    , m_read_fd(read_fd)
-    , m_write_fd(write_fd)
+    , m_event_fd(event_fd)
     , m_pWorker(NULL)
+    , m_pCells(pCells)
+    , m_tail(0)
+    , m_signaled(false)
+    , m_head(0)
 {
     mxb_assert(pHandler);
-    mxb_assert(read_fd);
-    mxb_assert(write_fd);
+    mxb_assert(event_fd != -1);
+    mxb_assert(pCells);
+
+    for (uint64_t i = 0; i < QUEUE_CAPACITY; ++i)
+    {
+        m_pCells[i].seq.store(i, std::memory_order_relaxed);
+    }
 }
 
 MessageQueue::~MessageQueue()
 {
     if (m_pWorker)
     {
-        m_pWorker->remove_fd(m_read_fd);
+        m_pWorker->remove_fd(m_event_fd);
     }
 
-    close(m_read_fd);
-    close(m_write_fd);
+    close(m_event_fd);
+    delete [] m_pCells;
 }
 
 // static
@@ -80,7 +93,6 @@ bool MessageQueue::init()
     mxb_assert(!this_unit.initialized);
 
     this_unit.initialized = true;
-    this_unit.pipe_max_size = get_pipe_max_size();
 
     return this_unit.initialized;
 }
@@ -97,78 +109,116 @@ MessageQueue* MessageQueue::create(Handler* pHandler)
 {
     mxb_assert(this_unit.initialized);
 
-    /* From "man 7 pipe"
-     * ----
-     *
-     * O_NONBLOCK enabled, n <= PIPE_BUF
-     *   If  there  is room to write n bytes to the pipe, then write(2)
-     *   succeeds immediately, writing all n bytes; otherwise write(2)
-     *   fails, with errno set to EAGAIN.
-     *
-     * ... (On Linux, PIPE_BUF is 4096 bytes.)
-     *
-     * ----
-     *
-     * As O_NONBLOCK is set and the messages are less than 4096 bytes,
-     * O_DIRECT should not be needed and we should be safe without it.
-     *
-     * However, to be in the safe side, we first try whether it is supported,
-     * and if not, we create the pipe without O_DIRECT.
-     */
-
     MessageQueue* pThis = NULL;
 
-    int fds[2];
-
-    int rv = pipe2(fds, O_NONBLOCK | O_CLOEXEC | O_DIRECT);
+    int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
 
-    if ((rv != 0) && (errno == EINVAL))
+    if (fd != -1)
     {
-        // Ok, apparently the kernel does not support O_DIRECT. Let's try without.
-        rv = pipe2(fds, O_NONBLOCK | O_CLOEXEC);
+        Cell* pCells = new(std::nothrow) Cell[QUEUE_CAPACITY];
 
-        if (rv == 0)
+        if (pCells)
         {
-            // Succeeded, so apparently it was the missing support for O_DIRECT.
-            MXB_WARNING("Platform does not support O_DIRECT in conjunction with pipes, "
-                        "using without.");
-        }
-    }
+            pThis = new(std::nothrow) MessageQueue(pHandler, fd, pCells);
 
-    if (rv == 0)
-    {
-        int read_fd = fds[0];
-        int write_fd = fds[1];
-#ifdef F_SETPIPE_SZ
-        /**
-         * Increase the pipe buffer size on systems that support it. Modifying
-         * the buffer size of one fd will also increase it for the other.
-         */
-        if (fcntl(fds[0], F_SETPIPE_SZ, this_unit.pipe_max_size) == -1)
-        {
-            MXB_WARNING("Failed to increase pipe buffer size to '%d': %d, %s",
-                        this_unit.pipe_max_size,
-                        errno,
-                        mxb_strerror(errno));
+            if (!pThis)
+            {
+                delete [] pCells;
+            }
         }
-#endif
-        pThis = new(std::nothrow) MessageQueue(pHandler, read_fd, write_fd);
 
         if (!pThis)
         {
             MXB_OOM();
-            close(read_fd);
-            close(write_fd);
+            close(fd);
         }
     }
     else
     {
-        MXB_ERROR("Could not create pipe for worker: %s", mxb_strerror(errno));
+        MXB_ERROR("Could not create eventfd for worker: %s", mxb_strerror(errno));
     }
 
     return pThis;
 }
 
+bool MessageQueue::push(const Message& message) const
+{
+    uint64_t pos = m_tail.load(std::memory_order_relaxed);
+    Cell* pCell;
+
+    while (true)
+    {
+        pCell = &m_pCells[pos & QUEUE_MASK];
+        uint64_t seq = pCell->seq.load(std::memory_order_acquire);
+        int64_t diff = (int64_t)seq - (int64_t)pos;
+
+        if (diff == 0)
+        {
+            if (m_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            // The cell still holds the message pushed one lap ago, the queue is full.
+            return false;
+        }
+        else
+        {
+            pos = m_tail.load(std::memory_order_relaxed);
+        }
+    }
+
+    pCell->message = message;
+    pCell->seq.store(pos + 1, std::memory_order_release);
+
+    return true;
+}
+
+bool MessageQueue::pop(Message* pMessage)
+{
+    Cell* pCell = &m_pCells[m_head & QUEUE_MASK];
+
+    if (pCell->seq.load(std::memory_order_acquire) != m_head + 1)
+    {
+        // Empty, or the producer that claimed the cell has not yet stored the message.
+        // In the latter case the producer will signal once it has.
+        return false;
+    }
+
+    *pMessage = pCell->message;
+    pCell->seq.store(m_head + QUEUE_CAPACITY, std::memory_order_release);
+    ++m_head;
+
+    return true;
+}
+
+bool MessageQueue::empty() const
+{
+    const Cell* pCell = &m_pCells[m_head & QUEUE_MASK];
+
+    return pCell->seq.load(std::memory_order_acquire) != m_head + 1;
+}
+
+void MessageQueue::signal() const
+{
+    // The fence pairs with the one in handle_poll_events(). Either the consumer sees
+    // the message that was just pushed or we see that it has cleared m_signaled.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if (!m_signaled.load(std::memory_order_relaxed) && !m_signaled.exchange(true))
+    {
+        uint64_t one = 1;
+
+        if (write(m_event_fd, &one, sizeof(one)) != sizeof(one))
+        {
+            m_signaled.store(false);
+            MXB_ERROR("Failed to signal message queue: %d, %s", errno, mxb_strerror(errno));
+        }
+    }
+}
+
 bool MessageQueue::post(const Message& message) const
 {
     // NOTE: No logging here, this function must be signal safe.
@@ -178,56 +228,39 @@ bool MessageQueue::post(const Message& message) const
     if (m_pWorker)
     {
         /**
-         * This is a stopgap measure to solve MXS-1983 that causes Resource temporarily
-         * unavailable errors. The errors are caused by the pipe buffer being too small to
-         * hold all worker messages. By retrying a limited number of times before giving
-         * up, the success rate for posted messages under heavy load increases
-         * significantly.
+         * If the queue is full, we retry a limited number of times before giving up,
+         * so that a burst of messages, e.g. broadcasts under heavy load, does not
+         * immediately cause failures. See MXS-1983.
          */
         int fast = 0;
         int slow = 0;
         const int fast_size = 100;
         const int slow_limit = 3;
-        ssize_t n;
 
-        while (true)
+        while (!(rv = push(message)))
         {
-            n = write(m_write_fd, &message, sizeof(message));
-            rv = (n == sizeof(message));
-
-            if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            if (++fast > fast_size)
             {
-                if (++fast > fast_size)
+                fast = 0;
+
+                if (++slow >= slow_limit)
                 {
-                    fast = 0;
-
-                    if (++slow >= slow_limit)
-                    {
-                        break;
-                    }
-                    else
-                    {
-                        sched_yield();
-                    }
+                    break;
+                }
+                else
+                {
+                    sched_yield();
                 }
-            }
-            else
-            {
-                break;
             }
         }
 
-        if (n == -1)
+        if (rv)
         {
-            MXB_ERROR("Failed to write message: %d, %s", errno, mxb_strerror(errno));
-
-            static bool warn_pipe_buffer_size = true;
-
-            if ((errno == EAGAIN || errno == EWOULDBLOCK) && warn_pipe_buffer_size)
-            {
-                MXB_ERROR("Consider increasing pipe buffer size (sysctl fs.pipe-max-size)");
-                warn_pipe_buffer_size = false;
-            }
+            signal();
+        }
+        else
+        {
+            MXB_ERROR("Failed to post message, the message queue of the worker is full.");
         }
     }
     else
@@ -242,11 +275,11 @@ bool MessageQueue::add_to_worker(Worker* pWorker)
 {
     if (m_pWorker)
     {
-        m_pWorker->remove_fd(m_read_fd);
+        m_pWorker->remove_fd(m_event_fd);
         m_pWorker = NULL;
     }
 
-    if (pWorker->add_fd(m_read_fd, EPOLLIN, this))
+    if (pWorker->add_fd(m_event_fd, EPOLLIN, this))
     {
         m_pWorker = pWorker;
     }
@@ -260,7 +293,7 @@ Worker* MessageQueue::remove_from_worker()
 
     if (m_pWorker)
     {
-        m_pWorker->remove_fd(m_read_fd);
+        m_pWorker->remove_fd(m_event_fd);
         m_pWorker = NULL;
     }
 
@@ -278,39 +311,32 @@ uint32_t MessageQueue::handle_poll_events(Worker* pWorker, uint32_t events)
 
     if (events & EPOLLIN)
     {
-        Message message;
+        uint64_t count;
 
-        ssize_t n;
+        if (read(m_event_fd, &count, sizeof(count)) == -1 && errno != EAGAIN)
+        {
+            MXB_ERROR("Worker could not read from eventfd: %s", mxb_strerror(errno));
+        }
+
+        Message message;
 
         do
         {
-            n = read(m_read_fd, &message, sizeof(message));
-
-            if (n == sizeof(message))
+            // As long as m_signaled is set, the producers will not write to the
+            // eventfd, so messages posted while we are busy cost no system calls.
+            while (pop(&message))
             {
                 m_handler.handle_message(*this, message);
             }
-            else if (n == -1)
-            {
-                if (errno != EWOULDBLOCK)
-                {
-                    MXB_ERROR("Worker could not read from pipe: %s", mxb_strerror(errno));
-                }
-            }
-            else if (n != 0)
-            {
-                // This really should not happen as the pipe is in message mode. We
-                // should either get a message, nothing at all or an error. In non-debug
-                // mode we continue reading in order to empty the pipe as otherwise the
-                // thread may hang.
-                MXB_ERROR("MessageQueue could only read %ld bytes from pipe, although "
-                          "expected %lu bytes.",
-                          n,
-                          sizeof(message));
-                mxb_assert(!true);
-            }
+
+            m_signaled.store(false);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            // If something arrived after the queue was found to be empty and the
+            // producer has not yet seen m_signaled cleared, we continue. Otherwise
+            // the producer has signaled and we will be called again.
         }
-        while ((n != 0) && (n != -1));
+        while (!empty() && !m_signaled.exchange(true));
 
         rc = MXB_POLL_READ;
     }
@@ -0,0 +1,223 @@
+/*
+ * Copyright (c) 2018 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2022-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include <maxbase/assert.h>
+#include <maxbase/maxbase.hh>
+#include <maxbase/messagequeue.hh>
+#include <maxbase/semaphore.hh>
+#include <maxbase/worker.hh>
+
+using namespace maxbase;
+using namespace std;
+
+namespace
+{
+
+class Counter : public MessageQueue::Handler
+{
+public:
+    Counter(int nProducers)
+        : m_next(nProducers, 0)
+        , m_received(0)
+        , m_errors(0)
+    {
+    }
+
+    void handle_message(MessageQueue& queue, const MessageQueue::Message& message) override
+    {
+        // Messages of one producer must arrive in the order they were posted.
+        if (message.arg1() != m_next[message.id()])
+        {
+            cout << "error: Producer " << message.id() << " expected " << m_next[message.id()]
+                 << ", got " << message.arg1() << "." << endl;
+            ++m_errors;
+        }
+
+        m_next[message.id()] = message.arg1() + 1;
+        m_received.fetch_add(1, std::memory_order_release);
+    }
+
+    int64_t received() const
+    {
+        return m_received.load(std::memory_order_acquire);
+    }
+
+    int errors() const
+    {
+        return m_errors;
+    }
+
+private:
+    vector<intptr_t>     m_next;
+    std::atomic<int64_t> m_received;
+    int                  m_errors;
+};
+
+bool wait_for(const Counter& counter, int64_t n)
+{
+    // At most 30 seconds.
+    for (int i = 0; i < 30000 && counter.received() < n; ++i)
+    {
+        usleep(1000);
+    }
+
+    return counter.received() == n;
+}
+
+int test_producers(Worker& worker, int nProducers, int nMessages)
+{
+    int rv = 0;
+    Counter counter(nProducers);
+    MessageQueue* pQueue = MessageQueue::create(&counter);
+    mxb_assert(pQueue);
+
+    worker.call([&]() {
+                    pQueue->add_to_worker(&worker);
+                }, Worker::EXECUTE_AUTO);
+
+    std::atomic<int> nFailed(0);
+    vector<thread> producers;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < nProducers; ++i)
+    {
+        producers.emplace_back([&, i]() {
+                                   for (int j = 0; j < nMessages; ++j)
+                                   {
+                                       MessageQueue::Message message(i, j);
+
+                                       // The queue may be full, so we retry until the message gets through.
+                                       while (!pQueue->post(message))
+                                       {
+                                           nFailed.fetch_add(1);
+                                           sched_yield();
+                                       }
+                                   }
+                               });
+    }
+
+    for (auto& t : producers)
+    {
+        t.join();
+    }
+
+    int64_t expected = (int64_t)nProducers * nMessages;
+
+    if (!wait_for(counter, expected))
+    {
+        cout << "error: Expected " << expected << " messages, got " << counter.received() << "." << endl;
+        rv = 1;
+    }
+
+    std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+
+    if (counter.errors() != 0)
+    {
+        rv = 1;
+    }
+
+    cout << setw(2) << nProducers << " producers: " << expected << " messages in "
+         << fixed << setprecision(3) << secs.count() << "s, "
+         << setprecision(0) << expected / secs.count() << " messages/s, "
+         << nFailed.load() << " posts found the queue full." << endl;
+
+    worker.call([&]() {
+                    pQueue->remove_from_worker();
+                }, Worker::EXECUTE_AUTO);
+    delete pQueue;
+
+    return rv;
+}
+
+int test_full(Worker& worker)
+{
+    int rv = 0;
+    Counter counter(1);
+    MessageQueue* pQueue = MessageQueue::create(&counter);
+    mxb_assert(pQueue);
+
+    worker.call([&]() {
+                    pQueue->add_to_worker(&worker);
+                }, Worker::EXECUTE_AUTO);
+
+    // Block the worker so that the queue cannot be emptied.
+    Semaphore blocked;
+    Semaphore release;
+    worker.execute([&]() {
+                       blocked.post();
+                       release.wait();
+                   }, Worker::EXECUTE_QUEUED);
+    blocked.wait();
+
+    int nPosted = 0;
+
+    while (pQueue->post(MessageQueue::Message(0, nPosted)))
+    {
+        ++nPosted;
+    }
+
+    cout << "Queue became full after " << nPosted << " messages." << endl;
+
+    release.post();
+
+    if (!wait_for(counter, nPosted) || counter.errors() != 0)
+    {
+        cout << "error: Expected " << nPosted << " messages, got " << counter.received() << "." << endl;
+        rv = 1;
+    }
+
+    // Once emptied, the queue must again accept messages.
+    if (!pQueue->post(MessageQueue::Message(0, nPosted)) || !wait_for(counter, nPosted + 1))
+    {
+        cout << "error: Could not post to a queue that had been full." << endl;
+        rv = 1;
+    }
+
+    worker.call([&]() {
+                    pQueue->remove_from_worker();
+                }, Worker::EXECUTE_AUTO);
+    delete pQueue;
+
+    return rv;
+}
+}
+
+int main(int argc, char* argv[])
+{
+    int nMessages = argc > 1 ? atoi(argv[1]) : 200000;
+
+    mxb::MaxBase mxb(MXB_LOG_TARGET_STDOUT);
+
+    Worker worker;
+    worker.start();
+
+    int rv = 0;
+
+    rv += test_producers(worker, 1, nMessages);
+    rv += test_producers(worker, 4, nMessages);
+    rv += test_producers(worker, 16, nMessages / 4);
+    rv += test_full(worker);
+
+    worker.shutdown();
+    worker.join();
+
+    return rv == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
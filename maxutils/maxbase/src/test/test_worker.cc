@@ -12,6 +12,8 @@
  */
 
 #include <iostream>
+#include <set>
+#include <vector>
 #include <maxbase/assert.h>
 #include <maxbase/maxbase.hh>
 #include <maxbase/worker.hh>
@@ -94,6 +96,284 @@ private:
 int TimerTest::s_id = 1;
 int TimerTest::s_ticks;
 
+/**
+ * A large number of one-shot calls with different delays, half of which
+ * are cancelled before they are due.
+ */
+class ManyCalls
+{
+public:
+    ManyCalls(Worker* pWorker, int n)
+        : m_worker(*pWorker)
+        , m_at(n)
+        , m_ids(n)
+        , m_state(n, PENDING)
+        , m_nPending(n)
+        , m_rv(EXIT_SUCCESS)
+    {
+    }
+
+    void start()
+    {
+        int n = m_at.size();
+        int64_t now = get_monotonic_time_ms();
+
+        for (int i = 0; i < n; ++i)
+        {
+            // Spread over 3 seconds, so that several levels of the wheel are used.
+            int32_t delay = 1 + (i * 7919) % 3000;
+
+            m_at[i] = now + delay;
+            m_ids[i] = m_worker.delayed_call(delay, &ManyCalls::call, this, i);
+        }
+
+        for (int i = 0; i < n; i += 2)
+        {
+            if (!m_worker.cancel_delayed_call(m_ids[i]))
+            {
+                cout << "Error: Could not cancel delayed call " << i << endl;
+                m_rv = EXIT_FAILURE;
+            }
+        }
+
+        if (m_nPending == 0)
+        {
+            m_worker.shutdown();
+        }
+    }
+
+    int rv() const
+    {
+        return m_rv;
+    }
+
+private:
+    enum state_t
+    {
+        PENDING,
+        EXECUTED,
+        CANCELLED
+    };
+
+    bool call(Worker::Call::action_t action, int i)
+    {
+        if (m_state[i] != PENDING)
+        {
+            cout << "Error: Delayed call " << i << " invoked twice." << endl;
+            m_rv = EXIT_FAILURE;
+        }
+        else if (action == Worker::Call::CANCEL)
+        {
+            if (i % 2 != 0)
+            {
+                cout << "Error: Delayed call " << i << " cancelled." << endl;
+                m_rv = EXIT_FAILURE;
+            }
+
+            m_state[i] = CANCELLED;
+        }
+        else
+        {
+            int64_t diff = get_monotonic_time_ms() - m_at[i];
+
+            if (i % 2 == 0 || diff < 0 || diff > 50)
+            {
+                cout << "Error: Delayed call " << i << " executed, difference: " << diff << endl;
+                m_rv = EXIT_FAILURE;
+            }
+
+            m_state[i] = EXECUTED;
+        }
+
+        if (--m_nPending == 0)
+        {
+            m_worker.shutdown();
+        }
+
+        return false;
+    }
+
+    Worker&          m_worker;
+    vector<int64_t>  m_at;
+    vector<uint64_t> m_ids;
+    vector<state_t>  m_state;
+    int              m_nPending;
+    int              m_rv;
+};
+
+int run_many()
+{
+    Worker w;
+    ManyCalls calls(&w, 20000);
+
+    w.execute([&calls]() {
+                  calls.start();
+              }, Worker::EXECUTE_QUEUED);
+
+    w.run();
+
+    return calls.rv();
+}
+
+/**
+ * Calls that are far enough in the future to be placed on levels 2 and 3 of
+ * the timing wheel. One of them is allowed to fire, which requires the wheel
+ * to cascade it down through all lower levels.
+ */
+class FarCalls
+{
+public:
+    enum
+    {
+        DUE_DELAY       = 66 * 1000,            // Level 2, fires.
+        CANCELLED_DELAY = 70 * 1000,            // Level 2, cancelled when on level 1.
+        CANCEL_AT       = 69 * 1000,
+        DISTANT_DELAY   = 5 * 60 * 60 * 1000,   // Level 3, cancelled at the end.
+    };
+
+    FarCalls(Worker* pWorker)
+        : m_worker(*pWorker)
+        , m_at(0)
+        , m_cancelled_id(0)
+        , m_distant_id(0)
+        , m_fired(0)
+        , m_rv(EXIT_SUCCESS)
+    {
+    }
+
+    void start()
+    {
+        m_at = get_monotonic_time_ms() + DUE_DELAY;
+
+        m_worker.delayed_call(DUE_DELAY, &FarCalls::due, this);
+        m_cancelled_id = m_worker.delayed_call(CANCELLED_DELAY, &FarCalls::not_due, this);
+        m_distant_id = m_worker.delayed_call(DISTANT_DELAY, &FarCalls::not_due, this);
+        m_worker.delayed_call(CANCEL_AT, &FarCalls::cancel, this);
+    }
+
+    int rv() const
+    {
+        return m_rv;
+    }
+
+private:
+    bool due(Worker::Call::action_t action)
+    {
+        if (action == Worker::Call::EXECUTE)
+        {
+            int64_t diff = get_monotonic_time_ms() - m_at;
+
+            cout << "Far call fired, difference: " << diff << endl;
+
+            if (diff < 0 || diff > 50)
+            {
+                cout << "Error: Far call fired at the wrong time: " << diff << endl;
+                m_rv = EXIT_FAILURE;
+            }
+
+            ++m_fired;
+        }
+
+        return false;
+    }
+
+    bool not_due(Worker::Call::action_t action)
+    {
+        if (action == Worker::Call::EXECUTE)
+        {
+            cout << "Error: A far call that should have been cancelled was executed." << endl;
+            m_rv = EXIT_FAILURE;
+        }
+
+        return false;
+    }
+
+    bool cancel(Worker::Call::action_t action)
+    {
+        if (action == Worker::Call::EXECUTE)
+        {
+            if (m_fired != 1)
+            {
+                cout << "Error: The far call fired " << m_fired << " times." << endl;
+                m_rv = EXIT_FAILURE;
+            }
+
+            if (!m_worker.cancel_delayed_call(m_cancelled_id)
+                || !m_worker.cancel_delayed_call(m_distant_id))
+            {
+                cout << "Error: Could not cancel far calls." << endl;
+                m_rv = EXIT_FAILURE;
+            }
+
+            m_worker.shutdown();
+        }
+
+        return false;
+    }
+
+    Worker&  m_worker;
+    int64_t  m_at;
+    uint64_t m_cancelled_id;
+    uint64_t m_distant_id;
+    int      m_fired;
+    int      m_rv;
+};
+
+int run_far()
+{
+    Worker w;
+    FarCalls calls(&w);
+
+    w.execute([&calls]() {
+                  calls.start();
+              }, Worker::EXECUTE_QUEUED);
+
+    w.run();
+
+    return calls.rv();
+}
+
+bool never_called(Worker::Call::action_t action)
+{
+    mxb_assert(action == Worker::Call::CANCEL);
+    return false;
+}
+
+/**
+ * The handle of a cancelled call is reused by the next one, but the id
+ * must still be different each time.
+ */
+int run_reuse()
+{
+    int rv = EXIT_SUCCESS;
+    Worker w;
+
+    w.execute([&w, &rv]() {
+                  set<uint64_t> ids;
+                  const int N = 100000;
+
+                  for (int i = 0; i < N; ++i)
+                  {
+                      uint64_t id = w.delayed_call(1000, never_called);
+
+                      if (!ids.insert(id).second)
+                      {
+                          cout << "Error: Delayed call id " << id << " reused after " << i << " calls." << endl;
+                          rv = EXIT_FAILURE;
+                          break;
+                      }
+
+                      w.cancel_delayed_call(id);
+                  }
+
+                  w.shutdown();
+              }, Worker::EXECUTE_QUEUED);
+
+    w.run();
+
+    return rv;
+}
+
 int run()
 {
     int rv = EXIT_SUCCESS;
@@ -120,9 +400,31 @@ int run()
 }
 }
 
-int main()
+int main(int argc, char* argv[])
 {
     mxb::MaxBase mxb(MXB_LOG_TARGET_STDOUT);
 
-    return run();
+    int rv;
+
+    if (argc > 1 && strcmp(argv[1], "far") == 0)
+    {
+        // Takes over a minute, so it is run as a test of its own.
+        rv = run_far();
+    }
+    else
+    {
+        rv = run();
+
+        if (rv == EXIT_SUCCESS)
+        {
+            rv = run_many();
+        }
+
+        if (rv == EXIT_SUCCESS)
+        {
+            rv = run_reuse();
+        }
+    }
+
+    return rv;
 }
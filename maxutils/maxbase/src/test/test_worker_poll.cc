@@ -0,0 +1,338 @@
+/*
+ * Copyright (c) 2018 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2022-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+/**
+ * Runs an echo server in a worker and measures the round trips a client
+ * gets through over loopback, first with epoll and then with io_uring.
+ *
+ * Usage: test_worker_poll [rounds] [connections]
+ */
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <maxbase/assert.h>
+#include <maxbase/maxbase.hh>
+#include <maxbase/worker.hh>
+
+using namespace maxbase;
+using namespace std;
+
+namespace
+{
+
+const int MESSAGE_SIZE = 64;
+
+class TestWorker : public Worker
+{
+public:
+    TestWorker(poll_backend_t backend)
+        : Worker(MAX_EVENTS, backend)
+    {
+    }
+
+    // Like the listening sockets of MaxScale, added level-triggered directly
+    // to the epoll instance.
+    bool add_level_triggered_fd(int fd, MXB_POLL_DATA* pData)
+    {
+        struct epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.ptr = pData;
+        pData->owner = this;
+
+        return epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, fd, &ev) == 0;
+    }
+};
+
+class Connection : public MXB_POLL_DATA
+{
+public:
+    Connection(int fd)
+        : m_fd(fd)
+    {
+        MXB_POLL_DATA::handler = &Connection::handler;
+    }
+
+    ~Connection()
+    {
+        close(m_fd);
+    }
+
+    int fd() const
+    {
+        return m_fd;
+    }
+
+private:
+    static uint32_t handler(MXB_POLL_DATA* pData, MXB_WORKER* pWorker, uint32_t events)
+    {
+        return static_cast<Connection*>(pData)->handle(static_cast<Worker*>(pWorker), events);
+    }
+
+    uint32_t handle(Worker* pWorker, uint32_t events)
+    {
+        uint32_t rv = MXB_POLL_NOP;
+        bool closed = (events & (EPOLLHUP | EPOLLERR)) != 0;
+
+        if (events & EPOLLIN)
+        {
+            char buffer[4096];
+            ssize_t n;
+
+            // Edge-triggered, so everything is read.
+            while ((n = read(m_fd, buffer, sizeof(buffer))) > 0)
+            {
+                MXB_AT_DEBUG(ssize_t written = ) write(m_fd, buffer, n);
+                mxb_assert(written == n);
+            }
+
+            closed = closed || n == 0;
+            rv |= MXB_POLL_READ;
+        }
+
+        if (closed)
+        {
+            pWorker->remove_fd(m_fd);
+            delete this;
+            rv |= MXB_POLL_HUP;
+        }
+
+        return rv;
+    }
+
+    int m_fd;
+};
+
+class Listener : public MXB_POLL_DATA
+{
+public:
+    Listener(TestWorker* pWorker, int fd)
+        : m_worker(*pWorker)
+        , m_fd(fd)
+    {
+        MXB_POLL_DATA::handler = &Listener::handler;
+    }
+
+private:
+    static uint32_t handler(MXB_POLL_DATA* pData, MXB_WORKER* pWorker, uint32_t events)
+    {
+        return static_cast<Listener*>(pData)->handle();
+    }
+
+    uint32_t handle()
+    {
+        // Only one connection per event, it is up to the level-triggering
+        // to deliver an event for the next one.
+        int fd = accept4(m_fd, nullptr, nullptr, SOCK_NONBLOCK);
+
+        if (fd != -1)
+        {
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+            Connection* pConnection = new Connection(fd);
+
+            if (!m_worker.add_fd(fd, EPOLLIN | EPOLLRDHUP, pConnection))
+            {
+                delete pConnection;
+            }
+        }
+
+        return MXB_POLL_ACCEPT;
+    }
+
+    TestWorker& m_worker;
+    int         m_fd;
+};
+
+int create_listener(uint16_t* pPort)
+{
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    mxb_assert(fd != -1);
+
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+
+    if (bind(fd, (struct sockaddr*)&addr, len) != 0
+        || listen(fd, 128) != 0
+        || getsockname(fd, (struct sockaddr*)&addr, &len) != 0)
+    {
+        cout << "error: Could not create listener: " << strerror(errno) << endl;
+        close(fd);
+        return -1;
+    }
+
+    *pPort = ntohs(addr.sin_port);
+    return fd;
+}
+
+int connect_to(uint16_t port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0)
+    {
+        cout << "error: Could not connect: " << strerror(errno) << endl;
+        close(fd);
+        return -1;
+    }
+
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    return fd;
+}
+
+bool read_fully(int fd, char* pBuffer, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t n = read(fd, pBuffer, len);
+
+        if (n <= 0)
+        {
+            return false;
+        }
+
+        pBuffer += n;
+        len -= n;
+    }
+
+    return true;
+}
+
+int run(Worker::poll_backend_t backend, int rounds, int nConnections)
+{
+    const char* zName = backend == Worker::POLL_BACKEND_EPOLL ? "epoll" : "io_uring";
+    TestWorker worker(backend);
+
+    if (worker.poll_backend() != backend)
+    {
+        cout << zName << ": not available, skipping." << endl;
+        return 0;
+    }
+
+    uint16_t port;
+    int listener_fd = create_listener(&port);
+
+    if (listener_fd == -1)
+    {
+        return 1;
+    }
+
+    Listener listener(&worker, listener_fd);
+
+    if (!worker.add_level_triggered_fd(listener_fd, &listener) || !worker.start())
+    {
+        cout << "error: Could not start worker." << endl;
+        close(listener_fd);
+        return 1;
+    }
+
+    int rv = 0;
+    int fds[nConnections];
+
+    for (int i = 0; i < nConnections; ++i)
+    {
+        fds[i] = connect_to(port);
+
+        if (fds[i] == -1)
+        {
+            rv = 1;
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (int round = 0; rv == 0 && round < rounds; ++round)
+    {
+        char message[MESSAGE_SIZE];
+        char reply[MESSAGE_SIZE];
+
+        memset(message, 'a' + round % 26, sizeof(message));
+
+        for (int i = 0; i < nConnections; ++i)
+        {
+            if (write(fds[i], message, sizeof(message)) != sizeof(message))
+            {
+                cout << "error: Write failed: " << strerror(errno) << endl;
+                rv = 1;
+            }
+        }
+
+        for (int i = 0; rv == 0 && i < nConnections; ++i)
+        {
+            if (!read_fully(fds[i], reply, sizeof(reply)) || memcmp(message, reply, sizeof(reply)) != 0)
+            {
+                cout << "error: Did not get the message echoed back." << endl;
+                rv = 1;
+            }
+        }
+    }
+
+    std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+
+    for (int i = 0; i < nConnections; ++i)
+    {
+        if (fds[i] != -1)
+        {
+            close(fds[i]);
+        }
+    }
+
+    worker.shutdown();
+    worker.join();
+
+    close(listener_fd);
+
+    if (rv == 0)
+    {
+        double round_trips = (double)rounds * nConnections;
+
+        cout << setw(8) << zName << ": "
+             << rounds << " rounds of " << nConnections << " messages in "
+             << fixed << setprecision(3) << secs.count() << "s, "
+             << setprecision(0) << round_trips / secs.count() << " round trips/s" << endl;
+    }
+
+    return rv;
+}
+}
+
+int main(int argc, char* argv[])
+{
+    int rounds = argc > 1 ? atoi(argv[1]) : 10000;
+    int nConnections = argc > 2 ? atoi(argv[2]) : 16;
+
+    mxb::MaxBase mxb(MXB_LOG_TARGET_STDOUT);
+
+    int rv = 0;
+
+    rv += run(Worker::POLL_BACKEND_EPOLL, rounds, nConnections);
+    rv += run(Worker::POLL_BACKEND_IO_URING, rounds, nConnections);
+
+    return rv == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
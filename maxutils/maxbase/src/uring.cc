@@ -0,0 +1,531 @@
+/*
+ * Copyright (c) 2018 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2022-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+#include "uring.hh"
+
+#include <errno.h>
+#include <string.h>
+
+#include <maxbase/assert.h>
+#include <maxbase/log.h>
+#include <maxbase/string.h>
+
+#if defined (HAVE_IO_URING)
+
+#include <algorithm>
+#include <endian.h>
+#include <unistd.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include <maxbase/atomic.hh>
+
+namespace
+{
+
+// The user data of the poll request of the epoll instance.
+const uint64_t EPOLL_USER_DATA = 1ULL << 63;
+// The user data of requests whose completion is of no interest.
+const uint64_t IGNORE_USER_DATA = 0;
+
+// The user data of a poll request of a descriptor contains both the descriptor
+// and its generation, so that completions of a descriptor that has since been
+// removed, or removed and added anew, can be recognized and ignored.
+inline uint64_t slot_user_data(int fd, uint32_t generation)
+{
+    return (static_cast<uint64_t>(generation) << 32) | static_cast<uint32_t>(fd);
+}
+
+inline uint32_t next_generation(uint32_t generation)
+{
+    // At most 31 bits so as not to collide with EPOLL_USER_DATA and never 0 so
+    // as not to collide with IGNORE_USER_DATA.
+    generation = (generation + 1) & 0x7fffffff;
+    return generation != 0 ? generation : 1;
+}
+
+inline uint32_t to_poll32_events(uint32_t events)
+{
+#if __BYTE_ORDER == __BIG_ENDIAN
+    events = (events << 16) | (events >> 16);
+#endif
+    return events;
+}
+
+int io_uring_setup(uint32_t entries, io_uring_params* pParams)
+{
+    return syscall(__NR_io_uring_setup, entries, pParams);
+}
+
+int io_uring_enter(int fd, uint32_t to_submit, uint32_t min_complete, uint32_t flags,
+                   void* pArg, size_t arg_size)
+{
+    return syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, pArg, arg_size);
+}
+}
+
+namespace maxbase
+{
+
+URing::URing(int epoll_fd)
+    : m_epoll_fd(epoll_fd)
+    , m_ring_fd(-1)
+    , m_epoll_armed(false)
+    , m_epoll_ready(false)
+    , m_pRings(nullptr)
+    , m_rings_size(0)
+    , m_pSqes(nullptr)
+    , m_sqes_size(0)
+    , m_pSq_head(nullptr)
+    , m_pSq_tail(nullptr)
+    , m_sq_mask(0)
+    , m_sq_entries(0)
+    , m_sq_local_tail(0)
+    , m_pCq_head(nullptr)
+    , m_pCq_tail(nullptr)
+    , m_cq_mask(0)
+    , m_pCqes(nullptr)
+{
+}
+
+URing::~URing()
+{
+    if (m_pSqes)
+    {
+        munmap(m_pSqes, m_sqes_size);
+    }
+
+    if (m_pRings)
+    {
+        munmap(m_pRings, m_rings_size);
+    }
+
+    if (m_ring_fd != -1)
+    {
+        close(m_ring_fd);
+    }
+}
+
+// static
+URing* URing::create(int epoll_fd, uint32_t entries)
+{
+    URing* pThis = new URing(epoll_fd);
+
+    if (!pThis->setup(entries))
+    {
+        delete pThis;
+        pThis = nullptr;
+    }
+
+    return pThis;
+}
+
+bool URing::setup(uint32_t entries)
+{
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    // A multishot poll request may produce any number of completions, so the
+    // completion queue is made considerably larger than the submission queue.
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = 8 * entries;
+
+#if defined (IORING_SETUP_COOP_TASKRUN)
+    // The completions are only looked at when the worker waits for events, so
+    // there is no need to interrupt the worker to run the completion work.
+    params.flags |= IORING_SETUP_COOP_TASKRUN;
+#endif
+
+    m_ring_fd = io_uring_setup(entries, &params);
+
+#if defined (IORING_SETUP_COOP_TASKRUN)
+    if (m_ring_fd == -1 && errno == EINVAL)
+    {
+        // Older than Linux 5.19.
+        params.flags &= ~IORING_SETUP_COOP_TASKRUN;
+        m_ring_fd = io_uring_setup(entries, &params);
+    }
+#endif
+
+    if (m_ring_fd == -1)
+    {
+        MXB_INFO("Could not create io_uring instance: %s", mxb_strerror(errno));
+        return false;
+    }
+
+    // Multishot poll requests are supported as of Linux 5.13, which is also
+    // when IORING_FEAT_RSRC_TAGS appeared.
+    const uint32_t required = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP
+        | IORING_FEAT_EXT_ARG | IORING_FEAT_RSRC_TAGS;
+
+    if ((params.features & required) != required)
+    {
+        MXB_INFO("The io_uring implementation of the kernel lacks required features.");
+        return false;
+    }
+
+    // With IORING_FEAT_SINGLE_MMAP, both rings are in the same mapping.
+    m_rings_size = std::max(params.sq_off.array + params.sq_entries * sizeof(uint32_t),
+                            params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+    void* pRings = mmap(nullptr, m_rings_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        m_ring_fd, IORING_OFF_SQ_RING);
+
+    if (pRings == MAP_FAILED)
+    {
+        MXB_ERROR("Could not map io_uring queues: %s", mxb_strerror(errno));
+        return false;
+    }
+
+    m_pRings = pRings;
+
+    m_sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    void* pSqes = mmap(nullptr, m_sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                       m_ring_fd, IORING_OFF_SQES);
+
+    if (pSqes == MAP_FAILED)
+    {
+        MXB_ERROR("Could not map io_uring submission queue entries: %s", mxb_strerror(errno));
+        return false;
+    }
+
+    m_pSqes = static_cast<io_uring_sqe*>(pSqes);
+
+    char* p = static_cast<char*>(m_pRings);
+
+    m_pSq_head = reinterpret_cast<uint32_t*>(p + params.sq_off.head);
+    m_pSq_tail = reinterpret_cast<uint32_t*>(p + params.sq_off.tail);
+    m_sq_mask = *reinterpret_cast<uint32_t*>(p + params.sq_off.ring_mask);
+    m_sq_entries = *reinterpret_cast<uint32_t*>(p + params.sq_off.ring_entries);
+    m_sq_local_tail = *m_pSq_tail;
+
+    // The submission queue entries are always used in order.
+    uint32_t* pArray = reinterpret_cast<uint32_t*>(p + params.sq_off.array);
+
+    for (uint32_t i = 0; i < m_sq_entries; ++i)
+    {
+        pArray[i] = i;
+    }
+
+    m_pCq_head = reinterpret_cast<uint32_t*>(p + params.cq_off.head);
+    m_pCq_tail = reinterpret_cast<uint32_t*>(p + params.cq_off.tail);
+    m_cq_mask = *reinterpret_cast<uint32_t*>(p + params.cq_off.ring_mask);
+    m_pCqes = reinterpret_cast<io_uring_cqe*>(p + params.cq_off.cqes);
+
+    return true;
+}
+
+uint32_t URing::publish()
+{
+    atomic::store(m_pSq_tail, m_sq_local_tail, atomic::RELEASE);
+
+    return m_sq_local_tail - atomic::load(m_pSq_head, atomic::ACQUIRE);
+}
+
+int URing::enter(uint32_t to_submit, uint32_t min_complete, uint32_t flags, void* pArg)
+{
+    size_t arg_size = pArg ? sizeof(io_uring_getevents_arg) : 0;
+
+    return io_uring_enter(m_ring_fd, to_submit, min_complete, flags, pArg, arg_size);
+}
+
+io_uring_sqe* URing::get_sqe()
+{
+    if (m_sq_local_tail - atomic::load(m_pSq_head, atomic::ACQUIRE) == m_sq_entries)
+    {
+        // The submission queue is full, so the kernel must consume what is there.
+        if (enter(publish(), 0, 0, nullptr) == -1)
+        {
+            MXB_ERROR("Could not submit io_uring requests: %s", mxb_strerror(errno));
+        }
+
+        if (m_sq_local_tail - atomic::load(m_pSq_head, atomic::ACQUIRE) == m_sq_entries)
+        {
+            return nullptr;
+        }
+    }
+
+    io_uring_sqe* pSqe = &m_pSqes[m_sq_local_tail & m_sq_mask];
+    memset(pSqe, 0, sizeof(*pSqe));
+    ++m_sq_local_tail;
+
+    return pSqe;
+}
+
+bool URing::prep_poll(int fd, const Slot& slot)
+{
+    io_uring_sqe* pSqe = get_sqe();
+
+    if (pSqe)
+    {
+        pSqe->opcode = IORING_OP_POLL_ADD;
+        pSqe->fd = fd;
+        pSqe->poll32_events = to_poll32_events(slot.events);
+        pSqe->len = IORING_POLL_ADD_MULTI;
+        pSqe->user_data = slot_user_data(fd, slot.generation);
+    }
+
+    return pSqe != nullptr;
+}
+
+bool URing::prep_epoll_poll()
+{
+    io_uring_sqe* pSqe = get_sqe();
+
+    if (pSqe)
+    {
+        // A one-shot request, so that the epoll instance is polled anew each
+        // time it has been emptied. That gives the level-triggered descriptors
+        // in it level-triggered behaviour.
+        pSqe->opcode = IORING_OP_POLL_ADD;
+        pSqe->fd = m_epoll_fd;
+        pSqe->poll32_events = to_poll32_events(EPOLLIN);
+        pSqe->user_data = EPOLL_USER_DATA;
+
+        m_epoll_armed = true;
+    }
+
+    return pSqe != nullptr;
+}
+
+bool URing::add_fd(int fd, uint32_t events, MXB_POLL_DATA* pData, bool submit_now)
+{
+    mxb_assert(fd >= 0);
+    std::lock_guard<std::mutex> guard(m_lock);
+
+    if ((size_t)fd >= m_slots.size())
+    {
+        m_slots.resize(fd + 1, Slot {nullptr, 0, 0});
+    }
+
+    Slot& slot = m_slots[fd];
+
+    if (slot.pData)
+    {
+        errno = EEXIST;
+        return false;
+    }
+
+    // Multishot poll requests are always edge-triggered.
+    slot.events = events & ~(EPOLLET | EPOLLONESHOT | EPOLLEXCLUSIVE);
+    slot.generation = next_generation(slot.generation);
+
+    if (!prep_poll(fd, slot))
+    {
+        errno = EBUSY;
+        return false;
+    }
+
+    slot.pData = pData;
+
+    if (submit_now && enter(publish(), 0, 0, nullptr) == -1)
+    {
+        MXB_ERROR("Could not submit io_uring requests: %s", mxb_strerror(errno));
+    }
+
+    return true;
+}
+
+bool URing::remove_fd(int fd)
+{
+    std::lock_guard<std::mutex> guard(m_lock);
+
+    if (fd < 0 || (size_t)fd >= m_slots.size() || !m_slots[fd].pData)
+    {
+        errno = ENOENT;
+        return false;
+    }
+
+    Slot& slot = m_slots[fd];
+    slot.pData = nullptr;
+
+    io_uring_sqe* pSqe = get_sqe();
+
+    if (pSqe)
+    {
+        pSqe->opcode = IORING_OP_POLL_REMOVE;
+        pSqe->fd = -1;
+        pSqe->addr = slot_user_data(fd, slot.generation);
+        pSqe->user_data = IGNORE_USER_DATA;
+
+        // The poll request holds a reference to the file, so the removal is
+        // submitted immediately as the descriptor may be closed right after.
+        if (enter(publish(), 0, 0, nullptr) == -1)
+        {
+            MXB_ERROR("Could not submit io_uring requests: %s", mxb_strerror(errno));
+        }
+    }
+    else
+    {
+        MXB_ERROR("Could not remove descriptor %d from io_uring, the submission queue is full.", fd);
+    }
+
+    return true;
+}
+
+int URing::reap(struct epoll_event* pEvents, int max_events)
+{
+    int n = 0;
+    uint32_t head = *m_pCq_head;
+    uint32_t tail = atomic::load(m_pCq_tail, atomic::ACQUIRE);
+
+    while (head != tail && n < max_events)
+    {
+        const io_uring_cqe& cqe = m_pCqes[head & m_cq_mask];
+        ++head;
+
+        if (cqe.user_data == EPOLL_USER_DATA)
+        {
+            m_epoll_armed = false;
+            m_epoll_ready = cqe.res > 0;
+        }
+        else if (cqe.user_data != IGNORE_USER_DATA)
+        {
+            uint32_t fd = static_cast<uint32_t>(cqe.user_data);
+            uint32_t generation = static_cast<uint32_t>(cqe.user_data >> 32);
+
+            if (fd < m_slots.size() && m_slots[fd].pData && m_slots[fd].generation == generation)
+            {
+                Slot& slot = m_slots[fd];
+
+                if (cqe.res >= 0)
+                {
+                    pEvents[n].events = cqe.res;
+                    pEvents[n].data.ptr = slot.pData;
+                    ++n;
+
+                    if (!(cqe.flags & IORING_CQE_F_MORE))
+                    {
+                        // The kernel terminated the multishot request, e.g. because
+                        // the completion queue overflowed, so it is issued anew.
+                        prep_poll(fd, slot);
+                    }
+                }
+                else if (cqe.res != -ECANCELED)
+                {
+                    MXB_ERROR("Polling of descriptor %u failed: %s", fd, mxb_strerror(-cqe.res));
+                    pEvents[n].events = EPOLLERR;
+                    pEvents[n].data.ptr = slot.pData;
+                    ++n;
+                }
+            }
+        }
+    }
+
+    atomic::store(m_pCq_head, head, atomic::RELEASE);
+
+    return n;
+}
+
+int URing::wait(struct epoll_event* pEvents, int max_events, int timeout)
+{
+    std::unique_lock<std::mutex> guard(m_lock);
+
+    if (!m_epoll_armed && !m_epoll_ready)
+    {
+        prep_epoll_poll();
+    }
+
+    uint32_t to_submit = publish();
+    bool ready = m_epoll_ready || *m_pCq_head != atomic::load(m_pCq_tail, atomic::ACQUIRE);
+
+    guard.unlock();
+
+    int rv = 0;
+
+    if (ready || timeout == 0)
+    {
+        if (to_submit != 0)
+        {
+            rv = enter(to_submit, 0, 0, nullptr);
+        }
+    }
+    else
+    {
+        // Both the pending requests are submitted and the completions waited
+        // for using one system call.
+        __kernel_timespec ts;
+        ts.tv_sec = timeout / 1000;
+        ts.tv_nsec = (timeout % 1000) * 1000000;
+
+        io_uring_getevents_arg arg;
+        memset(&arg, 0, sizeof(arg));
+        arg.ts = timeout > 0 ? reinterpret_cast<uint64_t>(&ts) : 0;
+
+        rv = enter(to_submit, 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg);
+    }
+
+    if (rv == -1 && errno != ETIME && errno != EBUSY)
+    {
+        return -1;
+    }
+
+    guard.lock();
+
+    int n = reap(pEvents, max_events);
+
+    if (m_epoll_ready && n < max_events)
+    {
+        int rc = epoll_wait(m_epoll_fd, pEvents + n, max_events - n, 0);
+
+        if (rc > 0)
+        {
+            n += rc;
+        }
+
+        m_epoll_ready = false;
+    }
+
+    return n;
+}
+}
+
+#else
+
+namespace maxbase
+{
+
+URing::~URing()
+{
+}
+
+// static
+URing* URing::create(int epoll_fd, uint32_t entries)
+{
+    MXB_INFO("MaxScale was built without io_uring support.");
+    return nullptr;
+}
+
+bool URing::add_fd(int fd, uint32_t events, MXB_POLL_DATA* pData, bool submit_now)
+{
+    mxb_assert(!true);
+    errno = ENOSYS;
+    return false;
+}
+
+bool URing::remove_fd(int fd)
+{
+    mxb_assert(!true);
+    errno = ENOSYS;
+    return false;
+}
+
+int URing::wait(struct epoll_event* pEvents, int max_events, int timeout)
+{
+    mxb_assert(!true);
+    errno = ENOSYS;
+    return -1;
+}
+}
+
+#endif
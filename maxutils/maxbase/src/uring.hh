@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2018 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2022-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+#pragma once
+
+#include <maxbase/ccdefs.hh>
+
+#include <mutex>
+#include <vector>
+#include <sys/epoll.h>
+
+#include <maxbase/poll.h>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+namespace maxbase
+{
+
+/**
+ * URing is the io_uring based poll backend of a worker.
+ *
+ * Every descriptor added to the ring is polled with a multishot poll request
+ * whose completions are translated into epoll events, so the handlers of the
+ * descriptors work exactly as with epoll. The epoll instance of the worker is
+ * polled via the ring as well, so that descriptors added directly to it, as
+ * the level-triggered listening sockets are, keep on working.
+ *
+ * Only the worker thread may call @c wait. The descriptors may be added and
+ * removed from any thread.
+ */
+class URing
+{
+public:
+    URing(const URing&) = delete;
+    URing& operator=(const URing&) = delete;
+
+    ~URing();
+
+    /**
+     * Create a ring.
+     *
+     * @param epoll_fd  The epoll instance of the worker.
+     * @param entries   The number of submission queue entries.
+     *
+     * @return A new ring or NULL, if io_uring is not available.
+     */
+    static URing* create(int epoll_fd, uint32_t entries);
+
+    /**
+     * Start polling a descriptor.
+     *
+     * @param fd          The descriptor. Must not already be in the ring.
+     * @param events      Mask of epoll event types. The descriptor is always
+     *                    edge-triggered.
+     * @param pData       The poll data passed to the handler.
+     * @param submit_now  If false, the request is submitted only at the next
+     *                    call to @c wait.
+     *
+     * @return True, if the descriptor could be added.
+     */
+    bool add_fd(int fd, uint32_t events, MXB_POLL_DATA* pData, bool submit_now);
+
+    /**
+     * Stop polling a descriptor. Once the function returns, no events will
+     * be reported for the descriptor and it can be closed.
+     *
+     * @param fd  The descriptor.
+     *
+     * @return True, if the descriptor was in the ring.
+     */
+    bool remove_fd(int fd);
+
+    /**
+     * Submit pending requests and wait for events.
+     *
+     * @param pEvents     Array where the events are stored.
+     * @param max_events  The size of the array.
+     * @param timeout     Timeout in milliseconds.
+     *
+     * @return The number of events or -1 on error, in which case errno is set.
+     */
+    int wait(struct epoll_event* pEvents, int max_events, int timeout);
+
+private:
+    struct Slot
+    {
+        MXB_POLL_DATA* pData;       // NULL, if the descriptor is not in the ring
+        uint32_t       events;      // The polled events
+        uint32_t       generation;  // Incremented whenever the descriptor is added
+    };
+
+    URing(int epoll_fd);
+
+    bool          setup(uint32_t entries);
+    io_uring_sqe* get_sqe();
+    bool          prep_poll(int fd, const Slot& slot);
+    bool          prep_epoll_poll();
+    uint32_t      publish();
+    int           enter(uint32_t to_submit, uint32_t min_complete, uint32_t flags, void* pArg);
+    int           reap(struct epoll_event* pEvents, int max_events);
+
+    int                m_epoll_fd;
+    int                m_ring_fd;
+    std::mutex         m_lock;              // Protects the submission queue and the slots
+    std::vector<Slot>  m_slots;             // Indexed by descriptor
+    bool               m_epoll_armed;       // Whether the epoll instance is being polled
+    bool               m_epoll_ready;       // Whether the epoll instance has events
+
+    void*              m_pRings;            // The submission and completion queue rings
+    size_t             m_rings_size;
+    io_uring_sqe*      m_pSqes;
+    size_t             m_sqes_size;
+
+    uint32_t*          m_pSq_head;
+    uint32_t*          m_pSq_tail;
+    uint32_t           m_sq_mask;
+    uint32_t           m_sq_entries;
+    uint32_t           m_sq_local_tail;     // Tail including requests not yet published
+
+    uint32_t*          m_pCq_head;
+    uint32_t*          m_pCq_tail;
+    uint32_t           m_cq_mask;
+    io_uring_cqe*      m_pCqes;
+};
+}
@@ -27,6 +27,8 @@
 #include <maxbase/log.h>
 #include <maxbase/string.h>
 
+#include "uring.hh"
+
 #define WORKER_ABSENT_ID -1
 
 using std::function;
@@ -52,6 +54,19 @@ struct this_unit
     false,      // initialized
 };
 
+// Freed delayed calls are kept for reuse in blocks of this size.
+const size_t CALL_BLOCK_SIZE = 64;
+const uint32_t MAX_FREE_CALLS = 4096;
+
+// A delayed call id consists of the generation of the handle in the upper
+// and the index of the handle in the lower 32 bits.
+const uint32_t MAX_CALL_HANDLES = 1 << 22;
+
+struct FreeCall
+{
+    FreeCall* pNext;
+};
+
 thread_local struct this_thread
 {
     Worker* pCurrent_worker;    // The current worker
@@ -60,6 +75,34 @@ thread_local struct this_thread
     nullptr
 };
 
+/**
+ * The delayed calls freed by a thread, released when the thread exits.
+ */
+thread_local struct FreeCalls
+{
+    FreeCall* pHead = nullptr;
+    uint32_t  n = 0;
+
+    ~FreeCalls()
+    {
+        while (pHead)
+        {
+            FreeCall* pFree = pHead;
+            pHead = pFree->pNext;
+            ::operator delete(pFree);
+        }
+    }
+} free_calls;
+
+int64_t get_monotonic_time_ms()
+{
+    struct timespec ts;
+    MXB_AT_DEBUG(int rv = ) clock_gettime(CLOCK_MONOTONIC, &ts);
+    mxb_assert(rv == 0);
+
+    return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
 /**
  * Structure used for sending cross-thread messages.
  */
@@ -279,12 +322,30 @@ int create_epoll_instance()
 
     return fd;
 }
+
+URing* create_ring(int epoll_fd, int max_events, Worker::poll_backend_t backend)
+{
+    URing* pRing = nullptr;
+
+    if (epoll_fd != -1 && backend == Worker::POLL_BACKEND_IO_URING)
+    {
+        pRing = URing::create(epoll_fd, max_events);
+
+        if (!pRing)
+        {
+            MXB_WARNING("io_uring is not available, the worker will use epoll.");
+        }
+    }
+
+    return pRing;
+}
 }
 
-Worker::Worker(int max_events)
+Worker::Worker(int max_events, poll_backend_t backend)
     : m_epoll_fd(create_epoll_instance())
     , m_state(STOPPED)
     , m_max_events(max_events)
+    , m_pRing(create_ring(m_epoll_fd, max_events, backend))
     , m_pQueue(NULL)
     , m_started(false)
     , m_should_shutdown(false)
@@ -292,10 +353,14 @@ Worker::Worker(int max_events)
     , m_nCurrent_descriptors(0)
     , m_nTotal_descriptors(0)
     , m_pTimer(new PrivateTimer(this, this, &Worker::tick))
-    , m_next_delayed_call_id{1}
+    , m_wheel_time(get_monotonic_time_ms())
+    , m_timer_at(0)
 {
     mxb_assert(max_events > 0);
 
+    memset(m_wheel, 0, sizeof(m_wheel));
+    memset(m_wheel_count, 0, sizeof(m_wheel_count));
+
     if (m_epoll_fd != -1)
     {
         m_pQueue = MessageQueue::create(this);
@@ -322,13 +387,17 @@ Worker::~Worker()
 
     delete m_pTimer;
     delete m_pQueue;
+    delete m_pRing;
     close(m_epoll_fd);
 
     // When going down, we need to cancel all pending calls.
-    for (auto i = m_calls.begin(); i != m_calls.end(); ++i)
+    for (auto i = m_call_handles.begin(); i != m_call_handles.end(); ++i)
     {
-        i->second->call(Call::CANCEL);
-        delete i->second;
+        if (i->pCall)
+        {
+            i->pCall->call(Call::CANCEL);
+            delete i->pCall;
+        }
     }
 }
 
@@ -369,17 +438,28 @@ bool Worker::add_fd(int fd, uint32_t events, MXB_POLL_DATA* pData)
 
     pData->owner = this;
 
-    if (epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, fd, &ev) == 0)
+    if (m_pRing)
     {
-        mxb::atomic::add(&m_nCurrent_descriptors, 1, mxb::atomic::RELAXED);
-        mxb::atomic::add(&m_nTotal_descriptors, 1, mxb::atomic::RELAXED);
+        // On the worker thread the request is submitted when the worker
+        // next waits for events, together with everything else pending.
+        if (!m_pRing->add_fd(fd, events, pData, get_current() != this))
+        {
+            MXB_ERROR("Could not add descriptor %d to io_uring: %s", fd, mxb_strerror(errno));
+            rv = false;
+        }
     }
-    else
+    else if (epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, fd, &ev) != 0)
     {
         resolve_poll_error(fd, errno, EPOLL_CTL_ADD);
         rv = false;
     }
 
+    if (rv)
+    {
+        mxb::atomic::add(&m_nCurrent_descriptors, 1, mxb::atomic::RELAXED);
+        mxb::atomic::add(&m_nTotal_descriptors, 1, mxb::atomic::RELAXED);
+    }
+
     return rv;
 }
 
@@ -389,7 +469,19 @@ bool Worker::remove_fd(int fd)
 
     struct epoll_event ev = {};
 
-    if (epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, fd, &ev) == 0)
+    if (m_pRing)
+    {
+        if (m_pRing->remove_fd(fd))
+        {
+            mxb::atomic::add(&m_nCurrent_descriptors, -1, mxb::atomic::RELAXED);
+        }
+        else
+        {
+            MXB_ERROR("File descriptor %d was not found in io_uring.", fd);
+            rv = false;
+        }
+    }
+    else if (epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, fd, &ev) == 0)
     {
         mxb::atomic::add(&m_nCurrent_descriptors, -1, mxb::atomic::RELAXED);
     }
@@ -778,16 +870,26 @@ void Worker::poll_waitevents()
         }
 
         m_load.about_to_wait(now);
-        nfds = epoll_wait(m_epoll_fd, events, m_max_events, timeout);
+
+        if (m_pRing)
+        {
+            nfds = m_pRing->wait(events, m_max_events, timeout);
+        }
+        else
+        {
+            nfds = epoll_wait(m_epoll_fd, events, m_max_events, timeout);
+        }
+
         m_load.about_to_work();
 
         if (nfds == -1 && errno != EINTR)
         {
             int eno = errno;
             errno = 0;
-            MXB_ERROR("%lu [poll_waitevents] epoll_wait returned "
+            MXB_ERROR("%lu [poll_waitevents] %s returned "
                       "%d, errno %d",
                       pthread_self(),
+                      m_pRing ? "io_uring_enter" : "epoll_wait",
                       nfds,
                       eno);
         }
@@ -887,136 +989,325 @@ void Worker::poll_waitevents()
     }   /*< while(1) */
 }
 
-void Worker::tick()
+// static
+void* Worker::DelayedCall::operator new(size_t size)
 {
-    int64_t now = WorkerLoad::get_time_ms();
+    void* pCall = nullptr;
 
-    vector<DelayedCall*> repeating_calls;
+    if (size <= CALL_BLOCK_SIZE && free_calls.pHead)
+    {
+        FreeCall* pFree = free_calls.pHead;
+        free_calls.pHead = pFree->pNext;
+        --free_calls.n;
+        pCall = pFree;
+    }
+    else
+    {
+        pCall = ::operator new(size <= CALL_BLOCK_SIZE ? CALL_BLOCK_SIZE : size);
+    }
 
-    auto i = m_sorted_calls.begin();
+    return pCall;
+}
 
-    // i->first is the time when the first call should be invoked.
-    while (!m_sorted_calls.empty() && (i->first <= now))
+// static
+void Worker::DelayedCall::operator delete(void* pCall, size_t size)
+{
+    if (size <= CALL_BLOCK_SIZE && free_calls.n < MAX_FREE_CALLS)
+    {
+        FreeCall* pFree = static_cast<FreeCall*>(pCall);
+        pFree->pNext = free_calls.pHead;
+        free_calls.pHead = pFree;
+        ++free_calls.n;
+    }
+    else
     {
-        DelayedCall* pCall = i->second;
+        ::operator delete(pCall);
+    }
+}
+
+void Worker::tick()
+{
+    int64_t now = get_monotonic_time_ms();
+
+    m_timer_at = 0;
 
-        auto j = m_calls.find(pCall->id());
-        mxb_assert(j != m_calls.end());
+    mxb_assert(m_repeating_calls.empty());
 
-        m_sorted_calls.erase(i);
-        m_calls.erase(j);
+    int64_t t;
 
-        if (pCall->call(Worker::Call::EXECUTE))
+    while ((t = wheel_next_event()) <= now)
+    {
+        m_wheel_time = t;
+
+        // Move the calls of the higher levels down, if the wheel is at the
+        // start of a slot of theirs. The highest level must be done first.
+        for (int level = WHEEL_LEVELS - 1; level > 0; --level)
         {
-            repeating_calls.push_back(pCall);
+            if ((t & ((INT64_C(1) << (WHEEL_BITS * level)) - 1)) == 0)
+            {
+                wheel_cascade(level, t);
+            }
         }
-        else
+
+        DelayedCall** ppSlot = &m_wheel[0][t & WHEEL_MASK];
+
+        // NOTE: The head must be reloaded on each iteration, as a delayed
+        // NOTE: call may cancel another delayed call in the same slot.
+        while (DelayedCall* pCall = *ppSlot)
         {
-            delete pCall;
+            mxb_assert(pCall->at() <= t);
+            wheel_remove(pCall);
+
+            if (pCall->call(Worker::Call::EXECUTE))
+            {
+                m_repeating_calls.push_back(pCall);
+            }
+            else
+            {
+                m_call_handles[pCall->index()].pCall = nullptr;
+                m_free_handles.push_back(pCall->index());
+                delete pCall;
+            }
         }
 
-        // NOTE: Must be reassigned, ++i will not work in case a delayed
-        // NOTE: call cancels another delayed call.
-        i = m_sorted_calls.begin();
+        m_wheel_time = t + 1;
     }
 
-    for (auto i = repeating_calls.begin(); i != repeating_calls.end(); ++i)
+    if (m_wheel_time <= now)
     {
-        DelayedCall* pCall = *i;
+        // Nothing to do in between.
+        m_wheel_time = now + 1;
+    }
 
-        m_sorted_calls.insert(std::make_pair(pCall->at(), pCall));
-        m_calls.insert(std::make_pair(pCall->id(), pCall));
+    for (auto i = m_repeating_calls.begin(); i != m_repeating_calls.end(); ++i)
+    {
+        wheel_add(*i);
     }
 
-    adjust_timer();
+    m_repeating_calls.clear();
+
+    adjust_timer(now);
 }
 
-uint32_t Worker::add_delayed_call(DelayedCall* pCall)
+uint64_t Worker::add_delayed_call(DelayedCall* pCall)
 {
-    bool adjust = true;
+    uint32_t index;
 
-    if (!m_sorted_calls.empty())
+    if (!m_free_handles.empty())
+    {
+        // The handle that has been free the longest is reused, so that the
+        // generation of a handle changes as seldom as possible.
+        index = m_free_handles.front();
+        m_free_handles.pop_front();
+    }
+    else if (m_call_handles.size() < MAX_CALL_HANDLES)
+    {
+        index = m_call_handles.size();
+        m_call_handles.push_back(CallHandle {nullptr, 0});
+    }
+    else
     {
-        DelayedCall* pFirst = m_sorted_calls.begin()->second;
+        MXB_ERROR("Too many delayed calls, cannot add more than %u.", MAX_CALL_HANDLES);
+        pCall->call(Worker::Call::CANCEL);
+        delete pCall;
+        return 0;
+    }
 
-        if (pCall->at() > pFirst->at())
-        {
-            // If the added delayed call needs to be called later
-            // than the first delayed call, then we do not need to
-            // adjust the timer.
-            adjust = false;
-        }
+    CallHandle& handle = m_call_handles[index];
+
+    // The generation is never 0, so neither is the id.
+    if (++handle.generation == 0)
+    {
+        handle.generation = 1;
     }
 
-    // Insert the delayed call into the map ordered by invocation time.
-    m_sorted_calls.insert(std::make_pair(pCall->at(), pCall));
+    handle.pCall = pCall;
+    pCall->m_index = index;
+    uint64_t id = ((uint64_t)handle.generation << 32) | index;
 
-    // Insert the delayed call into the map indexed by id.
-    mxb_assert(m_calls.find(pCall->id()) == m_calls.end());
-    m_calls.insert(std::make_pair(pCall->id(), pCall));
+    wheel_add(pCall);
 
-    if (adjust)
+    // The timer needs to be adjusted only if this call is the earliest one.
+    if (m_timer_at == 0 || pCall->at() < m_timer_at)
     {
-        adjust_timer();
+        adjust_timer(get_monotonic_time_ms());
     }
 
-    return pCall->id();
+    return id;
 }
 
-void Worker::adjust_timer()
+void Worker::adjust_timer(int64_t now)
 {
-    if (!m_sorted_calls.empty())
+    int64_t at = wheel_next_event();
+
+    if (at != INT64_MAX)
     {
-        DelayedCall* pCall = m_sorted_calls.begin()->second;
+        if (at != m_timer_at)
+        {
+            int64_t delay = at - now;
 
-        uint64_t now = WorkerLoad::get_time_ms();
-        int64_t delay = pCall->at() - now;
+            if (delay <= 0)
+            {
+                delay = 1;
+            }
 
-        if (delay <= 0)
-        {
-            delay = 1;
+            m_pTimer->start(delay);
+            m_timer_at = at;
         }
-
-        m_pTimer->start(delay);
     }
-    else
+    else if (m_timer_at != 0)
     {
         m_pTimer->cancel();
+        m_timer_at = 0;
     }
 }
 
-bool Worker::cancel_delayed_call(uint32_t id)
+void Worker::wheel_add(DelayedCall* pCall)
 {
-    bool found = false;
+    mxb_assert(!pCall->m_ppSlot);
 
-    auto i = m_calls.find(id);
+    int64_t at = std::max(pCall->at(), m_wheel_time);
+    uint64_t diff = at - m_wheel_time;
+    int level = 0;
 
-    if (i != m_calls.end())
+    while (level < WHEEL_LEVELS - 1 && diff >= (UINT64_C(1) << (WHEEL_BITS * (level + 1))))
     {
-        DelayedCall* pCall = i->second;
-        m_calls.erase(i);
+        ++level;
+    }
 
-        // All delayed calls with exactly the same trigger time.
-        // Not particularly likely there will be many of those.
-        auto range = m_sorted_calls.equal_range(pCall->at());
+    if (diff >> (WHEEL_BITS * WHEEL_LEVELS))
+    {
+        // Beyond the range of the wheel. It will end up on the highest level
+        // again when the slot is cascaded.
+        at = m_wheel_time + (INT64_C(1) << (WHEEL_BITS * WHEEL_LEVELS)) - 1;
+    }
 
-        mxb_assert(range.first != range.second);
+    DelayedCall** ppSlot = &m_wheel[level][(at >> (WHEEL_BITS * level)) & WHEEL_MASK];
 
-        for (auto k = range.first; k != range.second; ++k)
+    pCall->m_pPrev = nullptr;
+    pCall->m_pNext = *ppSlot;
+
+    if (*ppSlot)
+    {
+        (*ppSlot)->m_pPrev = pCall;
+    }
+
+    *ppSlot = pCall;
+    pCall->m_ppSlot = ppSlot;
+    ++m_wheel_count[level];
+}
+
+void Worker::wheel_remove(DelayedCall* pCall)
+{
+    mxb_assert(pCall->m_ppSlot);
+
+    if (pCall->m_pPrev)
+    {
+        pCall->m_pPrev->m_pNext = pCall->m_pNext;
+    }
+    else
+    {
+        *pCall->m_ppSlot = pCall->m_pNext;
+    }
+
+    if (pCall->m_pNext)
+    {
+        pCall->m_pNext->m_pPrev = pCall->m_pPrev;
+    }
+
+    --m_wheel_count[(pCall->m_ppSlot - &m_wheel[0][0]) / WHEEL_SIZE];
+
+    pCall->m_pNext = nullptr;
+    pCall->m_pPrev = nullptr;
+    pCall->m_ppSlot = nullptr;
+}
+
+void Worker::wheel_cascade(int level, int64_t now)
+{
+    mxb_assert(now == m_wheel_time);
+
+    DelayedCall** ppSlot = &m_wheel[level][(now >> (WHEEL_BITS * level)) & WHEEL_MASK];
+
+    while (DelayedCall* pCall = *ppSlot)
+    {
+        wheel_remove(pCall);
+        wheel_add(pCall);
+    }
+}
+
+int64_t Worker::wheel_next_event() const
+{
+    int64_t next = INT64_MAX;
+
+    if (m_wheel_count[0] != 0)
+    {
+        // The calls on level 0 are due within WHEEL_SIZE milliseconds, so
+        // the first non-empty slot tells exactly when the next one is.
+        for (int i = 0; i < WHEEL_SIZE; ++i)
         {
-            if (k->second == pCall)
+            if (m_wheel[0][(m_wheel_time + i) & WHEEL_MASK])
             {
-                m_sorted_calls.erase(k);
+                next = m_wheel_time + i;
+                break;
+            }
+        }
+    }
 
-                pCall->call(Worker::Call::CANCEL);
-                delete pCall;
+    // On the higher levels, the time that matters is when a slot is
+    // reached and its calls are moved to the lower levels.
+    for (int level = 1; level < WHEEL_LEVELS; ++level)
+    {
+        if (m_wheel_count[level] != 0)
+        {
+            int shift = WHEEL_BITS * level;
+            int64_t unit = INT64_C(1) << shift;
+            int64_t first = (m_wheel_time + unit - 1) & ~(unit - 1);
+            int64_t current = first >> shift;
 
-                found = true;
-                break;
+            for (int i = 0; i < WHEEL_SIZE; ++i)
+            {
+                if (m_wheel[level][(current + i) & WHEEL_MASK])
+                {
+                    next = std::min(next, first + i * unit);
+                    break;
+                }
             }
         }
+    }
+
+    return next;
+}
+
+bool Worker::cancel_delayed_call(uint64_t id)
+{
+    bool found = false;
+
+    uint32_t index = id & 0xffffffff;
+    uint32_t generation = id >> 32;
+    DelayedCall* pCall = nullptr;
+
+    if (index < m_call_handles.size())
+    {
+        CallHandle& handle = m_call_handles[index];
+
+        if (handle.pCall && handle.generation == generation && handle.pCall->m_ppSlot)
+        {
+            pCall = handle.pCall;
+            handle.pCall = nullptr;
+            m_free_handles.push_back(index);
+        }
+    }
+
+    if (pCall)
+    {
+        // The timer is not adjusted, if the call was the earliest one the
+        // timer will fire in vain and then be adjusted.
+        wheel_remove(pCall);
+
+        pCall->call(Worker::Call::CANCEL);
+        delete pCall;
 
-        mxb_assert(found);
+        found = true;
     }
     else
     {
@@ -0,0 +1,1412 @@
+/*
+ * Copyright (c) 2018 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2022-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+#pragma once
+
+#include <maxscale/ccdefs.hh>
+#include <string.h>
+#include <maxscale/customparser.hh>
+#include <maxscale/query_classifier.h>
+
+/**
+ * @class QcFastPath
+ *
+ * QcFastPath recognizes the simple statements that make up the bulk of
+ * an OLTP workload, that is, single table SELECTs, INSERT/REPLACE ... VALUES,
+ * UPDATEs and DELETEs whose WHERE clause only consists of comparisons between
+ * columns and literals combined with AND, OR and NOT.
+ *
+ * The parser collects the tables, fields and functions of the statement in
+ * the order in which sqlite would report them. Anything that is not
+ * recognized, or that might be interpreted differently by sqlite, causes the
+ * parsing to fail, in which case the statement must be parsed by sqlite.
+ *
+ * The parser does not allocate memory and refers directly to the statement
+ * text, which must thus outlive the parser. As the class is used for every
+ * statement, it is defined in its entirety in the header to allow for
+ * aggressive inlining.
+ */
+class QcFastPath : public maxscale::CustomParser
+{
+    QcFastPath(const QcFastPath&);
+    QcFastPath& operator=(const QcFastPath&);
+
+public:
+    enum
+    {
+        MAX_NAME_LEN  = 64, // The maximum length of an identifier, as in MariaDB.
+        MAX_FIELDS    = 64, // The maximum number of fields of a statement.
+        MAX_ARGUMENTS = 128,// The maximum total number of fields of all functions.
+        MAX_FUNCTIONS = 32, // The maximum number of functions of a statement.
+        MAX_EXCLUDES  = 64, // The maximum number of names in the select or set list.
+    };
+
+    /**
+     * A name in the statement, with quotes removed. If the name is absent,
+     * @c z is NULL.
+     */
+    struct Name
+    {
+        const char* z;
+        int         n;
+
+        /**
+         * Copy the name into a buffer.
+         *
+         * @param zBuffer  A buffer of at least MAX_NAME_LEN + 1 bytes.
+         *
+         * @return @c zBuffer if the name is present, otherwise NULL.
+         */
+        const char* copy(char* zBuffer) const
+        {
+            const char* zName = NULL;
+
+            if (z)
+            {
+                memcpy(zBuffer, z, n);
+                zBuffer[n] = 0;
+                zName = zBuffer;
+            }
+
+            return zName;
+        }
+    };
+
+    struct Field
+    {
+        Name database;
+        Name table;
+        Name column;
+    };
+
+    // A field used as an argument of a function.
+    struct Argument
+    {
+        int   function;     // The index of the function.
+        Field field;
+    };
+
+    /**
+     * @param is_keyword  Function returning whether a word is a keyword, and thus
+     *                    cannot be used as an unquoted identifier.
+     */
+    QcFastPath(bool (* is_keyword)(const char* zWord))
+        : m_is_keyword(is_keyword)
+        , m_operation(QUERY_OP_UNDEFINED)
+        , m_type_mask(QUERY_TYPE_UNKNOWN)
+        , m_has_clause(false)
+        , m_n_fields(0)
+        , m_n_arguments(0)
+        , m_n_functions(0)
+        , m_n_excludes(0)
+    {
+        memset(&m_table, 0, sizeof(m_table));
+        memset(&m_alias, 0, sizeof(m_alias));
+    }
+
+    /**
+     * Parse a statement.
+     *
+     * @param pSql  The statement, not NULL terminated.
+     * @param len   The length of the statement.
+     *
+     * @return True, if the statement was recognized, false if it must be
+     *         parsed by sqlite.
+     */
+    bool parse(const char* pSql, int len)
+    {
+        m_pSql = pSql;
+        m_len = len;
+        m_pI = m_pSql;
+        m_pEnd = m_pI + m_len;
+
+        bool rv = false;
+
+        if (next())
+        {
+            if (is_word("SELECT"))
+            {
+                rv = parse_select();
+            }
+            else if (is_word("UPDATE"))
+            {
+                rv = parse_update();
+            }
+            else if (is_word("DELETE"))
+            {
+                rv = parse_delete();
+            }
+            else if (is_word("INSERT") || is_word("REPLACE"))
+            {
+                rv = parse_insert();
+            }
+        }
+
+        return rv;
+    }
+
+    qc_query_op_t operation() const
+    {
+        return m_operation;
+    }
+
+    uint32_t type_mask() const
+    {
+        return m_type_mask;
+    }
+
+    bool has_clause() const
+    {
+        return m_has_clause;
+    }
+
+    /**
+     * @return The table of the statement. If the statement has no FROM
+     *         clause, the table name will be NULL.
+     */
+    const Field& table() const
+    {
+        return m_table;
+    }
+
+    const Name& alias() const
+    {
+        return m_alias;
+    }
+
+    int n_fields() const
+    {
+        return m_n_fields;
+    }
+
+    const Field& field(int i) const
+    {
+        mxb_assert(i < m_n_fields);
+        return m_fields[i];
+    }
+
+    int n_functions() const
+    {
+        return m_n_functions;
+    }
+
+    /**
+     * @return The name of a function, as reported by qc_sqlite.
+     */
+    const char* function(int i) const
+    {
+        mxb_assert(i < m_n_functions);
+        return m_functions[i];
+    }
+
+    int n_arguments() const
+    {
+        return m_n_arguments;
+    }
+
+    const Argument& argument(int i) const
+    {
+        mxb_assert(i < m_n_arguments);
+        return m_arguments[i];
+    }
+
+private:
+    enum kind_t
+    {
+        K_END,          // End of statement.
+        K_WORD,         // An unquoted identifier or keyword.
+        K_QUOTED,       // A backtick quoted identifier.
+        K_NUMBER,
+        K_STRING,
+        K_PARAM,        // A '?' placeholder.
+        K_SYMBOL,       // Punctuation or operator, m_tok.n is its length.
+    };
+
+    struct Token
+    {
+        kind_t      kind;
+        const char* z;
+        int         n;
+        int         identifier;     // Whether a word is an identifier, -1 if not yet checked.
+    };
+
+    // An operand of a comparison.
+    struct Operand
+    {
+        bool  is_field;
+        bool  is_negative;
+        Field field;
+    };
+
+    static bool is_space(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+    }
+
+    static bool is_ident_char(char c)
+    {
+        return is_alpha(c) || is_number(c) || c == '_' || c == '$' || (c & 0x80);
+    }
+
+    /**
+     * Bypass whitespace and comments. Executable comments are not recognized,
+     * as their content may have to be parsed.
+     *
+     * @return False, if the statement contains something that must be handled by sqlite.
+     */
+    bool bypass_whitespace_and_comments()
+    {
+        while (m_pI < m_pEnd)
+        {
+            char c = *m_pI;
+
+            if (is_space(c))
+            {
+                ++m_pI;
+            }
+            else if (c == '#'
+                     || (c == '-' && m_pI + 1 < m_pEnd && m_pI[1] == '-'))
+            {
+                if (c == '-' && m_pI + 2 < m_pEnd && !is_space(m_pI[2]))
+                {
+                    // In MariaDB "--" only starts a comment if followed by whitespace.
+                    return false;
+                }
+
+                while (m_pI < m_pEnd && *m_pI != '\n')
+                {
+                    ++m_pI;
+                }
+            }
+            else if (c == '/' && m_pI + 1 < m_pEnd && m_pI[1] == '*')
+            {
+                const char* pC = m_pI + 2;
+
+                if (pC < m_pEnd && (*pC == '!' || *pC == 'M'))
+                {
+                    return false;
+                }
+
+                while (pC + 1 < m_pEnd && !(pC[0] == '*' && pC[1] == '/'))
+                {
+                    ++pC;
+                }
+
+                if (pC + 1 >= m_pEnd)
+                {
+                    return false;
+                }
+
+                m_pI = pC + 2;
+            }
+            else
+            {
+                break;
+            }
+        }
+
+        return true;
+    }
+
+    bool scan_quoted(char quote)
+    {
+        const char* pI = m_pI + 1;
+
+        while (pI < m_pEnd)
+        {
+            if (*pI == '\\' && quote != '`')
+            {
+                pI += 2;
+            }
+            else if (*pI == quote)
+            {
+                if (pI + 1 < m_pEnd && pI[1] == quote)
+                {
+                    if (quote == '`')
+                    {
+                        // An escaped backtick in an identifier would require unescaping.
+                        return false;
+                    }
+
+                    pI += 2;
+                }
+                else
+                {
+                    break;
+                }
+            }
+            else if (*pI == 0)
+            {
+                return false;
+            }
+            else
+            {
+                ++pI;
+            }
+        }
+
+        if (pI >= m_pEnd)
+        {
+            return false;
+        }
+
+        m_tok.z = m_pI + 1;
+        m_tok.n = pI - m_pI - 1;
+        m_pI = pI + 1;
+
+        return true;
+    }
+
+    bool scan_number()
+    {
+        const char* pI = m_pI;
+
+        if (*pI == '0' && pI + 1 < m_pEnd && (pI[1] == 'x' || pI[1] == 'X'))
+        {
+            pI += 2;
+
+            const char* pStart = pI;
+
+            while (pI < m_pEnd && (is_number(*pI)
+                                   || (toupper(*pI) >= 'A' && toupper(*pI) <= 'F')))
+            {
+                ++pI;
+            }
+
+            if (pI == pStart)
+            {
+                return false;
+            }
+        }
+        else
+        {
+            bool digits = false;
+
+            while (pI < m_pEnd && is_number(*pI))
+            {
+                ++pI;
+                digits = true;
+            }
+
+            if (pI < m_pEnd && *pI == '.')
+            {
+                ++pI;
+
+                while (pI < m_pEnd && is_number(*pI))
+                {
+                    ++pI;
+                    digits = true;
+                }
+            }
+
+            if (!digits)
+            {
+                return false;
+            }
+
+            if (pI < m_pEnd && (*pI == 'e' || *pI == 'E'))
+            {
+                ++pI;
+
+                if (pI < m_pEnd && (*pI == '+' || *pI == '-'))
+                {
+                    ++pI;
+                }
+
+                if (pI == m_pEnd || !is_number(*pI))
+                {
+                    return false;
+                }
+
+                while (pI < m_pEnd && is_number(*pI))
+                {
+                    ++pI;
+                }
+            }
+        }
+
+        if (pI < m_pEnd && (is_ident_char(*pI) || *pI == '.'))
+        {
+            // Something like "1abc", which sqlite tokenizes differently from MariaDB.
+            return false;
+        }
+
+        m_tok.kind = K_NUMBER;
+        m_tok.z = m_pI;
+        m_tok.n = pI - m_pI;
+        m_pI = pI;
+
+        return true;
+    }
+
+    /**
+     * Move to the next token.
+     *
+     * @return False, if the next token is something that must be handled by sqlite.
+     */
+    bool next()
+    {
+        if (!bypass_whitespace_and_comments())
+        {
+            return false;
+        }
+
+        if (m_pI == m_pEnd)
+        {
+            m_tok.kind = K_END;
+            m_tok.z = m_pI;
+            m_tok.n = 0;
+            return true;
+        }
+
+        char c = *m_pI;
+        bool rv = true;
+
+        if (is_alpha(c) || c == '_')
+        {
+            const char* pI = m_pI + 1;
+
+            while (pI < m_pEnd && is_ident_char(*pI))
+            {
+                ++pI;
+            }
+
+            m_tok.kind = K_WORD;
+            m_tok.identifier = -1;
+            m_tok.z = m_pI;
+            m_tok.n = pI - m_pI;
+            m_pI = pI;
+
+            // "$" and non-ASCII characters in identifiers are left to sqlite.
+            for (const char* p = m_tok.z; rv && p < pI; ++p)
+            {
+                rv = !(*p == '$' || (*p & 0x80));
+            }
+
+            // A word immediately followed by a quote is e.g. a character set
+            // introducer or a hexadecimal literal.
+            rv = rv && (m_pI == m_pEnd || (*m_pI != '\'' && *m_pI != '"'));
+        }
+        else if (is_number(c) || (c == '.' && m_pI + 1 < m_pEnd && is_number(m_pI[1])))
+        {
+            rv = scan_number();
+        }
+        else if (c == '\'' || c == '"')
+        {
+            m_tok.kind = K_STRING;
+            rv = scan_quoted(c);
+
+            if (rv)
+            {
+                // Adjacent strings are concatenated.
+                const char* pI = m_pI;
+                rv = bypass_whitespace_and_comments()
+                    && (m_pI == m_pEnd || (*m_pI != '\'' && *m_pI != '"'));
+                m_pI = pI;
+            }
+        }
+        else if (c == '`')
+        {
+            m_tok.kind = K_QUOTED;
+            rv = scan_quoted(c)
+                && m_tok.n > 0
+                && m_tok.n <= MAX_NAME_LEN
+                && m_tok.z[0] != '\''
+                && m_tok.z[0] != '"'
+                && m_tok.z[0] != '['
+                && !((m_tok.n == 4 && strncasecmp(m_tok.z, "true", 4) == 0)
+                     || (m_tok.n == 5 && strncasecmp(m_tok.z, "false", 5) == 0));
+        }
+        else if (c == '?')
+        {
+            m_tok.kind = K_PARAM;
+            m_tok.z = m_pI++;
+            m_tok.n = 1;
+        }
+        else
+        {
+            m_tok.kind = K_SYMBOL;
+            m_tok.z = m_pI;
+            m_tok.n = 1;
+
+            switch (c)
+            {
+            case '(':
+            case ')':
+            case ',':
+            case '.':
+            case '*':
+            case ';':
+            case '=':
+            case '-':
+                break;
+
+            case '<':
+                if (m_pI + 1 < m_pEnd && (m_pI[1] == '>' || m_pI[1] == '='))
+                {
+                    m_tok.n = 2;
+                }
+                break;
+
+            case '>':
+                if (m_pI + 1 < m_pEnd && m_pI[1] == '=')
+                {
+                    m_tok.n = 2;
+                }
+                break;
+
+            case '!':
+                rv = (m_pI + 1 < m_pEnd && m_pI[1] == '=');
+                m_tok.n = 2;
+                break;
+
+            default:
+                rv = false;
+            }
+
+            if (rv)
+            {
+                m_pI += m_tok.n;
+
+                // Things like "<=>" and "==".
+                rv = (m_pI == m_pEnd) || (*m_pI != '=' && *m_pI != '>' && *m_pI != '<');
+            }
+        }
+
+        return rv;
+    }
+
+    /**
+     * Is the current token a specific keyword.
+     *
+     * @param zWord  An UPPERCASE keyword.
+     */
+    bool is_word(const char* zWord) const
+    {
+        bool rv = false;
+
+        if (m_tok.kind == K_WORD)
+        {
+            const char* z = m_tok.z;
+            const char* zEnd = z + m_tok.n;
+
+            while (z < zEnd && *zWord && toupper(*z) == *zWord)
+            {
+                ++z;
+                ++zWord;
+            }
+
+            rv = (z == zEnd) && !*zWord;
+        }
+
+        return rv;
+    }
+
+    bool is_symbol(char c) const
+    {
+        return m_tok.kind == K_SYMBOL && m_tok.n == 1 && *m_tok.z == c;
+    }
+
+    bool accept_word(const char* zWord)
+    {
+        return is_word(zWord) && next();
+    }
+
+    bool accept_symbol(char c)
+    {
+        return is_symbol(c) && next();
+    }
+
+    /**
+     * Is the current token an identifier, that is, a quoted identifier or
+     * an unquoted one that is not a keyword.
+     */
+    bool is_identifier()
+    {
+        bool rv = false;
+
+        if (m_tok.kind == K_QUOTED)
+        {
+            rv = true;
+        }
+        else if (m_tok.kind == K_WORD)
+        {
+            if (m_tok.identifier == -1)
+            {
+                m_tok.identifier = 0;
+
+                if (m_tok.n <= MAX_NAME_LEN)
+                {
+                    char zWord[MAX_NAME_LEN + 1];
+                    memcpy(zWord, m_tok.z, m_tok.n);
+                    zWord[m_tok.n] = 0;
+
+                    m_tok.identifier = !m_is_keyword(zWord);
+                }
+            }
+
+            rv = m_tok.identifier;
+        }
+
+        return rv;
+    }
+
+    bool parse_identifier(Name* pName)
+    {
+        bool rv = is_identifier();
+
+        if (rv)
+        {
+            pName->z = m_tok.z;
+            pName->n = m_tok.n;
+            rv = next();
+        }
+
+        return rv;
+    }
+
+    /**
+     * Parse [[database.]table.]column. If @c allow_star is true, the column
+     * may also be '*', provided the name has at most two parts, as in sqlite.
+     */
+    bool parse_field(Field* pField, bool allow_star)
+    {
+        memset(pField, 0, sizeof(*pField));
+
+        Name names[3];
+        int n = 0;
+
+        if (!parse_identifier(&names[n++]))
+        {
+            return false;
+        }
+
+        while (is_symbol('.'))
+        {
+            if (n == 3 || !next())
+            {
+                return false;
+            }
+
+            if (is_identifier())
+            {
+                if (!parse_identifier(&names[n++]))
+                {
+                    return false;
+                }
+            }
+            else if (allow_star && is_symbol('*') && n == 1)
+            {
+                static const char STAR[] = "*";
+                names[n].z = STAR;
+                names[n].n = 1;
+                ++n;
+
+                // Nothing may follow a '*'.
+                return next() && !is_symbol('.') && set_field(pField, names, n);
+            }
+            else
+            {
+                return false;
+            }
+        }
+
+        return set_field(pField, names, n);
+    }
+
+    static bool set_field(Field* pField, const Name* pNames, int n)
+    {
+        switch (n)
+        {
+        case 3:
+            pField->database = pNames[0];
+            pField->table = pNames[1];
+            pField->column = pNames[2];
+            break;
+
+        case 2:
+            pField->table = pNames[0];
+            pField->column = pNames[1];
+            break;
+
+        default:
+            pField->column = pNames[0];
+        }
+
+        return true;
+    }
+
+    bool parse_table()
+    {
+        Name first;
+
+        if (!parse_identifier(&first))
+        {
+            return false;
+        }
+
+        if (is_symbol('.'))
+        {
+            m_table.database = first;
+
+            if (!next() || !parse_identifier(&m_table.table))
+            {
+                return false;
+            }
+        }
+        else
+        {
+            m_table.table = first;
+        }
+
+        return true;
+    }
+
+    bool parse_alias()
+    {
+        bool rv = true;
+
+        if (is_word("AS"))
+        {
+            rv = next() && parse_identifier(&m_alias);
+        }
+        else if (is_identifier())
+        {
+            rv = parse_identifier(&m_alias);
+        }
+
+        return rv;
+    }
+
+    bool add_field(const Field& field)
+    {
+        bool rv = m_n_fields < MAX_FIELDS;
+
+        if (rv)
+        {
+            m_fields[m_n_fields++] = field;
+        }
+
+        return rv;
+    }
+
+    /**
+     * Add a field referred to in the WHERE clause, unless it is an unqualified
+     * name that is also present in the select or set list.
+     */
+    bool add_where_field(const Field& field)
+    {
+        if (!field.table.z)
+        {
+            for (int i = 0; i < m_n_excludes; ++i)
+            {
+                const Name& exclude = m_excludes[i];
+
+                if (exclude.n == field.column.n && strncasecmp(exclude.z, field.column.z, exclude.n) == 0)
+                {
+                    return true;
+                }
+            }
+        }
+
+        return add_field(field);
+    }
+
+    bool add_exclude(const Name& name)
+    {
+        bool rv = m_n_excludes < MAX_EXCLUDES;
+
+        if (rv)
+        {
+            m_excludes[m_n_excludes++] = name;
+        }
+
+        return rv;
+    }
+
+    bool add_function(const char* zName)
+    {
+        bool rv = m_n_functions < MAX_FUNCTIONS;
+
+        if (rv)
+        {
+            m_functions[m_n_functions++] = zName;
+        }
+
+        return rv;
+    }
+
+    /**
+     * Add an operand as an argument of a function, if it is a field.
+     *
+     * @param function  The index of the function.
+     * @param operand   The operand.
+     */
+    bool add_argument(int function, const Operand& operand)
+    {
+        bool rv = true;
+
+        if (operand.is_field)
+        {
+            rv = m_n_arguments < MAX_ARGUMENTS;
+
+            if (rv)
+            {
+                Argument& argument = m_arguments[m_n_arguments++];
+                argument.function = function;
+                argument.field = operand.field;
+            }
+        }
+
+        return rv;
+    }
+
+    /**
+     * Add an operand of the WHERE clause, as an argument of a function and as a field.
+     */
+    bool add_operand(int function, const Operand& operand)
+    {
+        return add_argument(function, operand)
+               && (!operand.is_field || add_where_field(operand.field))
+               && add_uminus(operand);
+    }
+
+    /**
+     * Parse a literal, a placeholder or a negated number or placeholder.
+     */
+    bool parse_literal(bool* pIs_negative)
+    {
+        *pIs_negative = false;
+
+        if (is_symbol('-'))
+        {
+            *pIs_negative = true;
+
+            if (!next())
+            {
+                return false;
+            }
+
+            return (m_tok.kind == K_NUMBER || m_tok.kind == K_PARAM) && next();
+        }
+
+        return (m_tok.kind == K_NUMBER
+                || m_tok.kind == K_STRING
+                || m_tok.kind == K_PARAM
+                || is_word("NULL")
+                || is_word("TRUE")
+                || is_word("FALSE")) && next();
+    }
+
+    bool parse_operand(Operand* pOperand)
+    {
+        pOperand->is_field = false;
+        pOperand->is_negative = false;
+
+        if (m_tok.kind == K_QUOTED || m_tok.kind == K_WORD)
+        {
+            if (is_word("NULL") || is_word("TRUE") || is_word("FALSE"))
+            {
+                return next();
+            }
+
+            pOperand->is_field = true;
+            return parse_field(&pOperand->field, false);
+        }
+
+        return parse_literal(&pOperand->is_negative);
+    }
+
+    bool add_uminus(const Operand& operand)
+    {
+        return !operand.is_negative || add_function("-");
+    }
+
+    /**
+     * Parse a predicate, that is, a comparison, [NOT] IN, [NOT] BETWEEN or IS [NOT] NULL.
+     */
+    bool parse_predicate()
+    {
+        Operand left;
+
+        if (!parse_operand(&left))
+        {
+            return false;
+        }
+
+        bool negated = false;
+        const char* zOp = NULL;
+
+        if (m_tok.kind == K_SYMBOL)
+        {
+            switch (*m_tok.z)
+            {
+            case '=':
+                zOp = "=";
+                break;
+
+            case '!':
+                zOp = "<>";
+                break;
+
+            case '<':
+                zOp = (m_tok.n == 1) ? "<" : (m_tok.z[1] == '=' ? "<=" : "<>");
+                break;
+
+            case '>':
+                zOp = (m_tok.n == 1) ? ">" : ">=";
+                break;
+
+            default:
+                return false;
+            }
+
+            Operand right;
+            int i = m_n_functions;
+
+            return next()
+                   && parse_operand(&right)
+                   && add_function(zOp)
+                   && add_operand(i, left)
+                   && add_operand(i, right);
+        }
+        else if (is_word("IS"))
+        {
+            if (!next())
+            {
+                return false;
+            }
+
+            if (is_word("NOT"))
+            {
+                negated = true;
+
+                if (!next())
+                {
+                    return false;
+                }
+            }
+
+            int i = m_n_functions;
+
+            return accept_word("NULL")
+                   && add_function(negated ? "isnotnull" : "isnull")
+                   && add_operand(i, left);
+        }
+
+        if (is_word("NOT"))
+        {
+            negated = true;
+
+            if (!next())
+            {
+                return false;
+            }
+        }
+
+        if (is_word("IN"))
+        {
+            return next() && parse_in_list(left, negated);
+        }
+        else if (is_word("BETWEEN"))
+        {
+            Operand low;
+            Operand high;
+            int i = m_n_functions;
+
+            return next()
+                   && parse_operand(&low)
+                   && accept_word("AND")
+                   && parse_operand(&high)
+                   && add_function("between")
+                   && add_operand(i, left)
+                   && add_operand(i, low)
+                   && add_operand(i, high);
+        }
+
+        return false;
+    }
+
+    /**
+     * Parse the list of [NOT] IN. A list of one element is reported as a
+     * comparison, the way sqlite does it.
+     */
+    bool parse_in_list(const Operand& left, bool negated)
+    {
+        // The name is known only once the number of elements is known.
+        int i = m_n_functions;
+        int n = 0;
+
+        if (!accept_symbol('(') || !add_function(NULL) || !add_operand(i, left))
+        {
+            return false;
+        }
+
+        do
+        {
+            Operand element;
+
+            if (!parse_operand(&element) || !add_operand(i, element))
+            {
+                return false;
+            }
+
+            ++n;
+        }
+        while (accept_symbol(','));
+
+        m_functions[i] = (n == 1) ? (negated ? "<>" : "=") : "in";
+
+        return accept_symbol(')');
+    }
+
+    bool parse_term()
+    {
+        if (is_word("NOT"))
+        {
+            return next() && parse_term();
+        }
+        else if (is_symbol('('))
+        {
+            return next() && parse_condition() && accept_symbol(')');
+        }
+
+        return parse_predicate();
+    }
+
+    bool parse_condition()
+    {
+        bool rv = parse_term();
+
+        while (rv && (is_word("AND") || is_word("OR")))
+        {
+            rv = next() && parse_term();
+        }
+
+        return rv;
+    }
+
+    bool parse_where()
+    {
+        bool rv = true;
+
+        if (is_word("WHERE"))
+        {
+            m_has_clause = true;
+            rv = next() && parse_condition();
+        }
+
+        return rv;
+    }
+
+    bool parse_order_by()
+    {
+        bool rv = true;
+
+        if (is_word("ORDER"))
+        {
+            rv = next() && accept_word("BY");
+
+            do
+            {
+                Field field;
+
+                rv = rv && (m_tok.kind == K_NUMBER ? next() : parse_field(&field, false));
+
+                if (rv && (is_word("ASC") || is_word("DESC")))
+                {
+                    rv = next();
+                }
+            }
+            while (rv && accept_symbol(','));
+        }
+
+        return rv;
+    }
+
+    bool parse_limit(bool allow_offset)
+    {
+        bool rv = true;
+
+        if (is_word("LIMIT"))
+        {
+            rv = next() && (m_tok.kind == K_NUMBER || m_tok.kind == K_PARAM) && next();
+
+            if (rv && allow_offset && (is_symbol(',') || is_word("OFFSET")))
+            {
+                rv = next() && (m_tok.kind == K_NUMBER || m_tok.kind == K_PARAM) && next();
+            }
+        }
+
+        return rv;
+    }
+
+    /**
+     * Check that the statement ends at the current token.
+     */
+    bool parse_end()
+    {
+        if (is_symbol(';'))
+        {
+            // Multi-statements are left to sqlite.
+            return next() && m_tok.kind == K_END;
+        }
+
+        return m_tok.kind == K_END;
+    }
+
+    bool parse_select()
+    {
+        m_operation = QUERY_OP_SELECT;
+        m_type_mask = QUERY_TYPE_READ;
+
+        if (!next() || (is_word("DISTINCT") && !next()))
+        {
+            return false;
+        }
+
+        do
+        {
+            if (is_symbol('*'))
+            {
+                static const char STAR[] = "*";
+                Field field;
+                memset(&field, 0, sizeof(field));
+                field.column.z = STAR;
+                field.column.n = 1;
+
+                if (!next() || !add_field(field))
+                {
+                    return false;
+                }
+            }
+            else if (m_tok.kind == K_QUOTED
+                     || (m_tok.kind == K_WORD && !is_word("NULL") && !is_word("TRUE") && !is_word("FALSE")))
+            {
+                Field field;
+
+                if (!parse_field(&field, true) || !add_field(field) || !add_exclude(field.column))
+                {
+                    return false;
+                }
+            }
+            else
+            {
+                bool is_negative;
+
+                if (!parse_literal(&is_negative) || (is_negative && !add_function("-")))
+                {
+                    return false;
+                }
+            }
+        }
+        while (accept_symbol(','));
+
+        if (!is_word("FROM"))
+        {
+            return parse_end();
+        }
+
+        if (!next() || !parse_table())
+        {
+            return false;
+        }
+
+        if (!parse_alias())
+        {
+            return false;
+        }
+
+        if (!parse_where() || !parse_order_by() || !parse_limit(true))
+        {
+            return false;
+        }
+
+        if (is_word("FOR"))
+        {
+            if (!next() || !accept_word("UPDATE"))
+            {
+                return false;
+            }
+
+            m_type_mask = QUERY_TYPE_WRITE;
+        }
+
+        return parse_end();
+    }
+
+    bool parse_update()
+    {
+        m_operation = QUERY_OP_UPDATE;
+        m_type_mask = QUERY_TYPE_WRITE;
+
+        if (!next() || !parse_table())
+        {
+            return false;
+        }
+
+        if (!parse_alias())
+        {
+            return false;
+        }
+
+        if (!accept_word("SET"))
+        {
+            return false;
+        }
+
+        do
+        {
+            Operand column;
+            Operand value;
+            int i = m_n_functions;
+
+            column.is_field = true;
+            column.is_negative = false;
+
+            if (!parse_field(&column.field, false)
+                || !accept_symbol('=')
+                || !parse_operand(&value)
+                || !add_function("=")
+                || !add_argument(i, column)
+                || !add_argument(i, value)
+                || !add_field(column.field)
+                || (value.is_field && !add_field(value.field))
+                || !add_uminus(value)
+                || !add_exclude(column.field.column))
+            {
+                return false;
+            }
+        }
+        while (accept_symbol(','));
+
+        return parse_where() && parse_order_by() && parse_limit(false) && parse_end();
+    }
+
+    bool parse_delete()
+    {
+        m_operation = QUERY_OP_DELETE;
+        m_type_mask = QUERY_TYPE_WRITE;
+
+        return next()
+               && accept_word("FROM")
+               && parse_table()
+               && parse_where()
+               && parse_order_by()
+               && parse_limit(false)
+               && parse_end();
+    }
+
+    bool parse_insert()
+    {
+        m_operation = QUERY_OP_INSERT;
+        m_type_mask = QUERY_TYPE_WRITE;
+
+        if (!next() || (is_word("IGNORE") && !next()) || (is_word("INTO") && !next()))
+        {
+            return false;
+        }
+
+        if (!parse_table())
+        {
+            return false;
+        }
+
+        if (is_symbol('('))
+        {
+            int first = m_n_fields;
+            int i = m_n_functions;
+
+            if (!next())
+            {
+                return false;
+            }
+
+            do
+            {
+                Field field;
+                memset(&field, 0, sizeof(field));
+
+                if (!parse_identifier(&field.column) || !add_field(field))
+                {
+                    return false;
+                }
+            }
+            while (accept_symbol(','));
+
+            if (!accept_symbol(')') || !add_function("="))
+            {
+                return false;
+            }
+
+            for (int j = first; j < m_n_fields; ++j)
+            {
+                Operand operand;
+                operand.is_field = true;
+                operand.field = m_fields[j];
+
+                if (!add_argument(i, operand))
+                {
+                    return false;
+                }
+            }
+        }
+
+        if (!(is_word("VALUES") || is_word("VALUE")) || !next())
+        {
+            return false;
+        }
+
+        do
+        {
+            if (!accept_symbol('('))
+            {
+                return false;
+            }
+
+            do
+            {
+                bool is_negative;
+
+                if (!parse_literal(&is_negative) || (is_negative && !add_function("-")))
+                {
+                    return false;
+                }
+            }
+            while (accept_symbol(','));
+
+            if (!accept_symbol(')'))
+            {
+                return false;
+            }
+        }
+        while (accept_symbol(','));
+
+        return parse_end();
+    }
+
+    bool (* m_is_keyword)(const char* zWord);
+    Token         m_tok;
+    qc_query_op_t m_operation;
+    uint32_t      m_type_mask;
+    bool          m_has_clause;
+    Field         m_table;
+    Name          m_alias;
+    Field         m_fields[MAX_FIELDS];
+    int           m_n_fields;
+    Argument      m_arguments[MAX_ARGUMENTS];
+    int           m_n_arguments;
+    const char*   m_functions[MAX_FUNCTIONS];
+    int           m_n_functions;
+    Name          m_excludes[MAX_EXCLUDES];
+    int           m_n_excludes;
+};
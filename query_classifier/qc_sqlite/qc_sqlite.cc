@@ -22,6 +22,7 @@
 #include <signal.h>
 #include <string.h>
 #include <algorithm>
+#include <atomic>
 #include <map>
 #include <new>
 #include <string>
@@ -37,6 +38,7 @@
 #include <maxscale/utils.h>
 
 #include "builtin_functions.h"
+#include "qc_fastpath.hh"
 
 using std::vector;
 
@@ -142,6 +144,7 @@ static struct
     qc_log_level_t   log_level;
     qc_sql_mode_t    sql_mode;
     qc_parse_as_t    parse_as;
+    bool             fast_path;
     QC_NAME_MAPPING* pFunction_name_mappings;
     std::mutex       lock;
 } this_unit;
@@ -1530,6 +1533,112 @@ public:
         return update_function_info(pAliases, name, NULL, NULL, pExclude);
     }
 
+    /**
+     * Classify a statement using the fast path parser, without involving sqlite.
+     * The information is collected using the same functions as when sqlite is
+     * used, so the result is identical.
+     *
+     * @param zQuery  The statement.
+     * @param len     The length of the statement.
+     *
+     * @return True, if the statement was classified, false if it must be parsed by sqlite.
+     */
+    bool classify_fast_path(const char* zQuery, size_t len)
+    {
+        if (m_sql_mode == QC_SQL_MODE_ORACLE)
+        {
+            return false;
+        }
+
+        QcFastPath parser(is_keyword);
+
+        if (!parser.parse(zQuery, len))
+        {
+            return false;
+        }
+
+        m_status = m_status_cap;
+        m_type_mask = parser.type_mask();
+        m_operation = parser.operation();
+        m_has_clause = parser.has_clause();
+
+        QcAliases aliases;
+        char database[QcFastPath::MAX_NAME_LEN + 1];
+        char table[QcFastPath::MAX_NAME_LEN + 1];
+        char column[QcFastPath::MAX_NAME_LEN + 1];
+
+        const QcFastPath::Field& from = parser.table();
+
+        if (from.table.z)
+        {
+            char alias[QcFastPath::MAX_NAME_LEN + 1];
+
+            update_names(from.database.copy(database),
+                         from.table.copy(table),
+                         parser.alias().copy(alias),
+                         &aliases);
+        }
+
+        for (int i = 0; i < parser.n_fields(); ++i)
+        {
+            const QcFastPath::Field& field = parser.field(i);
+
+            update_field_info(&aliases,
+                              0,
+                              field.database.copy(database),
+                              field.table.copy(table),
+                              field.column.copy(column),
+                              NULL);
+        }
+
+        for (int i = 0; i < parser.n_functions(); ++i)
+        {
+            const char* zName = parser.function(i);
+
+            if ((this_unit.parse_as == QC_PARSE_AS_103) && (strcmp(zName, "-") == 0))
+            {
+                // In MariaDB 10.3 a unary minus is not considered a function.
+                continue;
+            }
+
+            int j = update_function_info(&aliases, zName, NULL);
+
+            if (j != -1)
+            {
+                vector<QC_FIELD_INFO>& fields = m_function_field_usage[j];
+
+                for (int k = 0; k < parser.n_arguments(); ++k)
+                {
+                    const QcFastPath::Argument& argument = parser.argument(k);
+
+                    if (argument.function == i)
+                    {
+                        update_function_fields(&aliases,
+                                               argument.field.database.copy(database),
+                                               argument.field.table.copy(table),
+                                               argument.field.column.copy(column),
+                                               fields);
+                    }
+                }
+
+                if (fields.size() != 0)
+                {
+                    QC_FUNCTION_INFO& info = m_function_infos[j];
+
+                    info.fields = &fields[0];
+                    info.n_fields = fields.size();
+                }
+            }
+        }
+
+        return true;
+    }
+
+    static bool is_keyword(const char* zWord)
+    {
+        return sqlite3_test_control(SQLITE_TESTCTRL_ISKEYWORD, zWord) != 0;
+    }
+
     //
     // sqlite3 callbacks
     //
@@ -3344,7 +3453,7 @@ private:
 
 public:
     // TODO: Make these private once everything's been updated.
-    int32_t m_refs;                             // The reference count.
+    std::atomic<int32_t> m_refs;                // The reference count, cached infos are shared by threads.
     qc_parse_result_t m_status;                 // The validity of the information in this structure.
     qc_parse_result_t m_status_cap;             // The cap on 'm_status', it won't be set to higher than this.
     uint32_t m_collect;                         // What information should be collected.
@@ -3667,7 +3776,12 @@ static bool parse_query(GWBUF* query, uint32_t collect)
 
                     this_thread.pInfo->m_pQuery = s;
                     this_thread.pInfo->m_nQuery = len;
-                    parse_query_string(s, len, suppress_logging);
+
+                    if (!this_unit.fast_path || !pInfo->classify_fast_path(s, len))
+                    {
+                        parse_query_string(s, len, suppress_logging);
+                    }
+
                     this_thread.pInfo->m_pQuery = NULL;
                     this_thread.pInfo->m_nQuery = 0;
 
@@ -4559,6 +4673,7 @@ static bool get_key_and_value(char* arg, const char** pkey, const char** pvalue)
 
 static const char ARG_LOG_UNRECOGNIZED_STATEMENTS[] = "log_unrecognized_statements";
 static const char ARG_PARSE_AS[] = "parse_as";
+static const char ARG_FAST_PATH[] = "fast_path";
 
 static int32_t qc_sqlite_setup(qc_sql_mode_t sql_mode, const char* cargs)
 {
@@ -4567,6 +4682,7 @@ static int32_t qc_sqlite_setup(qc_sql_mode_t sql_mode, const char* cargs)
 
     qc_log_level_t log_level = QC_LOG_NOTHING;
     qc_parse_as_t parse_as = (sql_mode == QC_SQL_MODE_ORACLE) ? QC_PARSE_AS_103 : QC_PARSE_AS_DEFAULT;
+    bool fast_path = true;
     QC_NAME_MAPPING* function_name_mappings = function_name_mappings_default;
 
     if (cargs)
@@ -4617,6 +4733,22 @@ static int32_t qc_sqlite_setup(qc_sql_mode_t sql_mode, const char* cargs)
                                     key);
                     }
                 }
+                else if (strcmp(key, ARG_FAST_PATH) == 0)
+                {
+                    int truth = QcSqliteInfo::string_to_truth(value);
+
+                    if (truth != -1)
+                    {
+                        fast_path = truth;
+                    }
+                    else
+                    {
+                        MXS_WARNING("'%s' is not a boolean value for '%s'. "
+                                    "Using the fast path.",
+                                    value,
+                                    key);
+                    }
+                }
                 else
                 {
                     MXS_WARNING("'%s' is not a recognized argument.", key);
@@ -4644,6 +4776,7 @@ static int32_t qc_sqlite_setup(qc_sql_mode_t sql_mode, const char* cargs)
     this_unit.log_level = log_level;
     this_unit.sql_mode = sql_mode;
     this_unit.parse_as = parse_as;
+    this_unit.fast_path = fast_path;
     this_unit.pFunction_name_mappings = function_name_mappings;
 
     return this_unit.setup ? QC_RESULT_OK : QC_RESULT_ERROR;
@@ -0,0 +1,32 @@
+#! /bin/sh
+#
+# Classifies the statements of a test file with qc_sqlite, first with and then
+# without the fast path parser, and checks that the results are identical.
+#
+if [ $# -ne 2 ]
+then
+    echo "Usage: compare_fastpath.sh <compare executable> <test file>"
+    exit 1
+fi
+COMPARE=$1
+INPUT=$2
+NAME=`basename $INPUT .test`
+FAST=$NAME.fast_path.output
+SLOW=$NAME.no_fast_path.output
+
+if ! $COMPARE -0 qc_sqlite -A fast_path=true -v 3 $INPUT > $FAST \
+    || ! $COMPARE -0 qc_sqlite -A fast_path=false -v 3 $INPUT > $SLOW
+then
+    echo "FAILED: Could not classify the statements of $INPUT."
+    exit 1
+fi
+
+# The timings at the end of the output differ from run to run.
+if diff -I "classifier:" $SLOW $FAST
+then
+    echo "PASSED"
+    exit 0
+else
+    echo "FAILED: The fast path classified the statements of $INPUT differently."
+    exit 1
+fi
@@ -0,0 +1,596 @@
+/*
+ * Copyright (c) 2018 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2022-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <maxscale/buffer.hh>
+#include <maxscale/jansson.hh>
+#include <maxscale/log.h>
+#include <maxscale/paths.h>
+#include <maxscale/protocol/mysql.h>
+#include <maxscale/query_classifier.h>
+#include <maxscale/utils.hh>
+#include "testreader.hh"
+
+using namespace std;
+
+namespace
+{
+
+char USAGE[] =
+    "usage: qc_benchmark [-m masks] [-c sizes] [-t threads] [-r repeats] [-a args] [-j file] [-O] [file...]\n"
+    "\n"
+    "-m  comma separated list of collect masks, default \"0,15\"\n"
+    "-c  comma separated list of cache sizes in bytes, 0 disables the cache, default \"0,67108864\"\n"
+    "-t  comma separated list of thread counts, default \"1\"\n"
+    "-r  how many times each thread classifies the statements of a workload, default 10\n"
+    "-a  arguments passed to qc_sqlite\n"
+    "-j  write the results as JSON to file, '-' for stdout\n"
+    "-O  use the built-in OLTP workloads also when files are given\n"
+    "\n"
+    "Classifies the statements of each .test file and of the built-in OLTP workloads\n"
+    "with every combination of collect mask, cache size and thread count, and reports\n"
+    "the throughput, the latency percentiles and the allocations per statement.\n";
+
+/**
+ * Allocations are counted by interposing malloc and friends. Since the counters
+ * are thread local, every thread only sees the allocations it made itself.
+ */
+thread_local uint64_t this_thread_allocations = 0;
+}
+
+#ifdef __GLIBC__
+extern "C"
+{
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t nmemb, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+
+void* malloc(size_t size)
+{
+    ++this_thread_allocations;
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t nmemb, size_t size)
+{
+    ++this_thread_allocations;
+    return __libc_calloc(nmemb, size);
+}
+
+void* realloc(void* ptr, size_t size)
+{
+    ++this_thread_allocations;
+    return __libc_realloc(ptr, size);
+}
+}
+
+#define ALLOCATIONS_COUNTED true
+#else
+#define ALLOCATIONS_COUNTED false
+#endif
+
+namespace
+{
+
+struct Workload
+{
+    string         name;
+    vector<string> statements;
+};
+
+struct Result
+{
+    Result()
+        : statements(0)
+        , not_parsed(0)
+        , seconds(0)
+        , allocations(0)
+    {
+        memset(&cache, 0, sizeof(cache));
+    }
+
+    uint64_t         statements;
+    uint64_t         not_parsed;
+    double           seconds;   // Time spent in qc_parse().
+    uint64_t         allocations;
+    QC_CACHE_STATS   cache;
+    vector<uint32_t> latencies; // In nanoseconds.
+};
+
+GWBUF* create_query(const string& sql)
+{
+    size_t plen = sql.length() + 1;
+    GWBUF* buf = gwbuf_alloc(MYSQL_HEADER_LEN + plen);
+    uint8_t* data = GWBUF_DATA(buf);
+
+    gw_mysql_set_byte3(data, plen);
+    data[3] = 0;
+    data[4] = MXS_COM_QUERY;
+    memcpy(data + MYSQL_HEADER_LEN + 1, sql.c_str(), sql.length());
+
+    return buf;
+}
+
+/**
+ * Creates a workload resembling the transactions of sysbench oltp_read_only
+ * or oltp_read_write. The ids are random, but the same on every run.
+ */
+Workload create_oltp_workload(bool read_write, int n_transactions)
+{
+    const int N_TABLES = 10;
+    const int TABLE_SIZE = 1000000;
+    const int RANGE_SIZE = 100;
+
+    Workload workload;
+    workload.name = read_write ? "oltp_read_write" : "oltp_read_only";
+
+    mt19937 engine(read_write ? 4711 : 42);
+    uniform_int_distribution<int> table(1, N_TABLES);
+    uniform_int_distribution<int> id(1, TABLE_SIZE);
+    vector<string>& s = workload.statements;
+
+    auto t = [&]() {
+            return "sbtest" + to_string(table(engine));
+        };
+    auto range = [&]() {
+            int start = id(engine);
+            return " WHERE id BETWEEN " + to_string(start) + " AND " + to_string(start + RANGE_SIZE - 1);
+        };
+
+    for (int i = 0; i < n_transactions; ++i)
+    {
+        s.push_back("BEGIN");
+
+        for (int j = 0; j < 10; ++j)
+        {
+            s.push_back("SELECT c FROM " + t() + " WHERE id=" + to_string(id(engine)));
+        }
+
+        s.push_back("SELECT c FROM " + t() + range());
+        s.push_back("SELECT SUM(k) FROM " + t() + range());
+        s.push_back("SELECT c FROM " + t() + range() + " ORDER BY c");
+        s.push_back("SELECT DISTINCT c FROM " + t() + range() + " ORDER BY c");
+
+        if (read_write)
+        {
+            int deleted = id(engine);
+            string table_name = t();
+
+            s.push_back("UPDATE " + t() + " SET k=k+1 WHERE id=" + to_string(id(engine)));
+            s.push_back("UPDATE " + t() + " SET c='" + to_string(engine()) + "-" + to_string(engine())
+                        + "' WHERE id=" + to_string(id(engine)));
+            s.push_back("DELETE FROM " + table_name + " WHERE id=" + to_string(deleted));
+            s.push_back("INSERT INTO " + table_name + " (id, k, c, pad) VALUES (" + to_string(deleted)
+                        + ", " + to_string(id(engine)) + ", '" + to_string(engine()) + "', '"
+                        + to_string(engine()) + "')");
+        }
+
+        s.push_back("COMMIT");
+    }
+
+    return workload;
+}
+
+bool read_workload(const char* zFile, Workload* pWorkload)
+{
+    bool rv = false;
+    ifstream in(zFile);
+
+    if (in)
+    {
+        maxscale::TestReader reader(in);
+        string statement;
+
+        while (reader.get_statement(statement) == maxscale::TestReader::RESULT_STMT)
+        {
+            pWorkload->statements.push_back(statement);
+        }
+
+        pWorkload->name = zFile;
+        rv = true;
+    }
+    else
+    {
+        cerr << "error: Could not open '" << zFile << "'." << endl;
+    }
+
+    return rv;
+}
+
+bool parse_list(const char* zList, vector<int64_t>* pValues)
+{
+    bool rv = true;
+
+    for (const auto& s : mxs::strtok(zList, ","))
+    {
+        char* zEnd;
+        long long value = strtoll(s.c_str(), &zEnd, 0);
+
+        if (*zEnd == 0 && value >= 0)
+        {
+            pValues->push_back(value);
+        }
+        else
+        {
+            cerr << "error: '" << s << "' is not a valid value." << endl;
+            rv = false;
+        }
+    }
+
+    return rv && !pValues->empty();
+}
+
+void run_thread(const Workload& workload,
+                uint32_t collect,
+                int repeats,
+                atomic<int>* pReady,
+                atomic<bool>* pGo,
+                Result* pResult)
+{
+    qc_thread_init(QC_INIT_BOTH);
+
+    size_t n = workload.statements.size();
+    vector<GWBUF*> queries(n);
+    pResult->latencies.reserve(n * repeats);
+
+    ++*pReady;
+
+    while (!pGo->load())
+    {
+        this_thread::yield();
+    }
+
+    for (int i = 0; i < repeats; ++i)
+    {
+        // The parsing information is attached to the buffer, so fresh buffers
+        // are needed on each round. They are created before the measurement.
+        for (size_t j = 0; j < n; ++j)
+        {
+            queries[j] = create_query(workload.statements[j]);
+        }
+
+        uint64_t allocations = this_thread_allocations;
+        auto round_start = chrono::steady_clock::now();
+        auto start = round_start;
+
+        for (GWBUF* pQuery : queries)
+        {
+            if (qc_parse(pQuery, collect) != QC_QUERY_PARSED)
+            {
+                ++pResult->not_parsed;
+            }
+
+            auto end = chrono::steady_clock::now();
+            pResult->latencies.push_back(chrono::duration_cast<chrono::nanoseconds>(end - start).count());
+            start = end;
+        }
+
+        chrono::duration<double> secs = start - round_start;
+        pResult->seconds += secs.count();
+        // The latencies were reserved upfront, so pushing them does not allocate.
+        pResult->allocations += this_thread_allocations - allocations;
+        pResult->statements += n;
+
+        for (GWBUF* pQuery : queries)
+        {
+            gwbuf_free(pQuery);
+        }
+    }
+
+    qc_get_cache_stats(&pResult->cache);
+    qc_thread_end(QC_INIT_BOTH);
+}
+
+json_t* run(const Workload& workload, uint32_t collect, int64_t cache_size, int n_threads, int repeats)
+{
+    // A fresh shared cache, so that every run starts from a cold cache.
+    qc_process_end(QC_INIT_SELF);
+    qc_process_init(QC_INIT_SELF);
+
+    QC_CACHE_PROPERTIES properties {};
+    properties.max_size = cache_size;
+    qc_set_cache_properties(&properties);
+
+    vector<Result> results(n_threads);
+    vector<thread> threads;
+    atomic<int> ready {0};
+    atomic<bool> go {false};
+
+    for (int i = 0; i < n_threads; ++i)
+    {
+        threads.emplace_back(run_thread, cref(workload), collect, repeats, &ready, &go, &results[i]);
+    }
+
+    while (ready.load() != n_threads)
+    {
+        this_thread::yield();
+    }
+
+    go.store(true);
+
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+
+    Result total;
+    double stmts_per_sec = 0;
+
+    for (const auto& r : results)
+    {
+        total.statements += r.statements;
+        total.not_parsed += r.not_parsed;
+        total.allocations += r.allocations;
+        total.cache.hits += r.cache.hits;
+        total.cache.misses += r.cache.misses;
+        total.cache.shared_hits += r.cache.shared_hits;
+        total.latencies.insert(total.latencies.end(), r.latencies.begin(), r.latencies.end());
+
+        if (r.seconds > 0)
+        {
+            stmts_per_sec += r.statements / r.seconds;
+        }
+    }
+
+    sort(total.latencies.begin(), total.latencies.end());
+
+    auto percentile = [&total](double p) {
+            size_t n = total.latencies.size();
+            return n ? total.latencies[min(n - 1, (size_t)(p * n))] : 0;
+        };
+
+    json_t* pLatency = json_object();
+    json_object_set_new(pLatency, "p50", json_integer(percentile(0.50)));
+    json_object_set_new(pLatency, "p90", json_integer(percentile(0.90)));
+    json_object_set_new(pLatency, "p99", json_integer(percentile(0.99)));
+    json_object_set_new(pLatency, "p99.9", json_integer(percentile(0.999)));
+    json_object_set_new(pLatency, "max", json_integer(percentile(1)));
+
+    json_t* pCache = json_object();
+    json_object_set_new(pCache, "hits", json_integer(total.cache.hits));
+    json_object_set_new(pCache, "misses", json_integer(total.cache.misses));
+    json_object_set_new(pCache, "shared_hits", json_integer(total.cache.shared_hits));
+
+    json_t* pResult = json_object();
+    json_object_set_new(pResult, "workload", json_string(workload.name.c_str()));
+    json_object_set_new(pResult, "collect", json_integer(collect));
+    json_object_set_new(pResult, "cache_size", json_integer(cache_size));
+    json_object_set_new(pResult, "threads", json_integer(n_threads));
+    json_object_set_new(pResult, "statements", json_integer(total.statements));
+    json_object_set_new(pResult, "not_parsed", json_integer(total.not_parsed));
+    json_object_set_new(pResult, "stmts_per_sec", json_real(stmts_per_sec));
+    json_object_set_new(pResult, "latency_ns", pLatency);
+
+    if (ALLOCATIONS_COUNTED && total.statements)
+    {
+        json_object_set_new(pResult, "allocs_per_stmt",
+                            json_real((double)total.allocations / total.statements));
+    }
+
+    json_object_set_new(pResult, "cache", pCache);
+
+    return pResult;
+}
+
+void print(ostream& out, json_t* pResult)
+{
+    json_t* pLatency = json_object_get(pResult, "latency_ns");
+    json_t* pAllocs = json_object_get(pResult, "allocs_per_stmt");
+
+    out << left << setw(24) << json_string_value(json_object_get(pResult, "workload")) << right
+        << " collect " << setw(2) << json_integer_value(json_object_get(pResult, "collect"))
+        << ", cache " << setw(10) << json_integer_value(json_object_get(pResult, "cache_size"))
+        << ", threads " << setw(2) << json_integer_value(json_object_get(pResult, "threads"))
+        << ": " << fixed << setprecision(0) << setw(9)
+        << json_real_value(json_object_get(pResult, "stmts_per_sec")) << " stmts/s"
+        << ", p50/p99/p99.9 " << json_integer_value(json_object_get(pLatency, "p50"))
+        << "/" << json_integer_value(json_object_get(pLatency, "p99"))
+        << "/" << json_integer_value(json_object_get(pLatency, "p99.9")) << " ns";
+
+    if (pAllocs)
+    {
+        out << ", " << setprecision(1) << json_real_value(pAllocs) << " allocs/stmt";
+    }
+
+    out << endl;
+}
+}
+
+int main(int argc, char* argv[])
+{
+    int rv = EXIT_SUCCESS;
+
+    vector<int64_t> masks;
+    vector<int64_t> cache_sizes;
+    vector<int64_t> thread_counts;
+    int repeats = 10;
+    const char* zArgs = nullptr;
+    const char* zJson = nullptr;
+    bool oltp = false;
+
+    int c;
+    while ((c = getopt(argc, argv, "m:c:t:r:a:j:O")) != -1)
+    {
+        switch (c)
+        {
+        case 'm':
+            rv = parse_list(optarg, &masks) ? rv : EXIT_FAILURE;
+            break;
+
+        case 'c':
+            rv = parse_list(optarg, &cache_sizes) ? rv : EXIT_FAILURE;
+            break;
+
+        case 't':
+            rv = parse_list(optarg, &thread_counts) ? rv : EXIT_FAILURE;
+            break;
+
+        case 'r':
+            repeats = atoi(optarg);
+            break;
+
+        case 'a':
+            zArgs = optarg;
+            break;
+
+        case 'j':
+            zJson = optarg;
+            break;
+
+        case 'O':
+            oltp = true;
+            break;
+
+        default:
+            rv = EXIT_FAILURE;
+        }
+    }
+
+    if (masks.empty())
+    {
+        masks = {QC_COLLECT_ESSENTIALS, QC_COLLECT_ALL};
+    }
+
+    if (cache_sizes.empty())
+    {
+        cache_sizes = {0, 64 * 1024 * 1024};
+    }
+
+    if (thread_counts.empty())
+    {
+        thread_counts = {1};
+    }
+
+    vector<Workload> workloads;
+
+    for (int i = optind; (rv == EXIT_SUCCESS) && (i < argc); ++i)
+    {
+        Workload workload;
+
+        if (read_workload(argv[i], &workload))
+        {
+            workloads.push_back(workload);
+        }
+        else
+        {
+            rv = EXIT_FAILURE;
+        }
+    }
+
+    if (oltp || optind == argc)
+    {
+        workloads.push_back(create_oltp_workload(false, 100));
+        workloads.push_back(create_oltp_workload(true, 100));
+    }
+
+    if ((rv == EXIT_SUCCESS) && (repeats > 0))
+    {
+        rv = EXIT_FAILURE;
+
+        set_datadir(strdup("/tmp"));
+        set_langdir(strdup("."));
+        set_process_datadir(strdup("/tmp"));
+
+        if (mxs_log_init(NULL, ".", MXS_LOG_TARGET_DEFAULT))
+        {
+            if (qc_setup(nullptr, QC_SQL_MODE_DEFAULT, "qc_sqlite", zArgs)
+                && qc_process_init(QC_INIT_BOTH))
+            {
+                json_t* pResults = json_array();
+                bool text = !zJson || strcmp(zJson, "-") != 0;
+
+                for (const auto& workload : workloads)
+                {
+                    for (auto mask : masks)
+                    {
+                        for (auto cache_size : cache_sizes)
+                        {
+                            for (auto n_threads : thread_counts)
+                            {
+                                json_t* pResult = run(workload, mask, cache_size, n_threads, repeats);
+
+                                if (text)
+                                {
+                                    print(cout, pResult);
+                                }
+
+                                json_array_append_new(pResults, pResult);
+                            }
+                        }
+                    }
+                }
+
+                rv = EXIT_SUCCESS;
+
+                if (zJson)
+                {
+                    json_t* pOutput = json_object();
+                    json_object_set_new(pOutput, "classifier", json_string("qc_sqlite"));
+                    json_object_set_new(pOutput, "args", json_string(zArgs ? zArgs : ""));
+                    json_object_set_new(pOutput, "repeats", json_integer(repeats));
+                    json_object_set_new(pOutput, "results", pResults);
+
+                    int flags = JSON_INDENT(4) | JSON_PRESERVE_ORDER;
+
+                    if (text)
+                    {
+                        if (json_dump_file(pOutput, zJson, flags) != 0)
+                        {
+                            cerr << "error: Could not write results to '" << zJson << "'." << endl;
+                            rv = EXIT_FAILURE;
+                        }
+                    }
+                    else
+                    {
+                        json_dumpf(pOutput, stdout, flags);
+                        fputc('\n', stdout);
+                    }
+
+                    json_decref(pOutput);
+                }
+                else
+                {
+                    json_decref(pResults);
+                }
+
+                qc_process_end(QC_INIT_BOTH);
+            }
+            else
+            {
+                cerr << "error: Could not initialize qc_sqlite." << endl;
+            }
+
+            mxs_log_finish();
+        }
+        else
+        {
+            cerr << "error: Could not initialize log." << endl;
+        }
+    }
+    else
+    {
+        cout << USAGE << endl;
+    }
+
+    return rv;
+}
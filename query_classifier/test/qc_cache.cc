@@ -80,13 +80,18 @@ int main(int argc, char* argv[])
 
     QC_CACHE_PROPERTIES* pCache_properties = nullptr;
     const char* zStatement = nullptr;
+    const char* zArgs = nullptr;
     int n = 0;
 
     int c;
-    while ((c = getopt(argc, argv, "cns:#:")) != -1)
+    while ((c = getopt(argc, argv, "a:cns:#:")) != -1)
     {
         switch (c)
         {
+        case 'a':
+            zArgs = optarg;
+            break;
+
         case 'c':
             {
                 static QC_CACHE_PROPERTIES cache_properties;
@@ -126,7 +131,7 @@ int main(int argc, char* argv[])
                  << (pCache_properties ? "using " : "NOT using ")
                  << "the query classification cache." << endl;
 
-            if (qc_setup(pCache_properties, QC_SQL_MODE_DEFAULT, "qc_sqlite", NULL)
+            if (qc_setup(pCache_properties, QC_SQL_MODE_DEFAULT, "qc_sqlite", zArgs)
                 && qc_process_init(QC_INIT_BOTH)
                 && qc_thread_init(QC_INIT_BOTH))
             {
@@ -151,7 +156,7 @@ int main(int argc, char* argv[])
     }
     else
     {
-        cerr << "usage: qc_cache [-(c|n)] -s statement -# iterations" << endl;
+        cerr << "usage: qc_cache [-(c|n)] [-a args] -s statement -# iterations" << endl;
     }
 
     return rv;
@@ -13,6 +13,7 @@
 
 #include <maxscale/backend.hh>
 
+#include <algorithm>
 #include <sstream>
 
 #include <maxbase/atomic.hh>
@@ -68,7 +69,15 @@ void Backend::close(close_type type)
                 set_state(FATAL_FAILURE);
             }
 
-            dcb_close(m_dcb);
+            if (type == CLOSE_RELEASE)
+            {
+                dcb_release(m_dcb);
+            }
+            else
+            {
+                dcb_close(m_dcb);
+            }
+
             m_dcb = NULL;
 
             /** decrease server current connection counters */
@@ -81,6 +90,25 @@ void Backend::close(close_type type)
     }
 }
 
+void Backend::take_ownership()
+{
+    gwbuf_take_ownership(m_pending_cmd.get());
+
+    for (auto& sescmd : m_session_commands)
+    {
+        sescmd->take_ownership();
+    }
+}
+
+bool Backend::can_release() const
+{
+    return in_use()
+           && !is_waiting_result()
+           && m_session_commands.empty()
+           && m_backend->server->persistpoolmax > 0
+           && (m_dcb->func.established == NULL || m_dcb->func.established(m_dcb));
+}
+
 bool Backend::execute_session_command()
 {
     if (is_closed() || !has_session_commands())
@@ -141,6 +169,30 @@ uint64_t Backend::complete_session_command()
     return rval;
 }
 
+bool Backend::discard_session_command(uint64_t position)
+{
+    auto it = m_session_commands.begin();
+
+    if (it != m_session_commands.end() && is_waiting_result())
+    {
+        // The first command has already been sent to the server
+        ++it;
+    }
+
+    it = std::find_if(it, m_session_commands.end(), [position](const SSessionCommand& sescmd) {
+                          return sescmd->get_position() == position;
+                      });
+
+    bool rval = it != m_session_commands.end();
+
+    if (rval)
+    {
+        m_session_commands.erase(it);
+    }
+
+    return rval;
+}
+
 size_t Backend::session_command_count() const
 {
     return m_session_commands.size();
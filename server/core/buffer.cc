@@ -15,6 +15,7 @@
 
 #include <errno.h>
 #include <stdlib.h>
+#include <atomic>
 #include <sstream>
 
 #include <maxbase/assert.h>
@@ -24,18 +25,320 @@
 #include <maxscale/utils.h>
 #include <maxscale/routingworker.hh>
 
+#include "internal/buffer.hh"
+
 using mxs::RoutingWorker;
 
 static void             gwbuf_free_one(GWBUF* buf);
 static buffer_object_t* gwbuf_remove_buffer_object(GWBUF* buf,
                                                    buffer_object_t* bufobj);
 
+namespace
+{
+
+/** Buffers with at most this many bytes of data are allocated with the GWBUF header */
+const size_t INLINE_DATA_SIZE = 256;
+
+/** The maximum number of bytes a pool keeps cached in the free list of one size class */
+const size_t MAX_CACHED_BYTES = 1024 * 1024;
+
+class BufferPool;
+
+/**
+ * The prefix of every chunk of memory handed out by the buffer pools. The size
+ * is a multiple of 16 so that the memory after it has the alignment of malloc.
+ */
+struct Chunk
+{
+    BufferPool* pool;   /**< The pool the chunk belongs to, NULL if it is not pooled */
+    int64_t     index;  /**< The size class of the chunk */
+};
+
+/** A free chunk, the link is stored in the memory after the chunk prefix */
+struct FreeChunk
+{
+    Chunk      chunk;
+    FreeChunk* next;
+};
+
+/**
+ * Per routing worker pool of GWBUF headers and SHARED_BUF payloads.
+ *
+ * The pool is only used by the thread that created it. Chunks freed by other threads
+ * are pushed to a lock-free list that the owning thread collects when its own free
+ * lists run empty.
+ */
+class BufferPool
+{
+public:
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    enum
+    {
+        HEADER,         /**< A GWBUF header */
+        INLINE,         /**< A GWBUF header followed by a SHARED_BUF of INLINE_DATA_SIZE bytes */
+        FIRST_PAYLOAD,  /**< The first of the power of two sized SHARED_BUF classes */
+        N_CLASSES = FIRST_PAYLOAD + 9
+    };
+
+    BufferPool()
+        : m_remote(nullptr)
+    {
+        m_size[HEADER] = sizeof(GWBUF);
+        m_size[INLINE] = sizeof(GWBUF) + sizeof(SHARED_BUF) + INLINE_DATA_SIZE;
+
+        for (int i = FIRST_PAYLOAD; i < N_CLASSES; i++)
+        {
+            m_size[i] = 64 << (i - FIRST_PAYLOAD);
+        }
+
+        for (int i = 0; i < N_CLASSES; i++)
+        {
+            m_free[i] = nullptr;
+            m_nfree[i] = 0;
+            m_max_free[i] = MAX_CACHED_BYTES / m_size[i];
+        }
+
+        memset(&m_stats, 0, sizeof(m_stats));
+    }
+
+    /**
+     * Get the pool of the calling thread
+     *
+     * @return The pool or NULL if the calling thread is not a routing worker
+     */
+    static BufferPool* get()
+    {
+        static thread_local BufferPool* pool = nullptr;
+
+        if (!pool && RoutingWorker::get_current_id() != -1)
+        {
+            // The pool is never deleted as buffers allocated from it may outlive the worker.
+            pool = new(std::nothrow) BufferPool;
+        }
+
+        return pool;
+    }
+
+    /**
+     * Get the size class for a payload
+     *
+     * @param size Size of the memory
+     *
+     * @return The size class or -1 if the memory is too large to be pooled
+     */
+    int payload_class(size_t size) const
+    {
+        for (int i = FIRST_PAYLOAD; i < N_CLASSES; i++)
+        {
+            if (size <= m_size[i])
+            {
+                return i;
+            }
+        }
+
+        return -1;
+    }
+
+    void* alloc(int index)
+    {
+        FreeChunk* free_chunk = m_free[index];
+
+        if (!free_chunk && m_remote.load(std::memory_order_relaxed))
+        {
+            collect_remote();
+            free_chunk = m_free[index];
+        }
+
+        Chunk* chunk;
+
+        if (free_chunk)
+        {
+            m_free[index] = free_chunk->next;
+            --m_nfree[index];
+            ++m_stats.hits;
+            chunk = &free_chunk->chunk;
+        }
+        else
+        {
+            ++m_stats.misses;
+            chunk = (Chunk*)MXS_MALLOC(sizeof(Chunk) + m_size[index]);
+
+            if (!chunk)
+            {
+                return nullptr;
+            }
+
+            chunk->pool = this;
+            chunk->index = index;
+        }
+
+        return chunk + 1;
+    }
+
+    /**
+     * Free a chunk of this pool. Called by the thread that owns the pool.
+     */
+    void free(Chunk* chunk)
+    {
+        int index = chunk->index;
+
+        if (m_nfree[index] < m_max_free[index])
+        {
+            FreeChunk* free_chunk = reinterpret_cast<FreeChunk*>(chunk);
+            free_chunk->next = m_free[index];
+            m_free[index] = free_chunk;
+            ++m_nfree[index];
+        }
+        else
+        {
+            MXS_FREE(chunk);
+        }
+    }
+
+    /**
+     * Free a chunk of this pool. Called by some other thread than the owner.
+     */
+    void free_remote(Chunk* chunk)
+    {
+        FreeChunk* free_chunk = reinterpret_cast<FreeChunk*>(chunk);
+        free_chunk->next = m_remote.load(std::memory_order_relaxed);
+
+        while (!m_remote.compare_exchange_weak(free_chunk->next, free_chunk,
+                                               std::memory_order_release,
+                                               std::memory_order_relaxed))
+        {
+        }
+    }
+
+    mxs::BufferPoolStats stats() const
+    {
+        mxs::BufferPoolStats stats = m_stats;
+        stats.cached = 0;
+
+        for (int i = 0; i < N_CLASSES; i++)
+        {
+            stats.cached += m_nfree[i];
+        }
+
+        return stats;
+    }
+
+private:
+    void collect_remote()
+    {
+        // The whole list is taken at once, so there is no ABA problem with the concurrent pushes.
+        FreeChunk* free_chunk = m_remote.exchange(nullptr, std::memory_order_acquire);
+
+        while (free_chunk)
+        {
+            FreeChunk* next = free_chunk->next;
+            ++m_stats.remote_frees;
+            free(&free_chunk->chunk);
+            free_chunk = next;
+        }
+    }
+
+    size_t                  m_size[N_CLASSES];      /**< Size of the memory of each class */
+    FreeChunk*              m_free[N_CLASSES];      /**< Free lists */
+    size_t                  m_nfree[N_CLASSES];     /**< Length of the free lists */
+    size_t                  m_max_free[N_CLASSES];  /**< Maximum length of the free lists */
+    std::atomic<FreeChunk*> m_remote;               /**< Chunks freed by other threads */
+    mxs::BufferPoolStats    m_stats;
+};
+
+/**
+ * Allocate memory from the pool of the calling thread
+ *
+ * @param index The size class of the memory, -1 for memory that is not pooled
+ * @param size  The size of the memory
+ *
+ * @return Pointer to the memory or NULL on allocation failure
+ */
+void* pool_alloc(BufferPool* pool, int index, size_t size)
+{
+    if (pool && index != -1)
+    {
+        return pool->alloc(index);
+    }
+
+    Chunk* chunk = (Chunk*)MXS_MALLOC(sizeof(Chunk) + size);
+
+    if (!chunk)
+    {
+        return nullptr;
+    }
+
+    chunk->pool = nullptr;
+    chunk->index = -1;
+
+    return chunk + 1;
+}
+
+/**
+ * Free memory allocated with pool_alloc(). Can be called by any thread.
+ *
+ * @param ptr Memory to free
+ */
+void pool_free(void* ptr)
+{
+    Chunk* chunk = static_cast<Chunk*>(ptr) - 1;
+
+    if (!chunk->pool)
+    {
+        MXS_FREE(chunk);
+    }
+    else if (chunk->pool == BufferPool::get())
+    {
+        chunk->pool->free(chunk);
+    }
+    else
+    {
+        chunk->pool->free_remote(chunk);
+    }
+}
+
+GWBUF* alloc_header()
+{
+    BufferPool* pool = BufferPool::get();
+    return (GWBUF*)pool_alloc(pool, BufferPool::HEADER, sizeof(GWBUF));
+}
+
+SHARED_BUF* alloc_payload(size_t size)
+{
+    BufferPool* pool = BufferPool::get();
+    return (SHARED_BUF*)pool_alloc(pool, pool ? pool->payload_class(size) : -1, size);
+}
+
+/**
+ * Check whether a header is the one the shared buffer was allocated with
+ */
+inline bool is_inline_header(const GWBUF* buf)
+{
+    return (buf->sbuf->info & GWBUF_INFO_INLINE) && reinterpret_cast<const SHARED_BUF*>(buf + 1) == buf->sbuf;
+}
+}
+
+mxs::BufferPoolStats mxs::buffer_pool_stats()
+{
+    BufferPool* pool = BufferPool::get();
+    mxs::BufferPoolStats stats = {};
+
+    if (pool)
+    {
+        stats = pool->stats();
+    }
+
+    return stats;
+}
+
 /**
  * Allocate a new gateway buffer structure of size bytes.
  *
- * For now we allocate memory directly from malloc for buffer the management
- * structure and the actual data buffer itself. We may swap at a future date
- * to a more efficient mechanism.
+ * On routing workers the buffer management structure and the actual data buffer
+ * are taken from the free lists of the worker. Small buffers are allocated as one
+ * chunk that contains both the management structure and the data.
  *
  * @param       size The size in bytes of the data area required
  * @return      Pointer to the buffer structure or NULL if memory could not
@@ -43,19 +346,48 @@ static buffer_object_t* gwbuf_remove_buffer_object(GWBUF* buf,
  */
 GWBUF* gwbuf_alloc(unsigned int size)
 {
-    size_t sbuf_size = sizeof(SHARED_BUF) + (size ? size - 1 : 0);
-    GWBUF* rval = (GWBUF*)MXS_MALLOC(sizeof(GWBUF));
-    SHARED_BUF* sbuf = (SHARED_BUF*)MXS_MALLOC(sbuf_size);
+    GWBUF* rval;
+    SHARED_BUF* sbuf;
 
-    if (rval == NULL || sbuf == NULL)
+    if (size <= INLINE_DATA_SIZE)
     {
-        MXS_FREE(rval);
-        MXS_FREE(sbuf);
-        return NULL;
+        BufferPool* pool = BufferPool::get();
+        size_t inline_size = sizeof(GWBUF) + sizeof(SHARED_BUF) + INLINE_DATA_SIZE;
+        rval = (GWBUF*)pool_alloc(pool, BufferPool::INLINE, inline_size);
+
+        if (rval == NULL)
+        {
+            return NULL;
+        }
+
+        sbuf = reinterpret_cast<SHARED_BUF*>(rval + 1);
+        sbuf->info = GWBUF_INFO_INLINE;
+    }
+    else
+    {
+        size_t sbuf_size = sizeof(SHARED_BUF) + size - 1;
+        rval = alloc_header();
+        sbuf = alloc_payload(sbuf_size);
+
+        if (rval == NULL || sbuf == NULL)
+        {
+            if (rval)
+            {
+                pool_free(rval);
+            }
+
+            if (sbuf)
+            {
+                pool_free(sbuf);
+            }
+
+            return NULL;
+        }
+
+        sbuf->info = GWBUF_INFO_NONE;
     }
 
     sbuf->refcount = 1;
-    sbuf->info = GWBUF_INFO_NONE;
     sbuf->bufobj = NULL;
 
 #ifdef SS_DEBUG
@@ -110,6 +442,16 @@ void gwbuf_free(GWBUF* buf)
     }
 }
 
+void gwbuf_take_ownership(GWBUF* buf)
+{
+#ifdef SS_DEBUG
+    for (; buf; buf = buf->next)
+    {
+        buf->owner = RoutingWorker::get_current_id();
+    }
+#endif
+}
+
 /**
  * Free a single gateway buffer
  *
@@ -117,18 +459,25 @@ void gwbuf_free(GWBUF* buf)
  */
 static void gwbuf_free_one(GWBUF* buf)
 {
-    --buf->sbuf->refcount;
+    SHARED_BUF* sbuf = buf->sbuf;
+    bool inline_header = is_inline_header(buf);
+    bool inline_sbuf = sbuf->info & GWBUF_INFO_INLINE;
 
-    if (buf->sbuf->refcount == 0)
+    --sbuf->refcount;
+
+    if (sbuf->refcount == 0)
     {
-        buffer_object_t* bo = buf->sbuf->bufobj;
+        buffer_object_t* bo = sbuf->bufobj;
 
         while (bo != NULL)
         {
             bo = gwbuf_remove_buffer_object(buf, bo);
         }
 
-        MXS_FREE(buf->sbuf);
+        if (!inline_sbuf)
+        {
+            pool_free(sbuf);
+        }
     }
 
     while (buf->properties)
@@ -147,7 +496,17 @@ static void gwbuf_free_one(GWBUF* buf)
         hint_free(h);
     }
 
-    MXS_FREE(buf);
+    // The header a shared buffer was allocated with is released together with
+    // the shared buffer, which may still be referred to by clones.
+    if (!inline_header)
+    {
+        pool_free(buf);
+    }
+
+    if (inline_sbuf && sbuf->refcount == 0)
+    {
+        pool_free(reinterpret_cast<GWBUF*>(sbuf) - 1);
+    }
 }
 
 /**
@@ -162,13 +521,15 @@ static void gwbuf_free_one(GWBUF* buf)
  */
 static GWBUF* gwbuf_clone_one(GWBUF* buf)
 {
-    GWBUF* rval = (GWBUF*)MXS_CALLOC(1, sizeof(GWBUF));
+    GWBUF* rval = alloc_header();
 
     if (rval == NULL)
     {
         return NULL;
     }
 
+    rval->properties = NULL;
+
     mxb_assert(buf->owner == RoutingWorker::get_current_id());
     ++buf->sbuf->refcount;
 #ifdef SS_DEBUG
@@ -257,7 +618,7 @@ static GWBUF *gwbuf_clone_portion(GWBUF* buf,
     mxb_assert(buf->owner == RoutingWorker::get_current_id());
     mxb_assert(start_offset + length <= GWBUF_LENGTH(buf));
 
-    GWBUF* clonebuf = (GWBUF*)MXS_MALLOC(sizeof(GWBUF));
+    GWBUF* clonebuf = alloc_header();
 
     if (clonebuf == NULL)
     {
@@ -265,6 +626,7 @@ static GWBUF *gwbuf_clone_portion(GWBUF* buf,
     }
 
     ++buf->sbuf->refcount;
+    buf->sbuf->info |= GWBUF_INFO_SPLIT;
 #ifdef SS_DEBUG
     clonebuf->owner = RoutingWorker::get_current_id();
 #endif
@@ -316,8 +678,9 @@ GWBUF* gwbuf_split(GWBUF** buf, size_t length)
 
             if (length > 0)
             {
+                // The split buffers share the data, only the headers are new
                 mxb_assert(GWBUF_LENGTH(buffer) > length);
-                GWBUF* partial = gwbuf_deep_clone_portion(buffer, length);
+                GWBUF* partial = gwbuf_clone_portion(buffer, 0, length);
 
                 /** If the head points to the original head of the buffer chain
                  * and we are splitting a contiguous buffer, we only need to return
@@ -567,6 +930,8 @@ void gwbuf_add_buffer_object(GWBUF* buf,
     newb->bo_data = data;
     newb->bo_donefun_fp = donefun_fp;
     newb->bo_next = NULL;
+    newb->bo_start = buf->start;
+    newb->bo_end = buf->end;
 
     buffer_object_t** p_b = &buf->sbuf->bufobj;
     /** Search the end of the list and add there */
@@ -583,8 +948,11 @@ void* gwbuf_get_buffer_object_data(GWBUF* buf, bufobj_id_t id)
 {
     mxb_assert(buf->owner == RoutingWorker::get_current_id());
     buffer_object_t* bo = buf->sbuf->bufobj;
+    bool split = buf->sbuf->info & GWBUF_INFO_SPLIT;
 
-    while (bo != NULL && bo->bo_id != id)
+    // The parts of a split buffer are different statements or replies
+    while (bo != NULL
+           && (bo->bo_id != id || (split && (bo->bo_start != buf->start || bo->bo_end != buf->end))))
     {
         bo = bo->bo_next;
     }
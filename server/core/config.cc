@@ -85,14 +85,19 @@ const char CN_ARG_MIN[] = "arg_min";
 const char CN_ATTRIBUTES[] = "attributes";
 const char CN_AUTHENTICATOR[] = "authenticator";
 const char CN_AUTHENTICATOR_DIAGNOSTICS[] = "authenticator_diagnostics";
+const char CN_AUTHENTICATOR_STATISTICS[] = "authenticator_statistics";
 const char CN_AUTHENTICATOR_OPTIONS[] = "authenticator_options";
 const char CN_AUTH_ALL_SERVERS[] = "auth_all_servers";
 const char CN_AUTH_CONNECT_TIMEOUT[] = "auth_connect_timeout";
 const char CN_AUTH_READ_TIMEOUT[] = "auth_read_timeout";
 const char CN_AUTH_WRITE_TIMEOUT[] = "auth_write_timeout";
 const char CN_AUTO[] = "auto";
+const char CN_BACKEND_COMPRESSION[] = "backend_compression";
+const char CN_CACHE_PERSIST[] = "cache_persist";
 const char CN_CACHE_SIZE[] = "cache_size";
 const char CN_CLASSIFY[] = "classify";
+const char CN_CLIENT_COMPRESSION[] = "client_compression";
+const char CN_COMPRESSION_THRESHOLD[] = "compression_threshold";
 const char CN_CONNECTION_TIMEOUT[] = "connection_timeout";
 const char CN_DATA[] = "data";
 const char CN_DEFAULT[] = "default";
@@ -139,17 +144,22 @@ const char CN_PARAMETERS[] = "parameters";
 const char CN_PARSE_RESULT[] = "parse_result";
 const char CN_PASSIVE[] = "passive";
 const char CN_PASSWORD[] = "password";
+const char CN_POLL_BACKEND[] = "poll_backend";
 const char CN_POLL_SLEEP[] = "poll_sleep";
 const char CN_PORT[] = "port";
 const char CN_PROTOCOL[] = "protocol";
 const char CN_QUERY_CLASSIFIER[] = "query_classifier";
 const char CN_QUERY_CLASSIFIER_ARGS[] = "query_classifier_args";
+const char CN_QUERY_CLASSIFIER_CACHE_PERSIST[] = "query_classifier_cache_persist";
 const char CN_QUERY_CLASSIFIER_CACHE_SIZE[] = "query_classifier_cache_size";
 const char CN_QUERY_RETRIES[] = "query_retries";
 const char CN_QUERY_RETRY_TIMEOUT[] = "query_retry_timeout";
+const char CN_REBALANCE_PERIOD[] = "rebalance_period";
+const char CN_REBALANCE_THRESHOLD[] = "rebalance_threshold";
 const char CN_RELATIONSHIPS[] = "relationships";
 const char CN_REQUIRED[] = "required";
 const char CN_RETAIN_LAST_STATEMENTS[] = "retain_last_statements";
+const char CN_REUSEPORT[] = "reuseport";
 const char CN_RETRY_ON_FAILURE[] = "retry_on_failure";
 const char CN_ROUTER[] = "router";
 const char CN_ROUTER_DIAGNOSTICS[] = "router_diagnostics";
@@ -2349,6 +2359,10 @@ static int handle_global_item(const char* name, const char* value)
             return 0;
         }
     }
+    else if (strcmp(name, CN_QUERY_CLASSIFIER_CACHE_PERSIST) == 0)
+    {
+        gateway.qc_cache_properties.persist = config_truth_value(value);
+    }
     else if (strcmp(name, "sql_mode") == 0)
     {
         if (strcasecmp(value, "default") == 0)
@@ -2625,6 +2639,94 @@ static int handle_global_item(const char* name, const char* value)
             return 0;
         }
     }
+    else if (strcmp(name, CN_POLL_BACKEND) == 0)
+    {
+        if (strcmp(value, "epoll") == 0)
+        {
+            gateway.io_uring = false;
+        }
+        else if (strcmp(value, "io_uring") == 0)
+        {
+            gateway.io_uring = true;
+        }
+        else
+        {
+            MXS_ERROR("%s can have the values 'epoll' or 'io_uring'.", CN_POLL_BACKEND);
+            return 0;
+        }
+    }
+    else if (strcmp(name, CN_REBALANCE_PERIOD) == 0)
+    {
+        char* endptr;
+        int intval = strtol(value, &endptr, 0);
+        if (*endptr == '\0' && intval >= 0)
+        {
+            gateway.rebalance_period = intval;
+        }
+        else
+        {
+            MXS_ERROR("Invalid value for '%s': %s", CN_REBALANCE_PERIOD, value);
+            return 0;
+        }
+    }
+    else if (strcmp(name, CN_REBALANCE_THRESHOLD) == 0)
+    {
+        char* endptr;
+        int intval = strtol(value, &endptr, 0);
+        if (*endptr == '\0' && intval > 0 && intval <= 100)
+        {
+            gateway.rebalance_threshold = intval;
+        }
+        else
+        {
+            MXS_ERROR("Invalid value for '%s', expected a percentage between 1 and 100: %s",
+                      CN_REBALANCE_THRESHOLD, value);
+            return 0;
+        }
+    }
+    else if (strcmp(name, CN_REUSEPORT) == 0)
+    {
+        int b = config_truth_value(value);
+
+        if (b != -1)
+        {
+            gateway.reuseport = b;
+        }
+        else
+        {
+            MXS_ERROR("Invalid value for '%s': %s", CN_REUSEPORT, value);
+            return 0;
+        }
+    }
+    else if (strcmp(name, CN_CLIENT_COMPRESSION) == 0 || strcmp(name, CN_BACKEND_COMPRESSION) == 0)
+    {
+        int b = config_truth_value(value);
+
+        if (b != -1)
+        {
+            if (strcmp(name, CN_CLIENT_COMPRESSION) == 0)
+            {
+                gateway.client_compression = b;
+            }
+            else
+            {
+                gateway.backend_compression = b;
+            }
+        }
+        else
+        {
+            MXS_ERROR("Invalid value for '%s': %s", name, value);
+            return 0;
+        }
+    }
+    else if (strcmp(name, CN_COMPRESSION_THRESHOLD) == 0)
+    {
+        if (!get_suffixed_size(value, &gateway.compression_threshold))
+        {
+            MXS_ERROR("Invalid value for '%s': %s", CN_COMPRESSION_THRESHOLD, value);
+            return 0;
+        }
+    }
     else
     {
         bool found = false;
@@ -2710,6 +2812,7 @@ bool config_can_modify_at_runtime(const char* name)
         CN_LOG_THROTTLING,
         "sql_mode",
         CN_QUERY_CLASSIFIER_ARGS,
+        CN_QUERY_CLASSIFIER_CACHE_PERSIST,
         CN_QUERY_CLASSIFIER,
         CN_POLL_SLEEP,
         CN_NON_BLOCKING_POLLS,
@@ -2844,6 +2947,13 @@ void config_set_global_defaults()
     gateway.passive = false;
     gateway.promoted_at = 0;
     gateway.load_persisted_configs = true;
+    gateway.reuseport = false;
+    gateway.io_uring = false;
+    gateway.rebalance_period = 0;
+    gateway.rebalance_threshold = DEFAULT_REBALANCE_THRESHOLD;
+    gateway.client_compression = false;
+    gateway.backend_compression = false;
+    gateway.compression_threshold = DEFAULT_COMPRESSION_THRESHOLD;
 
     gateway.peer_hosts[0] = '\0';
     gateway.peer_user[0] = '\0';
@@ -2851,6 +2961,7 @@ void config_set_global_defaults()
     gateway.log_target = MXB_LOG_TARGET_DEFAULT;
 
     gateway.qc_cache_properties.max_size = get_total_memory() * 0.15;
+    gateway.qc_cache_properties.persist = false;
 
     if (gateway.qc_cache_properties.max_size == 0)
     {
@@ -4549,10 +4660,20 @@ json_t* config_maxscale_to_json(const char* host)
     json_object_set_new(param,
                         CN_QUERY_CLASSIFIER_CACHE_SIZE,
                         json_integer(cnf->qc_cache_properties.max_size));
+    json_object_set_new(param,
+                        CN_QUERY_CLASSIFIER_CACHE_PERSIST,
+                        json_boolean(cnf->qc_cache_properties.persist));
 
     json_object_set_new(param, CN_RETAIN_LAST_STATEMENTS, json_integer(session_get_retain_last_statements()));
     json_object_set_new(param, CN_DUMP_LAST_STATEMENTS, json_string(session_get_dump_statements_str()));
     json_object_set_new(param, CN_LOAD_PERSISTED_CONFIGS, json_boolean(cnf->load_persisted_configs));
+    json_object_set_new(param, CN_REUSEPORT, json_boolean(cnf->reuseport));
+    json_object_set_new(param, CN_POLL_BACKEND, json_string(cnf->io_uring ? "io_uring" : "epoll"));
+    json_object_set_new(param, CN_REBALANCE_PERIOD, json_integer(cnf->rebalance_period));
+    json_object_set_new(param, CN_REBALANCE_THRESHOLD, json_integer(cnf->rebalance_threshold));
+    json_object_set_new(param, CN_CLIENT_COMPRESSION, json_boolean(cnf->client_compression));
+    json_object_set_new(param, CN_BACKEND_COMPRESSION, json_boolean(cnf->backend_compression));
+    json_object_set_new(param, CN_COMPRESSION_THRESHOLD, json_integer(cnf->compression_threshold));
 
     json_t* attr = json_object();
     time_t started = maxscale_started();
@@ -25,6 +25,7 @@
 #include <arpa/inet.h>
 #include <errno.h>
 #include <inttypes.h>
+#include <limits.h>
 #include <netinet/tcp.h>
 #include <signal.h>
 #include <stdarg.h>
@@ -35,6 +36,7 @@
 #include <sys/ioctl.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #include <sys/un.h>
 #include <time.h>
 
@@ -55,6 +57,8 @@
 #include <atomic>
 
 #include "internal/modules.h"
+#include "internal/objectpool.hh"
+#include "internal/server.hh"
 #include "internal/session.h"
 
 using maxscale::RoutingWorker;
@@ -73,21 +77,78 @@ constexpr uint32_t poll_events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLHUP | EP
 constexpr uint32_t poll_events = EPOLLIN | EPOLLOUT | EPOLLHUP | EPOLLET;
 #endif
 
+/** The maximum number of buffers that are gathered into one writev() call */
+constexpr int DCB_MAX_IOVEC = IOV_MAX;
+
+/**
+ * The maximum number of bytes that are coalesced into one SSL_write() call. This is
+ * the maximum amount of plaintext that fits into one TLS record.
+ */
+constexpr size_t DCB_SSL_COALESCE_SIZE = SSL3_RT_MAX_PLAIN_LENGTH;
+
+/** The maximum number of DCBs a routing worker keeps for reuse */
+constexpr size_t DCB_POOL_SIZE = 1024;
+
+/** The protocol states are pooled in size classes that are multiples of this */
+constexpr size_t PROTOCOL_CLASS_SIZE = 64;
+
+/** The number of protocol size classes, larger protocol states are not pooled */
+constexpr int PROTOCOL_CLASSES = 8;
+
+/** The maximum number of protocol states a routing worker keeps for reuse in one size class */
+constexpr size_t PROTOCOL_POOL_SIZE = 1024;
+
 namespace
 {
 
+/**
+ * The DCBs and protocol states a routing worker keeps for reuse, so that
+ * a new connection does not have to allocate them.
+ */
+struct ObjectPools
+{
+    ObjectPools()
+        : dcbs(sizeof(DCB), DCB_POOL_SIZE)
+    {
+        for (int i = 0; i < PROTOCOL_CLASSES; i++)
+        {
+            protocols[i].reset(new mxs::FreeList((i + 1) * PROTOCOL_CLASS_SIZE, PROTOCOL_POOL_SIZE));
+        }
+    }
+
+    /**
+     * Get the pools of the calling thread
+     *
+     * @return The pools or NULL if the calling thread is not a routing worker
+     */
+    static ObjectPools* get()
+    {
+        static thread_local ObjectPools* pools = nullptr;
+
+        if (!pools && RoutingWorker::get_current_id() != -1)
+        {
+            // Never deleted, just like the buffer pools.
+            pools = new(std::nothrow) ObjectPools;
+        }
+
+        return pools;
+    }
+
+    mxs::FreeList                  dcbs;
+    std::unique_ptr<mxs::FreeList> protocols[PROTOCOL_CLASSES];
+};
+
 static struct
 {
     DCB   dcb_initialized;  /** A DCB with null values, used for initialization. */
     DCB** all_dcbs;         /** #workers sized array of pointers to DCBs where dcbs are listed. */
-    bool  check_timeouts;   /** Should session timeouts be checked. */
     std::atomic<uint64_t> uid_generator {0};
 } this_unit;
 
 static thread_local struct
 {
-    long next_timeout_check;/** When to next check for idle sessions. */
-    DCB* current_dcb;       /** The DCB currently being handled by event handlers. */
+    DCB*    current_dcb;                        /** The DCB currently being handled by event handlers. */
+    uint8_t ssl_buffer[DCB_SSL_COALESCE_SIZE];  /** Buffer where small SSL writes are coalesced. */
 } this_thread;
 }
 
@@ -101,6 +162,7 @@ static void        dcb_stop_polling_and_shutdown(DCB* dcb);
 static bool        dcb_maybe_add_persistent(DCB*);
 static inline bool dcb_write_parameter_check(DCB* dcb, GWBUF* queue);
 static int         dcb_read_no_bytes_available(DCB* dcb, int nreadtotal);
+static int         dcb_read_socket(DCB* dcb, GWBUF** head, int nreadtotal, int maxbytes);
 static int         dcb_create_SSL(DCB* dcb, SSL_LISTENER* ssl);
 static int         dcb_read_SSL(DCB* dcb, GWBUF** head);
 static GWBUF*      dcb_basic_read(DCB* dcb,
@@ -114,7 +176,13 @@ static int    gw_write(DCB* dcb, GWBUF* writeq, bool* stop_writing);
 static int    gw_write_SSL(DCB* dcb, GWBUF* writeq, bool* stop_writing);
 static int    dcb_log_errors_SSL(DCB* dcb, int ret);
 static int    dcb_accept_one_connection(DCB* dcb, struct sockaddr* client_conn);
-static int    dcb_listen_create_socket_inet(const char* host, uint16_t port);
+static int    dcb_listen_create_socket_inet(const char* host, uint16_t port, bool reuseport);
+static bool   dcb_listen_start(int fd, const char* host, uint16_t port, const char* protocol_name);
+static bool   dcb_listen_create_worker_sockets(DCB* dcb,
+                                               const char* host,
+                                               uint16_t port,
+                                               const char* protocol_name);
+static void   dcb_close_worker_sockets(DCB* dcb);
 static int    dcb_listen_create_socket_unix(const char* path);
 static int    dcb_set_socket_option(int sockfd, int level, int optname, void* optval, socklen_t optlen);
 static void   dcb_add_to_all_list(DCB* dcb);
@@ -122,8 +190,13 @@ static void   dcb_add_to_list(DCB* dcb);
 static bool   dcb_add_to_worker(Worker* worker, DCB* dcb, uint32_t events);
 static DCB*   dcb_find_free();
 static void   dcb_remove_from_list(DCB* dcb);
+static void   dcb_start_idle_timer(DCB* dcb);
+static void   dcb_stop_idle_timer(DCB* dcb);
+static char*  dcb_copy_string(char* buf, size_t size, const char* str);
+static void   dcb_free_string(char* str, const char* buf);
 
 static uint32_t dcb_poll_handler(MXB_POLL_DATA* data, MXB_WORKER* worker, uint32_t events);
+static uint32_t dcb_worker_listener_handler(MXB_POLL_DATA* data, MXB_WORKER* worker, uint32_t events);
 static uint32_t dcb_process_poll_events(DCB* dcb, uint32_t ev);
 static bool     dcb_session_check(DCB* dcb, const char*);
 static int      upstream_throttle_callback(DCB* dcb, DCB_REASON reason, void* userdata);
@@ -190,9 +263,10 @@ static void dcb_initialize(DCB* dcb)
  */
 DCB* dcb_alloc(dcb_role_t role, SERV_LISTENER* listener)
 {
-    DCB* newdcb;
+    ObjectPools* pools = ObjectPools::get();
+    DCB* newdcb = (DCB*)(pools ? pools->dcbs.alloc() : MXS_MALLOC(sizeof(DCB)));
 
-    if ((newdcb = (DCB*)MXS_MALLOC(sizeof(*newdcb))) == NULL)
+    if (newdcb == NULL)
     {
         return NULL;
     }
@@ -282,10 +356,18 @@ void dcb_free_all_memory(DCB* dcb)
     }
 
     DCB_CALLBACK* cb_dcb;
+    ObjectPools* pools = ObjectPools::get();
 
     if (dcb->protocol)
     {
-        MXS_FREE(dcb->protocol);
+        if (dcb->protocol_size && pools)
+        {
+            pools->protocols[(dcb->protocol_size - 1) / PROTOCOL_CLASS_SIZE]->free(dcb->protocol);
+        }
+        else
+        {
+            MXS_FREE(dcb->protocol);
+        }
     }
     if (dcb->data && dcb->authfunc.free)
     {
@@ -297,17 +379,17 @@ void dcb_free_all_memory(DCB* dcb)
         dcb->authfunc.destroy(dcb->authenticator_data);
         dcb->authenticator_data = NULL;
     }
-    if (dcb->protoname)
-    {
-        MXS_FREE(dcb->protoname);
-    }
-    if (dcb->remote)
+    if (dcb->codec)
     {
-        MXS_FREE(dcb->remote);
+        dcb->codec->free(dcb->codec);
+        dcb->codec = NULL;
     }
-    if (dcb->user)
+    dcb_free_string(dcb->protoname, dcb->protoname_buf);
+    dcb_free_string(dcb->remote, dcb->remote_buf);
+    dcb_free_string(dcb->user, dcb->user_buf);
+    if (dcb->worker_listeners)
     {
-        MXS_FREE(dcb->user);
+        MXS_FREE(dcb->worker_listeners);
     }
 
     /* Clear write and read buffers */
@@ -350,7 +432,134 @@ void dcb_free_all_memory(DCB* dcb)
 
     // Ensure that id is immediately the wrong one.
     dcb->poll.owner = reinterpret_cast<MXB_WORKER*>(0xdeadbeef);
-    MXS_FREE(dcb);
+
+    if (pools)
+    {
+        pools->dcbs.free(dcb);
+    }
+    else
+    {
+        MXS_FREE(dcb);
+    }
+}
+
+/**
+ * Copy a string into a buffer of a DCB or, if it does not fit, into allocated memory
+ *
+ * @param buf   The buffer of the DCB
+ * @param size  Size of the buffer
+ * @param str   The string to copy
+ *
+ * @return The copy or NULL on allocation failure
+ */
+static char* dcb_copy_string(char* buf, size_t size, const char* str)
+{
+    size_t len = strlen(str);
+    char* rval;
+
+    if (len < size)
+    {
+        memcpy(buf, str, len + 1);
+        rval = buf;
+    }
+    else
+    {
+        rval = MXS_STRDUP(str);
+    }
+
+    return rval;
+}
+
+/**
+ * Free a string copied with dcb_copy_string()
+ *
+ * @param str  The string, may be NULL
+ * @param buf  The buffer of the DCB the string may be in
+ */
+static void dcb_free_string(char* str, const char* buf)
+{
+    if (str != buf)
+    {
+        MXS_FREE(str);
+    }
+}
+
+bool dcb_set_user(DCB* dcb, const char* user)
+{
+    dcb_free_string(dcb->user, dcb->user_buf);
+    dcb->user = user ? dcb_copy_string(dcb->user_buf, sizeof(dcb->user_buf), user) : NULL;
+
+    return dcb->user || !user;
+}
+
+void* dcb_alloc_protocol(DCB* dcb, size_t size)
+{
+    ObjectPools* pools = ObjectPools::get();
+    void* protocol;
+
+    if (pools && size > 0 && size <= PROTOCOL_CLASSES * PROTOCOL_CLASS_SIZE)
+    {
+        mxs::FreeList* pool = pools->protocols[(size - 1) / PROTOCOL_CLASS_SIZE].get();
+
+        if ((protocol = pool->alloc()) != NULL)
+        {
+            memset(protocol, 0, pool->size());
+            dcb->protocol_size = size;
+        }
+    }
+    else if ((protocol = MXS_CALLOC(1, size)) != NULL)
+    {
+        dcb->protocol_size = 0;
+    }
+
+    if (protocol)
+    {
+        dcb->protocol = protocol;
+    }
+
+    return protocol;
+}
+
+namespace
+{
+
+mxs::ObjectPoolStats sum_stats(const mxs::ObjectPoolStats& lhs, const mxs::ObjectPoolStats& rhs)
+{
+    mxs::ObjectPoolStats stats;
+    stats.hits = lhs.hits + rhs.hits;
+    stats.misses = lhs.misses + rhs.misses;
+    stats.cached = lhs.cached + rhs.cached;
+    return stats;
+}
+}
+
+mxs::ObjectPoolStats mxs::dcb_pool_stats()
+{
+    ObjectPools* pools = ObjectPools::get();
+    mxs::ObjectPoolStats stats = {};
+
+    if (pools)
+    {
+        stats = pools->dcbs.stats();
+    }
+
+    return stats;
+}
+
+mxs::ObjectPoolStats mxs::protocol_pool_stats()
+{
+    ObjectPools* pools = ObjectPools::get();
+    mxs::ObjectPoolStats stats = {};
+
+    if (pools)
+    {
+        for (int i = 0; i < PROTOCOL_CLASSES; i++)
+        {
+            stats = sum_stats(stats, pools->protocols[i]->stats());
+        }
+    }
+
+    return stats;
 }
 
 /**
@@ -398,6 +607,7 @@ DCB* dcb_connect(SERVER* server, MXS_SESSION* session, const char* protocol)
                                     user,
                                     session->client_dcb->remote,
                                     protocol,
+                                    session->client_dcb->pool_capabilities,
                                     static_cast<RoutingWorker*>(session->client_dcb->poll.owner)->id());
         if (dcb)
         {
@@ -407,6 +617,10 @@ DCB* dcb_connect(SERVER* server, MXS_SESSION* session, const char* protocol)
             session_link_backend_dcb(session, dcb);
 
             MXS_DEBUG("Reusing a persistent connection, dcb %p", dcb);
+            // The connection may have been made for another client.
+            dcb->remote = dcb_copy_string(dcb->remote_buf,
+                                          sizeof(dcb->remote_buf),
+                                          session->client_dcb->remote);
             dcb->persistentstart = 0;
             dcb->was_persistent = true;
             dcb->last_read = mxs_clock();
@@ -416,6 +630,11 @@ DCB* dcb_connect(SERVER* server, MXS_SESSION* session, const char* protocol)
         else
         {
             MXS_DEBUG("Failed to find a reusable persistent connection");
+
+            if (server->persistpoolmax)
+            {
+                mxb::atomic::add(&server->stats.n_new_conn, 1, mxb::atomic::RELAXED);
+            }
         }
     }
 
@@ -433,11 +652,11 @@ DCB* dcb_connect(SERVER* server, MXS_SESSION* session, const char* protocol)
         return NULL;
     }
     memcpy(&(dcb->func), funcs, sizeof(MXS_PROTOCOL));
-    dcb->protoname = MXS_STRDUP_A(protocol);
+    dcb->protoname = dcb_copy_string(dcb->protoname_buf, sizeof(dcb->protoname_buf), protocol);
 
     if (session->client_dcb->remote)
     {
-        dcb->remote = MXS_STRDUP_A(session->client_dcb->remote);
+        dcb->remote = dcb_copy_string(dcb->remote_buf, sizeof(dcb->remote_buf), session->client_dcb->remote);
     }
 
     const char* authenticator = server->authenticator ?
@@ -565,7 +784,6 @@ int dcb_read(DCB* dcb,
              GWBUF** head,
              int maxbytes)
 {
-    int nsingleread = 0;
     int nreadtotal = 0;
 
     if (dcb->readq)
@@ -581,6 +799,46 @@ int dcb_read(DCB* dcb,
         nreadtotal = gwbuf_length(*head);
     }
 
+    if (!dcb->codec)
+    {
+        return dcb_read_socket(dcb, head, nreadtotal, maxbytes);
+    }
+
+    // The read queue holds decoded data, only what is read now must be decoded.
+    GWBUF* raw = NULL;
+    int rval = dcb_read_socket(dcb, &raw, nreadtotal, maxbytes);
+
+    if (raw)
+    {
+        bool error = false;
+        GWBUF* decoded = dcb->codec->decode(dcb->codec, dcb, raw, &error);
+
+        if (error)
+        {
+            gwbuf_free(decoded);
+            return -1;
+        }
+
+        *head = gwbuf_append(*head, decoded);
+    }
+
+    return rval < 0 ? rval : gwbuf_length(*head);
+}
+
+/**
+ * Read data from the socket of a DCB
+ *
+ * @param dcb         The DCB to read from
+ * @param head        Pointer to linked list to append data to
+ * @param nreadtotal  Number of bytes already in the list
+ * @param maxbytes    Maximum bytes to read (0 = no limit)
+ *
+ * @return -1 on error, otherwise the total number of bytes read
+ */
+static int dcb_read_socket(DCB* dcb, GWBUF** head, int nreadtotal, int maxbytes)
+{
+    int nsingleread = 0;
+
     if (SSL_HANDSHAKE_DONE == dcb->ssl_state || SSL_ESTABLISHED == dcb->ssl_state)
     {
         return dcb_read_SSL(dcb, head);
@@ -633,6 +891,27 @@ int dcb_read(DCB* dcb,
     return nreadtotal;
 }
 
+bool dcb_set_codec(DCB* dcb, DCB_CODEC* codec)
+{
+    bool error = false;
+
+    if (dcb->codec)
+    {
+        dcb->codec->free(dcb->codec);
+    }
+
+    dcb->codec = codec;
+
+    if (codec && dcb->readq)
+    {
+        // Data that arrived after the data that switched the codec on.
+        GWBUF* raw = dcb->readq;
+        dcb->readq = codec->decode(codec, dcb, raw, &error);
+    }
+
+    return !error;
+}
+
 /**
  * Find the number of bytes available for the DCB's socket
  *
@@ -904,6 +1183,20 @@ static int dcb_log_errors_SSL(DCB* dcb, int ret)
  */
 int dcb_write(DCB* dcb, GWBUF* queue)
 {
+    if (dcb->codec && queue)
+    {
+        queue = dcb->codec->encode(dcb->codec, dcb, queue);
+
+        if (!queue)
+        {
+            MXS_ERROR("Could not encode the data written to dcb %p in state %s fd %d.",
+                      dcb,
+                      STRDCBSTATE(dcb->state),
+                      dcb->fd);
+            return 0;
+        }
+    }
+
     dcb->writeqlen += gwbuf_length(queue);
     // The following guarantees that queue is not NULL
     if (!dcb_write_parameter_check(dcb, queue))
@@ -998,6 +1291,9 @@ static void dcb_log_write_failure(DCB* dcb, GWBUF* queue, int eno)
  *
  * This is called as part of the EPOLLOUT handling of a socket and will try to
  * send any buffered data from the write queue up until the point the write would block.
+ * The buffers of the write queue are gathered into as few system calls as possible:
+ * plain sockets use one writev() for up to DCB_MAX_IOVEC buffers and SSL connections
+ * coalesce small buffers into one SSL_write().
  *
  * @param dcb DCB to drain
  * @return The number of bytes written
@@ -1027,6 +1323,13 @@ int dcb_drain_writeq(DCB* dcb)
         {
             written = gw_write(dcb, local_writeq, &stop_writing);
         }
+
+        /** Consume the bytes we have written from the list of buffers,
+         * and increment the total bytes written. A partial write can span
+         * several buffers of the list. */
+        local_writeq = gwbuf_consume(local_writeq, written);
+        total_written += written;
+
         /*
          * If the stop_writing boolean is set, writing has become blocked,
          * so the remaining data is put back at the front of the write
@@ -1037,13 +1340,6 @@ int dcb_drain_writeq(DCB* dcb)
             dcb->writeq = gwbuf_append(local_writeq, dcb->writeq);
             local_writeq = NULL;
         }
-        else
-        {
-            /** Consume the bytes we have written from the list of buffers,
-             * and increment the total bytes written. */
-            local_writeq = gwbuf_consume(local_writeq, written);
-            total_written += written;
-        }
     }
 
     if (dcb->writeq == NULL)
@@ -1142,13 +1438,8 @@ void dcb_close(DCB* dcb)
      */
     else if (dcb->persistentstart > 0)
     {
-        // A DCB in the persistent pool.
-
-        // TODO: This dcb will now actually be closed when dcb_persistent_clean_count() is
-        // TODO: called by either dcb_maybe_add_persistent() - another dcb is added to the
-        // TODO: persistent pool - or server_get_persistent() - get a dcb from the persistent
-        // TODO: pool - is called. There is no reason not to just remove this dcb from the
-        // TODO: persistent pool here and now, and then close it immediately.
+        // A DCB in the persistent pool. It is no longer handed out and the
+        // periodic cleaning of the pools closes it.
         dcb->dcb_errhandle_called = true;
     }
     else if (dcb->n_close == 0)
@@ -1176,12 +1467,28 @@ void dcb_close(DCB* dcb)
     }
 }
 
-static void cb_dcb_close_in_owning_thread(MXB_WORKER*, void* data)
+void dcb_release(DCB* dcb)
+{
+    mxb_assert(dcb->dcb_role == DCB_ROLE_BACKEND_HANDLER);
+    dcb->flags |= DCBF_RELEASED;
+    dcb_close(dcb);
+}
+
+static void cb_dcb_close_in_owning_thread(MXB_WORKER* worker, void* data)
 {
     DCB* dcb = static_cast<DCB*>(data);
     mxb_assert(dcb);
 
-    dcb_close(dcb);
+    if (dcb->poll.owner != worker || (dcb->session && session_is_moving(dcb->session)))
+    {
+        // The session of the DCB has been moved to another worker after the
+        // closing was posted, or is still on its way there.
+        dcb_close_in_owning_thread(dcb);
+    }
+    else
+    {
+        dcb_close(dcb);
+    }
 }
 
 void dcb_close_in_owning_thread(DCB* dcb)
@@ -1231,7 +1538,7 @@ void dcb_final_close(DCB* dcb)
         user = session_get_user(dcb->session);
         if (user && strlen(user) && !dcb->user)
         {
-            dcb->user = MXS_STRDUP_A(user);
+            dcb_set_user(dcb, user);
         }
 
         if (dcb_maybe_add_persistent(dcb))
@@ -1276,6 +1583,11 @@ void dcb_final_close(DCB* dcb)
                 MXS_DEBUG("Closed socket %d on dcb %p.", dcb->fd, dcb);
             }
 
+            if (dcb->worker_listeners)
+            {
+                dcb_close_worker_sockets(dcb);
+            }
+
             if (dcb->path && (dcb->dcb_role == DCB_ROLE_SERVICE_LISTENER))
             {
                 if (unlink(dcb->path) != 0)
@@ -1306,22 +1618,24 @@ void dcb_final_close(DCB* dcb)
 static bool dcb_maybe_add_persistent(DCB* dcb)
 {
     RoutingWorker* owner = static_cast<RoutingWorker*>(dcb->poll.owner);
+    Server* server = static_cast<Server*>(dcb->server);
     if (dcb->user != NULL
         && (dcb->func.established == NULL || dcb->func.established(dcb))
         && strlen(dcb->user)
         && dcb->server
         && dcb->session
-        && session_valid_for_pool(dcb->session)
+        && ((dcb->flags & DCBF_RELEASED) || session_valid_for_pool(dcb->session))
         && dcb->server->persistpoolmax
         && (dcb->server->status & SERVER_RUNNING)
         && !dcb->dcb_errhandle_called
         && !(dcb->flags & DCBF_HUNG)
-        && dcb_persistent_clean_count(dcb, owner->id(), false) < dcb->server->persistpoolmax
+        && (long)server->persistent_pool(owner->id()).size() < dcb->server->persistpoolmax
         && mxb::atomic::load(&dcb->server->stats.n_persistent) < dcb->server->persistpoolmax)
     {
         DCB_CALLBACK* loopcallback;
         MXS_DEBUG("Adding DCB to persistent pool, user %s.", dcb->user);
         dcb->was_persistent = false;
+        dcb->flags &= ~DCBF_RELEASED;
         dcb->persistentstart = time(NULL);
         if (dcb->session)
         /*<
@@ -1352,8 +1666,7 @@ static bool dcb_maybe_add_persistent(DCB* dcb)
         dcb->delayq = NULL;
         dcb->writeq = NULL;
 
-        dcb->nextpersistent = dcb->server->persistent[owner->id()];
-        dcb->server->persistent[owner->id()] = dcb;
+        server->persistent_pool(owner->id()).add(dcb);
         mxb::atomic::add(&dcb->server->stats.n_persistent, 1);
         mxb::atomic::add(&dcb->server->stats.n_current, -1, mxb::atomic::RELAXED);
         return true;
@@ -1799,8 +2112,23 @@ void dcb_printf(DCB* dcb, const char* fmt, ...)
 static int gw_write_SSL(DCB* dcb, GWBUF* writeq, bool* stop_writing)
 {
     int written;
+    void* buf = GWBUF_DATA(writeq);
+    size_t nbytes = GWBUF_LENGTH(writeq);
 
-    written = SSL_write(dcb->ssl, GWBUF_DATA(writeq), GWBUF_LENGTH(writeq));
+    if (writeq->next && nbytes < DCB_SSL_COALESCE_SIZE)
+    {
+        /**
+         * Coalesce the small buffers at the head of the queue into one TLS record. If the
+         * write needs to be retried, the same prefix of the queue is copied again so the
+         * SSL library sees the same data at a possibly different address (the SSL object
+         * is created with SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER).
+         */
+        buf = this_thread.ssl_buffer;
+        nbytes = gwbuf_copy_data(writeq, 0, DCB_SSL_COALESCE_SIZE, this_thread.ssl_buffer);
+    }
+
+    written = SSL_write(dcb->ssl, buf, nbytes);
+    dcb->stats.n_writes++;
 
     *stop_writing = false;
     switch ((SSL_get_error(dcb->ssl, written)))
@@ -1855,6 +2183,10 @@ static int gw_write_SSL(DCB* dcb, GWBUF* writeq, bool* stop_writing)
 /**
  * Write data to a DCB. The data is taken from the DCB's write queue.
  *
+ * Up to DCB_MAX_IOVEC buffers of the list are written with one writev() call.
+ * A short write means that the socket buffer is full, in which case the caller
+ * is told to stop writing instead of retrying until the write fails with EAGAIN.
+ *
  * @param dcb           The DCB to write buffer
  * @param writeq        A buffer list containing the data to be written
  * @param stop_writing  Set to true if the caller should stop writing, false otherwise
@@ -1862,17 +2194,40 @@ static int gw_write_SSL(DCB* dcb, GWBUF* writeq, bool* stop_writing)
  */
 static int gw_write(DCB* dcb, GWBUF* writeq, bool* stop_writing)
 {
-    int written = 0;
+    ssize_t written = 0;
     int fd = dcb->fd;
-    size_t nbytes = GWBUF_LENGTH(writeq);
-    void* buf = GWBUF_DATA(writeq);
+    struct iovec iov[DCB_MAX_IOVEC];
+    int n_iov = 0;
+    size_t nbytes = 0;
     int saved_errno;
 
+    for (GWBUF* buf = writeq; buf && n_iov < DCB_MAX_IOVEC; buf = buf->next)
+    {
+        size_t len = GWBUF_LENGTH(buf);
+
+        if (len > 0)
+        {
+            iov[n_iov].iov_base = GWBUF_DATA(buf);
+            iov[n_iov].iov_len = len;
+            nbytes += len;
+            ++n_iov;
+        }
+    }
+
     errno = 0;
 
     if (fd > 0)
     {
-        written = write(fd, buf, nbytes);
+        if (n_iov == 1)
+        {
+            written = write(fd, iov[0].iov_base, iov[0].iov_len);
+        }
+        else
+        {
+            written = writev(fd, iov, n_iov);
+        }
+
+        dcb->stats.n_writes++;
     }
 
     saved_errno = errno;
@@ -1893,7 +2248,7 @@ static int gw_write(DCB* dcb, GWBUF* writeq, bool* stop_writing)
     }
     else
     {
-        *stop_writing = false;
+        *stop_writing = (size_t)written < nbytes;
     }
 
     return written > 0 ? written : 0;
@@ -2066,69 +2421,30 @@ void dcb_hangup_foreach(struct server* server)
 /**
  * Check persistent pool for expiry or excess size and count
  *
- * @param dcb           The DCB being closed.
+ * @param srv           The server whose pool is checked
  * @param id            Thread ID
- * @param cleanall      Boolean, if true the whole pool is cleared for the
- *                      server related to the given DCB
+ * @param cleanall      Boolean, if true the whole pool is cleared
  * @return              A count of the DCBs remaining in the pool
  */
-int dcb_persistent_clean_count(DCB* dcb, int id, bool cleanall)
+int dcb_persistent_clean_count(SERVER* srv, int id, bool cleanall)
 {
-    int count = 0;
-    if (dcb && dcb->server)
-    {
-        SERVER* server = dcb->server;
-        DCB* previousdcb = NULL;
-        DCB* persistentdcb, * nextdcb;
-        DCB* disposals = NULL;
+    Server* server = static_cast<Server*>(srv);
+    mxs::PersistentPool& pool = server->persistent_pool(id);
 
-        persistentdcb = server->persistent[id];
-        while (persistentdcb)
-        {
-            nextdcb = persistentdcb->nextpersistent;
-            if (cleanall
-                || persistentdcb->dcb_errhandle_called
-                || count >= server->persistpoolmax
-                || persistentdcb->server == NULL
-                || !(persistentdcb->server->status & SERVER_RUNNING)
-                || (time(NULL) - persistentdcb->persistentstart) > server->persistmaxtime)
-            {
-                /* Remove from persistent pool */
-                if (previousdcb)
-                {
-                    previousdcb->nextpersistent = nextdcb;
-                }
-                else
-                {
-                    server->persistent[id] = nextdcb;
-                }
-                /* Add removed DCBs to disposal list for processing outside spinlock */
-                persistentdcb->nextpersistent = disposals;
-                disposals = persistentdcb;
-                mxb::atomic::add(&server->stats.n_persistent, -1);
-            }
-            else
-            {
-                count++;
-                previousdcb = persistentdcb;
-            }
-            persistentdcb = nextdcb;
-        }
-        server->persistmax = MXS_MAX(server->persistmax, count);
-
-        /** Call possible callback for this DCB in case of close */
-        while (disposals)
+    for (DCB* dcb : pool.evict(server->persistpoolmax, server->persistmaxtime, cleanall))
+    {
+        mxb::atomic::add(&server->stats.n_persistent, -1);
+        dcb->persistentstart = -1;
+        if (DCB_STATE_POLLING == dcb->state)
         {
-            nextdcb = disposals->nextpersistent;
-            disposals->persistentstart = -1;
-            if (DCB_STATE_POLLING == disposals->state)
-            {
-                dcb_stop_polling_and_shutdown(disposals);
-            }
-            dcb_close(disposals);
-            disposals = nextdcb;
+            dcb_stop_polling_and_shutdown(dcb);
         }
+        dcb_close(dcb);
     }
+
+    int count = pool.size();
+    server->persistmax = MXS_MAX(server->persistmax, count);
+
     return count;
 }
 
@@ -2219,6 +2535,9 @@ static int dcb_create_SSL(DCB* dcb, SSL_LISTENER* ssl)
         return -1;
     }
 
+    /** Coalesced writes are retried from a buffer whose address may change */
+    SSL_set_mode(dcb->ssl, SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+
     return 0;
 }
 
@@ -2405,6 +2724,12 @@ DCB* dcb_accept(DCB* dcb)
     {
         dcb->stats.n_accepts++;
 
+        if (dcb->worker_listeners)
+        {
+            DCB_WORKER_LISTENER* wl = &dcb->worker_listeners[RoutingWorker::get_current_id()];
+            mxb::atomic::add(&wl->n_accepts, 1, mxb::atomic::RELAXED);
+        }
+
         configure_network_socket(c_sock, client_conn.ss_family);
 
         client_dcb = dcb_alloc(DCB_ROLE_CLIENT_HANDLER, dcb->listener);
@@ -2428,33 +2753,32 @@ DCB* dcb_accept(DCB* dcb)
             {
                 // client address
                 client_dcb->ip.ss_family = AF_UNIX;
-                client_dcb->remote = MXS_STRDUP_A("localhost");
+                client_dcb->remote = dcb_copy_string(client_dcb->remote_buf,
+                                                     sizeof(client_dcb->remote_buf),
+                                                     "localhost");
                 client_dcb->path = MXS_STRDUP_A(dcb->path);
             }
             else
             {
                 /* client IP in raw data*/
                 memcpy(&client_dcb->ip, &client_conn, sizeof(client_conn));
-                /* client IP in string representation */
-                client_dcb->remote = (char*)MXS_CALLOC(INET6_ADDRSTRLEN + 1, sizeof(char));
+                /* client IP in string representation, always fits in the DCB */
+                client_dcb->remote = client_dcb->remote_buf;
 
-                if (client_dcb->remote)
+                void* ptr;
+                if (client_dcb->ip.ss_family == AF_INET)
                 {
-                    void* ptr;
-                    if (client_dcb->ip.ss_family == AF_INET)
-                    {
-                        ptr = &((struct sockaddr_in*)&client_dcb->ip)->sin_addr;
-                    }
-                    else
-                    {
-                        ptr = &((struct sockaddr_in6*)&client_dcb->ip)->sin6_addr;
-                    }
-
-                    inet_ntop(client_dcb->ip.ss_family,
-                              ptr,
-                              client_dcb->remote,
-                              INET6_ADDRSTRLEN);
+                    ptr = &((struct sockaddr_in*)&client_dcb->ip)->sin_addr;
                 }
+                else
+                {
+                    ptr = &((struct sockaddr_in6*)&client_dcb->ip)->sin6_addr;
+                }
+
+                inet_ntop(client_dcb->ip.ss_family,
+                          ptr,
+                          client_dcb->remote,
+                          sizeof(client_dcb->remote_buf));
             }
             memcpy(&client_dcb->func, protocol_funcs, sizeof(MXS_PROTOCOL));
             if (dcb->listener->authenticator)
@@ -2532,6 +2856,15 @@ DCB* dcb_accept(DCB* dcb)
 static int dcb_accept_one_connection(DCB* dcb, struct sockaddr* client_conn)
 {
     int c_sock;
+    int fd = dcb->fd;
+
+    if (dcb->worker_listeners)
+    {
+        // Each worker only accepts from its own socket.
+        int id = RoutingWorker::get_current_id();
+        mxb_assert(id >= 0 && id < dcb->n_worker_listeners);
+        fd = dcb->worker_listeners[id].fd;
+    }
 
     /* Try up to 10 times to get a file descriptor by use of accept */
     for (int i = 0; i < 10; i++)
@@ -2540,7 +2873,7 @@ static int dcb_accept_one_connection(DCB* dcb, struct sockaddr* client_conn)
         int eno = 0;
 
         /* new connection from client */
-        c_sock = accept(dcb->fd,
+        c_sock = accept(fd,
                         client_conn,
                         &client_len);
         eno = errno;
@@ -2628,6 +2961,7 @@ int dcb_listen(DCB* dcb, const char* config, const char* protocol_name)
     }
 
     int listener_socket = -1;
+    bool reuseport = false;
 
     if (strchr(host, '/'))
     {
@@ -2640,7 +2974,8 @@ int dcb_listen(DCB* dcb, const char* config, const char* protocol_name)
     }
     else if (port > 0)
     {
-        listener_socket = dcb_listen_create_socket_inet(host, port);
+        reuseport = config_get_global_options()->reuseport;
+        listener_socket = dcb_listen_create_socket_inet(host, port, reuseport);
 
         if (listener_socket == -1 && strcmp(host, "::") == 0)
         {
@@ -2648,7 +2983,7 @@ int dcb_listen(DCB* dcb, const char* config, const char* protocol_name)
             MXS_WARNING("Failed to bind on default IPv6 host '::', attempting "
                         "to bind on IPv4 version '0.0.0.0'");
             strcpy(host, "0.0.0.0");
-            listener_socket = dcb_listen_create_socket_inet(host, port);
+            listener_socket = dcb_listen_create_socket_inet(host, port, reuseport);
         }
     }
     else
@@ -2663,6 +2998,51 @@ int dcb_listen(DCB* dcb, const char* config, const char* protocol_name)
         return -1;
     }
 
+    if (!dcb_listen_start(listener_socket, host, port, protocol_name))
+    {
+        close(listener_socket);
+        return -1;
+    }
+
+    // assign listener_socket to dcb
+    dcb->fd = listener_socket;
+
+    if (reuseport)
+    {
+        if (!dcb_listen_create_worker_sockets(dcb, host, port, protocol_name))
+        {
+            return -1;
+        }
+
+        MXS_NOTICE("Listening for connections at [%s]:%u with protocol %s using %d "
+                   "SO_REUSEPORT sockets", host, port, protocol_name, dcb->n_worker_listeners);
+    }
+    else
+    {
+        MXS_NOTICE("Listening for connections at [%s]:%u with protocol %s", host, port, protocol_name);
+    }
+
+    // add listening socket to poll structure
+    if (poll_add_dcb(dcb) != 0)
+    {
+        MXS_ERROR("MaxScale encountered system limit while "
+                  "attempting to register on an epoll instance.");
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Start listening on a bound socket
+ *
+ * @param fd            The bound socket
+ * @param host          The address the socket is bound to
+ * @param port          The port the socket is bound to
+ * @param protocol_name Name of protocol that is listening
+ * @return True if listen() succeeded
+ */
+static bool dcb_listen_start(int fd, const char* host, uint16_t port, const char* protocol_name)
+{
     /**
      * The use of INT_MAX for backlog length in listen() allows the end-user to
      * control the backlog length with the net.ipv4.tcp_max_syn_backlog kernel
@@ -2670,7 +3050,7 @@ int dcb_listen(DCB* dcb, const char* config, const char* protocol_name)
      *
      * @see man 2 listen
      */
-    if (listen(listener_socket, INT_MAX) != 0)
+    if (listen(fd, INT_MAX) != 0)
     {
         MXS_ERROR("Failed to start listening on [%s]:%u with protocol '%s': %d, %s",
                   host,
@@ -2678,36 +3058,130 @@ int dcb_listen(DCB* dcb, const char* config, const char* protocol_name)
                   protocol_name,
                   errno,
                   mxs_strerror(errno));
-        close(listener_socket);
-        return -1;
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Create one SO_REUSEPORT socket per routing worker
+ *
+ * The socket in @c dcb->fd is used as the socket of the first worker. The
+ * kernel distributes the incoming connections between the sockets so the
+ * workers do not compete for the same accept queue.
+ *
+ * @param dcb           Listener DCB whose @c fd is already listening
+ * @param host          The network address to listen on
+ * @param port          The port to listen on
+ * @param protocol_name Name of protocol that is listening
+ * @return True if all sockets were created, false otherwise
+ */
+static bool dcb_listen_create_worker_sockets(DCB* dcb,
+                                             const char* host,
+                                             uint16_t port,
+                                             const char* protocol_name)
+{
+    int n = config_threadcount();
+    DCB_WORKER_LISTENER* listeners = (DCB_WORKER_LISTENER*)MXS_CALLOC(n, sizeof(DCB_WORKER_LISTENER));
+
+    if (!listeners)
+    {
+        return false;
     }
 
-    MXS_NOTICE("Listening for connections at [%s]:%u with protocol %s", host, port, protocol_name);
+    int i;
 
-    // assign listener_socket to dcb
-    dcb->fd = listener_socket;
+    for (i = 0; i < n; i++)
+    {
+        DCB_WORKER_LISTENER* wl = &listeners[i];
+        wl->poll.handler = dcb_worker_listener_handler;
+        wl->dcb = dcb;
 
-    // add listening socket to poll structure
-    if (poll_add_dcb(dcb) != 0)
+        if (i == 0)
+        {
+            wl->fd = dcb->fd;
+        }
+        else
+        {
+            wl->fd = dcb_listen_create_socket_inet(host, port, true);
+
+            if (wl->fd == -1)
+            {
+                break;
+            }
+            else if (!dcb_listen_start(wl->fd, host, port, protocol_name))
+            {
+                close(wl->fd);
+                break;
+            }
+        }
+    }
+
+    if (i == n)
     {
-        MXS_ERROR("MaxScale encountered system limit while "
-                  "attempting to register on an epoll instance.");
-        return -1;
+        dcb->worker_listeners = listeners;
+        dcb->n_worker_listeners = n;
     }
-    return 0;
+    else
+    {
+        // The first socket is owned by the DCB, close only the ones created here.
+        while (--i > 0)
+        {
+            close(listeners[i].fd);
+        }
+
+        MXS_FREE(listeners);
+    }
+
+    return dcb->worker_listeners != NULL;
+}
+
+/**
+ * @brief Close the per-worker sockets of a listener
+ *
+ * The first socket is the one in @c dcb->fd and is closed by the caller. The
+ * array itself is freed along with the DCB, as other workers may still be
+ * processing events of the sockets.
+ *
+ * @param dcb Listener DCB
+ */
+static void dcb_close_worker_sockets(DCB* dcb)
+{
+    for (int i = 1; i < dcb->n_worker_listeners; i++)
+    {
+        DCB_WORKER_LISTENER* wl = &dcb->worker_listeners[i];
+
+        if (wl->fd != DCBFD_CLOSED && close(wl->fd) < 0)
+        {
+            MXS_ERROR("Failed to close listening socket %d on dcb %p: %d, %s",
+                      wl->fd,
+                      dcb,
+                      errno,
+                      mxs_strerror(errno));
+        }
+
+        wl->fd = DCBFD_CLOSED;
+    }
+
+    dcb->worker_listeners[0].fd = DCBFD_CLOSED;
 }
 
 /**
  * @brief Create a network listener socket
  *
- * @param host The network address to listen on
- * @param port The port to listen on
- * @return     The opened socket or -1 on error
+ * @param host      The network address to listen on
+ * @param port      The port to listen on
+ * @param reuseport Whether to set SO_REUSEPORT on the socket
+ * @return          The opened socket or -1 on error
  */
-static int dcb_listen_create_socket_inet(const char* host, uint16_t port)
+static int dcb_listen_create_socket_inet(const char* host, uint16_t port, bool reuseport)
 {
     struct sockaddr_storage server_address = {};
-    return open_network_socket(MXS_SOCKET_LISTENER, &server_address, host, port);
+    return open_network_socket(reuseport ? MXS_SOCKET_LISTENER_REUSEPORT : MXS_SOCKET_LISTENER,
+                               &server_address,
+                               host,
+                               port);
 }
 
 /**
@@ -2836,6 +3310,8 @@ static void dcb_add_to_list(DCB* dcb)
             this_unit.all_dcbs[id]->thread.tail->thread.next = dcb;
             this_unit.all_dcbs[id]->thread.tail = dcb;
         }
+
+        dcb_start_idle_timer(dcb);
     }
 }
 
@@ -2848,6 +3324,8 @@ static void dcb_remove_from_list(DCB* dcb)
 {
     int id = static_cast<RoutingWorker*>(dcb->poll.owner)->id();
 
+    dcb_stop_idle_timer(dcb);
+
     if (dcb == this_unit.all_dcbs[id])
     {
         DCB* tail = this_unit.all_dcbs[id]->thread.tail;
@@ -2889,54 +3367,130 @@ static void dcb_remove_from_list(DCB* dcb)
 }
 
 /**
- * Enable the timing out of idle connections.
+ * Convert the time until the next idle check to the delay of a delayed call.
+ *
+ * Timeouts longer than about 24.8 days do not fit in the delay, so it is
+ * capped. The check then finds the DCB not yet idle and re-arms the timer.
+ *
+ * @param ms  Milliseconds until the check.
+ *
+ * @return The delay to use.
  */
-void dcb_enable_session_timeouts()
+static int32_t idle_timer_delay(int64_t ms)
 {
-    this_unit.check_timeouts = true;
+    return ms < INT32_MAX ? ms : INT32_MAX;
 }
 
 /**
- * Close sessions that have been idle for too long.
+ * Check whether a client DCB has been idle for too long.
  *
- * If the time since a session last sent data is greater than the set value in the
- * service, it is disconnected. The connection timeout is disabled by default.
+ * If the time since the client last sent data is greater than the connection
+ * timeout of the service, the session is closed. Otherwise the check is
+ * scheduled again for when the timeout could next be exceeded, so the cost is
+ * proportional to the number of expiring timers and not to the number of
+ * connections. The reads only update @c last_read and never touch the timer.
  */
-void dcb_process_idle_sessions(int thr)
+static bool dcb_idle_timeout_cb(Worker::Call::action_t action, DCB* dcb)
 {
-    if (this_unit.check_timeouts && mxs_clock() >= this_thread.next_timeout_check)
+    if (action == Worker::Call::CANCEL)
     {
-        /** Because the resolution of the timeout is one second, we only need to
-         * check for it once per second. One heartbeat is 100 milliseconds. */
-        this_thread.next_timeout_check = mxs_clock() + 10;
+        return false;
+    }
+
+    dcb->idle_timer = 0;
+
+    SERVICE* service = dcb->listener->service;
+    int64_t timeout = service->conn_idle_timeout * 10;
 
-        for (DCB* dcb = this_unit.all_dcbs[thr]; dcb; dcb = dcb->thread.next)
+    if (timeout && dcb->state == DCB_STATE_POLLING)
+    {
+        int64_t idle = mxs_clock() - dcb->last_read;
+
+        if (idle > timeout)
         {
-            if (dcb->dcb_role == DCB_ROLE_CLIENT_HANDLER)
-            {
-                mxb_assert(dcb->listener);
-                SERVICE* service = dcb->listener->service;
+            MXS_WARNING("Timing out '%s'@%s, idle for %.1f seconds",
+                        dcb->user ? dcb->user : "<unknown>",
+                        dcb->remote ? dcb->remote : "<unknown>",
+                        (float)idle / 10.f);
+            dcb->session->close_reason = SESSION_CLOSE_TIMEOUT;
+            mxb::atomic::add(&service->stats.n_idle_timeouts, 1, mxb::atomic::RELAXED);
+            poll_fake_hangup_event(dcb);
+        }
+        else
+        {
+            // One tick is 100 milliseconds.
+            int32_t delay = idle_timer_delay((timeout - idle + 1) * 100);
+            RoutingWorker* worker = static_cast<RoutingWorker*>(dcb->poll.owner);
+            dcb->idle_timer = worker->delayed_call(delay, dcb_idle_timeout_cb, dcb);
+        }
+    }
+    else if (timeout)
+    {
+        RoutingWorker* worker = static_cast<RoutingWorker*>(dcb->poll.owner);
+        dcb->idle_timer = worker->delayed_call(idle_timer_delay(timeout * 100), dcb_idle_timeout_cb, dcb);
+    }
 
-                if (service->conn_idle_timeout && dcb->state == DCB_STATE_POLLING)
-                {
-                    int64_t idle = mxs_clock() - dcb->last_read;
-                    int64_t timeout = service->conn_idle_timeout * 10;
+    return false;
+}
 
-                    if (idle > timeout)
-                    {
-                        MXS_WARNING("Timing out '%s'@%s, idle for %.1f seconds",
-                                    dcb->user ? dcb->user : "<unknown>",
-                                    dcb->remote ? dcb->remote : "<unknown>",
-                                    (float)idle / 10.f);
-                        dcb->session->close_reason = SESSION_CLOSE_TIMEOUT;
-                        poll_fake_hangup_event(dcb);
-                    }
-                }
-            }
+/**
+ * Start the idle timeout timer of a client DCB, if its service has a
+ * connection timeout.
+ *
+ * @param dcb  A DCB owned by the calling worker.
+ */
+static void dcb_start_idle_timer(DCB* dcb)
+{
+    if (dcb->dcb_role == DCB_ROLE_CLIENT_HANDLER && dcb->idle_timer == 0)
+    {
+        mxb_assert(dcb->listener);
+        mxb_assert(dcb->poll.owner == RoutingWorker::get_current());
+        SERVICE* service = dcb->listener->service;
+
+        if (service->conn_idle_timeout)
+        {
+            RoutingWorker* worker = static_cast<RoutingWorker*>(dcb->poll.owner);
+            dcb->idle_timer = worker->delayed_call(idle_timer_delay(service->conn_idle_timeout * 1000),
+                                                   dcb_idle_timeout_cb,
+                                                   dcb);
         }
     }
 }
 
+static void dcb_stop_idle_timer(DCB* dcb)
+{
+    if (dcb->idle_timer)
+    {
+        RoutingWorker* worker = static_cast<RoutingWorker*>(dcb->poll.owner);
+        mxb_assert(worker == RoutingWorker::get_current());
+        worker->cancel_delayed_call(dcb->idle_timer);
+        dcb->idle_timer = 0;
+    }
+}
+
+/**
+ * Restart the idle timeout timers of the client DCBs of a service, after
+ * its connection timeout has been changed.
+ *
+ * @param service  The service.
+ */
+void dcb_reset_idle_timeouts(SERVICE* service)
+{
+    RoutingWorker::broadcast([service]() {
+                                 int id = RoutingWorker::get_current_id();
+
+                                 for (DCB* dcb = this_unit.all_dcbs[id]; dcb; dcb = dcb->thread.next)
+                                 {
+                                     if (dcb->dcb_role == DCB_ROLE_CLIENT_HANDLER
+                                         && dcb->listener->service == service)
+                                     {
+                                         dcb_stop_idle_timer(dcb);
+                                         dcb_start_idle_timer(dcb);
+                                     }
+                                 }
+                             }, RoutingWorker::EXECUTE_AUTO);
+}
+
 /** Helper class for serial iteration over all DCBs */
 class SerialDcbTask : public Worker::Task
 {
@@ -3005,6 +3559,46 @@ void dcb_foreach_local(bool (* func)(DCB* dcb, void* data), void* data)
     }
 }
 
+bool dcb_is_movable(const DCB* dcb)
+{
+    return dcb->state == DCB_STATE_POLLING
+           && dcb->fd != DCBFD_CLOSED
+           && dcb != this_thread.current_dcb
+           && dcb->persistentstart == 0
+           && dcb->n_close == 0
+           && dcb->fake_event == 0
+           && !dcb->writeq && !dcb->delayq && !dcb->readq && !dcb->fakeq
+           && !dcb->high_water_reached;
+}
+
+void dcb_detach_from_worker(DCB* dcb)
+{
+    mxb_assert(dcb->poll.owner == RoutingWorker::get_current());
+    mxb_assert(dcb_is_movable(dcb));
+
+    Worker* worker = static_cast<Worker*>(dcb->poll.owner);
+    worker->remove_fd(dcb->fd);
+    dcb_remove_from_list(dcb);
+}
+
+bool dcb_attach_to_worker(DCB* dcb)
+{
+    mxb_assert(dcb->poll.owner == RoutingWorker::get_current());
+    mxb_assert(dcb->state == DCB_STATE_POLLING);
+
+    // Any data that arrived while the DCB was not polled is reported when
+    // the descriptor is added, as the readiness is checked at that point.
+    Worker* worker = static_cast<Worker*>(dcb->poll.owner);
+    bool attached = worker->add_fd(dcb->fd, poll_events, (MXB_POLL_DATA*)dcb);
+
+    if (attached)
+    {
+        dcb_add_to_list(dcb);
+    }
+
+    return attached;
+}
+
 int dcb_get_port(const DCB* dcb)
 {
     int rval = -1;
@@ -3238,6 +3832,12 @@ static uint32_t dcb_handler(DCB* dcb, uint32_t events)
     return rv;
 }
 
+static uint32_t dcb_worker_listener_handler(MXB_POLL_DATA* data, MXB_WORKER* worker, uint32_t events)
+{
+    DCB_WORKER_LISTENER* wl = (DCB_WORKER_LISTENER*)data;
+    return dcb_poll_handler(&wl->dcb->poll, worker, events);
+}
+
 static uint32_t dcb_poll_handler(MXB_POLL_DATA* data, MXB_WORKER* worker, uint32_t events)
 {
     uint32_t rval = 0;
@@ -3491,6 +4091,41 @@ static bool add_fd_to_routing_workers(int fd, uint32_t events, MXB_POLL_DATA* da
     return rv;
 }
 
+static bool add_worker_listeners_to_routing_workers(DCB* dcb, uint32_t events)
+{
+    bool rv = true;
+    int i;
+
+    for (i = 0; i < dcb->n_worker_listeners && rv; i++)
+    {
+        DCB_WORKER_LISTENER* wl = &dcb->worker_listeners[i];
+        rv = RoutingWorker::get(i)->add_listener_fd(wl->fd, events, &wl->poll);
+    }
+
+    if (rv)
+    {
+        // The DCB itself is book-kept exactly like a shared listener.
+        RoutingWorker* worker = RoutingWorker::get_current();
+
+        if (!worker)
+        {
+            worker = RoutingWorker::get(RoutingWorker::MAIN);
+        }
+
+        dcb->poll.owner = worker;
+    }
+    else
+    {
+        // Remove the sockets that were added before the failing one.
+        for (int j = 0; j < i - 1; j++)
+        {
+            RoutingWorker::get(j)->remove_listener_fd(dcb->worker_listeners[j].fd);
+        }
+    }
+
+    return rv;
+}
+
 static bool dcb_add_to_worker(Worker* worker, DCB* dcb, uint32_t events)
 {
     bool rv = false;
@@ -3501,7 +4136,11 @@ static bool dcb_add_to_worker(Worker* worker, DCB* dcb, uint32_t events)
         mxb_assert(dcb->dcb_role == DCB_ROLE_SERVICE_LISTENER);
 
         // A listening DCB, we add it immediately.
-        if (add_fd_to_routing_workers(dcb->fd, events, (MXB_POLL_DATA*)dcb))
+        bool added = dcb->worker_listeners ?
+            add_worker_listeners_to_routing_workers(dcb, events) :
+            add_fd_to_routing_workers(dcb->fd, events, (MXB_POLL_DATA*)dcb);
+
+        if (added)
         {
             // If this takes place on the main thread (all listening DCBs are
             // stored on the main thread)...
@@ -3692,7 +4331,19 @@ int poll_remove_dcb(DCB* dcb)
 
         if (dcb->dcb_role == DCB_ROLE_SERVICE_LISTENER)
         {
-            if (RoutingWorker::remove_shared_fd(dcbfd))
+            if (dcb->worker_listeners)
+            {
+                rc = 0;
+
+                for (int i = 0; i < dcb->n_worker_listeners; i++)
+                {
+                    if (!RoutingWorker::get(i)->remove_listener_fd(dcb->worker_listeners[i].fd))
+                    {
+                        rc = -1;
+                    }
+                }
+            }
+            else if (RoutingWorker::remove_shared_fd(dcbfd))
             {
                 rc = 0;
             }
@@ -3716,6 +4367,11 @@ DCB* dcb_get_current()
     return this_thread.current_dcb;
 }
 
+bool dcb_is_open(DCB* dcb, uint64_t uid)
+{
+    return dcb_is_still_valid(dcb, RoutingWorker::get_current_id()) && dcb->m_uid == uid;
+}
+
 /**
  * @brief DCB callback for upstream throtting
  * Called by any backend dcb when its writeq is above high water mark or
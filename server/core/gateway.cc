@@ -62,6 +62,7 @@
 #include <maxscale/version.h>
 #include <maxscale/random.h>
 #include <maxscale/routingworker.hh>
+#include <maxscale/threadpool.hh>
 
 #include "internal/admin.hh"
 #include "internal/config.hh"
@@ -69,6 +70,7 @@
 #include "internal/modules.h"
 #include "internal/monitor.h"
 #include "internal/poll.hh"
+#include "internal/query_classifier.hh"
 #include "internal/service.hh"
 
 using namespace maxscale;
@@ -2172,6 +2174,12 @@ int main(int argc, char** argv)
         goto return_main;
     }
 
+    if (!cnf->config_check)
+    {
+        // The classification of the saved statements proceeds while the services are started.
+        qc_start_cache_persistence();
+    }
+
     /** Start all monitors */
     monitor_start_all();
 
@@ -2255,6 +2263,9 @@ int main(int argc, char** argv)
     mxb_assert(worker);
     worker->run();
 
+    /*< Stop the blocking tasks before the workers that get their results */
+    mxs::ThreadPool::stop_all();
+
     /** Stop administrative interface */
     mxs_admin_shutdown();
 
@@ -2276,6 +2287,8 @@ int main(int argc, char** argv)
 
     MXS_NOTICE("All workers have shut down.");
 
+    qc_end_cache_persistence();
+
     maxscale_start_teardown();
 
     /*<
@@ -0,0 +1,42 @@
+/*
+ * Copyright (c) 2018 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2022-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+#pragma once
+
+/**
+ * The private buffer header
+ */
+
+#include <maxscale/ccdefs.hh>
+#include <maxscale/buffer.h>
+
+namespace maxscale
+{
+
+/**
+ * Statistics of the buffer pool of one routing worker.
+ */
+struct BufferPoolStats
+{
+    uint64_t hits;          /**< Allocations served from the free lists */
+    uint64_t misses;        /**< Allocations that had to use malloc */
+    uint64_t remote_frees;  /**< Chunks freed by some other thread */
+    uint64_t cached;        /**< Number of chunks currently in the free lists */
+};
+
+/**
+ * Get the buffer pool statistics of the calling thread
+ *
+ * @return The statistics, all zero if the thread is not a routing worker
+ */
+BufferPoolStats buffer_pool_stats();
+}
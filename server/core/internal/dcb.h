@@ -19,4 +19,32 @@ MXS_BEGIN_DECLS
 void dcb_free_all_memory(DCB* dcb);
 void dcb_final_close(DCB* dcb);
 
+/**
+ * Check whether a DCB can be moved to another worker
+ *
+ * @param dcb  The DCB
+ *
+ * @return True, if the DCB is polled and has no queued data or pending events
+ */
+bool dcb_is_movable(const DCB* dcb);
+
+/**
+ * Remove a DCB from the polling and the DCB list of its owner, in preparation
+ * of moving it to another worker. Must be called in the owning worker.
+ *
+ * @param dcb  A DCB for which dcb_is_movable() returns true
+ */
+void dcb_detach_from_worker(DCB* dcb);
+
+/**
+ * Add a DCB detached with dcb_detach_from_worker() to the polling and the DCB
+ * list of its new owner. Must be called in the new owner, which must already
+ * be stored in @c dcb->poll.owner.
+ *
+ * @param dcb  The DCB
+ *
+ * @return True, if the DCB could be added to the worker
+ */
+bool dcb_attach_to_worker(DCB* dcb);
+
 MXS_END_DECLS
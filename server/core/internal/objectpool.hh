@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2018 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2022-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+#pragma once
+
+/**
+ * Recycling of the objects allocated for every connection
+ */
+
+#include <maxscale/ccdefs.hh>
+#include <maxbase/assert.h>
+#include <maxscale/alloc.h>
+
+namespace maxscale
+{
+
+/**
+ * Statistics of one object pool of one routing worker.
+ */
+struct ObjectPoolStats
+{
+    uint64_t hits;      /**< Allocations served from the free list */
+    uint64_t misses;    /**< Allocations that had to use malloc */
+    uint64_t cached;    /**< Number of objects currently in the free list */
+};
+
+/**
+ * A free list of equally sized blocks of memory, used by a single thread.
+ *
+ * The blocks are ordinary MXS_MALLOC memory, so a block allocated by one thread
+ * can be freed to the list of another thread or with MXS_FREE.
+ */
+class FreeList
+{
+public:
+    FreeList(const FreeList&) = delete;
+    FreeList& operator=(const FreeList&) = delete;
+
+    /**
+     * Create a free list
+     *
+     * @param size        Size of the blocks, at least the size of a pointer
+     * @param max_cached  Maximum number of blocks kept in the list
+     */
+    FreeList(size_t size, size_t max_cached)
+        : m_size(size)
+        , m_max_cached(max_cached)
+        , m_pHead(nullptr)
+    {
+        mxb_assert(size >= sizeof(Block));
+        m_stats.hits = 0;
+        m_stats.misses = 0;
+        m_stats.cached = 0;
+    }
+
+    ~FreeList()
+    {
+        while (m_pHead)
+        {
+            Block* pBlock = m_pHead;
+            m_pHead = pBlock->pNext;
+            MXS_FREE(pBlock);
+        }
+    }
+
+    size_t size() const
+    {
+        return m_size;
+    }
+
+    /**
+     * Allocate a block
+     *
+     * @return A block of @c size() bytes or NULL on allocation failure
+     */
+    void* alloc()
+    {
+        void* pMem;
+
+        if (m_pHead)
+        {
+            Block* pBlock = m_pHead;
+            m_pHead = pBlock->pNext;
+            --m_stats.cached;
+            ++m_stats.hits;
+            pMem = pBlock;
+        }
+        else
+        {
+            ++m_stats.misses;
+            pMem = MXS_MALLOC(m_size);
+        }
+
+        return pMem;
+    }
+
+    /**
+     * Free a block
+     *
+     * @param pMem  A block of @c size() bytes allocated by any free list of the
+     *              same size or with MXS_MALLOC.
+     */
+    void free(void* pMem)
+    {
+        if (m_stats.cached < m_max_cached)
+        {
+            Block* pBlock = static_cast<Block*>(pMem);
+            pBlock->pNext = m_pHead;
+            m_pHead = pBlock;
+            ++m_stats.cached;
+        }
+        else
+        {
+            MXS_FREE(pMem);
+        }
+    }
+
+    const ObjectPoolStats& stats() const
+    {
+        return m_stats;
+    }
+
+private:
+    struct Block
+    {
+        Block* pNext;
+    };
+
+    size_t          m_size;
+    size_t          m_max_cached;
+    Block*          m_pHead;
+    ObjectPoolStats m_stats;
+};
+
+/**
+ * Get the statistics of the DCB pool of the calling thread
+ *
+ * @return The statistics, all zero if the thread is not a routing worker
+ */
+ObjectPoolStats dcb_pool_stats();
+
+/**
+ * Get the statistics of the protocol object pools of the calling thread
+ *
+ * @return The statistics of all size classes combined, all zero if the thread
+ *         is not a routing worker
+ */
+ObjectPoolStats protocol_pool_stats();
+
+/**
+ * Get the statistics of the session pool of the calling thread
+ *
+ * @return The statistics, all zero if the thread is not a routing worker
+ */
+ObjectPoolStats session_pool_stats();
+}
@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2018 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2022-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+#pragma once
+
+/**
+ * The persistent connection pool of a server
+ */
+
+#include <maxscale/ccdefs.hh>
+
+#include <deque>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <maxscale/dcb.h>
+
+namespace maxscale
+{
+
+/**
+ * The unused connections to one server, owned by one routing worker.
+ *
+ * The connections are indexed by protocol, capabilities, user and client address,
+ * so a connection made for the same user from the same address is found in constant
+ * time. If there is none, the most recently pooled connection of the same protocol
+ * and capabilities is handed out and the protocol module resets it for the new user.
+ * The capabilities are negotiated when the connection is created and resetting it
+ * does not change them, so a connection is never handed out to a session that
+ * needs different ones. For the same reason, if the server uses the proxy protocol,
+ * a connection is only handed out to a client from the same address.
+ *
+ * The pool only keeps track of the connections, closing them is left to the caller.
+ */
+class PersistentPool
+{
+public:
+    PersistentPool(const PersistentPool&) = delete;
+    PersistentPool& operator=(const PersistentPool&) = delete;
+
+    PersistentPool()
+    {
+    }
+
+    /**
+     * @return The number of connections in the pool
+     */
+    size_t size() const
+    {
+        return m_entries.size();
+    }
+
+    /**
+     * Add a connection to the pool
+     *
+     * @param pDcb  A backend DCB with the user, the client address, the protocol and
+     *              the capabilities set
+     */
+    void add(DCB* pDcb);
+
+    /**
+     * Take a connection from the pool
+     *
+     * @param zUser      The user the connection is needed for
+     * @param zIp        The address of the client
+     * @param zProtocol     The protocol of the connection
+     * @param capabilities  The protocol capabilities the connection must have
+     * @param max_age       Connections pooled longer than this many seconds are not used
+     * @param pExact        Set to true if the connection was made for the same user and address
+     *
+     * @return A connection or NULL if there are no usable connections
+     */
+    DCB* acquire(const char* zUser,
+                 const char* zIp,
+                 const char* zProtocol,
+                 uint64_t capabilities,
+                 time_t max_age,
+                 bool* pExact);
+
+    /**
+     * Remove the connections that should not be reused
+     *
+     * The connections that have failed or hung, whose server is no longer running
+     * or which have been in the pool for too long are removed, as are the oldest
+     * connections if there are more than allowed.
+     *
+     * @param max_size  The maximum number of connections to keep
+     * @param max_age   The maximum number of seconds a connection is kept
+     * @param all       Remove all connections
+     *
+     * @return The removed connections
+     */
+    std::vector<DCB*> evict(size_t max_size, time_t max_age, bool all);
+
+private:
+    struct Entry
+    {
+        DCB*        pDcb;
+        std::string key;
+    };
+
+    typedef std::list<Entry>                Entries;
+    typedef std::deque<Entries::iterator>   Bucket;
+
+    static std::string key_of(const char* zUser,
+                              const char* zIp,
+                              const char* zProtocol,
+                              uint64_t capabilities);
+    static bool        is_usable(const DCB* pDcb, time_t now, time_t max_age);
+
+    DCB* remove(Entries::iterator it);
+
+    Entries                                 m_entries;  /**< Oldest connection first */
+    std::unordered_map<std::string, Bucket> m_index;    /**< Connections by protocol, capabilities,
+                                                         * user and address */
+};
+}
@@ -37,6 +37,24 @@ typedef enum qc_trx_parse_using
  */
 uint32_t qc_get_trx_type_mask_using(GWBUF* stmt, qc_trx_parse_using_t use);
 
+/**
+ * Start persisting the query classifier cache, if it has been enabled
+ *
+ * The statements saved by the previous run are classified again in the
+ * background and the most used statements of the cache are saved periodically.
+ * Must be called after the query classifier plugin has been initialized.
+ */
+void qc_start_cache_persistence();
+
+/**
+ * End persisting the query classifier cache
+ *
+ * Stops the classification of the saved statements and saves the most used
+ * statements of the cache. Must be called before the query classifier plugin
+ * is finalized.
+ */
+void qc_end_cache_persistence();
+
 /**
  * Common query classifier properties as JSON.
  *
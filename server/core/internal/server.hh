@@ -22,6 +22,7 @@
 
 #include <maxbase/average.hh>
 #include <maxscale/server.h>
+#include "persistentpool.hh"
 #include <maxscale/resultset.hh>
 #include <maxscale/routingworker.hh>
 
@@ -49,10 +50,32 @@ public:
 
     void response_time_add(double ave, int num_samples);
 
+    /**
+     * Get the persistent connection pool of a routing worker
+     *
+     * @param id  The id of the worker
+     *
+     * @return The pool, only to be used by that worker
+     */
+    mxs::PersistentPool& persistent_pool(int id)
+    {
+        return m_persistent[id];
+    }
+
     mutable std::mutex m_lock;
+    std::unique_ptr<mxs::PersistentPool[]> m_persistent;    /**< The pools of the routing workers */
 
 private:
     maxbase::EMAverage m_response_time;
 };
 
 void server_free(Server* server);
+
+/**
+ * Close the stale connections in the persistent pools of a routing worker
+ *
+ * Called periodically by every routing worker.
+ *
+ * @param id  The id of the calling worker
+ */
+void server_clean_persistent_pools(int id);
@@ -60,6 +60,39 @@ void session_link_backend_dcb(MXS_SESSION* session, struct dcb* dcb);
  */
 void session_unlink_backend_dcb(MXS_SESSION* session, struct dcb* dcb);
 
+/**
+ * Check whether a session can be moved to another worker. Must be called in
+ * the worker that owns the session.
+ *
+ * A session can be moved if it is idle, that is, it is not in a transaction,
+ * it is not waiting for a result and none of its DCBs has queued data. Sessions
+ * with filters are never moved, as filters may keep worker specific data, and
+ * neither are those of routers that do not declare RCAP_TYPE_MOVABLE_SESSIONS.
+ *
+ * @param session  The session
+ *
+ * @return True, if the session can be moved
+ */
+bool session_is_movable(MXS_SESSION* session);
+
+/**
+ * Take over a session that has been moved to the calling worker
+ *
+ * The buffers that the session and its router session keep are taken over by
+ * the calling worker. Must be called before the session is used in its new worker.
+ *
+ * @param session  The session
+ */
+void session_moved(MXS_SESSION* session);
+
+/**
+ * Mark a session as being moved or as having arrived to its new worker
+ *
+ * @param session  The session
+ * @param moving   Whether the session is being moved
+ */
+void session_set_moving(MXS_SESSION* session, bool moving);
+
 void printAllSessions();
 void printSession(MXS_SESSION*);
 
@@ -20,6 +20,7 @@
 #include <unordered_set>
 #include <vector>
 
+#include <maxbase/atomic.hh>
 #include <maxscale/buffer.hh>
 #include <maxscale/session.h>
 #include <maxscale/resultset.hh>
@@ -103,6 +104,11 @@ public:
     Session(SERVICE* service);
     ~Session();
 
+    // The memory of the sessions is recycled by the routing workers.
+    static void* operator new(size_t size, const std::nothrow_t&) noexcept;
+    static void  operator delete(void* pSession, size_t size);
+    static void  operator delete(void* pSession, const std::nothrow_t&) noexcept;
+
     bool setup_filters(Service* service);
 
     const FilterList& get_filters() const
@@ -117,6 +123,7 @@ public:
                              const char* value_end);
     bool remove_variable(const char* name, void** context);
     void retain_statement(GWBUF* pBuffer);
+    void take_ownership();
     void dump_statements() const;
     void book_server_response(SERVER* pServer, bool final_response);
     void book_last_as_complete();
@@ -141,6 +148,16 @@ public:
         return m_dcb_set;
     }
 
+    bool is_moving() const
+    {
+        return mxb::atomic::load(&m_moving, mxb::atomic::ACQUIRE);
+    }
+
+    void set_moving(bool moving)
+    {
+        mxb::atomic::store(&m_moving, moving, mxb::atomic::RELEASE);
+    }
+
 private:
     FilterList        m_filters;
     SessionVarsByName m_variables;
@@ -148,6 +165,7 @@ private:
     int               m_current_query = -1;     /*< The index of the current query */
     DCBSet            m_dcb_set;                /*< Set of associated backend DCBs */
     uint32_t          m_retain_last_statements; /*< How many statements be retained */
+    bool              m_moving = false;         /*< Is the session being moved to another worker */
 };
 }
 
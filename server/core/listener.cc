@@ -41,6 +41,7 @@
 #include <maxscale/alloc.h>
 #include <maxscale/users.h>
 #include <maxscale/service.h>
+#include <maxbase/atomic.hh>
 
 static RSA* rsa_512 = NULL;
 static RSA* rsa_1024 = NULL;
@@ -142,6 +143,8 @@ SERV_LISTENER* listener_alloc(struct service* service,
     proto->users = NULL;
     proto->next = NULL;
     proto->auth_instance = auth_instance;
+    memset(&proto->client_compression, 0, sizeof(proto->client_compression));
+    memset(&proto->backend_compression, 0, sizeof(proto->backend_compression));
     pthread_mutex_init(&proto->lock, NULL);
 
     return proto;
@@ -552,6 +555,22 @@ bool listener_serialize(const SERV_LISTENER* listener)
     return rval;
 }
 
+static json_t* compression_stats_to_json(const LISTENER_COMPRESSION_STATS* stats)
+{
+    int64_t plain = mxb::atomic::load(&stats->plain_bytes, mxb::atomic::RELAXED);
+    int64_t wire = mxb::atomic::load(&stats->wire_bytes, mxb::atomic::RELAXED);
+
+    json_t* obj = json_object();
+    json_object_set_new(obj, "plain_bytes", json_integer(plain));
+    json_object_set_new(obj, "wire_bytes", json_integer(wire));
+    json_object_set_new(obj, "bytes_saved", json_integer(plain - wire));
+    json_object_set_new(obj, "compress_ns",
+                        json_integer(mxb::atomic::load(&stats->compress_ns, mxb::atomic::RELAXED)));
+    json_object_set_new(obj, "decompress_ns",
+                        json_integer(mxb::atomic::load(&stats->decompress_ns, mxb::atomic::RELAXED)));
+    return obj;
+}
+
 json_t* listener_to_json(const SERV_LISTENER* listener)
 {
     json_t* param = json_object();
@@ -578,6 +597,25 @@ json_t* listener_to_json(const SERV_LISTENER* listener)
     json_object_set_new(attr, CN_STATE, json_string(listener_state_to_string(listener)));
     json_object_set_new(attr, CN_PARAMETERS, param);
 
+    if (listener->listener->worker_listeners)
+    {
+        json_t* accepts = json_array();
+
+        for (int i = 0; i < listener->listener->n_worker_listeners; i++)
+        {
+            DCB_WORKER_LISTENER* wl = &listener->listener->worker_listeners[i];
+            uint64_t n = mxb::atomic::load(&wl->n_accepts, mxb::atomic::RELAXED);
+            json_array_append_new(accepts, json_integer(n));
+        }
+
+        json_object_set_new(attr, "worker_accepts", accepts);
+    }
+
+    json_t* compression = json_object();
+    json_object_set_new(compression, "client", compression_stats_to_json(&listener->client_compression));
+    json_object_set_new(compression, "backend", compression_stats_to_json(&listener->backend_compression));
+    json_object_set_new(attr, "compression", compression);
+
     if (listener->listener->authfunc.diagnostic_json)
     {
         json_t* diag = listener->listener->authfunc.diagnostic_json(listener);
@@ -588,6 +626,16 @@ json_t* listener_to_json(const SERV_LISTENER* listener)
         }
     }
 
+    if (listener->listener->authfunc.statistics_json)
+    {
+        json_t* stats = listener->listener->authfunc.statistics_json(listener);
+
+        if (stats)
+        {
+            json_object_set_new(attr, CN_AUTHENTICATOR_STATISTICS, stats);
+        }
+    }
+
     json_t* rval = json_object();
     json_object_set_new(rval, CN_ID, json_string(listener->name));
     json_object_set_new(rval, CN_TYPE, json_string(CN_LISTENERS));
@@ -23,11 +23,16 @@
 #include <mutex>
 #include <functional>
 #include <cctype>
+#include <limits>
+#if defined (__x86_64__)
+#include <immintrin.h>
+#endif
 
 #include <maxscale/alloc.h>
 #include <maxscale/buffer.h>
 #include <maxscale/buffer.hh>
 #include <maxscale/modutil.h>
+#include <maxscale/modutil.hh>
 #include <maxscale/poll.h>
 #include <maxscale/protocol/mysql.h>
 #include <maxscale/utils.h>
@@ -496,6 +501,24 @@ static bool only_one_packet(GWBUF* buffer)
     return packet_len + MYSQL_HEADER_LEN == buffer_len;
 }
 
+/**
+ * Check whether a buffer chain is at least @c len bytes long
+ *
+ * Only the buffers needed to reach the length are looked at, so splitting
+ * packets one by one from a long chain takes linear time.
+ */
+static bool has_length(const GWBUF* buffer, size_t len)
+{
+    size_t total = 0;
+
+    for (; buffer && total < len; buffer = buffer->next)
+    {
+        total += GWBUF_LENGTH(buffer);
+    }
+
+    return total >= len;
+}
+
 /**
  * Return the first packet from a buffer.
  *
@@ -513,30 +536,26 @@ GWBUF* modutil_get_next_MySQL_packet(GWBUF** p_readbuf)
     GWBUF* packet = NULL;
     GWBUF* readbuf = *p_readbuf;
 
-    if (readbuf)
+    if (readbuf && has_length(readbuf, MYSQL_HEADER_LEN))
     {
-        size_t totalbuflen = gwbuf_length(readbuf);
-        if (totalbuflen >= MYSQL_HEADER_LEN)
-        {
-            size_t packetlen;
+        size_t packetlen;
 
-            if (GWBUF_LENGTH(readbuf) >= 3)     // The length is in the 3 first bytes.
-            {
-                uint8_t* data = (uint8_t*)GWBUF_DATA((readbuf));
-                packetlen = MYSQL_GET_PAYLOAD_LEN(data) + 4;
-            }
-            else
-            {
-                // The header is split between two GWBUFs.
-                uint8_t data[3];
-                gwbuf_copy_data(readbuf, 0, 3, data);
-                packetlen = MYSQL_GET_PAYLOAD_LEN(data) + 4;
-            }
+        if (GWBUF_LENGTH(readbuf) >= 3)     // The length is in the 3 first bytes.
+        {
+            uint8_t* data = (uint8_t*)GWBUF_DATA((readbuf));
+            packetlen = MYSQL_GET_PAYLOAD_LEN(data) + 4;
+        }
+        else
+        {
+            // The header is split between two GWBUFs.
+            uint8_t data[3];
+            gwbuf_copy_data(readbuf, 0, 3, data);
+            packetlen = MYSQL_GET_PAYLOAD_LEN(data) + 4;
+        }
 
-            if (packetlen <= totalbuflen)
-            {
-                packet = gwbuf_split(p_readbuf, packetlen);
-            }
+        if (has_length(readbuf, packetlen))
+        {
+            packet = gwbuf_split(p_readbuf, packetlen);
         }
     }
 
@@ -1250,20 +1269,8 @@ mxs_pcre2_result_t modutil_mysql_wildcard_match(const char* pattern, const char*
     return rval;
 }
 
-static inline bool is_next(mxs::Buffer::iterator it, mxs::Buffer::iterator end, const std::string& str)
+namespace
 {
-    mxb_assert(it != end);
-    for (auto s_it = str.begin(); s_it != str.end(); ++s_it, ++it)
-    {
-        if (it == end || *it != *s_it)
-        {
-            return false;
-        }
-    }
-
-    return true;
-}
-
 
 // Class for fast char type lookups
 class LUT
@@ -1295,24 +1302,249 @@ private:
 };
 
 // Optimized versions of standard functions that ignore the locale and use a lookup table
-static const LUT is_space(::isspace);
-static const LUT is_digit(::isdigit);
-static const LUT is_alpha(::isalpha);
-static const LUT is_alnum(::isalnum);
-static const LUT is_xdigit(::isxdigit);
+const LUT is_space(::isspace);
+const LUT is_digit(::isdigit);
+const LUT is_alpha(::isalpha);
+const LUT is_alnum(::isalnum);
+const LUT is_xdigit(::isxdigit);
 
 // For detection of characters that need special treatment, helps speed up processing of keywords etc.
-static const LUT is_special([](uint8_t c) {
-                                return isdigit(c) || isspace(c) || std::string("\"'`#-/\\").find(
-                                    c) != std::string::npos;
-                            });
+const LUT is_special([](uint8_t c) {
+                         return isdigit(c) || isspace(c) || std::string("\"'`#-/\\").find(
+                             c) != std::string::npos;
+                     });
+
+/**
+ * Scanners that copy the characters which need no special treatment and find the bytes which
+ * end strings and comments. The SSE2 and AVX2 versions examine 16 or 32 bytes at a time. Their
+ * comparisons are signed which means that bytes above 0x7f never match a range.
+ */
+struct ScalarScanner
+{
+    /**
+     * Copy characters up to the next one that needs special treatment
+     *
+     * @param it  The input, moved to the first special character or to @c end. The vectorized
+     *            scanners call this for the tail of the input which can be empty or start with
+     *            a special character.
+     * @param end The end of the input
+     * @param out The output buffer, must have room for as many bytes as there are left in the input
+     * @param i   Current length of the output, updated by the number of copied characters
+     */
+    static inline void copy_normal(const uint8_t*& it, const uint8_t* end, char* out, int& i)
+    {
+        while (it != end && (!is_special(*it) || is_lone_space(it, end)))
+        {
+            out[i++] = *it++;
+        }
+    }
+
+    /**
+     * Check if a space can be copied as-is
+     *
+     * A space that follows a normal character and is followed by something other than whitespace
+     * is not removed by the canonicalization.
+     */
+    static inline bool is_lone_space(const uint8_t* it, const uint8_t* end)
+    {
+        return *it == ' ' && it + 1 != end && !is_space(it[1]);
+    }
+
+    /**
+     * Find the first occurrence of either of two bytes
+     *
+     * @return Pointer to the first occurrence or @c end if neither was found
+     */
+    static inline const uint8_t* find_either(const uint8_t* it, const uint8_t* end, uint8_t a, uint8_t b)
+    {
+        while (it != end && *it != a && *it != b)
+        {
+            ++it;
+        }
+
+        return it;
+    }
+};
+
+#if defined (__x86_64__)
+
+/**
+ * Combine the special characters and the whitespace of a block into the bitmask of characters that
+ * stop the copying. A space that is surrounded by characters other than whitespace is copied as-is,
+ * the same as ScalarScanner::is_lone_space() does. The first character of a block always follows a
+ * copied character and the character after the last one is not known.
+ */
+template<class Mask>
+inline Mask stop_mask(Mask special, Mask whitespace, Mask space)
+{
+    const Mask last = Mask(1) << (sizeof(Mask) * 8 - 1);
+    Mask lone = space & ~(whitespace << 1) & ~((whitespace >> 1) | last);
+    return (special | whitespace) & ~lone;
+}
+
+// Matches the same characters as the is_special table. The slash and the digits form one range,
+// as do the double quote and the hash.
+inline uint16_t special_sse2(__m128i v)
+{
+    __m128i slash_digit = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('/' - 1)),
+                                        _mm_cmpgt_epi8(_mm_set1_epi8('9' + 1), v));
+    __m128i quote_hash = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('"' - 1)),
+                                       _mm_cmpgt_epi8(_mm_set1_epi8('#' + 1), v));
+    __m128i other = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\'')),
+                                              _mm_cmpeq_epi8(v, _mm_set1_epi8('-'))),
+                                 _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('`')),
+                                              _mm_cmpeq_epi8(v, _mm_set1_epi8('\\'))));
+    __m128i space = _mm_cmpeq_epi8(v, _mm_set1_epi8(' '));
+    __m128i whitespace = _mm_or_si128(_mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('\t' - 1)),
+                                                    _mm_cmpgt_epi8(_mm_set1_epi8('\r' + 1), v)),
+                                      space);
+
+    return stop_mask<uint16_t>(_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(slash_digit, quote_hash), other)),
+                               _mm_movemask_epi8(whitespace),
+                               _mm_movemask_epi8(space));
+}
+
+__attribute__((target("avx2")))
+inline uint32_t special_avx2(__m256i v)
+{
+    __m256i slash_digit = _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8('/' - 1)),
+                                           _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), v));
+    __m256i quote_hash = _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8('"' - 1)),
+                                          _mm256_cmpgt_epi8(_mm256_set1_epi8('#' + 1), v));
+    __m256i other = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\'')),
+                                                    _mm256_cmpeq_epi8(v, _mm256_set1_epi8('-'))),
+                                    _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('`')),
+                                                    _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\'))));
+    __m256i space = _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' '));
+    __m256i whitespace = _mm256_or_si256(_mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8('\t' - 1)),
+                                                          _mm256_cmpgt_epi8(_mm256_set1_epi8('\r' + 1), v)),
+                                         space);
+    __m256i special = _mm256_or_si256(_mm256_or_si256(slash_digit, quote_hash), other);
+
+    return stop_mask<uint32_t>(_mm256_movemask_epi8(special),
+                               _mm256_movemask_epi8(whitespace),
+                               _mm256_movemask_epi8(space));
+}
+
+struct Sse2Scanner
+{
+    static inline void copy_normal(const uint8_t*& it, const uint8_t* end, char* out, int& i)
+    {
+        while (end - it >= 16)
+        {
+            // All 16 bytes are stored but only the ones before the first special character are kept
+            __m128i v = _mm_loadu_si128((const __m128i*)it);
+            _mm_storeu_si128((__m128i*)(out + i), v);
+            uint32_t mask = special_sse2(v);
+
+            if (mask)
+            {
+                int n = __builtin_ctz(mask);
+                it += n;
+                i += n;
+                return;
+            }
+
+            it += 16;
+            i += 16;
+        }
+
+        ScalarScanner::copy_normal(it, end, out, i);
+    }
+
+    static inline const uint8_t* find_either(const uint8_t* it, const uint8_t* end, uint8_t a, uint8_t b)
+    {
+        __m128i va = _mm_set1_epi8(a);
+        __m128i vb = _mm_set1_epi8(b);
+
+        while (end - it >= 16)
+        {
+            __m128i v = _mm_loadu_si128((const __m128i*)it);
+            int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, va), _mm_cmpeq_epi8(v, vb)));
+
+            if (mask)
+            {
+                return it + __builtin_ctz(mask);
+            }
+
+            it += 16;
+        }
+
+        return ScalarScanner::find_either(it, end, a, b);
+    }
+};
+
+struct Avx2Scanner
+{
+    __attribute__((target("avx2")))
+    static inline void copy_normal(const uint8_t*& it, const uint8_t* end, char* out, int& i)
+    {
+        while (end - it >= 32)
+        {
+            __m256i v = _mm256_loadu_si256((const __m256i*)it);
+            _mm256_storeu_si256((__m256i*)(out + i), v);
+            uint32_t mask = special_avx2(v);
+
+            if (mask)
+            {
+                int n = __builtin_ctz(mask);
+                it += n;
+                i += n;
+                return;
+            }
+
+            it += 32;
+            i += 32;
+        }
+
+        Sse2Scanner::copy_normal(it, end, out, i);
+    }
+
+    __attribute__((target("avx2")))
+    static inline const uint8_t* find_either(const uint8_t* it, const uint8_t* end, uint8_t a, uint8_t b)
+    {
+        __m256i va = _mm256_set1_epi8(a);
+        __m256i vb = _mm256_set1_epi8(b);
+
+        while (end - it >= 32)
+        {
+            __m256i v = _mm256_loadu_si256((const __m256i*)it);
+            uint32_t mask = _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(v, va),
+                                                                 _mm256_cmpeq_epi8(v, vb)));
+
+            if (mask)
+            {
+                return it + __builtin_ctz(mask);
+            }
+
+            it += 32;
+        }
+
+        return Sse2Scanner::find_either(it, end, a, b);
+    }
+};
+
+#endif
+
+inline bool is_next(const uint8_t* it, const uint8_t* end, const char* str)
+{
+    mxb_assert(it != end);
+    for (; *str; ++str, ++it)
+    {
+        if (it == end || *it != (uint8_t)*str)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
 
-static std::pair<bool, mxs::Buffer::iterator> probe_number(mxs::Buffer::iterator it,
-                                                           mxs::Buffer::iterator end)
+std::pair<bool, const uint8_t*> probe_number(const uint8_t* it, const uint8_t* end)
 {
     mxb_assert(it != end);
     mxb_assert(is_digit(*it));
-    std::pair<bool, mxs::Buffer::iterator> rval = std::make_pair(true, it);
+    std::pair<bool, const uint8_t*> rval = std::make_pair(true, it);
     bool is_hex = *it == '0';
     bool allow_hex = false;
 
@@ -1365,7 +1597,7 @@ static std::pair<bool, mxs::Buffer::iterator> probe_number(mxs::Buffer::iterator
                     rval.first = false;
                     break;
                 }
-                mxb_assert(is_digit(*next_it));
+                mxb_assert(next_it == end || is_digit(*next_it));
             }
             else
             {
@@ -1383,7 +1615,7 @@ static std::pair<bool, mxs::Buffer::iterator> probe_number(mxs::Buffer::iterator
     return rval;
 }
 
-static inline bool is_negation(const std::string& str, int i)
+inline bool is_negation(const char* str, int i)
 {
     bool rval = false;
 
@@ -1406,52 +1638,86 @@ static inline bool is_negation(const std::string& str, int i)
     return rval;
 }
 
-mxs::Buffer::iterator find_char(mxs::Buffer::iterator it, const mxs::Buffer::iterator& end, char c)
+/**
+ * Find the closing quote of a string, skipping escaped characters
+ *
+ * @return Pointer to the closing quote or @c end if the string is not terminated
+ */
+template<class Scanner>
+inline const uint8_t* find_char(const uint8_t* it, const uint8_t* end, char c)
 {
-    for (; it != end; ++it)
+    while ((it = Scanner::find_either(it, end, c, '\\')) != end && *it == '\\')
     {
-        if (*it == '\\')
-        {
-            if (++it == end)
-            {
-                break;
-            }
-        }
-        else if (*it == c)
+        if (++it == end)
         {
-            return it;
+            break;
         }
+
+        ++it;
     }
 
     return it;
 }
 
-namespace maxscale
+/**
+ * Find the end of a comment
+ *
+ * @param it  The start of the comment
+ * @param end The end of the statement
+ *
+ * @return Pointer to the slash that ends the comment or @c end if the comment is not terminated
+ */
+const uint8_t* find_comment_end(const uint8_t* it, const uint8_t* end)
 {
+    while ((it = (const uint8_t*)memchr(it, '*', end - it)))
+    {
+        if (++it == end)
+        {
+            return end;
+        }
+        else if (*it == '/')
+        {
+            return it;
+        }
+    }
 
-std::string get_canonical(GWBUF* querybuf)
+    return end;
+}
+
+/**
+ * Canonicalize a statement
+ *
+ * @param sql    The statement
+ * @param len    Length of the statement
+ * @param digest If not NULL, the digest of the canonical form is stored here
+ *
+ * @return The canonical form
+ */
+template<class Scanner>
+inline std::string canonicalize(const char* sql, size_t len, uint64_t* digest)
 {
     std::string rval;
     int i = 0;
-    rval.resize(gwbuf_length(querybuf) - MYSQL_HEADER_LEN + 1);
-    mxs::Buffer buf(querybuf);
+    rval.resize(len + 1);
+    char* out = &rval[0];
+    const uint8_t* end = (const uint8_t*)sql + len;
 
-    for (auto it = std::next(buf.begin(), MYSQL_HEADER_LEN + 1);    // Skip packet header and command
-         it != buf.end(); ++it)
+    for (const uint8_t* it = (const uint8_t*)sql; it != end; ++it)
     {
         if (!is_special(*it))
         {
-            // Normal character, no special handling required
-            rval[i++] = *it;
+            // Normal characters, no special handling required. Copy them up to the next special one.
+            Scanner::copy_normal(it, end, out, i);
+            --it;
         }
         else if (*it == '\\')
         {
             // Jump over any escaped values
-            rval[i++] += *it++;
+            out[i++] = *it++;
 
-            if (it != buf.end())
+            if (it != end)
             {
-                rval[i++] = *it;
+                out[i++] = *it;
             }
             else
             {
@@ -1461,37 +1727,26 @@ std::string get_canonical(GWBUF* querybuf)
         }
         else if (is_space(*it))
         {
-            if (i == 0 || is_space(rval[i - 1]))
+            if (i == 0 || is_space(out[i - 1]))
             {
                 // Leading or repeating whitespace, skip it
             }
             else
             {
-                rval[i++] = ' ';
+                out[i++] = ' ';
             }
         }
-        else if (*it == '/' && is_next(it, buf.end(), "/*"))
+        else if (*it == '/' && is_next(it, end, "/*"))
         {
             auto comment_start = std::next(it, 2);
-            if (comment_start == buf.end())
+            if (comment_start == end)
             {
                 break;
             }
             else if (*comment_start != '!' && *comment_start != 'M')
             {
-                // Non-executable comment
-                while (it != buf.end())
-                {
-                    if (is_next(it, buf.end(), "*/"))
-                    {
-                        // Comment end marker, return to normal parsing
-                        ++it;
-                        break;
-                    }
-                    ++it;
-                }
-
-                if (it == buf.end())
+                // Non-executable comment, return to normal parsing after the end marker
+                if ((it = find_comment_end(it, end)) == end)
                 {
                     break;
                 }
@@ -1499,92 +1754,209 @@ std::string get_canonical(GWBUF* querybuf)
             else
             {
                 // Executable comment, treat it as normal SQL
-                rval[i++] = *it;
+                out[i++] = *it;
             }
         }
         else if ((*it == '#' || *it == '-')
-                 && (is_next(it, buf.end(), "# ") || is_next(it, buf.end(), "-- ")))
+                 && (is_next(it, end, "# ") || is_next(it, end, "-- ")))
         {
             // End-of-line comment, jump to the next line if one exists
-            while (it != buf.end())
+            if ((it = Scanner::find_either(it, end, '\n', '\r')) == end)
             {
-                if (*it == '\n')
-                {
-                    break;
-                }
-                else if (*it == '\r')
-                {
-                    if ((is_next(it, buf.end(), "\r\n")))
-                    {
-                        ++it;
-                    }
-                    break;
-                }
-
-                ++it;
+                break;
             }
-
-            if (it == buf.end())
+            else if (*it == '\r' && is_next(it, end, "\r\n"))
             {
-                break;
+                ++it;
             }
         }
-        else if (is_digit(*it) && (i == 0 || (!is_alnum(rval[i - 1]) && rval[i - 1] != '_')))
+        else if (is_digit(*it) && (i == 0 || (!is_alnum(out[i - 1]) && out[i - 1] != '_')))
         {
-            auto num_end = probe_number(it, buf.end());
+            auto num_end = probe_number(it, end);
 
             if (num_end.first)
             {
-                if (is_negation(rval, i))
+                if (is_negation(out, i))
                 {
                     // Remove the sign
                     i--;
                 }
-                rval[i++] = '?';
+                out[i++] = '?';
                 it = num_end.second;
             }
         }
         else if (*it == '\'' || *it == '"')
         {
             char c = *it;
-            if ((it = find_char(std::next(it), buf.end(), c)) == buf.end())
+            if ((it = find_char<Scanner>(std::next(it), end, c)) == end)
             {
                 break;
             }
-            rval[i++] = '?';
+            out[i++] = '?';
         }
         else if (*it == '`')
         {
             auto start = it;
-            if ((it = find_char(std::next(it), buf.end(), '`')) == buf.end())
+            if ((it = find_char<Scanner>(std::next(it), end, '`')) == end)
             {
                 break;
             }
-            std::copy(start, it, &rval[i]);
-            i += std::distance(start, it);
-            rval[i++] = '`';
+            memcpy(out + i, start, it - start);
+            i += it - start;
+            out[i++] = '`';
         }
         else
         {
-            rval[i++] = *it;
+            out[i++] = *it;
         }
 
-        mxb_assert(it != buf.end());
+        mxb_assert(it != end);
     }
 
     // Remove trailing whitespace
-    while (i > 0 && is_space(rval[i - 1]))
+    while (i > 0 && is_space(out[i - 1]))
     {
         --i;
     }
 
+    if (digest)
+    {
+        *digest = mxs::canonical_digest(out, i);
+    }
+
     // Shrink the buffer so that the internal bookkeeping of std::string remains up to date
     rval.resize(i);
 
-    buf.release();
-
     return rval;
 }
+
+typedef std::string (* Canonicalizer)(const char* sql, size_t len, uint64_t* digest);
+
+#if defined (__x86_64__)
+
+__attribute__((flatten))
+std::string canonicalize_sse2(const char* sql, size_t len, uint64_t* digest)
+{
+    return canonicalize<Sse2Scanner>(sql, len, digest);
+}
+
+__attribute__((target("avx2"), flatten))
+std::string canonicalize_avx2(const char* sql, size_t len, uint64_t* digest)
+{
+    return canonicalize<Avx2Scanner>(sql, len, digest);
+}
+
+Canonicalizer select_canonicalizer()
+{
+    // Can be called before main(), the CPU information must be initialized explicitly
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") ? canonicalize_avx2 : canonicalize_sse2;
+}
+
+#else
+
+Canonicalizer select_canonicalizer()
+{
+    return canonicalize<ScalarScanner>;
+}
+
+#endif
+
+const Canonicalizer best_canonicalizer = select_canonicalizer();
+}
+
+namespace maxscale
+{
+
+uint64_t canonical_digest(const char* canonical, size_t len)
+{
+    // MurmurHash64A
+    const uint64_t m = 0xc6a4a7935bd1e995ULL;
+    const int r = 47;
+    const uint8_t* data = (const uint8_t*)canonical;
+    const uint8_t* end = data + (len & ~size_t(7));
+    uint64_t h = 0x8445d61a4e774912ULL ^ (len * m);
+
+    for (; data != end; data += sizeof(uint64_t))
+    {
+        uint64_t k;
+        memcpy(&k, data, sizeof(k));
+        k *= m;
+        k ^= k >> r;
+        k *= m;
+        h ^= k;
+        h *= m;
+    }
+
+    switch (len & 7)
+    {
+    case 7:
+        h ^= uint64_t(data[6]) << 48;
+
+    // Fall through
+    case 6:
+        h ^= uint64_t(data[5]) << 40;
+
+    // Fall through
+    case 5:
+        h ^= uint64_t(data[4]) << 32;
+
+    // Fall through
+    case 4:
+        h ^= uint64_t(data[3]) << 24;
+
+    // Fall through
+    case 3:
+        h ^= uint64_t(data[2]) << 16;
+
+    // Fall through
+    case 2:
+        h ^= uint64_t(data[1]) << 8;
+
+    // Fall through
+    case 1:
+        h ^= uint64_t(data[0]);
+        h *= m;
+    }
+
+    h ^= h >> r;
+    h *= m;
+    h ^= h >> r;
+
+    return h;
+}
+
+std::string get_canonical(const char* sql, size_t len, uint64_t* digest)
+{
+    return best_canonicalizer(sql, len, digest);
+}
+
+std::string get_canonical(GWBUF* querybuf, uint64_t* digest)
+{
+    const size_t header_len = MYSQL_HEADER_LEN + 1;     // Packet header and command
+    size_t buflen = gwbuf_length(querybuf);
+
+    if (buflen < header_len)
+    {
+        return get_canonical("", 0, digest);
+    }
+    else if (!querybuf->next)
+    {
+        return get_canonical((const char*)GWBUF_DATA(querybuf) + header_len, buflen - header_len, digest);
+    }
+    else
+    {
+        // Chained buffer, the canonicalizer needs the statement in one piece
+        std::string sql(buflen - header_len, '\0');
+        gwbuf_copy_data(querybuf, header_len, sql.size(), (uint8_t*)&sql[0]);
+        return get_canonical(sql.c_str(), sql.size(), digest);
+    }
+}
+
+std::string get_canonical(GWBUF* querybuf)
+{
+    return get_canonical(querybuf, nullptr);
+}
 }
 
 char* modutil_get_canonical(GWBUF* querybuf)
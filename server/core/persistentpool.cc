@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2018 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2022-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+#include "internal/persistentpool.hh"
+
+#include <algorithm>
+#include <string.h>
+#include <maxscale/server.h>
+
+namespace maxscale
+{
+
+// static
+std::string PersistentPool::key_of(const char* zUser,
+                                   const char* zIp,
+                                   const char* zProtocol,
+                                   uint64_t capabilities)
+{
+    std::string key(zProtocol);
+    key += '\0';
+    key.append(reinterpret_cast<const char*>(&capabilities), sizeof(capabilities));
+    key += zUser;
+    key += '\0';
+    key += zIp;
+    return key;
+}
+
+// static
+bool PersistentPool::is_usable(const DCB* pDcb, time_t now, time_t max_age)
+{
+    return !pDcb->dcb_errhandle_called
+           && !(pDcb->flags & DCBF_HUNG)
+           && pDcb->server
+           && (pDcb->server->status & SERVER_RUNNING)
+           && now - pDcb->persistentstart <= max_age;
+}
+
+void PersistentPool::add(DCB* pDcb)
+{
+    mxb_assert(pDcb->user && pDcb->protoname);
+    std::string key = key_of(pDcb->user,
+                             pDcb->remote ? pDcb->remote : "",
+                             pDcb->protoname,
+                             pDcb->pool_capabilities);
+
+    Entries::iterator it = m_entries.insert(m_entries.end(), Entry {pDcb, key});
+    m_index[key].push_back(it);
+}
+
+DCB* PersistentPool::acquire(const char* zUser,
+                             const char* zIp,
+                             const char* zProtocol,
+                             uint64_t capabilities,
+                             time_t max_age,
+                             bool* pExact)
+{
+    time_t now = time(NULL);
+    DCB* pDcb = NULL;
+    auto bucket = m_index.find(key_of(zUser, zIp, zProtocol, capabilities));
+
+    if (bucket != m_index.end())
+    {
+        // The newest connection has been idle for the shortest time.
+        for (auto it = bucket->second.rbegin(); it != bucket->second.rend(); ++it)
+        {
+            if (is_usable((*it)->pDcb, now, max_age))
+            {
+                pDcb = remove(*it);
+                *pExact = true;
+                break;
+            }
+        }
+    }
+
+    if (!pDcb)
+    {
+        // All connections of a server normally use the same protocol and most clients
+        // the same capabilities, so this usually stops at the first connection. With
+        // the proxy protocol, the server has been told the client address when the
+        // connection was created and resetting the connection does not change it.
+        for (auto it = m_entries.rbegin(); it != m_entries.rend(); ++it)
+        {
+            if (it->pDcb->pool_capabilities == capabilities
+                && strcmp(it->pDcb->protoname, zProtocol) == 0
+                && is_usable(it->pDcb, now, max_age)
+                && (!it->pDcb->server->proxy_protocol
+                    || strcmp(it->pDcb->remote ? it->pDcb->remote : "", zIp) == 0))
+            {
+                pDcb = remove(std::prev(it.base()));
+                *pExact = false;
+                break;
+            }
+        }
+    }
+
+    return pDcb;
+}
+
+std::vector<DCB*> PersistentPool::evict(size_t max_size, time_t max_age, bool all)
+{
+    std::vector<DCB*> removed;
+    time_t now = time(NULL);
+    Entries::iterator it = m_entries.begin();
+
+    while (it != m_entries.end())
+    {
+        Entries::iterator current = it++;
+
+        if (all || m_entries.size() > max_size || !is_usable(current->pDcb, now, max_age))
+        {
+            removed.push_back(remove(current));
+        }
+    }
+
+    return removed;
+}
+
+DCB* PersistentPool::remove(Entries::iterator it)
+{
+    auto bucket = m_index.find(it->key);
+    mxb_assert(bucket != m_index.end());
+    Bucket& entries = bucket->second;
+
+    // Connections are taken from the back and evicted from the front.
+    if (entries.back() == it)
+    {
+        entries.pop_back();
+    }
+    else if (entries.front() == it)
+    {
+        entries.pop_front();
+    }
+    else
+    {
+        entries.erase(std::find(entries.begin(), entries.end(), it));
+    }
+
+    if (entries.empty())
+    {
+        m_index.erase(bucket);
+    }
+
+    DCB* pDcb = it->pDcb;
+    m_entries.erase(it);
+
+    return pDcb;
+}
+}
@@ -15,15 +15,24 @@
 #include <inttypes.h>
 #include <algorithm>
 #include <atomic>
-#include <random>
+#include <list>
+#include <mutex>
+#include <thread>
 #include <unordered_map>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
 #include <maxscale/alloc.h>
 #include <maxbase/atomic.h>
 #include <maxbase/format.hh>
 #include <maxscale/config.h>
+#include <maxscale/housekeeper.h>
 #include <maxscale/json_api.h>
 #include <maxscale/log.h>
+#include <maxscale/modutil.h>
 #include <maxscale/modutil.hh>
+#include <maxscale/paths.h>
 #include <maxscale/pcre2.h>
 #include <maxscale/utils.h>
 #include <maxscale/jansson.hh>
@@ -52,8 +61,14 @@ struct type_name_info
 };
 
 const char DEFAULT_QC_NAME[] = "qc_sqlite";
+
+// How often, in seconds, the cache is saved when it is persisted.
+const int CACHE_SAVE_INTERVAL = 300;
 const char QC_TRX_PARSE_USING[] = "QC_TRX_PARSE_USING";
 
+class QCSharedCache;
+class QCInfoCache;
+
 class ThisUnit
 {
 public:
@@ -61,6 +76,8 @@ public:
         : classifier(nullptr)
         , qc_trx_parse_using(QC_TRX_PARSE_USING_PARSER)
         , qc_sql_mode(QC_SQL_MODE_DEFAULT)
+        , pShared_cache(nullptr)
+        , cache_persist(false)
         , m_cache_max_size(std::numeric_limits<int64_t>::max())
     {
     }
@@ -71,6 +88,8 @@ public:
     QUERY_CLASSIFIER*    classifier;
     qc_trx_parse_using_t qc_trx_parse_using;
     qc_sql_mode_t        qc_sql_mode;
+    QCSharedCache*       pShared_cache;
+    bool                 cache_persist;
 
     int64_t cache_max_size() const
     {
@@ -91,8 +110,6 @@ private:
 
 static ThisUnit this_unit;
 
-class QCInfoCache;
-
 static thread_local struct
 {
     QCInfoCache* pInfo_cache;
@@ -101,198 +118,500 @@ static thread_local struct
     nullptr
 };
 
-
 /**
- * @class QCInfoCache
+ * @class QCSharedCache
  *
- * An instance of this class maintains a mapping from a canonical statement to
- * the QC_STMT_INFO object created by the actual query classifier.
+ * An instance of this class maps the digest of a canonical statement to the
+ * QC_STMT_INFO object created by the actual query classifier and is shared
+ * by all threads, so that a statement parsed by one thread benefits all.
+ *
+ * The cache is divided into shards by the digest, each with its own lock and
+ * a share of the maximum size. The entries of a shard are evicted using the
+ * CLOCK algorithm; a hit marks the entry as referenced and the clock hand
+ * evicts the first entry that has not been referenced since the hand last
+ * passed it.
  */
-class QCInfoCache
+class QCSharedCache
 {
 public:
-    QCInfoCache(const QCInfoCache&) = delete;
-    QCInfoCache& operator=(const QCInfoCache&) = delete;
+    struct Statement
+    {
+        std::string   canonical_stmt;
+        qc_sql_mode_t sql_mode;
+        uint64_t      version;  // The server version the statement was classified for.
+        uint64_t      hits;
+    };
 
-    QCInfoCache()
-        : m_reng(m_rdev())
+    QCSharedCache(const QCSharedCache&) = delete;
+    QCSharedCache& operator=(const QCSharedCache&) = delete;
+
+    QCSharedCache()
     {
-        memset(&m_stats, 0, sizeof(m_stats));
     }
 
-    ~QCInfoCache()
+    ~QCSharedCache()
     {
-        mxb_assert(this_unit.classifier);
-
-        for (auto a : m_infos)
+        for (auto& shard : m_shards)
         {
-            this_unit.classifier->qc_info_close(a.second.pInfo);
+            while (!shard.entries.empty())
+            {
+                shard.remove(shard.entries.size() - 1);
+            }
         }
     }
 
-    QC_STMT_INFO* peek(const std::string& canonical_stmt) const
-    {
-        auto i = m_infos.find(canonical_stmt);
-
-        return i != m_infos.end() ? i->second.pInfo : nullptr;
-    }
-
-    QC_STMT_INFO* get(const std::string& canonical_stmt)
+    QC_STMT_INFO* get(uint64_t digest, const std::string& canonical_stmt)
     {
         QC_STMT_INFO* pInfo = nullptr;
+        Shard& shard = shard_of(digest);
+        std::lock_guard<std::mutex> guard(shard.lock);
 
-        auto i = m_infos.find(canonical_stmt);
+        auto i = shard.index.find(digest);
 
-        if (i != m_infos.end())
+        if (i != shard.index.end())
         {
-            const Entry& entry = i->second;
+            Entry& entry = shard.entries[i->second];
 
-            if (entry.sql_mode == this_unit.qc_sql_mode)
+            if (entry.sql_mode == this_unit.qc_sql_mode && entry.canonical_stmt == canonical_stmt)
             {
-                mxb_assert(this_unit.classifier);
-                this_unit.classifier->qc_info_dup(entry.pInfo);
-                pInfo = entry.pInfo;
+                entry.referenced = true;
+                ++entry.hits;
 
-                ++m_stats.hits;
+                mxb_assert(this_unit.classifier);
+                pInfo = this_unit.classifier->qc_info_dup(entry.pInfo);
             }
-            else
-            {
-                // If the sql_mode has changed, we discard the existing result.
-                erase(i);
+        }
 
-                ++m_stats.misses;
-            }
+        if (pInfo)
+        {
+            ++shard.stats.hits;
         }
         else
         {
-            ++m_stats.misses;
+            ++shard.stats.misses;
         }
 
         return pInfo;
     }
 
-    void insert(const std::string& canonical_stmt, QC_STMT_INFO* pInfo)
+    bool contains(uint64_t digest, const std::string& canonical_stmt)
     {
-        mxb_assert(peek(canonical_stmt) == nullptr);
-        mxb_assert(this_unit.classifier);
+        Shard& shard = shard_of(digest);
+        std::lock_guard<std::mutex> guard(shard.lock);
+
+        auto i = shard.index.find(digest);
+
+        return i != shard.index.end() && shard.entries[i->second].canonical_stmt == canonical_stmt;
+    }
+
+    // Adds hits that were found in the cache of a thread, so that the hot statements can be found.
+    void add_hits(uint64_t digest, uint64_t hits)
+    {
+        Shard& shard = shard_of(digest);
+        std::lock_guard<std::mutex> guard(shard.lock);
 
+        auto i = shard.index.find(digest);
+
+        if (i != shard.index.end())
+        {
+            shard.entries[i->second].hits += hits;
+        }
+    }
+
+    void insert(uint64_t digest, const std::string& canonical_stmt, QC_STMT_INFO* pInfo, uint64_t version)
+    {
         // 0xffffff is the maximum packet size, 4 is for packet header and 1 is for command byte. These are
         // MariaDB/MySQL protocol specific values that are also defined in <maxscale/protocol/mysql.h> but
         // should not be exposed to the core.
         constexpr int64_t max_entry_size = 0xffffff - 5;
 
-        int64_t cache_max_size = this_unit.cache_max_size() / config_get_global_options()->n_threads;
+        int64_t cache_max_size = this_unit.cache_max_size() / N_SHARDS;
         int64_t size = canonical_stmt.size();
 
         if (size < max_entry_size && size <= cache_max_size)
         {
-            int64_t required_space = (m_stats.size + size) - cache_max_size;
+            Shard& shard = shard_of(digest);
+            std::lock_guard<std::mutex> guard(shard.lock);
+
+            auto i = shard.index.find(digest);
+
+            if (i != shard.index.end())
+            {
+                const Entry& entry = shard.entries[i->second];
+
+                if (entry.sql_mode == this_unit.qc_sql_mode && entry.canonical_stmt == canonical_stmt)
+                {
+                    // Another thread parsed the same statement at the same time.
+                    return;
+                }
+
+                // The sql_mode has changed or the digests collide, the new result replaces the old.
+                shard.remove(i->second);
+            }
 
-            if (required_space > 0)
+            while (shard.stats.size + size > cache_max_size && !shard.entries.empty())
             {
-                make_space(required_space);
+                shard.evict();
             }
 
-            if (m_stats.size + size <= cache_max_size)
+            if (shard.stats.size + size <= cache_max_size)
             {
+                mxb_assert(this_unit.classifier);
                 this_unit.classifier->qc_info_dup(pInfo);
 
-                m_infos.emplace(canonical_stmt, Entry(pInfo, this_unit.qc_sql_mode));
+                shard.index.emplace(digest, shard.entries.size());
+                shard.entries.emplace_back(digest, canonical_stmt, pInfo, this_unit.qc_sql_mode, version);
 
-                ++m_stats.inserts;
-                m_stats.size += size;
+                ++shard.stats.inserts;
+                shard.stats.size += size;
             }
         }
     }
 
     void get_stats(QC_CACHE_STATS* pStats)
     {
-        *pStats = m_stats;
+        memset(pStats, 0, sizeof(*pStats));
+
+        for (auto& shard : m_shards)
+        {
+            std::lock_guard<std::mutex> guard(shard.lock);
+
+            pStats->size += shard.stats.size;
+            pStats->inserts += shard.stats.inserts;
+            pStats->hits += shard.stats.hits;
+            pStats->misses += shard.stats.misses;
+            pStats->evictions += shard.stats.evictions;
+        }
+    }
+
+    /**
+     * Get the most used statements
+     *
+     * @param max_count  The maximum number of statements to return.
+     *
+     * @return The statements, the most used first.
+     */
+    std::vector<Statement> get_hottest(size_t max_count)
+    {
+        // The hit counts are collected first, so that the statements
+        // themselves need not be copied.
+        std::vector<std::pair<uint64_t, uint64_t>> hits;   // Hits and digest.
+
+        for (auto& shard : m_shards)
+        {
+            std::lock_guard<std::mutex> guard(shard.lock);
+
+            for (const auto& entry : shard.entries)
+            {
+                hits.emplace_back(entry.hits, entry.digest);
+            }
+        }
+
+        auto more_hits = [](const std::pair<uint64_t, uint64_t>& lhs,
+                            const std::pair<uint64_t, uint64_t>& rhs) {
+                return lhs.first > rhs.first;
+            };
+
+        if (hits.size() > max_count)
+        {
+            std::nth_element(hits.begin(), hits.begin() + max_count, hits.end(), more_hits);
+            hits.resize(max_count);
+        }
+
+        std::sort(hits.begin(), hits.end(), more_hits);
+
+        std::vector<Statement> statements;
+        statements.reserve(hits.size());
+
+        for (const auto& h : hits)
+        {
+            Shard& shard = shard_of(h.second);
+            std::lock_guard<std::mutex> guard(shard.lock);
+
+            auto i = shard.index.find(h.second);
+
+            // The entry may have been evicted in the meantime.
+            if (i != shard.index.end())
+            {
+                const Entry& entry = shard.entries[i->second];
+                statements.push_back({entry.canonical_stmt, entry.sql_mode, entry.version, entry.hits});
+            }
+        }
+
+        return statements;
     }
 
 private:
+    static const int N_SHARDS = 16;
+
     struct Entry
     {
-        Entry(QC_STMT_INFO* pInfo, qc_sql_mode_t sql_mode)
-            : pInfo(pInfo)
+        Entry(uint64_t digest, const std::string& canonical_stmt, QC_STMT_INFO* pInfo,
+              qc_sql_mode_t sql_mode, uint64_t version)
+            : digest(digest)
+            , canonical_stmt(canonical_stmt)
+            , pInfo(pInfo)
             , sql_mode(sql_mode)
+            , version(version)
+            , hits(0)
+            , referenced(false)
         {
         }
 
+        uint64_t      digest;
+        std::string   canonical_stmt;
         QC_STMT_INFO* pInfo;
         qc_sql_mode_t sql_mode;
+        uint64_t      version;
+        uint64_t      hits;
+        bool          referenced;
     };
 
-    typedef std::unordered_map<std::string, Entry> InfosByStmt;
+    struct Shard
+    {
+        Shard()
+            : hand(0)
+        {
+            memset(&stats, 0, sizeof(stats));
+        }
+
+        // Removes the entry at the given position and moves the last entry to its place.
+        void remove(size_t pos)
+        {
+            mxb_assert(pos < entries.size());
+            Entry& entry = entries[pos];
+
+            stats.size -= entry.canonical_stmt.size();
+            index.erase(entry.digest);
+
+            mxb_assert(this_unit.classifier);
+            this_unit.classifier->qc_info_close(entry.pInfo);
 
-    void erase(InfosByStmt::iterator& i)
+            if (pos != entries.size() - 1)
+            {
+                entry = std::move(entries.back());
+                index[entry.digest] = pos;
+            }
+
+            entries.pop_back();
+
+            if (hand >= entries.size())
+            {
+                hand = 0;
+            }
+        }
+
+        void evict()
+        {
+            mxb_assert(!entries.empty());
+
+            while (entries[hand].referenced)
+            {
+                entries[hand].referenced = false;
+                hand = (hand + 1) % entries.size();
+            }
+
+            remove(hand);
+            ++stats.evictions;
+        }
+
+        std::mutex                             lock;
+        std::vector<Entry>                     entries;
+        std::unordered_map<uint64_t, size_t>   index;   // Digest to position in entries.
+        size_t                                 hand;    // The clock hand, a position in entries.
+        QC_CACHE_STATS                         stats;
+    };
+
+    Shard& shard_of(uint64_t digest)
     {
-        mxb_assert(i != m_infos.end());
+        return m_shards[digest % N_SHARDS];
+    }
 
-        m_stats.size -= i->first.size();
+    Shard m_shards[N_SHARDS];
+};
 
-        mxb_assert(this_unit.classifier);
-        this_unit.classifier->qc_info_close(i->second.pInfo);
+/**
+ * @class QCInfoCache
+ *
+ * An instance of this class is the cache of a single thread and in front
+ * of the shared cache. It keeps the most recently used statements of the
+ * thread so that they can be found without locking and evicts the least
+ * recently used ones.
+ */
+class QCInfoCache
+{
+public:
+    QCInfoCache(const QCInfoCache&) = delete;
+    QCInfoCache& operator=(const QCInfoCache&) = delete;
+
+    QCInfoCache()
+    {
+        memset(&m_stats, 0, sizeof(m_stats));
+    }
 
-        m_infos.erase(i);
+    ~QCInfoCache()
+    {
+        mxb_assert(this_unit.classifier);
 
-        ++m_stats.evictions;
+        for (auto& entry : m_entries)
+        {
+            flush_hits(entry);
+            this_unit.classifier->qc_info_close(entry.pInfo);
+        }
     }
 
-    bool erase(const std::string& canonical_stmt)
+    QC_STMT_INFO* get(uint64_t digest, const std::string& canonical_stmt)
     {
-        bool erased = false;
+        QC_STMT_INFO* pInfo = nullptr;
 
-        auto i = m_infos.find(canonical_stmt);
-        mxb_assert(i != m_infos.end());
+        auto i = m_index.find(digest);
 
-        if (i != m_infos.end())
+        if (i != m_index.end())
         {
-            erase(i);
-            erased = true;
+            Entries::iterator it = i->second;
+
+            if (it->sql_mode == this_unit.qc_sql_mode && it->canonical_stmt == canonical_stmt)
+            {
+                // Most recently used entries are kept at the front.
+                m_entries.splice(m_entries.begin(), m_entries, it);
+
+                if (++it->hits == HITS_FLUSH_INTERVAL)
+                {
+                    flush_hits(*it);
+                }
+
+                mxb_assert(this_unit.classifier);
+                pInfo = this_unit.classifier->qc_info_dup(it->pInfo);
+            }
+            else
+            {
+                // If the sql_mode has changed, we discard the existing result.
+                erase(i);
+            }
+        }
+
+        if (!pInfo)
+        {
+            mxb_assert(this_unit.pShared_cache);
+            pInfo = this_unit.pShared_cache->get(digest, canonical_stmt);
+
+            if (pInfo)
+            {
+                add(digest, canonical_stmt, this_unit.classifier->qc_info_dup(pInfo));
+                ++m_stats.shared_hits;
+            }
+        }
+
+        if (pInfo)
+        {
+            ++m_stats.hits;
+        }
+        else
+        {
+            ++m_stats.misses;
         }
 
-        return erased;
+        return pInfo;
     }
 
-    void make_space(int64_t required_space)
+    void insert(uint64_t digest, const std::string& canonical_stmt, QC_STMT_INFO* pInfo, bool shared)
     {
-        int64_t freed_space = 0;
+        mxb_assert(m_index.find(digest) == m_index.end());
+        mxb_assert(this_unit.pShared_cache);
 
-        std::uniform_int_distribution<> dis(0, m_infos.bucket_count() - 1);
-
-        while ((freed_space < required_space) && !m_infos.empty())
+        if (shared)
         {
-            freed_space += evict(dis);
+            uint64_t version = 0;
+            this_unit.classifier->qc_get_server_version(&version);
+            this_unit.pShared_cache->insert(digest, canonical_stmt, pInfo, version);
         }
+
+        ++m_stats.inserts;
+
+        mxb_assert(this_unit.classifier);
+        add(digest, canonical_stmt, this_unit.classifier->qc_info_dup(pInfo));
     }
 
-    int64_t evict(std::uniform_int_distribution<>& dis)
+    void get_stats(QC_CACHE_STATS* pStats)
     {
-        int64_t freed_space = 0;
+        *pStats = m_stats;
+    }
+
+private:
+    // The number of statements kept by each thread. The hot statements of most workloads
+    // fit into this, the rest are found in the shared cache.
+    static const size_t MAX_ENTRIES = 1024;
+
+    // How many hits are counted locally before they are added to the shared cache.
+    static const uint32_t HITS_FLUSH_INTERVAL = 64;
+
+    struct Entry
+    {
+        Entry(uint64_t digest, const std::string& canonical_stmt, QC_STMT_INFO* pInfo,
+              qc_sql_mode_t sql_mode)
+            : digest(digest)
+            , canonical_stmt(canonical_stmt)
+            , pInfo(pInfo)
+            , sql_mode(sql_mode)
+            , hits(0)
+        {
+        }
 
-        int bucket = dis(m_reng);
-        mxb_assert((bucket >= 0) && (bucket < static_cast<int>(m_infos.bucket_count())));
+        uint64_t      digest;
+        std::string   canonical_stmt;
+        QC_STMT_INFO* pInfo;
+        qc_sql_mode_t sql_mode;
+        uint32_t      hits;     // Hits not yet added to the shared cache.
+    };
 
-        auto i = m_infos.begin(bucket);
+    typedef std::list<Entry>                                Entries;
+    typedef std::unordered_map<uint64_t, Entries::iterator> EntriesByDigest;
 
-        // We just remove the first entry in the bucket. In the general case
-        // there will be just one.
-        if (i != m_infos.end(bucket))
+    // Takes ownership of the reference of pInfo.
+    void add(uint64_t digest, const std::string& canonical_stmt, QC_STMT_INFO* pInfo)
+    {
+        if (m_entries.size() >= MAX_ENTRIES)
         {
-            freed_space += i->first.size();
+            auto i = m_index.find(m_entries.back().digest);
+            mxb_assert(i != m_index.end());
+            erase(i);
+
+            ++m_stats.evictions;
+        }
 
-            MXB_AT_DEBUG(bool erased = ) erase(i->first);
-            mxb_assert(erased);
+        m_entries.emplace_front(digest, canonical_stmt, pInfo, this_unit.qc_sql_mode);
+        m_index.emplace(digest, m_entries.begin());
+        m_stats.size += canonical_stmt.size();
+    }
+
+    void flush_hits(Entry& entry)
+    {
+        if (entry.hits && this_unit.pShared_cache)
+        {
+            this_unit.pShared_cache->add_hits(entry.digest, entry.hits);
         }
 
-        return freed_space;
+        entry.hits = 0;
     }
 
-    InfosByStmt        m_infos;
-    QC_CACHE_STATS     m_stats;
-    std::random_device m_rdev;
-    std::mt19937       m_reng;
+    void erase(EntriesByDigest::iterator i)
+    {
+        mxb_assert(i != m_index.end());
+        Entries::iterator it = i->second;
+
+        flush_hits(*it);
+        m_stats.size -= it->canonical_stmt.size();
+
+        mxb_assert(this_unit.classifier);
+        this_unit.classifier->qc_info_close(it->pInfo);
+
+        m_entries.erase(it);
+        m_index.erase(i);
+    }
+
+    Entries         m_entries;
+    EntriesByDigest m_index;
+    QC_CACHE_STATS  m_stats;
 };
 
 bool use_cached_result()
@@ -312,6 +631,29 @@ void info_object_close(void* pData)
     this_unit.classifier->qc_info_close(static_cast<QC_STMT_INFO*>(pData));
 }
 
+/**
+ * Get the canonical statement a statement is cached with
+ *
+ * @param pStmt    A COM_QUERY or COM_STMT_PREPARE packet.
+ * @param pDigest  The digest of the canonical statement is stored here.
+ *
+ * @return The canonical statement.
+ */
+std::string get_cache_key(GWBUF* pStmt, uint64_t* pDigest)
+{
+    std::string canonical = mxs::get_canonical(pStmt, pDigest);
+
+    if (modutil_is_SQL_prepare(pStmt))
+    {
+        // P as in prepare, and appended so as not to cause a
+        // need for copying the data.
+        canonical += ":P";
+        *pDigest = mxs::canonical_digest(canonical.c_str(), canonical.length());
+    }
+
+    return canonical;
+}
+
 
 /**
  * @class QCInfoCacheScope
@@ -333,25 +675,26 @@ public:
 
     QCInfoCacheScope(GWBUF* pStmt)
         : m_pStmt(pStmt)
+        , m_digest(0)
     {
         if (use_cached_result() && has_not_been_parsed(m_pStmt))
         {
-            m_canonical = mxs::get_canonical(m_pStmt);
+            m_canonical = get_cache_key(m_pStmt, &m_digest);
 
-            if (modutil_is_SQL_prepare(pStmt))
-            {
-                // P as in prepare, and appended so as not to cause a
-                // need for copying the data.
-                m_canonical += ":P";
-            }
-
-            QC_STMT_INFO* pInfo = this_thread.pInfo_cache->get(m_canonical);
+            QC_STMT_INFO* pInfo = this_thread.pInfo_cache->get(m_digest, m_canonical);
 
             if (pInfo)
             {
                 gwbuf_add_buffer_object(m_pStmt, GWBUF_PARSING_INFO, pInfo, info_object_close);
                 m_canonical.clear();    // Signals that nothing needs to be added in the destructor.
             }
+            else
+            {
+                // Everything is collected right away, so that the result never needs to be
+                // parsed again and can be shared by the threads without locking.
+                int32_t result;
+                this_unit.classifier->qc_parse(m_pStmt, QC_COLLECT_ALL, &result);
+            }
         }
     }
 
@@ -363,14 +706,518 @@ public:
             mxb_assert(pData);
             QC_STMT_INFO* pInfo = static_cast<QC_STMT_INFO*>(pData);
 
-            this_thread.pInfo_cache->insert(m_canonical, pInfo);
+            // The preparable statement of a PREPARE is parsed on demand and the
+            // result stored in it, so such a result is kept by this thread only.
+            GWBUF* pPreparable_stmt = nullptr;
+            this_unit.classifier->qc_get_preparable_stmt(m_pStmt, &pPreparable_stmt);
+
+            this_thread.pInfo_cache->insert(m_digest, m_canonical, pInfo, !pPreparable_stmt);
         }
     }
 
 private:
     GWBUF*      m_pStmt;
     std::string m_canonical;
+    uint64_t    m_digest;
+};
+
+const char* sql_mode_to_string(qc_sql_mode_t sql_mode)
+{
+    return sql_mode == QC_SQL_MODE_ORACLE ? "ORACLE" : "DEFAULT";
+}
+
+/**
+ * @class QCCacheWarmup
+ *
+ * Saves the most used statements of the shared cache to a file and, after
+ * a restart, classifies them again in the background so that the cache is
+ * warm before the production load needs it. Only the canonical statements
+ * are saved, so that no literal values, e.g. passwords, end up in the file.
+ * To be parsed, the placeholders of a canonical statement are replaced with
+ * literals.
+ */
+class QCCacheWarmup
+{
+public:
+    QCCacheWarmup(const QCCacheWarmup&) = delete;
+    QCCacheWarmup& operator=(const QCCacheWarmup&) = delete;
+
+    QCCacheWarmup()
+        : m_state(NOT_STARTED)
+        , m_next(0)
+        , m_processed(0)
+        , m_classified(0)
+        , m_running(0)
+        , m_stop(false)
+        , m_duration(0)
+    {
+    }
+
+    ~QCCacheWarmup()
+    {
+        stop();
+    }
+
+    /**
+     * Load the saved statements and start classifying them
+     *
+     * @return True, if statements were found and the classification was started.
+     */
+    bool start()
+    {
+        mxb_assert(m_state == NOT_STARTED);
+        bool rv = false;
+
+        if (load())
+        {
+            if (m_statements.empty())
+            {
+                m_state = DONE;
+            }
+            else
+            {
+                int n_threads = std::min((size_t)config_threadcount(), m_statements.size());
+
+                MXS_NOTICE("Warming up the query classifier cache with %lu statements using %d threads.",
+                           m_statements.size(), n_threads);
+
+                m_state = RUNNING;
+                m_started = Clock::now();
+                m_running = n_threads;
+
+                for (int i = 0; i < n_threads; ++i)
+                {
+                    m_threads.emplace_back(&QCCacheWarmup::run, this);
+                }
+
+                rv = true;
+            }
+        }
+
+        return rv;
+    }
+
+    /**
+     * Stop the classification, must be called before the classifier is finalized
+     */
+    void stop()
+    {
+        m_stop = true;
+
+        for (auto& thread : m_threads)
+        {
+            thread.join();
+        }
+
+        m_threads.clear();
+
+        if (m_state == RUNNING)
+        {
+            std::chrono::duration<double> elapsed = Clock::now() - m_started;
+            m_duration = elapsed.count() * 1000;
+            m_state = STOPPED;
+        }
+    }
+
+    /**
+     * Save the most used statements of the shared cache
+     *
+     * @return True, if the statements could be saved.
+     */
+    bool save()
+    {
+        std::lock_guard<std::mutex> guard(m_save_lock);
+        mxb_assert(this_unit.pShared_cache);
+
+        auto statements = this_unit.pShared_cache->get_hottest(MAX_STATEMENTS);
+
+        json_t* pStatements = json_array();
+
+        for (const auto& stmt : statements)
+        {
+            json_t* pStmt = json_object();
+            json_object_set_new(pStmt, "statement", json_string(stmt.canonical_stmt.c_str()));
+            json_object_set_new(pStmt, "sql_mode", json_string(sql_mode_to_string(stmt.sql_mode)));
+            json_object_set_new(pStmt, "server_version", json_integer(stmt.version));
+            json_object_set_new(pStmt, "hits", json_integer(stmt.hits));
+            json_array_append_new(pStatements, pStmt);
+        }
+
+        json_t* pJson = json_object();
+        json_object_set_new(pJson, "version", json_integer(FORMAT_VERSION));
+        json_object_set_new(pJson, "statements", pStatements);
+
+        std::string path = get_path();
+        std::string tmp = path + ".tmp";
+        bool rv = false;
+
+        // The file is written under another name and then renamed, so that a
+        // crash while writing does not destroy the previously saved statements.
+        // The statements reveal the schema, so only MaxScale may read the file.
+        if (write_file(pJson, tmp))
+        {
+            if (rename(tmp.c_str(), path.c_str()) == 0)
+            {
+                MXS_INFO("Saved %lu statements of the query classifier cache to '%s'.",
+                         statements.size(), path.c_str());
+                rv = true;
+            }
+            else
+            {
+                MXS_ERROR("Failed to rename '%s' to '%s': %d, %s",
+                          tmp.c_str(), path.c_str(), errno, mxs_strerror(errno));
+            }
+        }
+
+        json_decref(pJson);
+
+        return rv;
+    }
+
+    json_t* to_json() const
+    {
+        static const char* states[] = {"not started", "running", "finished", "stopped"};
+
+        json_t* pJson = json_object();
+        json_object_set_new(pJson, "state", json_string(states[m_state]));
+        json_object_set_new(pJson, "statements", json_integer(m_statements.size()));
+        json_object_set_new(pJson, "processed", json_integer(m_processed));
+        json_object_set_new(pJson, "classified", json_integer(m_classified));
+
+        double progress = m_statements.empty() ? 0 : 100.0 * m_processed / m_statements.size();
+        json_object_set_new(pJson, "progress", json_real(progress));
+
+        if (m_state == RUNNING)
+        {
+            std::chrono::duration<double> elapsed = Clock::now() - m_started;
+            json_object_set_new(pJson, "duration", json_real(elapsed.count()));
+        }
+        else
+        {
+            json_object_set_new(pJson, "duration", json_real(m_duration / 1000.0));
+        }
+
+        return pJson;
+    }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    enum State
+    {
+        NOT_STARTED,
+        RUNNING,
+        DONE,
+        STOPPED
+    };
+
+    // The maximum number of statements that are saved.
+    static const size_t MAX_STATEMENTS = 10000;
+    static const int    FORMAT_VERSION = 3;
+
+    static std::string get_path()
+    {
+        return std::string(get_cachedir()) + "/qc_cache.json";
+    }
+
+    static bool write_file(json_t* pJson, const std::string& path)
+    {
+        bool rv = false;
+
+        // A file left behind by an earlier failure would keep its permissions.
+        unlink(path.c_str());
+
+        int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+        FILE* pFile = fd != -1 ? fdopen(fd, "w") : nullptr;
+
+        if (pFile)
+        {
+            rv = json_dumpf(pJson, pFile, JSON_COMPACT) == 0;
+            rv = fclose(pFile) == 0 && rv;
+        }
+        else if (fd != -1)
+        {
+            close(fd);
+        }
+
+        if (!rv)
+        {
+            int err = errno;
+            MXS_ERROR("Failed to write the query classifier cache to '%s': %d, %s",
+                      path.c_str(), err, mxs_strerror(err));
+            unlink(path.c_str());
+        }
+
+        return rv;
+    }
+
+    /**
+     * Replace the placeholders of a canonical statement with a literal
+     *
+     * @param canonical  A canonical statement, without the suffix of a prepared statement.
+     * @param zLiteral   The literal to use.
+     *
+     * @return The statement.
+     */
+    static std::string replace_placeholders(const std::string& canonical, const char* zLiteral)
+    {
+        std::string sql;
+        bool quoted = false;    // The strings have been replaced, only identifiers are quoted.
+
+        for (char c : canonical)
+        {
+            if (c == '`')
+            {
+                quoted = !quoted;
+            }
+
+            if (c == '?' && !quoted)
+            {
+                sql += zLiteral;
+            }
+            else
+            {
+                sql += c;
+            }
+        }
+
+        return sql;
+    }
+
+    /**
+     * Check whether two parsed statements are classified the same
+     */
+    static bool same_classification(GWBUF* pStmt1, GWBUF* pStmt2)
+    {
+        QUERY_CLASSIFIER* pC = this_unit.classifier;
+
+        uint32_t type_mask1 = 0;
+        uint32_t type_mask2 = 0;
+        pC->qc_get_type_mask(pStmt1, &type_mask1);
+        pC->qc_get_type_mask(pStmt2, &type_mask2);
+
+        int32_t op1 = QUERY_OP_UNDEFINED;
+        int32_t op2 = QUERY_OP_UNDEFINED;
+        pC->qc_get_operation(pStmt1, &op1);
+        pC->qc_get_operation(pStmt2, &op2);
+
+        char** pzTables1 = nullptr;
+        char** pzTables2 = nullptr;
+        int32_t n_tables1 = 0;
+        int32_t n_tables2 = 0;
+        pC->qc_get_table_names(pStmt1, true, &pzTables1, &n_tables1);
+        pC->qc_get_table_names(pStmt2, true, &pzTables2, &n_tables2);
+
+        const QC_FIELD_INFO* pFields1 = nullptr;
+        const QC_FIELD_INFO* pFields2 = nullptr;
+        uint32_t n_fields1 = 0;
+        uint32_t n_fields2 = 0;
+        pC->qc_get_field_info(pStmt1, &pFields1, &n_fields1);
+        pC->qc_get_field_info(pStmt2, &pFields2, &n_fields2);
+
+        auto same = [](const char* zLhs, const char* zRhs) {
+                return zLhs == zRhs || (zLhs && zRhs && strcmp(zLhs, zRhs) == 0);
+            };
+
+        bool rv = type_mask1 == type_mask2 && op1 == op2
+            && n_tables1 == n_tables2 && n_fields1 == n_fields2;
+
+        for (int32_t i = 0; rv && i < n_tables1; ++i)
+        {
+            rv = same(pzTables1[i], pzTables2[i]);
+        }
+
+        for (uint32_t i = 0; rv && i < n_fields1; ++i)
+        {
+            rv = same(pFields1[i].database, pFields2[i].database)
+                && same(pFields1[i].table, pFields2[i].table)
+                && same(pFields1[i].column, pFields2[i].column)
+                && pFields1[i].context == pFields2[i].context;
+        }
+
+        qc_free_table_names(pzTables1, n_tables1);
+        qc_free_table_names(pzTables2, n_tables2);
+
+        return rv;
+    }
+
+    bool load()
+    {
+        std::string path = get_path();
+        json_error_t err;
+        json_t* pJson = json_load_file(path.c_str(), 0, &err);
+
+        if (!pJson)
+        {
+            if (access(path.c_str(), F_OK) == 0)
+            {
+                MXS_WARNING("Failed to load the query classifier cache from '%s', the cache "
+                            "will not be warmed up: %s", path.c_str(), err.text);
+            }
+
+            return false;
+        }
+
+        json_t* pStatements = json_object_get(pJson, "statements");
+
+        if (json_integer_value(json_object_get(pJson, "version")) == FORMAT_VERSION
+            && json_is_array(pStatements))
+        {
+            size_t i;
+            json_t* pStmt;
+
+            json_array_foreach(pStatements, i, pStmt)
+            {
+                json_t* pStatement = json_object_get(pStmt, "statement");
+                const char* zSql_mode = json_string_value(json_object_get(pStmt, "sql_mode"));
+
+                // Statements classified with another sql_mode could not be used.
+                if (json_is_string(pStatement) && zSql_mode
+                    && strcmp(zSql_mode, sql_mode_to_string(this_unit.qc_sql_mode)) == 0)
+                {
+                    json_int_t version = json_integer_value(json_object_get(pStmt, "server_version"));
+                    json_int_t hits = json_integer_value(json_object_get(pStmt, "hits"));
+
+                    m_statements.push_back({json_string_value(pStatement), this_unit.qc_sql_mode,
+                                            (uint64_t)version, (uint64_t)hits});
+                }
+            }
+        }
+        else
+        {
+            MXS_WARNING("The query classifier cache in '%s' has an unsupported format, the cache "
+                        "will not be warmed up.", path.c_str());
+        }
+
+        json_decref(pJson);
+
+        return true;
+    }
+
+    void run()
+    {
+        if (qc_thread_init(QC_INIT_PLUGIN))
+        {
+            size_t i;
+
+            while (!m_stop && (i = m_next++) < m_statements.size())
+            {
+                if (classify(m_statements[i]))
+                {
+                    ++m_classified;
+                }
+
+                ++m_processed;
+            }
+
+            qc_thread_end(QC_INIT_PLUGIN);
+        }
+        else
+        {
+            MXS_ERROR("Could not initialize the query classifier for warming up the cache.");
+        }
+
+        if (--m_running == 0 && !m_stop)
+        {
+            std::chrono::duration<double> elapsed = Clock::now() - m_started;
+            m_duration = elapsed.count() * 1000;
+            m_state = DONE;
+
+            MXS_NOTICE("Query classifier cache warmed up with %lu statements in %.1f seconds.",
+                       m_classified.load(), elapsed.count());
+        }
+    }
+
+    static GWBUF* create_stmt(const std::string& sql, bool is_prepare)
+    {
+        GWBUF* pStmt = modutil_create_query(sql.c_str());
+
+        if (is_prepare)
+        {
+            GWBUF_DATA(pStmt)[4] = 0x16;    // COM_STMT_PREPARE
+        }
+
+        return pStmt;
+    }
+
+    static bool is_parsed(GWBUF* pStmt)
+    {
+        int32_t result = QC_QUERY_INVALID;
+        this_unit.classifier->qc_parse(pStmt, QC_COLLECT_ALL, &result);
+
+        GWBUF* pPreparable_stmt = nullptr;
+        this_unit.classifier->qc_get_preparable_stmt(pStmt, &pPreparable_stmt);
+
+        // Only complete results are inserted, the workers will classify the rest themselves.
+        return result == QC_QUERY_PARSED
+               && gwbuf_get_buffer_object_data(pStmt, GWBUF_PARSING_INFO)
+               && !pPreparable_stmt;
+    }
+
+    bool classify(const QCSharedCache::Statement& stmt)
+    {
+        mxb_assert(this_unit.classifier);
+        mxb_assert(this_unit.pShared_cache);
+
+        const std::string& canonical = stmt.canonical_stmt;
+
+        // A COM_STMT_PREPARE is marked with the suffix ":P", see get_cache_key().
+        bool is_prepare = canonical.length() > 2 && canonical.compare(canonical.length() - 2, 2, ":P") == 0;
+        std::string sql = is_prepare ? canonical.substr(0, canonical.length() - 2) : canonical;
+
+        // The classification of some statements depends on the literals, e.g. that of
+        // SET autocommit=?, so the statement is parsed with two different literals and
+        // the result is used only if both are classified the same.
+        GWBUF* pStmt1 = create_stmt(replace_placeholders(sql, "1"), is_prepare);
+        GWBUF* pStmt0 = create_stmt(replace_placeholders(sql, "0"), is_prepare);
+
+        bool rv = false;
+        uint64_t digest;
+        uint64_t digest0;
+
+        // If the canonicalization has changed since the statements were saved, the statement
+        // would be cached under a key that the workers never look for.
+        if (get_cache_key(pStmt1, &digest) == canonical
+            && get_cache_key(pStmt0, &digest0) == canonical
+            && !this_unit.pShared_cache->contains(digest, canonical))   // Not classified by a worker.
+        {
+            this_unit.classifier->qc_set_server_version(stmt.version);
+
+            if (is_parsed(pStmt1) && is_parsed(pStmt0) && same_classification(pStmt1, pStmt0))
+            {
+                void* pData = gwbuf_get_buffer_object_data(pStmt1, GWBUF_PARSING_INFO);
+                QC_STMT_INFO* pInfo = static_cast<QC_STMT_INFO*>(pData);
+                this_unit.pShared_cache->insert(digest, canonical, pInfo, stmt.version);
+                rv = true;
+            }
+        }
+
+        gwbuf_free(pStmt1);
+        gwbuf_free(pStmt0);
+
+        return rv;
+    }
+
+    std::vector<QCSharedCache::Statement> m_statements;
+    std::vector<std::thread>              m_threads;
+    std::atomic<State>                    m_state;
+    std::atomic<size_t>                   m_next;       // The next statement to classify.
+    std::atomic<size_t>                   m_processed;
+    std::atomic<size_t>                   m_classified;
+    std::atomic<int>                      m_running;    // The number of running threads.
+    std::atomic<bool>                     m_stop;
+    Clock::time_point                     m_started;
+    std::atomic<int64_t>                  m_duration;   // Milliseconds, once finished.
+    std::mutex                            m_save_lock;
 };
+
+QCCacheWarmup cache_warmup;
+
+bool save_cache_task(void*)
+{
+    cache_warmup.save();
+    return true;
+}
 }
 
 
@@ -404,9 +1251,9 @@ bool qc_setup(const QC_CACHE_PROPERTIES* cache_properties,
 
             if (cache_max_size)
             {
-                int64_t size_per_thr = cache_max_size / config_get_global_options()->n_threads;
                 MXS_NOTICE("Query classification results are cached and reused. "
-                           "Memory used per thread: %s", mxb::to_binary_size(size_per_thr).c_str());
+                           "Memory used by the cache shared by all threads: %s",
+                           mxb::to_binary_size(cache_max_size).c_str());
             }
             else
             {
@@ -414,6 +1261,7 @@ bool qc_setup(const QC_CACHE_PROPERTIES* cache_properties,
             }
 
             this_unit.set_cache_max_size(cache_max_size);
+            this_unit.cache_persist = cache_max_size && cache_properties->persist;
         }
         else
         {
@@ -491,6 +1339,13 @@ bool qc_process_init(uint32_t kind)
         rc = this_unit.classifier->qc_process_init() == 0;
     }
 
+    if (rc && (kind & QC_INIT_SELF))
+    {
+        mxb_assert(!this_unit.pShared_cache);
+        this_unit.pShared_cache = new(std::nothrow) QCSharedCache;
+        rc = this_unit.pShared_cache != nullptr;
+    }
+
     return rc;
 }
 
@@ -499,6 +1354,13 @@ void qc_process_end(uint32_t kind)
     QC_TRACE();
     mxb_assert(this_unit.classifier);
 
+    if (kind & QC_INIT_SELF)
+    {
+        // The cached results must be closed before the classifier is finalized.
+        delete this_unit.pShared_cache;
+        this_unit.pShared_cache = nullptr;
+    }
+
     if (kind & QC_INIT_PLUGIN)
     {
         this_unit.classifier->qc_process_end();
@@ -1285,6 +2147,7 @@ void qc_set_sql_mode(qc_sql_mode_t sql_mode)
 void qc_get_cache_properties(QC_CACHE_PROPERTIES* properties)
 {
     properties->max_size = this_unit.cache_max_size();
+    properties->persist = this_unit.cache_persist;
 }
 
 bool qc_set_cache_properties(const QC_CACHE_PROPERTIES* properties)
@@ -1323,6 +2186,24 @@ bool qc_get_cache_stats(QC_CACHE_STATS* pStats)
     return rv;
 }
 
+void qc_start_cache_persistence()
+{
+    if (this_unit.cache_persist)
+    {
+        cache_warmup.start();
+        hktask_add("qc_cache_save", save_cache_task, nullptr, CACHE_SAVE_INTERVAL);
+    }
+}
+
+void qc_end_cache_persistence()
+{
+    if (this_unit.cache_persist)
+    {
+        cache_warmup.stop();
+        cache_warmup.save();
+    }
+}
+
 json_t* qc_get_cache_stats_as_json()
 {
     QC_CACHE_STATS stats = {};
@@ -1334,17 +2215,38 @@ json_t* qc_get_cache_stats_as_json()
     json_object_set_new(pStats, "hits", json_integer(stats.hits));
     json_object_set_new(pStats, "misses", json_integer(stats.misses));
     json_object_set_new(pStats, "evictions", json_integer(stats.evictions));
+    json_object_set_new(pStats, "shared_hits", json_integer(stats.shared_hits));
+
+    int64_t lookups = stats.hits + stats.misses;
+    json_object_set_new(pStats, "hit_rate", json_real(lookups ? (double)stats.hits / lookups : 0));
 
     return pStats;
 }
 
+bool qc_get_shared_cache_stats(QC_CACHE_STATS* pStats)
+{
+    QC_TRACE();
+
+    bool rv = false;
+
+    if (this_unit.pShared_cache && use_cached_result())
+    {
+        this_unit.pShared_cache->get_stats(pStats);
+        rv = true;
+    }
+
+    return rv;
+}
+
 std::unique_ptr<json_t> qc_as_json(const char* zHost)
 {
     json_t* pParams = json_object();
     json_object_set_new(pParams, CN_CACHE_SIZE, json_integer(this_unit.cache_max_size()));
+    json_object_set_new(pParams, CN_CACHE_PERSIST, json_boolean(this_unit.cache_persist));
 
     json_t* pAttributes = json_object();
     json_object_set_new(pAttributes, CN_PARAMETERS, pParams);
+    json_object_set_new(pAttributes, "cache_warmup", cache_warmup.to_json());
 
     json_t* pSelf = json_object();
     json_object_set_new(pSelf, CN_ID, json_string(CN_QUERY_CLASSIFIER));
@@ -0,0 +1,220 @@
+/*
+ * Copyright (c) 2018 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2022-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+#include <maxscale/resolver.hh>
+
+#include <netdb.h>
+#include <sys/socket.h>
+
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <maxbase/worker.hh>
+#include <maxscale/log.h>
+#include <maxscale/threadpool.hh>
+
+using Clock = std::chrono::steady_clock;
+using std::chrono::seconds;
+
+namespace
+{
+
+const int N_RESOLVER_THREADS = 4;
+const size_t MAX_CACHED_HOSTNAMES = 10000;
+
+bool default_reverse_lookup(const std::string& address, std::string* hostname)
+{
+    struct addrinfo* ai = NULL, hint = {};
+    hint.ai_flags = AI_ALL;
+    int rc;
+
+    if ((rc = getaddrinfo(address.c_str(), NULL, &hint, &ai)) != 0)
+    {
+        MXS_ERROR("Failed to obtain address for host %s, %s", address.c_str(), gai_strerror(rc));
+        return false;
+    }
+
+    char host[NI_MAXHOST] = "";
+    int lookup_result = getnameinfo(ai->ai_addr,
+                                    ai->ai_addrlen,
+                                    host,
+                                    sizeof(host),
+                                    NULL,
+                                    0,              // No need for the port
+                                    NI_NAMEREQD);   // Text address only
+    freeaddrinfo(ai);
+
+    if (lookup_result == 0)
+    {
+        *hostname = host;
+    }
+    else if (lookup_result != EAI_NONAME)
+    {
+        MXS_WARNING("Client hostname lookup failed for '%s', getnameinfo() returned: '%s'.",
+                    address.c_str(),
+                    gai_strerror(lookup_result));
+    }
+
+    return lookup_result == 0;
+}
+
+class Resolver
+{
+public:
+    Resolver(const Resolver&) = delete;
+    Resolver& operator=(const Resolver&) = delete;
+
+    Resolver()
+        : m_lookup(default_reverse_lookup)
+        , m_pool(N_RESOLVER_THREADS)
+    {
+    }
+
+    bool get(const std::string& address, std::string* hostname)
+    {
+        std::lock_guard<std::mutex> guard(m_lock);
+        auto it = m_cache.find(address);
+        bool rval = it != m_cache.end() && it->second.expires > Clock::now();
+
+        if (rval)
+        {
+            *hostname = it->second.hostname;
+        }
+
+        return rval;
+    }
+
+    void resolve(const std::string& address, std::function<void()> callback)
+    {
+        std::lock_guard<std::mutex> guard(m_lock);
+        auto& waiters = m_pending[address];
+
+        if (waiters.empty())
+        {
+            // No lookup in progress for this address
+            m_pool.execute([this, address]() {
+                               lookup(address);
+                           });
+        }
+
+        waiters.push_back({mxb::Worker::get_current(), std::move(callback)});
+    }
+
+    void set_ttl(seconds found, seconds not_found)
+    {
+        std::lock_guard<std::mutex> guard(m_lock);
+        m_ttl_found = found;
+        m_ttl_not_found = not_found;
+    }
+
+    void set_lookup(mxs::ReverseLookup func)
+    {
+        std::lock_guard<std::mutex> guard(m_lock);
+        m_lookup = func ? func : default_reverse_lookup;
+        m_cache.clear();
+    }
+
+private:
+    struct Entry
+    {
+        std::string       hostname;     /**< Empty if the address has no hostname */
+        Clock::time_point expires;
+    };
+
+    struct Waiter
+    {
+        mxb::Worker*          worker;   /**< Worker that gets the callback, NULL for none */
+        std::function<void()> callback;
+    };
+
+    void store(const std::string& address, const std::string& hostname, bool found)
+    {
+        auto now = Clock::now();
+
+        if (m_cache.size() >= MAX_CACHED_HOSTNAMES)
+        {
+            for (auto it = m_cache.begin(); it != m_cache.end();)
+            {
+                it = it->second.expires <= now ? m_cache.erase(it) : std::next(it);
+            }
+
+            if (m_cache.size() >= MAX_CACHED_HOSTNAMES)
+            {
+                m_cache.clear();
+            }
+        }
+
+        m_cache[address] = {hostname, now + (found ? m_ttl_found : m_ttl_not_found)};
+    }
+
+    void lookup(const std::string& address)
+    {
+        std::unique_lock<std::mutex> guard(m_lock);
+        mxs::ReverseLookup lookup = m_lookup;
+        guard.unlock();
+
+        std::string hostname;
+        bool found = lookup(address, &hostname);
+
+        guard.lock();
+        store(address, hostname, found);
+        std::vector<Waiter> waiters = std::move(m_pending[address]);
+        m_pending.erase(address);
+        guard.unlock();
+
+        for (auto& w : waiters)
+        {
+            mxs::ThreadPool::post(w.worker, std::move(w.callback));
+        }
+    }
+
+    std::mutex                                            m_lock;
+    std::unordered_map<std::string, std::vector<Waiter>>  m_pending;    /**< Lookups in progress */
+    std::unordered_map<std::string, Entry>                m_cache;
+    mxs::ReverseLookup                                    m_lookup;
+    seconds                                               m_ttl_found {300};
+    seconds                                               m_ttl_not_found {60};
+    mxs::ThreadPool                                       m_pool;       /**< Stopped first, uses the above */
+};
+
+Resolver& resolver()
+{
+    static Resolver instance;
+    return instance;
+}
+}
+
+namespace maxscale
+{
+
+bool cached_hostname(const std::string& address, std::string* hostname)
+{
+    return resolver().get(address, hostname);
+}
+
+void resolve_hostname(const std::string& address, std::function<void ()> callback)
+{
+    resolver().resolve(address, std::move(callback));
+}
+
+void set_hostname_cache_ttl(std::chrono::seconds found, std::chrono::seconds not_found)
+{
+    resolver().set_ttl(found, not_found);
+}
+
+void set_reverse_lookup(ReverseLookup func)
+{
+    resolver().set_lookup(std::move(func));
+}
+}
@@ -47,4 +47,8 @@ void RouterSession::handleError(GWBUF* pMessage,
                                 bool* pSuccess)
 {
 }
+
+void RouterSession::moved()
+{
+}
 }
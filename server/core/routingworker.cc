@@ -21,6 +21,8 @@
 #ifdef HAVE_SYSTEMD
 #include <systemd/sd-daemon.h>
 #endif
+#include <algorithm>
+#include <limits>
 #include <vector>
 #include <sstream>
 
@@ -34,10 +36,14 @@
 #include <maxscale/utils.hh>
 #include <maxscale/statistics.hh>
 
+#include "internal/buffer.hh"
 #include "internal/dcb.h"
 #include "internal/modules.h"
+#include "internal/objectpool.hh"
 #include "internal/poll.hh"
+#include "internal/server.hh"
 #include "internal/service.hh"
+#include "internal/session.h"
 
 #define WORKER_ABSENT_ID -1
 
@@ -52,6 +58,9 @@ using std::stringstream;
 namespace
 {
 
+// How often, in milliseconds, the stale connections are removed from the persistent pools.
+const int POOL_CLEANUP_INTERVAL = 1000;
+
 /**
  * Unit variables.
  */
@@ -251,9 +260,15 @@ private:
 };
 
 RoutingWorker::RoutingWorker()
-    : m_id(next_worker_id())
+    : mxb::Worker(MAX_EVENTS,
+                  config_get_global_options()->io_uring ?
+                  POLL_BACKEND_IO_URING : POLL_BACKEND_EPOLL)
+    , m_id(next_worker_id())
     , m_alive(true)
     , m_pWatchdog_notifier(nullptr)
+    , m_last_second_load(0)
+    , m_sessions_moved_in(0)
+    , m_sessions_moved_out(0)
 {
     MXB_POLL_DATA::handler = &RoutingWorker::epoll_instance_handler;
     MXB_POLL_DATA::owner = this;
@@ -439,6 +454,44 @@ bool RoutingWorker::remove_shared_fd(int fd)
     return rv;
 }
 
+bool RoutingWorker::add_listener_fd(int fd, uint32_t events, MXB_POLL_DATA* pData)
+{
+    bool rv = true;
+
+    // Level-triggered for the same reason as in add_shared_fd().
+    events &= ~EPOLLET;
+
+    struct epoll_event ev;
+
+    ev.events = events;
+    ev.data.ptr = pData;
+
+    pData->owner = this;
+
+    if (epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, fd, &ev) != 0)
+    {
+        Worker::resolve_poll_error(fd, errno, EPOLL_CTL_ADD);
+        rv = false;
+    }
+
+    return rv;
+}
+
+bool RoutingWorker::remove_listener_fd(int fd)
+{
+    bool rv = true;
+
+    struct epoll_event ev = {};
+
+    if (epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, fd, &ev) != 0)
+    {
+        Worker::resolve_poll_error(fd, errno, EPOLL_CTL_DEL);
+        rv = false;
+    }
+
+    return rv;
+}
+
 bool mxs_worker_should_shutdown(MXB_WORKER* pWorker)
 {
     return static_cast<RoutingWorker*>(pWorker)->should_shutdown();
@@ -565,6 +618,20 @@ bool RoutingWorker::pre_run()
         MXS_ERROR("Could not perform thread initialization for all modules. Thread exits.");
         this_thread.current_worker_id = WORKER_ABSENT_ID;
     }
+    else
+    {
+        delayed_call(POOL_CLEANUP_INTERVAL, &RoutingWorker::clean_persistent_pools, this);
+
+        if (m_id == this_unit.id_main_worker)
+        {
+            int period = config_get_global_options()->rebalance_period;
+
+            if (period > 0)
+            {
+                delayed_call(period * 1000, &RoutingWorker::balance_workers, this);
+            }
+        }
+    }
 
     return rv;
 }
@@ -631,10 +698,10 @@ RoutingWorker* RoutingWorker::create(int epoll_listener_fd)
 
 void RoutingWorker::epoll_tick()
 {
-    dcb_process_idle_sessions(m_id);
-
     m_state = ZPROCESSING;
 
+    mxb::atomic::store(&m_last_second_load, load(Load::ONE_SECOND), mxb::atomic::RELAXED);
+
     delete_zombies();
 
     check_systemd_watchdog();
@@ -994,7 +1061,13 @@ void RoutingWorker::get_qc_stats(std::vector<QC_CACHE_STATS>& all_stats)
 namespace
 {
 
-json_t* qc_stats_to_json(const char* zHost, int id, const QC_CACHE_STATS& stats)
+double qc_hit_rate(const QC_CACHE_STATS& stats)
+{
+    int64_t lookups = stats.hits + stats.misses;
+    return lookups ? (double)stats.hits / lookups : 0;
+}
+
+json_t* qc_cache_stats_to_json(const QC_CACHE_STATS& stats)
 {
     json_t* pStats = json_object();
     json_object_set_new(pStats, "size", json_integer(stats.size));
@@ -1002,6 +1075,15 @@ json_t* qc_stats_to_json(const char* zHost, int id, const QC_CACHE_STATS& stats)
     json_object_set_new(pStats, "hits", json_integer(stats.hits));
     json_object_set_new(pStats, "misses", json_integer(stats.misses));
     json_object_set_new(pStats, "evictions", json_integer(stats.evictions));
+    json_object_set_new(pStats, "hit_rate", json_real(qc_hit_rate(stats)));
+
+    return pStats;
+}
+
+json_t* qc_stats_to_json(const char* zHost, int id, const QC_CACHE_STATS& stats)
+{
+    json_t* pStats = qc_cache_stats_to_json(stats);
+    json_object_set_new(pStats, "shared_hits", json_integer(stats.shared_hits));
 
     json_t* pAttributes = json_object();
     json_object_set_new(pAttributes, "stats", pStats);
@@ -1047,6 +1129,8 @@ std::unique_ptr<json_t> RoutingWorker::get_qc_stats_as_json(const char* zHost)
 
     std::unique_ptr<json_t> sAll_stats(json_array());
 
+    QC_CACHE_STATS total = {};
+
     int id = 0;
     for (const auto& stats : all_stats)
     {
@@ -1054,18 +1138,250 @@ std::unique_ptr<json_t> RoutingWorker::get_qc_stats_as_json(const char* zHost)
 
         json_array_append_new(sAll_stats.get(), pJson);
         ++id;
+
+        total.hits += stats.hits;
+        total.misses += stats.misses;
     }
 
-    return std::unique_ptr<json_t>(mxs_json_resource(zHost, MXS_JSON_API_QC_STATS, sAll_stats.release()));
+    json_t* pResource = mxs_json_resource(zHost, MXS_JSON_API_QC_STATS, sAll_stats.release());
+
+    // The hit rate of all threads together and the state of the cache they share.
+    json_t* pMeta = json_object();
+    json_object_set_new(pMeta, "hit_rate", json_real(qc_hit_rate(total)));
+
+    QC_CACHE_STATS shared;
+
+    if (qc_get_shared_cache_stats(&shared))
+    {
+        json_object_set_new(pMeta, "shared_cache", qc_cache_stats_to_json(shared));
+    }
+
+    json_object_set_new(pResource, CN_META, pMeta);
+
+    return std::unique_ptr<json_t>(pResource);
 }
 
 // static
 RoutingWorker* RoutingWorker::pick_worker()
 {
     static int id_generator = 0;
-    int id = this_unit.id_min_worker
-        + (mxb::atomic::add(&id_generator, 1, mxb::atomic::RELAXED) % this_unit.nWorkers);
-    return get(id);
+    int n = mxb::atomic::add(&id_generator, 1, mxb::atomic::RELAXED);
+
+    // The loads change only once per second, so always picking the least loaded
+    // worker would send all new sessions of one second to the same worker. Of
+    // two consecutive workers the busy one is avoided, and between equally
+    // loaded ones the distribution remains round-robin.
+    RoutingWorker* pFirst = get(this_unit.id_min_worker + (n % this_unit.nWorkers));
+    RoutingWorker* pSecond = get(this_unit.id_min_worker + ((n + 1) % this_unit.nWorkers));
+
+    return pSecond->last_second_load() < pFirst->last_second_load() ? pSecond : pFirst;
+}
+
+bool RoutingWorker::clean_persistent_pools(Call::action_t action)
+{
+    if (action == Call::EXECUTE)
+    {
+        server_clean_persistent_pools(m_id);
+    }
+
+    return true;
+}
+
+bool RoutingWorker::balance_workers(Call::action_t action)
+{
+    if (action == Call::EXECUTE)
+    {
+        balance_workers();
+    }
+
+    return true;
+}
+
+void RoutingWorker::balance_workers()
+{
+    RoutingWorker* pBusiest = nullptr;
+    RoutingWorker* pIdlest = nullptr;
+    int max_load = -1;
+    int min_load = std::numeric_limits<int>::max();
+
+    for (int i = this_unit.id_min_worker; i <= this_unit.id_max_worker; ++i)
+    {
+        RoutingWorker* pWorker = get(i);
+        int load = pWorker->last_second_load();
+
+        if (load > max_load)
+        {
+            max_load = load;
+            pBusiest = pWorker;
+        }
+
+        if (load < min_load)
+        {
+            min_load = load;
+            pIdlest = pWorker;
+        }
+    }
+
+    if (pBusiest != pIdlest && max_load - min_load >= config_get_global_options()->rebalance_threshold)
+    {
+        // Moving half the difference evens out the loads.
+        int load = (max_load - min_load) / 2;
+
+        pBusiest->execute([pBusiest, pIdlest, load]() {
+                              pBusiest->rebalance(pIdlest, load);
+                          }, Worker::EXECUTE_QUEUED);
+    }
+}
+
+namespace
+{
+
+struct SessionLoad
+{
+    MXS_SESSION* pSession;
+    double       rate;      // Reads per second of the client during the lifetime of the session
+};
+
+bool add_session_load(DCB* pDcb, void* pData)
+{
+    if (pDcb->dcb_role == DCB_ROLE_CLIENT_HANDLER
+        && pDcb->session
+        && pDcb->session->state == SESSION_STATE_ROUTER_READY)
+    {
+        auto* pLoads = static_cast<std::vector<SessionLoad>*>(pData);
+        double age = difftime(time(nullptr), pDcb->session->stats.connect) + 1;
+
+        pLoads->push_back({pDcb->session, pDcb->stats.n_reads / age});
+    }
+
+    return true;
+}
+
+bool add_backend_dcb(DCB* pDcb, void* pData)
+{
+    static_cast<std::vector<DCB*>*>(pData)->push_back(pDcb);
+    return true;
+}
+}
+
+int RoutingWorker::rebalance(RoutingWorker* pTo, int load)
+{
+    mxb_assert(this == get_current());
+
+    std::vector<SessionLoad> loads;
+    dcb_foreach_local(add_session_load, &loads);
+
+    double total = 0;
+
+    for (const auto& l : loads)
+    {
+        total += l.rate;
+    }
+
+    std::sort(loads.begin(), loads.end(), [](const SessionLoad& lhs, const SessionLoad& rhs) {
+                  return lhs.rate > rhs.rate;
+              });
+
+    int current = last_second_load();
+    double to_move = current > 0 ? total * std::min(load, current) / current : 0;
+    double moved = 0;
+    int nMoved = 0;
+
+    for (auto it = loads.begin(); it != loads.end() && moved < to_move; ++it)
+    {
+        if (session_is_movable(it->pSession) && move_session(it->pSession, pTo))
+        {
+            moved += it->rate;
+            ++nMoved;
+        }
+    }
+
+    if (nMoved != 0)
+    {
+        MXS_INFO("Moved %d sessions from worker %d (load %d%%) to worker %d (load %d%%).",
+                 nMoved, id(), current, pTo->id(), pTo->last_second_load());
+    }
+
+    return nMoved;
+}
+
+bool RoutingWorker::move_session(MXS_SESSION* pSession, RoutingWorker* pTo)
+{
+    mxb_assert(this == get_current());
+    mxb_assert(pSession->client_dcb->poll.owner == this);
+    mxb_assert(session_is_movable(pSession));
+
+    std::vector<DCB*> dcbs {pSession->client_dcb};
+    session_foreach_backend_dcb(pSession, add_backend_dcb, &dcbs);
+
+    // The reference keeps the session alive until it has arrived.
+    session_get_ref(pSession);
+    session_set_moving(pSession, true);
+    bool registered = m_sessions.remove(pSession->ses_id);
+
+    for (DCB* pDcb : dcbs)
+    {
+        dcb_detach_from_worker(pDcb);
+        mxb::atomic::store(&pDcb->poll.owner, static_cast<MXB_WORKER*>(pTo), mxb::atomic::RELEASE);
+    }
+
+    auto attach = [pTo, pSession, dcbs, registered]() {
+            // Nothing of the session is used here before this.
+            session_moved(pSession);
+
+            bool attached = true;
+
+            for (DCB* pDcb : dcbs)
+            {
+                if (!dcb_attach_to_worker(pDcb))
+                {
+                    attached = false;
+                }
+            }
+
+            if (registered)
+            {
+                pTo->m_sessions.add(pSession);
+            }
+
+            ++pTo->m_sessions_moved_in;
+            session_set_moving(pSession, false);
+
+            if (!attached)
+            {
+                MXS_ERROR("Could not add the connections of session %lu to worker %d, closing session.",
+                          pSession->ses_id, pTo->id());
+                poll_fake_hangup_event(pSession->client_dcb);
+            }
+
+            session_put_ref(pSession);
+        };
+
+    bool moved = pTo->execute(attach, Worker::EXECUTE_QUEUED);
+
+    if (moved)
+    {
+        ++m_sessions_moved_out;
+    }
+    else
+    {
+        // The session stays here after all.
+        for (DCB* pDcb : dcbs)
+        {
+            mxb::atomic::store(&pDcb->poll.owner, static_cast<MXB_WORKER*>(this), mxb::atomic::RELEASE);
+            dcb_attach_to_worker(pDcb);
+        }
+
+        if (registered)
+        {
+            m_sessions.add(pSession);
+        }
+
+        session_set_moving(pSession, false);
+        session_put_ref(pSession);
+    }
+
+    return moved;
 }
 
 // static
@@ -1188,6 +1504,15 @@ namespace
 
 using namespace maxscale;
 
+json_t* pool_stats_to_json(const ObjectPoolStats& stats)
+{
+    json_t* pool = json_object();
+    json_object_set_new(pool, "hits", json_integer(stats.hits));
+    json_object_set_new(pool, "misses", json_integer(stats.misses));
+    json_object_set_new(pool, "cached", json_integer(stats.cached));
+    return pool;
+}
+
 class WorkerInfoTask : public Worker::Task
 {
 public:
@@ -1218,6 +1543,9 @@ public:
         rworker.get_descriptor_counts(&nCurrent, &nTotal);
         json_object_set_new(pStats, "current_descriptors", json_integer(nCurrent));
         json_object_set_new(pStats, "total_descriptors", json_integer(nTotal));
+        json_object_set_new(pStats, "poll_backend",
+                            json_string(rworker.poll_backend() == Worker::POLL_BACKEND_IO_URING ?
+                                        "io_uring" : "epoll"));
 
         json_t* load = json_object();
         json_object_set_new(load, "last_second", json_integer(rworker.load(Worker::Load::ONE_SECOND)));
@@ -1225,6 +1553,23 @@ public:
         json_object_set_new(load, "last_hour", json_integer(rworker.load(Worker::Load::ONE_HOUR)));
         json_object_set_new(pStats, "load", load);
 
+        mxs::BufferPoolStats pool = mxs::buffer_pool_stats();
+        json_t* buffers = json_object();
+        json_object_set_new(buffers, "hits", json_integer(pool.hits));
+        json_object_set_new(buffers, "misses", json_integer(pool.misses));
+        json_object_set_new(buffers, "remote_frees", json_integer(pool.remote_frees));
+        json_object_set_new(buffers, "cached", json_integer(pool.cached));
+        json_object_set_new(pStats, "buffer_pool", buffers);
+
+        json_t* objects = json_object();
+        json_object_set_new(objects, "dcbs", pool_stats_to_json(mxs::dcb_pool_stats()));
+        json_object_set_new(objects, "sessions", pool_stats_to_json(mxs::session_pool_stats()));
+        json_object_set_new(objects, "protocols", pool_stats_to_json(mxs::protocol_pool_stats()));
+        json_object_set_new(pStats, "object_pools", objects);
+
+        json_object_set_new(pStats, "sessions_moved_in", json_integer(rworker.sessions_moved_in()));
+        json_object_set_new(pStats, "sessions_moved_out", json_integer(rworker.sessions_moved_out()));
+
         json_t* qc = qc_get_cache_stats_as_json();
 
         if (qc)
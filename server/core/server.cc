@@ -130,13 +130,13 @@ SERVER* server_alloc(const char* name, MXS_CONFIG_PARAMETER* params)
     char* my_name = MXS_STRDUP(name);
     char* my_protocol = MXS_STRDUP(protocol);
     char* my_authenticator = MXS_STRDUP(authenticator);
-    DCB** persistent = (DCB**)MXS_CALLOC(config_threadcount(), sizeof(*persistent));
+    mxs::PersistentPool* persistent = new(std::nothrow) mxs::PersistentPool[config_threadcount()];
 
     if (!server || !my_name || !my_protocol || !my_authenticator || !persistent)
     {
         delete server;
         MXS_FREE(my_name);
-        MXS_FREE(persistent);
+        delete[] persistent;
         MXS_FREE(my_protocol);
         MXS_FREE(my_authenticator);
         SSL_LISTENER_free(ssl);
@@ -166,7 +166,7 @@ SERVER* server_alloc(const char* name, MXS_CONFIG_PARAMETER* params)
     server->is_active = true;
     server->auth_instance = auth_instance;
     server->server_ssl = ssl;
-    server->persistent = persistent;
+    server->m_persistent.reset(persistent);
     server->charset = SERVER_DEFAULT_CHARSET;
     memset(&server->stats, 0, sizeof(server->stats));
     server->persistmax = 0;
@@ -227,15 +227,11 @@ void server_free(Server* server)
     MXS_FREE(server->authenticator);
     server_parameter_free(server->parameters);
 
-    if (server->persistent)
-    {
-        int nthr = config_threadcount();
+    int nthr = config_threadcount();
 
-        for (int i = 0; i < nthr; i++)
-        {
-            dcb_persistent_clean_count(server->persistent[i], i, true);
-        }
-        MXS_FREE(server->persistent);
+    for (int i = 0; i < nthr; i++)
+    {
+        dcb_persistent_clean_count(server, i, true);
     }
 
     delete server->disk_space_threshold;
@@ -245,69 +241,49 @@ void server_free(Server* server)
 /**
  * Get a DCB from the persistent connection pool, if possible
  *
- * @param server      The server to set the name on
- * @param user        The name of the user needing the connection
- * @param ip          Client IP address
- * @param protocol    The name of the protocol needed for the connection
- * @param id          Thread ID
+ * @param server        The server to set the name on
+ * @param user          The name of the user needing the connection
+ * @param ip            Client IP address
+ * @param protocol      The name of the protocol needed for the connection
+ * @param capabilities  The protocol capabilities needed for the connection
+ * @param id            Thread ID
  *
  * @return A DCB or NULL if no connection is found
  */
-DCB* server_get_persistent(SERVER* server, const char* user, const char* ip, const char* protocol, int id)
+DCB* server_get_persistent(SERVER* srv,
+                           const char* user,
+                           const char* ip,
+                           const char* protocol,
+                           uint64_t capabilities,
+                           int id)
 {
-    DCB* dcb, * previous = NULL;
+    Server* server = static_cast<Server*>(srv);
+    DCB* dcb = NULL;
 
-    if (server->persistent[id]
-        && dcb_persistent_clean_count(server->persistent[id], id, false)
-        && server->persistent[id]   // Check after cleaning
-        && (server->status & SERVER_RUNNING))
+    if (server->persistpoolmax && ip && (server->status & SERVER_RUNNING))
     {
-        dcb = server->persistent[id];
-        while (dcb)
+        bool exact = false;
+        dcb = server->persistent_pool(id).acquire(user,
+                                                 ip,
+                                                 protocol,
+                                                 capabilities,
+                                                 server->persistmaxtime,
+                                                 &exact);
+
+        if (dcb)
         {
-            if (dcb->user
-                && dcb->protoname
-                && dcb->remote
-                && ip
-                && !dcb->dcb_errhandle_called
-                && !(dcb->flags & DCBF_HUNG)
-                && 0 == strcmp(dcb->user, user)
-                && 0 == strcmp(dcb->remote, ip)
-                && 0 == strcmp(dcb->protoname, protocol))
-            {
-                if (NULL == previous)
-                {
-                    server->persistent[id] = dcb->nextpersistent;
-                }
-                else
-                {
-                    previous->nextpersistent = dcb->nextpersistent;
-                }
-                MXS_FREE(dcb->user);
-                dcb->user = NULL;
-                mxb::atomic::add(&server->stats.n_persistent, -1);
-                mxb::atomic::add(&server->stats.n_current, 1, mxb::atomic::RELAXED);
-                return dcb;
-            }
-            else
-            {
-                MXS_DEBUG("%lu [server_get_persistent] Rejected dcb "
-                          "%p from pool, user %s looking for %s, protocol %s "
-                          "looking for %s, hung flag %s, error handle called %s.",
-                          pthread_self(),
-                          dcb,
-                          dcb->user ? dcb->user : "NULL",
-                          user,
-                          dcb->protoname ? dcb->protoname : "NULL",
-                          protocol,
-                          (dcb->flags & DCBF_HUNG) ? "true" : "false",
-                          dcb->dcb_errhandle_called ? "true" : "false");
-            }
-            previous = dcb;
-            dcb = dcb->nextpersistent;
+            MXS_DEBUG("Taking %s connection %p from the pool for user %s from %s",
+                      exact ? "matching" : "reassigned",
+                      dcb,
+                      user,
+                      ip);
+            dcb_set_user(dcb, NULL);
+            mxb::atomic::add(&server->stats.n_persistent, -1);
+            mxb::atomic::add(&server->stats.n_current, 1, mxb::atomic::RELAXED);
         }
     }
-    return NULL;
+
+    return dcb;
 }
 
 /**
@@ -478,7 +454,8 @@ public:
         mxb_assert(&rworker == RoutingWorker::get_current());
 
         int thread_id = rworker.id();
-        dcb_persistent_clean_count(m_server->persistent[thread_id], thread_id, false);
+        // The pooled connections are not part of the logical state of the server.
+        dcb_persistent_clean_count(const_cast<SERVER*>(m_server), thread_id, false);
     }
 
 private:
@@ -498,6 +475,56 @@ static void cleanup_persistent_connections(const SERVER* server)
     RoutingWorker::execute_concurrently(task);
 }
 
+void server_clean_persistent_pools(int id)
+{
+    std::vector<SERVER*> servers;
+
+    {
+        Guard guard(server_lock);
+
+        for (Server* server : all_servers)
+        {
+            if (server->is_active && server->persistpoolmax)
+            {
+                servers.push_back(server);
+            }
+        }
+    }
+
+    // Closing the connections must not be done while holding the lock.
+    for (SERVER* server : servers)
+    {
+        dcb_persistent_clean_count(server, id, false);
+    }
+}
+
+/**
+ * @brief Calculate an average duration
+ *
+ * @param total_ns  Total duration in nanoseconds
+ * @param count     Number of samples
+ *
+ * @return The average duration, zero if there are no samples
+ */
+static maxbase::Duration average_duration(uint64_t total_ns, uint64_t count)
+{
+    return maxbase::Duration(std::chrono::nanoseconds(count ? total_ns / count : 0));
+}
+
+/**
+ * @brief Get the ratio of connections taken from the persistent pool
+ *
+ * @param server  The server
+ *
+ * @return The share of connection requests that found a connection in the pool
+ */
+static double pool_hit_rate(const SERVER* server)
+{
+    uint64_t hits = mxb::atomic::load(&server->stats.n_from_pool, mxb::atomic::RELAXED);
+    uint64_t misses = mxb::atomic::load(&server->stats.n_new_conn, mxb::atomic::RELAXED);
+    return hits + misses ? (double)hits / (hits + misses) : 0;
+}
+
 /**
  * Print server details to a DCB
  *
@@ -587,6 +614,15 @@ void dprintServer(DCB* dcb, const SERVER* srv)
         double d = (double)server->stats.n_from_pool / (double)(server->stats.n_connections
                                                                 + server->stats.n_from_pool + 1);
         dcb_printf(dcb, "\tPool availability:                   %0.2lf%%\n", d * 100.0);
+        dcb_printf(dcb, "\tPool hit rate:                       %0.2lf%%\n", pool_hit_rate(server) * 100.0);
+
+        std::ostringstream wait_os;
+        wait_os << average_duration(server->stats.wait_ns, server->stats.n_waits);
+        dcb_printf(dcb, "\tAvg. connection wait time:           %s\n", wait_os.str().c_str());
+
+        std::ostringstream reset_os;
+        reset_os << average_duration(server->stats.reset_ns, server->stats.n_resets);
+        dcb_printf(dcb, "\tAvg. pooled connection reset time:   %s\n", reset_os.str().c_str());
     }
     if (server->server_ssl)
     {
@@ -1459,6 +1495,14 @@ static json_t* server_json_attributes(const SERVER* server)
     json_object_set_new(stats, "persistent_connections", json_integer(server->stats.n_persistent));
     json_object_set_new(stats, "active_operations", json_integer(server->stats.n_current_ops));
     json_object_set_new(stats, "routed_packets", json_integer(server->stats.packets));
+    json_object_set_new(stats, "connections_from_pool", json_integer(server->stats.n_from_pool));
+    json_object_set_new(stats, "pool_hit_rate", json_real(pool_hit_rate(server)));
+
+    maxbase::Duration wait_ave = average_duration(server->stats.wait_ns, server->stats.n_waits);
+    json_object_set_new(stats, "avg_connection_wait_time", json_string(to_string(wait_ave).c_str()));
+
+    maxbase::Duration reset_ave = average_duration(server->stats.reset_ns, server->stats.n_resets);
+    json_object_set_new(stats, "avg_connection_reset_time", json_string(to_string(reset_ave).c_str()));
 
     maxbase::Duration response_ave(server_response_time_average(server));
     json_object_set_new(stats, "adaptive_avg_select_time", json_string(to_string(response_ave).c_str()));
@@ -1564,6 +1608,18 @@ void server_add_response_average(SERVER* srv, double ave, int num_samples)
     server->response_time_add(ave, num_samples);
 }
 
+void server_add_connection_wait(SERVER* server, uint64_t ns, bool reset)
+{
+    mxb::atomic::add(&server->stats.n_waits, 1, mxb::atomic::RELAXED);
+    mxb::atomic::add(&server->stats.wait_ns, ns, mxb::atomic::RELAXED);
+
+    if (reset)
+    {
+        mxb::atomic::add(&server->stats.n_resets, 1, mxb::atomic::RELAXED);
+        mxb::atomic::add(&server->stats.reset_ns, ns, mxb::atomic::RELAXED);
+    }
+}
+
 int server_response_time_num_samples(const SERVER* srv)
 {
     const Server* server = static_cast<const Server*>(srv);
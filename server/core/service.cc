@@ -101,11 +101,6 @@ Service* service_alloc(const char* name, const char* router, MXS_CONFIG_PARAMETE
         return NULL;
     }
 
-    if (service->conn_idle_timeout)
-    {
-        dcb_enable_session_timeouts();
-    }
-
     // Store parameters in the service
     service_add_parameters(service, params);
 
@@ -179,6 +174,7 @@ Service::Service(const std::string& service_name,
     stats.n_failed_starts = 0;
     stats.n_current = 0;
     stats.n_sessions = 0;
+    stats.n_idle_timeouts = 0;
     state = SERVICE_STATE_ALLOC;
     active = true;
     ports = NULL;
@@ -1302,6 +1298,9 @@ void dprintService(DCB* dcb, SERVICE* svc)
     dcb_printf(dcb,
                "\tCurrently connected:                 %d\n",
                service->stats.n_current);
+    dcb_printf(dcb,
+               "\tIdle connections timed out:          %d\n",
+               service->stats.n_idle_timeouts);
 }
 
 /**
@@ -2075,6 +2074,7 @@ json_t* service_attributes(const SERVICE* service)
     json_object_set_new(attr, "started", json_string(timebuf));
     json_object_set_new(attr, "total_connections", json_integer(service->stats.n_sessions));
     json_object_set_new(attr, "connections", json_integer(service->stats.n_current));
+    json_object_set_new(attr, "idle_timeouts", json_integer(service->stats.n_idle_timeouts));
 
     /** Add service parameters and listeners */
     json_object_set_new(attr, CN_PARAMETERS, service_parameters_to_json(service));
@@ -2381,12 +2381,10 @@ void Service::update_basic_parameter(const std::string& key, const std::string&
     }
     else if (key == CN_CONNECTION_TIMEOUT)
     {
-        if ((conn_idle_timeout = std::stoi(value)))
-        {
-            dcb_enable_session_timeouts();
-        }
-
+        conn_idle_timeout = std::stoi(value);
         mxb_assert(conn_idle_timeout >= 0);
+
+        dcb_reset_idle_timeouts(this);
     }
     else if (key == CN_AUTH_ALL_SERVERS)
     {
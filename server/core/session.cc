@@ -23,8 +23,10 @@
 #include <string.h>
 #include <errno.h>
 #include <algorithm>
+#include <mutex>
 #include <string>
 #include <sstream>
+#include <unordered_map>
 
 #include <maxbase/atomic.hh>
 #include <maxscale/alloc.h>
@@ -43,6 +45,7 @@
 
 #include "internal/dcb.h"
 #include "internal/filter.hh"
+#include "internal/objectpool.hh"
 #include "internal/session.hh"
 #include "internal/service.hh"
 
@@ -69,6 +72,112 @@ struct
     SESSION_DUMP_STATEMENTS_NEVER
 };
 
+/**
+ * The registry of all sessions, indexed by session id. The sessions are spread
+ * over a number of independently locked shards so that the creation and
+ * destruction of sessions in different workers rarely contend and a lookup
+ * never needs to involve the workers.
+ */
+class SessionRegistry
+{
+public:
+    SessionRegistry(const SessionRegistry&) = delete;
+    SessionRegistry& operator=(const SessionRegistry&) = delete;
+
+    SessionRegistry()
+    {
+    }
+
+    void add(MXS_SESSION* session)
+    {
+        Shard& shard = shard_of(session->ses_id);
+        std::lock_guard<std::mutex> guard(shard.lock);
+        mxb_assert(shard.sessions.count(session->ses_id) == 0);
+        shard.sessions[session->ses_id] = session;
+    }
+
+    void remove(MXS_SESSION* session)
+    {
+        Shard& shard = shard_of(session->ses_id);
+        std::lock_guard<std::mutex> guard(shard.lock);
+        shard.sessions.erase(session->ses_id);
+    }
+
+    /**
+     * Get a reference to a session
+     *
+     * @param id  The session id
+     *
+     * @return A new reference to the session or NULL if no session with the
+     *         id exists or the session is being freed.
+     */
+    MXS_SESSION* get_ref(uint64_t id)
+    {
+        MXS_SESSION* session = NULL;
+        Shard& shard = shard_of(id);
+        std::lock_guard<std::mutex> guard(shard.lock);
+
+        auto it = shard.sessions.find(id);
+
+        if (it != shard.sessions.end())
+        {
+            // The last reference may just have been released, in which case the
+            // session is waiting for the lock in order to remove itself.
+            int refcount = mxb::atomic::load(&it->second->refcount);
+
+            while (refcount > 0)
+            {
+                if (mxb::atomic::compare_exchange(&it->second->refcount, &refcount, refcount + 1))
+                {
+                    session = it->second;
+                    break;
+                }
+            }
+        }
+
+        return session;
+    }
+
+private:
+    static const int N_SHARDS = 64;
+
+    struct Shard
+    {
+        std::mutex                                 lock;
+        std::unordered_map<uint64_t, MXS_SESSION*> sessions;
+    };
+
+    Shard& shard_of(uint64_t id)
+    {
+        return m_shards[id % N_SHARDS];
+    }
+
+    Shard m_shards[N_SHARDS];
+};
+
+SessionRegistry session_registry;
+
+/** The maximum number of sessions a routing worker keeps for reuse */
+const size_t SESSION_POOL_SIZE = 1024;
+
+/**
+ * Get the session pool of the calling thread
+ *
+ * @return The pool or NULL if the calling thread is not a routing worker
+ */
+FreeList* session_pool()
+{
+    static thread_local FreeList* pool = nullptr;
+
+    if (!pool && RoutingWorker::get_current_id() != -1)
+    {
+        // Never deleted, just like the buffer pools.
+        pool = new(std::nothrow) FreeList(sizeof(Session), SESSION_POOL_SIZE);
+    }
+
+    return pool;
+}
+
 static struct session dummy_session()
 {
     struct session session = {};
@@ -129,6 +238,8 @@ static MXS_SESSION* session_alloc_body(SERVICE* service,
     session->client_dcb = client_dcb;
     session->router_session = NULL;
     session->stats.connect = time(0);
+    session->stats.packets = 0;
+    session->stats.copied = 0;
     session->service = service;
     memset(&session->head, 0, sizeof(session->head));
     memset(&session->tail, 0, sizeof(session->tail));
@@ -247,6 +358,8 @@ static MXS_SESSION* session_alloc_body(SERVICE* service,
     // It will be freed later on when the DCB is closed.
     client_dcb->session = session;
 
+    session_registry.add(session);
+
     return (session->state == SESSION_STATE_TO_BE_FREED) ? NULL : session;
 }
 
@@ -378,6 +491,8 @@ static void session_final_free(MXS_SESSION* ses)
     Session* session = static_cast<Session*>(ses);
     mxb_assert(session->refcount == 0);
 
+    session_registry.remove(session);
+
     session->state = SESSION_STATE_TO_BE_FREED;
 
     mxb::atomic::add(&session->service->stats.n_current, -1, mxb::atomic::RELAXED);
@@ -505,6 +620,10 @@ void dprintSession(DCB* dcb, MXS_SESSION* print_session)
         dcb_printf(dcb,
                    "\tConnected:               %s\n",
                    asctime_r(localtime_r(&print_session->stats.connect, &result), buf));
+        dcb_printf(dcb,
+                   "\tPackets (copied):        %lu (%lu)\n",
+                   print_session->stats.packets,
+                   print_session->stats.copied);
         if (print_session->client_dcb->state == DCB_STATE_POLLING)
         {
             dcb_printf(dcb, "\tIdle:                %.0f seconds\n", idle);
@@ -781,30 +900,81 @@ const char* session_trx_state_to_string(mxs_session_trx_state_t state)
     return "UNKNOWN";
 }
 
-static bool ses_find_id(DCB* dcb, void* data)
+MXS_SESSION* session_get_by_id(uint64_t id)
 {
-    void** params = (void**)data;
-    MXS_SESSION** ses = (MXS_SESSION**)params[0];
-    uint64_t* id = (uint64_t*)params[1];
-    bool rval = true;
+    return session_registry.get_ref(id);
+}
+
+void session_foreach_backend_dcb(MXS_SESSION* session, bool (* func)(DCB* dcb, void* data), void* data)
+{
+    Session* ses = static_cast<Session*>(session);
+    mxb_assert(ses->client_dcb->poll.owner == RoutingWorker::get_current());
 
-    if (dcb->session->ses_id == *id)
+    for (DCB* dcb : ses->dcb_set())
     {
-        *ses = session_get_ref(dcb->session);
-        rval = false;
+        if (!func(dcb, data))
+        {
+            break;
+        }
     }
+}
 
-    return rval;
+bool session_is_movable(MXS_SESSION* session)
+{
+    Session* ses = static_cast<Session*>(session);
+    DCB* client_dcb = ses->client_dcb;
+    mxb_assert(client_dcb->poll.owner == RoutingWorker::get_current());
+
+    // Every backend DCB holds a reference, any further one means that some task,
+    // such as delayed routing or a KILL, still refers to the session.
+    bool movable = ses->state == SESSION_STATE_ROUTER_READY
+        && !ses->is_moving()
+        && client_dcb->dcb_role == DCB_ROLE_CLIENT_HANDLER
+        && (service_get_capabilities(ses->service) & RCAP_TYPE_MOVABLE_SESSIONS)
+        && ses->get_filters().empty()
+        && !ses->response.buffer
+        && session_is_autocommit(ses)
+        && !session_trx_is_active(ses)
+        && mxb::atomic::load(&ses->refcount) == 1 + (int)ses->dcb_set().size()
+        && dcb_is_movable(client_dcb);
+
+    // A result is assumed to be pending unless some backend has sent data
+    // after the client last did.
+    int64_t last_reply = ses->dcb_set().empty() ? client_dcb->last_read : 0;
+
+    for (auto it = ses->dcb_set().begin(); movable && it != ses->dcb_set().end(); ++it)
+    {
+        DCB* dcb = *it;
+        movable = dcb_is_movable(dcb) && (!dcb->func.established || dcb->func.established(dcb));
+        last_reply = std::max(last_reply, dcb->last_read);
+    }
+
+    return movable && last_reply >= client_dcb->last_read;
 }
 
-MXS_SESSION* session_get_by_id(uint64_t id)
+void session_moved(MXS_SESSION* session)
 {
-    MXS_SESSION* session = NULL;
-    void* params[] = {&session, &id};
+    Session* ses = static_cast<Session*>(session);
+    mxb_assert(session->client_dcb->poll.owner == RoutingWorker::get_current());
 
-    dcb_foreach(ses_find_id, params);
+    ses->take_ownership();
 
-    return session;
+    MXS_ROUTER_OBJECT* router = session->service->router;
+
+    if (router->sessionMoved)
+    {
+        router->sessionMoved(session->service->router_instance, session->router_session);
+    }
+}
+
+void session_set_moving(MXS_SESSION* session, bool moving)
+{
+    static_cast<Session*>(session)->set_moving(moving);
+}
+
+bool session_is_moving(const MXS_SESSION* session)
+{
+    return session->state != SESSION_STATE_DUMMY && static_cast<const Session*>(session)->is_moving();
 }
 
 MXS_SESSION* session_get_ref(MXS_SESSION* session)
@@ -887,6 +1057,8 @@ json_t* session_json_data(const Session* session, const char* host)
     trim(buf);
 
     json_object_set_new(attr, "connected", json_string(buf));
+    json_object_set_new(attr, "packets", json_integer(session->stats.packets));
+    json_object_set_new(attr, "copied_packets", json_integer(session->stats.copied));
 
     if (session->client_dcb->state == DCB_STATE_POLLING)
     {
@@ -1248,6 +1420,44 @@ Session::~Session()
     }
 }
 
+void* Session::operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    FreeList* pool = session_pool();
+    return pool && size == pool->size() ? pool->alloc() : MXS_MALLOC(size);
+}
+
+void Session::operator delete(void* pSession, size_t size)
+{
+    FreeList* pool = session_pool();
+
+    if (pool && size == pool->size())
+    {
+        pool->free(pSession);
+    }
+    else
+    {
+        MXS_FREE(pSession);
+    }
+}
+
+void Session::operator delete(void* pSession, const std::nothrow_t&) noexcept
+{
+    MXS_FREE(pSession);
+}
+
+ObjectPoolStats maxscale::session_pool_stats()
+{
+    FreeList* pool = session_pool();
+    ObjectPoolStats stats = {};
+
+    if (pool)
+    {
+        stats = pool->stats();
+    }
+
+    return stats;
+}
+
 namespace
 {
 
@@ -1299,6 +1509,14 @@ bool get_cmd_and_stmt(GWBUF* pBuffer, const char** ppCmd, char** ppStmt, int* pL
 
 }
 
+void Session::take_ownership()
+{
+    for (auto& info : m_last_queries)
+    {
+        gwbuf_take_ownership(info.query().get());
+    }
+}
+
 void Session::dump_statements() const
 {
     if (m_retain_last_statements)
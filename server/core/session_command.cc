@@ -88,4 +88,9 @@ void SessionCommand::mark_as_duplicate(const SessionCommand& rhs)
     // The commands now share the mxs::Buffer that contains the actual command
     m_buffer = rhs.m_buffer;
 }
+
+void SessionCommand::take_ownership()
+{
+    gwbuf_take_ownership(m_buffer.get());
+}
 }
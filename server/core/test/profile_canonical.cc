@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2018 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2022-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+#include <maxscale/ccdefs.hh>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <maxscale/buffer.hh>
+#include <maxscale/modutil.hh>
+#include <maxscale/paths.h>
+#include <maxscale/protocol/mysql.h>
+
+using namespace std;
+
+namespace
+{
+
+char USAGE[] = "usage: profile_canonical [-n count] file...\n"
+               "\n"
+               "Canonicalizes each line of the files count times (default 100) and\n"
+               "reports the throughput.\n";
+
+GWBUF* create_query(const string& sql)
+{
+    size_t plen = sql.length() + 1;
+    GWBUF* buf = gwbuf_alloc(MYSQL_HEADER_LEN + plen);
+    uint8_t* data = GWBUF_DATA(buf);
+
+    gw_mysql_set_byte3(data, plen);
+    data[3] = 0;
+    data[4] = MXS_COM_QUERY;
+    memcpy(data + MYSQL_HEADER_LEN + 1, sql.c_str(), sql.length());
+
+    return buf;
+}
+}
+
+int main(int argc, char* argv[])
+{
+    int rc = EXIT_SUCCESS;
+    int nCount = 100;
+
+    int c;
+    while ((c = getopt(argc, argv, "n:")) != -1)
+    {
+        switch (c)
+        {
+        case 'n':
+            nCount = atoi(optarg);
+            break;
+
+        default:
+            rc = EXIT_FAILURE;
+        }
+    }
+
+    if ((rc == EXIT_SUCCESS) && (optind < argc) && (nCount > 0))
+    {
+        rc = EXIT_FAILURE;
+
+        set_datadir(strdup("/tmp"));
+        set_langdir(strdup("."));
+        set_process_datadir(strdup("/tmp"));
+
+        if (mxs_log_init(NULL, ".", MXS_LOG_TARGET_DEFAULT))
+        {
+            vector<GWBUF*> queries;
+            size_t bytes = 0;
+
+            for (int i = optind; i < argc; ++i)
+            {
+                ifstream in(argv[i]);
+
+                for (string line; getline(in, line);)
+                {
+                    if (!line.empty())
+                    {
+                        queries.push_back(create_query(line));
+                        bytes += line.length();
+                    }
+                }
+            }
+
+            if (!queries.empty())
+            {
+                uint64_t sum = 0;
+                auto start = chrono::steady_clock::now();
+
+                for (int i = 0; i < nCount; ++i)
+                {
+                    for (GWBUF* query : queries)
+                    {
+                        uint64_t digest;
+                        sum += mxs::get_canonical(query, &digest).length() + digest;
+                    }
+                }
+
+                chrono::duration<double> secs = chrono::steady_clock::now() - start;
+                double n = (double)nCount * queries.size();
+
+                cout << "Statements: " << queries.size() << ", average length " << bytes / queries.size()
+                     << " bytes (checksum " << hex << sum << dec << ")" << endl;
+                cout << "Time: " << fixed << setprecision(3) << secs.count() << "s" << endl;
+                cout << "Statements/s: " << setprecision(0) << n / secs.count() << endl;
+                cout << "MB/s: " << setprecision(1) << nCount * bytes / secs.count() / 1e6 << endl;
+                cout << "ns/statement: " << setprecision(1) << secs.count() * 1e9 / n << endl;
+
+                rc = EXIT_SUCCESS;
+            }
+            else
+            {
+                cerr << "error: No statements found." << endl;
+            }
+
+            for (GWBUF* query : queries)
+            {
+                gwbuf_free(query);
+            }
+
+            mxs_log_finish();
+        }
+        else
+        {
+            cerr << "error: Could not initialize log." << endl;
+        }
+    }
+    else
+    {
+        cout << USAGE << endl;
+    }
+
+    return rc;
+}
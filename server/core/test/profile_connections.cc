@@ -0,0 +1,186 @@
+/*
+ * Copyright (c) 2018 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2022-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+/**
+ * Measures how many client connections per second can be set up and torn
+ * down, as far as the DCB, the session and the protocol object are concerned.
+ *
+ * The connections are first created all at once, in which case nearly all
+ * objects must be allocated, and then one after another, in which case the
+ * objects of the previous connection are reused.
+ *
+ * Usage: profile_connections [-n count] [-r rounds]
+ */
+
+#include <maxscale/ccdefs.hh>
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+#include <maxscale/listener.h>
+#include <maxscale/protocol/mysql.h>
+
+#include "test_utils.h"
+#include "../internal/modules.h"
+#include "../internal/objectpool.hh"
+#include "../internal/service.hh"
+
+using namespace std;
+
+namespace
+{
+
+char USAGE[] = "usage: profile_connections [-n count] [-r rounds]\n";
+
+MXS_SESSION* open_connection(Service* service, SERV_LISTENER* listener)
+{
+    // An internal DCB, so that the session does not create a router session.
+    DCB* dcb = dcb_alloc(DCB_ROLE_INTERNAL, listener);
+    mxb_assert(dcb);
+
+    dcb->service = service;
+    dcb_alloc_protocol(dcb, sizeof(MySQLProtocol));
+    dcb_set_user(dcb, "maxuser");
+
+    mxb::atomic::add(&service->client_count, 1);
+    MXS_SESSION* session = session_alloc(service, dcb);
+    mxb_assert(session);
+
+    return session;
+}
+
+void close_connection(MXS_SESSION* session)
+{
+    // Frees the session and its client DCB.
+    session_put_ref(session);
+}
+
+/**
+ * Report the median of the rounds, single rounds vary too much to be compared.
+ */
+void report(const char* zWhat, int nCount, vector<double> secs)
+{
+    sort(secs.begin(), secs.end());
+    double median = secs[secs.size() / 2];
+
+    cout << setw(12) << zWhat << ": " << nCount << " connections in "
+         << fixed << setprecision(3) << median << "s, "
+         << setprecision(0) << nCount / median << " connections/s (median of "
+         << secs.size() << " rounds)" << endl;
+}
+
+void report(const char* zWhat, const mxs::ObjectPoolStats& stats)
+{
+    cout << setw(12) << zWhat << ": " << stats.hits << " hits, " << stats.misses << " misses, "
+         << stats.cached << " cached" << endl;
+}
+
+int run(Service* service, int nCount, int nRounds)
+{
+    SERV_LISTENER listener = {};
+    vector<MXS_SESSION*> sessions(nCount);
+    vector<double> concurrent;
+    vector<double> sequential;
+
+    for (int round = 0; round < nRounds; ++round)
+    {
+        // All connections open at the same time, the pools can cover only a few of them.
+        auto start = chrono::steady_clock::now();
+
+        for (int i = 0; i < nCount; ++i)
+        {
+            sessions[i] = open_connection(service, &listener);
+        }
+
+        for (int i = 0; i < nCount; ++i)
+        {
+            close_connection(sessions[i]);
+        }
+
+        chrono::duration<double> secs = chrono::steady_clock::now() - start;
+        concurrent.push_back(secs.count());
+
+        // One connection at a time, every connection reuses the objects of the previous one.
+        start = chrono::steady_clock::now();
+
+        for (int i = 0; i < nCount; ++i)
+        {
+            close_connection(open_connection(service, &listener));
+        }
+
+        secs = chrono::steady_clock::now() - start;
+        sequential.push_back(secs.count());
+    }
+
+    report("concurrent", nCount, concurrent);
+    report("sequential", nCount, sequential);
+
+    report("dcbs", mxs::dcb_pool_stats());
+    report("sessions", mxs::session_pool_stats());
+    report("protocols", mxs::protocol_pool_stats());
+
+    return EXIT_SUCCESS;
+}
+}
+
+int main(int argc, char* argv[])
+{
+    int rc = EXIT_SUCCESS;
+    int nCount = 100000;
+    int nRounds = 15;
+
+    int c;
+    while ((c = getopt(argc, argv, "n:r:")) != -1)
+    {
+        switch (c)
+        {
+        case 'n':
+            nCount = atoi(optarg);
+            break;
+
+        case 'r':
+            nRounds = atoi(optarg);
+            break;
+
+        default:
+            rc = EXIT_FAILURE;
+        }
+    }
+
+    if (rc == EXIT_SUCCESS && nCount > 0 && nRounds > 0)
+    {
+        init_test_env(NULL);
+
+        set_libdir(MXS_STRDUP_A("../../modules/routing/readconnroute/"));
+        load_module("readconnroute", MODULE_ROUTER);
+
+        Service* service = service_alloc("MyService", "readconnroute", NULL);
+
+        if (service)
+        {
+            rc = run(service, nCount, nRounds);
+        }
+        else
+        {
+            cerr << "error: Could not create service." << endl;
+            rc = EXIT_FAILURE;
+        }
+    }
+    else
+    {
+        cout << USAGE << endl;
+    }
+
+    return rc;
+}
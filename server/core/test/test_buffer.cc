@@ -190,6 +190,8 @@ void test_split()
                        "Old buffer should be 5 bytes");
     mxb_assert_message(gwbuf_length(newbuf) == 5 && GWBUF_LENGTH(newbuf) == 5,
                        "New buffer should be 5 bytes");
+    mxb_assert_message(GWBUF_DATA(newbuf) + 5 == GWBUF_DATA(buffer),
+                       "The split buffers should share the data");
     mxb_assert_message(buffer->tail == buffer, "Old buffer's tail should point to itself");
     mxb_assert_message(newbuf->tail == newbuf, "New buffer's tail should point to itself");
     mxb_assert_message(buffer->next == NULL, "Old buffer's next pointer should be NULL");
@@ -445,6 +447,68 @@ void test_clone()
     gwbuf_free(original);
 }
 
+void test_inline()
+{
+    // A small buffer shares its allocation with its header, freeing the original
+    // before the clone must keep the data alive.
+    GWBUF* original = gwbuf_alloc_and_load(5, "12345");
+    mxb_assert(original->sbuf->info & GWBUF_INFO_INLINE);
+
+    GWBUF* clone = gwbuf_clone(original);
+    gwbuf_free(original);
+    mxb_assert(memcmp(GWBUF_DATA(clone), "12345", 5) == 0);
+    gwbuf_free(clone);
+
+    original = gwbuf_alloc_and_load(5, "12345");
+    clone = gwbuf_clone(original);
+    gwbuf_free(clone);
+    mxb_assert(memcmp(GWBUF_DATA(original), "12345", 5) == 0);
+    gwbuf_free(original);
+
+    // Large buffers are allocated separately from the header.
+    uint8_t* data = generate_data(1000);
+    original = gwbuf_alloc_and_load(1000, data);
+    mxb_assert((original->sbuf->info & GWBUF_INFO_INLINE) == 0);
+    mxb_assert(memcmp(GWBUF_DATA(original), data, 1000) == 0);
+    gwbuf_free(original);
+    MXS_FREE(data);
+}
+
+int n_objects_freed = 0;
+
+void free_object(void* data)
+{
+    ++n_objects_freed;
+}
+
+void test_split_objects()
+{
+    // The parts of a split buffer share the data but not the buffer objects.
+    GWBUF* buffer = gwbuf_alloc_and_load(10, "1234567890");
+    int first = 1;
+    int second = 2;
+
+    GWBUF* head = gwbuf_split(&buffer, 4);
+    mxb_assert(head->sbuf == buffer->sbuf);
+    gwbuf_add_buffer_object(head, GWBUF_REPLY_INFO, &first, free_object);
+    mxb_assert(gwbuf_get_buffer_object_data(head, GWBUF_REPLY_INFO) == &first);
+    mxb_assert(gwbuf_get_buffer_object_data(buffer, GWBUF_REPLY_INFO) == NULL);
+
+    gwbuf_add_buffer_object(buffer, GWBUF_REPLY_INFO, &second, free_object);
+    mxb_assert(gwbuf_get_buffer_object_data(buffer, GWBUF_REPLY_INFO) == &second);
+    mxb_assert(gwbuf_get_buffer_object_data(head, GWBUF_REPLY_INFO) == &first);
+
+    // A clone of a part is the same part
+    GWBUF* clone = gwbuf_clone(head);
+    mxb_assert(gwbuf_get_buffer_object_data(clone, GWBUF_REPLY_INFO) == &first);
+    gwbuf_free(clone);
+
+    gwbuf_free(head);
+    mxb_assert(n_objects_freed == 0);
+    gwbuf_free(buffer);
+    mxb_assert(n_objects_freed == 2);
+}
+
 /**
  * test1    Allocate a buffer and do lots of things
  *
@@ -564,6 +628,8 @@ static int test1()
     test_consume();
     test_compare();
     test_clone();
+    test_inline();
+    test_split_objects();
 
     return 0;
 }
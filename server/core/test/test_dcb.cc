@@ -30,9 +30,11 @@
 #undef NDEBUG
 #endif
 
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/socket.h>
 
 #include <maxscale/config.h>
 #include <maxscale/listener.h>
@@ -69,6 +71,79 @@ static int test1()
     return 0;
 }
 
+/**
+ * test2    Write a chain of buffers with one gathered write
+ *
+ */
+static int test2()
+{
+    int fds[2];
+    SERV_LISTENER dummy;
+    MXB_AT_DEBUG(int rc = ) socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    mxb_assert(rc == 0);
+
+    fprintf(stderr, "testdcb : writing a chain of 100 buffers");
+    DCB* dcb = dcb_alloc(DCB_ROLE_INTERNAL, &dummy);
+    dcb->fd = fds[0];
+
+    GWBUF* chain = NULL;
+
+    for (int i = 0; i < 100; i++)
+    {
+        uint8_t byte = i;
+        chain = gwbuf_append(chain, gwbuf_alloc_and_load(1, &byte));
+    }
+
+    bool stop_writing = true;
+    int written = gw_write(dcb, chain, &stop_writing);
+    mxb_assert_message(written == 100, "All data should be written");
+    mxb_assert_message(!stop_writing, "A complete write should not stop writing");
+    mxb_assert_message(dcb->stats.n_writes == 1, "The chain should be written with one system call");
+    gwbuf_free(chain);
+
+    uint8_t data[100];
+    MXB_AT_DEBUG(ssize_t n = ) read(fds[1], data, sizeof(data));
+    mxb_assert(n == 100);
+
+    for (int i = 0; i < 100; i++)
+    {
+        mxb_assert_message(data[i] == i, "Data should be written in order");
+    }
+    fprintf(stderr, "\t..done\n");
+
+    fprintf(stderr, "testdcb : partial write of a chain of buffers");
+    fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+    const size_t bufsize = 64 * 1024;
+    size_t total = 0;
+    uint8_t* payload = (uint8_t*)MXS_CALLOC(bufsize, 1);
+    chain = NULL;
+
+    for (int i = 0; i < 256; i++)
+    {
+        chain = gwbuf_append(chain, gwbuf_alloc_and_load(bufsize, payload));
+        total += bufsize;
+    }
+
+    stop_writing = false;
+    written = gw_write(dcb, chain, &stop_writing);
+    mxb_assert_message(written > 0 && (size_t)written < total, "Only part of the data should be written");
+    mxb_assert_message(stop_writing, "A short write should stop writing");
+    chain = gwbuf_consume(chain, written);
+    mxb_assert_message(gwbuf_length(chain) == total - written, "Partially written data should be consumed");
+    gwbuf_free(chain);
+    MXS_FREE(payload);
+    fprintf(stderr, "\t..done\n");
+
+    close(fds[0]);
+    close(fds[1]);
+    dcb->fd = DCBFD_CLOSED;
+    dcb->state = DCB_STATE_POLLING;
+    this_thread.current_dcb = dcb;
+    dcb_close(dcb);
+
+    return 0;
+}
+
 int main(int argc, char** argv)
 {
     int result = 0;
@@ -76,6 +151,7 @@ int main(int argc, char** argv)
     init_test_env(NULL);
 
     result += test1();
+    result += test2();
 
     exit(result);
 }
@@ -35,6 +35,7 @@
 
 #include <maxscale/alloc.h>
 #include <maxscale/modutil.h>
+#include <maxscale/modutil.hh>
 #include <maxscale/buffer.h>
 
 /**
@@ -633,6 +634,54 @@ void test_bypass_whitespace()
     mxb_assert_message(*sql == 'S', "9");
 }
 
+void test_canonical()
+{
+    // Long enough for the vectorized scanning to be used
+    const char sql[] = "SELECT long_column_name_1, long_column_name_2 FROM long_table_name "
+                       "WHERE long_column_name_1 = 'some string value'   AND long_column_name_2 = -123.5e-3 "
+                       "/* comment */ AND `quoted identifier` = \"string\" # end-of-line comment";
+    const char expected[] = "SELECT long_column_name_1, long_column_name_2 FROM long_table_name "
+                            "WHERE long_column_name_1 = ? AND long_column_name_2 = ? AND `quoted identifier` = ?";
+
+    GWBUF* buffer = modutil_create_query(sql);
+    uint64_t digest = 0;
+    std::string canonical = mxs::get_canonical(buffer, &digest);
+    mxb_assert_message(canonical == expected, "Canonical form should be correct");
+    mxb_assert_message(digest == mxs::canonical_digest(canonical.c_str(), canonical.length()),
+                       "Digest should match the canonical form");
+    mxb_assert_message(mxs::get_canonical(sql, sizeof(sql) - 1) == canonical,
+                       "SQL string should have the same canonical form");
+
+    // Split the statement into two buffers
+    GWBUF* head = gwbuf_split(&buffer, 50);
+    buffer = gwbuf_append(head, buffer);
+    mxb_assert_message(buffer->next, "Buffer should be a chain");
+
+    uint64_t chain_digest = 0;
+    mxb_assert_message(mxs::get_canonical(buffer, &chain_digest) == canonical,
+                       "Chained buffer should have the same canonical form");
+    mxb_assert_message(chain_digest == digest, "Chained buffer should have the same digest");
+
+    uint64_t other_digest = 0;
+    mxs::get_canonical("SELECT 1", 8, &other_digest);
+    mxb_assert_message(other_digest != digest, "Different statements should have different digests");
+
+    gwbuf_free(buffer);
+
+    // Statements that end at a block boundary of the vectorized scanning
+    const char block[] = "abcdefghijklmnopabcdefghijklmnopabcdefghijklmnopabcdefghijklmnop";
+
+    for (size_t len = 16; len < sizeof(block); len += 16)
+    {
+        mxb_assert_message(mxs::get_canonical(block, len) == std::string(block, len),
+                           "Statement with only normal characters should not change");
+    }
+
+    const char block_end[] = "SELECT a FROM t1 WHERE b = 'c'";
+    mxb_assert_message(mxs::get_canonical(block_end, 16) == std::string(block_end, 16),
+                       "Statement that ends with a full block should not change");
+}
+
 int main(int argc, char** argv)
 {
     int result = 0;
@@ -647,5 +696,6 @@ int main(int argc, char** argv)
     test_strnchr_esc_mysql();
     test_large_packets();
     test_bypass_whitespace();
+    test_canonical();
     exit(result);
 }
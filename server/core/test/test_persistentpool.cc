@@ -0,0 +1,210 @@
+/*
+ * Copyright (c) 2018 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2022-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+#include "../internal/persistentpool.hh"
+
+#include <iostream>
+#include <maxscale/protocol/mysql.h>
+#include <maxscale/server.h>
+
+using namespace std;
+
+namespace
+{
+
+SERVER test_server = {};
+
+class Connection
+{
+public:
+    Connection(const char* zUser,
+               const char* zRemote,
+               const char* zProtocol = "MySQLBackend",
+               uint64_t capabilities = 0)
+        : m_dcb()
+    {
+        m_dcb.pool_capabilities = capabilities;
+        m_dcb.server = &test_server;
+        m_dcb.user = const_cast<char*>(zUser);
+        m_dcb.remote = const_cast<char*>(zRemote);
+        m_dcb.protoname = const_cast<char*>(zProtocol);
+        m_dcb.persistentstart = time(NULL);
+    }
+
+    DCB* dcb()
+    {
+        return &m_dcb;
+    }
+
+private:
+    DCB m_dcb;
+};
+
+int expect(bool condition, const char* zWhat)
+{
+    if (!condition)
+    {
+        cout << "error: " << zWhat << endl;
+    }
+
+    return condition ? 0 : 1;
+}
+
+int test_acquire()
+{
+    int rv = 0;
+    mxs::PersistentPool pool;
+    Connection alice("alice", "10.0.0.1");
+    Connection bob("bob", "10.0.0.2");
+    Connection other("alice", "10.0.0.1", "CDC");
+    bool exact = false;
+
+    pool.add(alice.dcb());
+    pool.add(bob.dcb());
+    pool.add(other.dcb());
+
+    DCB* dcb = pool.acquire("alice", "10.0.0.1", "MySQLBackend", 0, 300, &exact);
+    rv += expect(dcb == alice.dcb() && exact, "The connection of the same user was not found.");
+
+    dcb = pool.acquire("carol", "10.0.0.3", "MySQLBackend", 0, 300, &exact);
+    rv += expect(dcb == bob.dcb() && !exact, "The connection of another user was not reused.");
+
+    dcb = pool.acquire("carol", "10.0.0.3", "MySQLBackend", 0, 300, &exact);
+    rv += expect(dcb == NULL, "A connection of another protocol was handed out.");
+    rv += expect(pool.size() == 1, "The pool has the wrong number of connections.");
+
+    return rv;
+}
+
+int test_capabilities()
+{
+    int rv = 0;
+    mxs::PersistentPool pool;
+    Connection found_rows("alice", "10.0.0.1", "MySQLBackend", GW_MYSQL_CAPABILITIES_FOUND_ROWS);
+    Connection multi_results("bob", "10.0.0.2", "MySQLBackend", GW_MYSQL_CAPABILITIES_MULTI_RESULTS);
+    bool exact = false;
+
+    pool.add(found_rows.dcb());
+    pool.add(multi_results.dcb());
+
+    DCB* dcb = pool.acquire("alice", "10.0.0.1", "MySQLBackend",
+                             GW_MYSQL_CAPABILITIES_MULTI_RESULTS, 300, &exact);
+    rv += expect(dcb == multi_results.dcb() && !exact,
+                 "The connection with the same capabilities was not reused.");
+
+    dcb = pool.acquire("alice", "10.0.0.1", "MySQLBackend", 0, 300, &exact);
+    rv += expect(dcb == NULL, "A connection with other capabilities was handed out.");
+
+    dcb = pool.acquire("carol", "10.0.0.3", "MySQLBackend", GW_MYSQL_CAPABILITIES_FOUND_ROWS, 300, &exact);
+    rv += expect(dcb == found_rows.dcb() && !exact,
+                 "The connection with the same capabilities was not reused for another user.");
+
+    return rv;
+}
+
+int test_proxy_protocol()
+{
+    int rv = 0;
+    mxs::PersistentPool pool;
+    Connection alice("alice", "10.0.0.1");
+    Connection bob("bob", "10.0.0.2");
+    bool exact = false;
+
+    test_server.proxy_protocol = true;
+    pool.add(alice.dcb());
+    pool.add(bob.dcb());
+
+    DCB* dcb = pool.acquire("carol", "10.0.0.3", "MySQLBackend", 0, 300, &exact);
+    rv += expect(dcb == NULL,
+                 "A connection from another address was handed out with the proxy protocol.");
+
+    dcb = pool.acquire("carol", "10.0.0.1", "MySQLBackend", 0, 300, &exact);
+    rv += expect(dcb == alice.dcb() && !exact,
+                 "The connection from the same address was not reused for another user.");
+
+    test_server.proxy_protocol = false;
+
+    dcb = pool.acquire("carol", "10.0.0.3", "MySQLBackend", 0, 300, &exact);
+    rv += expect(dcb == bob.dcb() && !exact,
+                 "The connection from another address was not reused without the proxy protocol.");
+
+    return rv;
+}
+
+int test_unusable()
+{
+    int rv = 0;
+    mxs::PersistentPool pool;
+    Connection old("alice", "10.0.0.1");
+    Connection hung("alice", "10.0.0.1");
+    bool exact = false;
+
+    old.dcb()->persistentstart -= 100;
+    hung.dcb()->flags |= DCBF_HUNG;
+
+    pool.add(old.dcb());
+    pool.add(hung.dcb());
+
+    DCB* dcb = pool.acquire("alice", "10.0.0.1", "MySQLBackend", 0, 10, &exact);
+    rv += expect(dcb == NULL, "An unusable connection was handed out.");
+
+    vector<DCB*> removed = pool.evict(10, 10, false);
+    rv += expect(removed.size() == 2 && pool.size() == 0, "Unusable connections were not evicted.");
+
+    return rv;
+}
+
+int test_evict()
+{
+    int rv = 0;
+    mxs::PersistentPool pool;
+    Connection first("alice", "10.0.0.1");
+    Connection second("bob", "10.0.0.1");
+    Connection third("alice", "10.0.0.1");
+
+    pool.add(first.dcb());
+    pool.add(second.dcb());
+    pool.add(third.dcb());
+
+    vector<DCB*> removed = pool.evict(1, 300, false);
+    rv += expect(removed.size() == 2 && removed[0] == first.dcb() && removed[1] == second.dcb(),
+                 "The oldest connections were not evicted first.");
+
+    removed = pool.evict(1, 300, false);
+    rv += expect(removed.empty() && pool.size() == 1, "A connection was evicted needlessly.");
+
+    removed = pool.evict(1, 300, true);
+    rv += expect(removed.size() == 1 && pool.size() == 0, "Not all connections were evicted.");
+
+    bool exact = false;
+    rv += expect(pool.acquire("alice", "10.0.0.1", "MySQLBackend", 0, 300, &exact) == NULL,
+                 "An evicted connection was handed out.");
+
+    return rv;
+}
+}
+
+int main(int argc, char** argv)
+{
+    int rv = 0;
+
+    test_server.status = SERVER_RUNNING;
+
+    rv += test_acquire();
+    rv += test_capabilities();
+    rv += test_proxy_protocol();
+    rv += test_unusable();
+    rv += test_evict();
+
+    return rv == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,512 @@
+/*
+ * Copyright (c) 2018 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2022-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+/**
+ * Tests of the query classification caches
+ *
+ * In the concurrency test, several threads use their own QCInfoCache in front of
+ * one QCSharedCache. The digests of the statements are chosen so that they collide
+ * and the shared cache is small enough for the CLOCK eviction to run all the time.
+ * Build with -DWITH_TSAN=Y to have ThreadSanitizer check the locking.
+ *
+ * In the persistence test, the statements of the shared cache are saved and the
+ * cache is warmed up from the saved canonical statements.
+ *
+ * The classifier is a fake one that counts the references of the classification
+ * results, so that a result that is closed too many or too few times is detected.
+ */
+
+#ifndef SS_DEBUG
+#define SS_DEBUG
+#endif
+
+#include <iostream>
+#include <sys/stat.h>
+#include <maxscale/paths.h>
+#include "../query_classifier.cc"
+
+using namespace std;
+
+namespace
+{
+
+const int N_THREADS = 4;
+const int N_ROUNDS = 20000;
+
+// More statements than QCInfoCache keeps, two of them per digest
+const int N_STATEMENTS = 3000;
+
+// Enough for some 20 statements per shard of the shared cache
+const int64_t CACHE_SIZE = 16 * 20 * 20;
+
+std::atomic<int> errors {0};
+
+struct FakeInfo : public QC_STMT_INFO
+{
+    FakeInfo(const std::string& sql)
+        : refs(1)
+        , sql(sql)
+    {
+    }
+
+    std::atomic<int> refs;
+    std::string      sql;   // The statement the result is for.
+};
+
+QC_STMT_INFO* fake_info_dup(QC_STMT_INFO* pInfo)
+{
+    FakeInfo* pFake = static_cast<FakeInfo*>(pInfo);
+
+    if (++pFake->refs <= 1)
+    {
+        cout << "error: A closed result was used: " << pFake->sql << endl;
+        ++errors;
+    }
+
+    return pInfo;
+}
+
+void fake_info_close(QC_STMT_INFO* pInfo)
+{
+    FakeInfo* pFake = static_cast<FakeInfo*>(pInfo);
+
+    if (--pFake->refs < 0)
+    {
+        cout << "error: A result was closed too many times: " << pFake->sql << endl;
+        ++errors;
+    }
+}
+
+void fake_get_server_version(uint64_t* pVersion)
+{
+    *pVersion = 0;
+}
+
+void fake_set_server_version(uint64_t version)
+{
+}
+
+int32_t fake_thread_init()
+{
+    return 0;
+}
+
+void fake_thread_end()
+{
+}
+
+// The statements parsed by fake_parse().
+std::mutex parsed_lock;
+std::vector<FakeInfo*> parsed;
+
+// Statements that contain "partial" are parsed only partially.
+int32_t fake_parse(GWBUF* pStmt, uint32_t collect, int32_t* pResult)
+{
+    std::string sql = mxs::extract_sql(pStmt);
+
+    if (!gwbuf_get_buffer_object_data(pStmt, GWBUF_PARSING_INFO))
+    {
+        FakeInfo* pFake = new FakeInfo(sql);
+        gwbuf_add_buffer_object(pStmt, GWBUF_PARSING_INFO, pFake, info_object_close);
+
+        std::lock_guard<std::mutex> guard(parsed_lock);
+        parsed.push_back(pFake);
+    }
+
+    *pResult = sql.find("partial") == std::string::npos ? QC_QUERY_PARSED : QC_QUERY_PARTIALLY_PARSED;
+
+    return QC_RESULT_OK;
+}
+
+int32_t fake_get_preparable_stmt(GWBUF* pStmt, GWBUF** ppPreparable_stmt)
+{
+    *ppPreparable_stmt = nullptr;
+    return QC_RESULT_OK;
+}
+
+// Like that of the real classifiers, the type of "SET autocommit" depends on the value.
+int32_t fake_get_type_mask(GWBUF* pStmt, uint32_t* pType_mask)
+{
+    std::string sql = mxs::extract_sql(pStmt);
+
+    if (sql == "SET autocommit=1")
+    {
+        *pType_mask = QUERY_TYPE_ENABLE_AUTOCOMMIT | QUERY_TYPE_COMMIT;
+    }
+    else if (sql == "SET autocommit=0")
+    {
+        *pType_mask = QUERY_TYPE_DISABLE_AUTOCOMMIT | QUERY_TYPE_BEGIN_TRX;
+    }
+    else
+    {
+        *pType_mask = QUERY_TYPE_READ;
+    }
+
+    return QC_RESULT_OK;
+}
+
+int32_t fake_get_operation(GWBUF* pStmt, int32_t* pOp)
+{
+    *pOp = QUERY_OP_SELECT;
+    return QC_RESULT_OK;
+}
+
+int32_t fake_get_table_names(GWBUF* pStmt, int32_t full_names, char*** pppNames, int32_t* pN_names)
+{
+    *pppNames = nullptr;
+    *pN_names = 0;
+    return QC_RESULT_OK;
+}
+
+int32_t fake_get_field_info(GWBUF* pStmt, const QC_FIELD_INFO** ppInfos, uint32_t* pN_infos)
+{
+    *ppInfos = nullptr;
+    *pN_infos = 0;
+    return QC_RESULT_OK;
+}
+
+void init_classifier(QUERY_CLASSIFIER* pClassifier)
+{
+    memset(pClassifier, 0, sizeof(*pClassifier));
+    pClassifier->qc_info_dup = fake_info_dup;
+    pClassifier->qc_info_close = fake_info_close;
+    pClassifier->qc_get_server_version = fake_get_server_version;
+    pClassifier->qc_set_server_version = fake_set_server_version;
+    pClassifier->qc_thread_init = fake_thread_init;
+    pClassifier->qc_thread_end = fake_thread_end;
+    pClassifier->qc_parse = fake_parse;
+    pClassifier->qc_get_preparable_stmt = fake_get_preparable_stmt;
+    pClassifier->qc_get_type_mask = fake_get_type_mask;
+    pClassifier->qc_get_operation = fake_get_operation;
+    pClassifier->qc_get_table_names = fake_get_table_names;
+    pClassifier->qc_get_field_info = fake_get_field_info;
+}
+
+int check_references(std::vector<FakeInfo*>& results)
+{
+    int rv = 0;
+
+    for (FakeInfo* pFake : results)
+    {
+        if (pFake->refs != 0)
+        {
+            cout << "error: " << pFake->refs << " references left to '"
+                 << pFake->sql << "'" << endl;
+            ++rv;
+        }
+
+        delete pFake;
+    }
+
+    results.clear();
+
+    return rv;
+}
+
+std::string canonical_of(int n)
+{
+    return "SELECT * FROM t" + std::to_string(n) + " WHERE a = ?";
+}
+
+uint64_t digest_of(int n)
+{
+    // Forces two statements to share each digest
+    return n / 2;
+}
+
+void run(int id, std::vector<FakeInfo*>* pResults)
+{
+    this_thread.pInfo_cache = new QCInfoCache;
+    uint64_t state = id + 1;
+
+    for (int i = 0; i < N_ROUNDS; i++)
+    {
+        // A skewed distribution, so that some statements stay in the caches
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        int n = (state >> 33) % N_STATEMENTS;
+
+        if (n % 4 == 0)
+        {
+            n %= 64;
+        }
+
+        std::string canonical = canonical_of(n);
+        uint64_t digest = digest_of(n);
+        QC_STMT_INFO* pInfo = this_thread.pInfo_cache->get(digest, canonical);
+
+        if (pInfo)
+        {
+            if (static_cast<FakeInfo*>(pInfo)->sql != canonical)
+            {
+                cout << "error: Got the result of '" << static_cast<FakeInfo*>(pInfo)->sql
+                     << "' for '" << canonical << "'" << endl;
+                ++errors;
+            }
+
+            this_unit.classifier->qc_info_close(pInfo);
+        }
+        else
+        {
+            FakeInfo* pFake = new FakeInfo(canonical);
+            pResults->push_back(pFake);
+            this_thread.pInfo_cache->insert(digest, canonical, pFake, true);
+            this_unit.classifier->qc_info_close(pFake);
+        }
+
+        if (i % 1000 == 0)
+        {
+            QC_CACHE_STATS stats;
+            this_unit.pShared_cache->get_stats(&stats);
+            this_unit.pShared_cache->get_hottest(10);
+        }
+    }
+
+    delete this_thread.pInfo_cache;
+    this_thread.pInfo_cache = nullptr;
+}
+
+int test_concurrency()
+{
+    QUERY_CLASSIFIER classifier;
+    init_classifier(&classifier);
+
+    this_unit.classifier = &classifier;
+    this_unit.set_cache_max_size(CACHE_SIZE);
+    this_unit.pShared_cache = new QCSharedCache;
+
+    std::vector<FakeInfo*> results[N_THREADS];
+    std::vector<std::thread> threads;
+
+    for (int i = 0; i < N_THREADS; i++)
+    {
+        threads.emplace_back(run, i, &results[i]);
+    }
+
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+
+    QC_CACHE_STATS stats;
+    this_unit.pShared_cache->get_stats(&stats);
+
+    if (stats.evictions == 0)
+    {
+        cout << "error: The shared cache should have evicted statements" << endl;
+        ++errors;
+    }
+
+    if (stats.size > CACHE_SIZE)
+    {
+        cout << "error: The shared cache is larger than its maximum size" << endl;
+        ++errors;
+    }
+
+    delete this_unit.pShared_cache;
+    this_unit.pShared_cache = nullptr;
+    this_unit.classifier = nullptr;
+
+    for (auto& v : results)
+    {
+        errors += check_references(v);
+    }
+
+    return errors;
+}
+
+GWBUF* create_stmt(const char* zSql, bool prepare)
+{
+    GWBUF* pStmt = modutil_create_query(zSql);
+
+    if (prepare)
+    {
+        GWBUF_DATA(pStmt)[4] = 0x16;    // COM_STMT_PREPARE
+    }
+
+    return pStmt;
+}
+
+void classify(const char* zSql, bool prepare = false)
+{
+    GWBUF* pStmt = create_stmt(zSql, prepare);
+    qc_parse(pStmt, QC_COLLECT_ALL);
+    gwbuf_free(pStmt);
+}
+
+bool is_cached(const char* zSql, bool prepare = false)
+{
+    GWBUF* pStmt = create_stmt(zSql, prepare);
+    uint64_t digest;
+    std::string canonical = get_cache_key(pStmt, &digest);
+    gwbuf_free(pStmt);
+
+    return this_unit.pShared_cache->contains(digest, canonical);
+}
+
+void expect(bool value, const char* zWhat)
+{
+    if (!value)
+    {
+        cout << "error: " << zWhat << endl;
+        ++errors;
+    }
+}
+
+bool wait_until_finished(QCCacheWarmup& warmup)
+{
+    bool finished = false;
+
+    for (int i = 0; i < 1000 && !finished; i++)
+    {
+        json_t* pJson = warmup.to_json();
+        finished = strcmp(json_string_value(json_object_get(pJson, "state")), "finished") == 0;
+        json_decref(pJson);
+
+        if (!finished)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+
+    return finished;
+}
+
+int test_persistence()
+{
+    QUERY_CLASSIFIER classifier;
+    init_classifier(&classifier);
+
+    this_unit.classifier = &classifier;
+    this_unit.set_cache_max_size(std::numeric_limits<int64_t>::max());
+    this_unit.pShared_cache = new QCSharedCache;
+    this_thread.pInfo_cache = new QCInfoCache;
+
+    classify("SELECT a FROM t WHERE b = 1");
+    classify("SELECT c FROM t WHERE d = 'secret'", true);
+    classify("SELECT partial FROM t WHERE b = 1");
+    classify("SET autocommit=1");
+
+    std::string path = std::string(get_cachedir()) + "/qc_cache.json";
+
+    {
+        QCCacheWarmup warmup;
+        expect(warmup.save(), "The statements should be saved");
+    }
+
+    struct stat st;
+    expect(stat(path.c_str(), &st) == 0 && (st.st_mode & 0777) == 0600,
+           "Only the owner should be able to read the saved statements");
+
+    json_error_t err;
+    json_t* pJson = json_load_file(path.c_str(), 0, &err);
+    json_t* pStatements = json_object_get(pJson, "statements");
+    expect(json_array_size(pStatements) == 4, "All statements should be saved");
+
+    char* zSaved = json_dumps(pJson, 0);
+    expect(zSaved && !strstr(zSaved, "secret"), "No literals should be saved");
+    MXS_FREE(zSaved);
+
+    bool found = false;
+    size_t i;
+    json_t* pStmt;
+
+    json_array_foreach(pStatements, i, pStmt)
+    {
+        if (strcmp(json_string_value(json_object_get(pStmt, "statement")), "SELECT c FROM t WHERE d = ?:P") == 0)
+        {
+            found = true;
+        }
+    }
+
+    expect(found, "The canonical statement should be saved");
+
+    // A statement that is not canonical, e.g. because the canonicalization has changed
+    // since the statements were saved, is not used.
+    pStmt = json_object();
+    json_object_set_new(pStmt, "statement", json_string("SELECT e FROM t WHERE f = 'x'"));
+    json_object_set_new(pStmt, "sql_mode", json_string("DEFAULT"));
+    json_object_set_new(pStmt, "server_version", json_integer(0));
+    json_object_set_new(pStmt, "hits", json_integer(0));
+    json_array_append_new(pStatements, pStmt);
+    json_dump_file(pJson, path.c_str(), JSON_COMPACT);
+    json_decref(pJson);
+
+    // Start from empty caches, as after a restart.
+    delete this_thread.pInfo_cache;
+    delete this_unit.pShared_cache;
+    this_unit.pShared_cache = new QCSharedCache;
+    this_thread.pInfo_cache = new QCInfoCache;
+
+    {
+        QCCacheWarmup warmup;
+        expect(warmup.start(), "The warm-up should be started");
+
+        expect(wait_until_finished(warmup), "The warm-up should finish");
+
+        pJson = warmup.to_json();
+        expect(json_integer_value(json_object_get(pJson, "processed")) == 5, "All statements should be processed");
+        expect(json_integer_value(json_object_get(pJson, "classified")) == 2,
+               "Only the completely and unambiguously parsed statements should be classified");
+        json_decref(pJson);
+    }
+
+    expect(is_cached("SELECT a FROM t WHERE b = 2"), "The statement should be in the cache");
+    expect(is_cached("SELECT c FROM t WHERE d = 'y'", true), "The prepared statement should be in the cache");
+    expect(!is_cached("SELECT c FROM t WHERE d = 'y'"), "The statement should be in the cache only as prepared");
+    expect(!is_cached("SELECT partial FROM t WHERE b = 2"),
+           "A partially parsed statement should not be in the cache");
+    expect(!is_cached("SET autocommit=0"),
+           "A statement whose classification depends on the literals should not be in the cache");
+    expect(!is_cached("SELECT e FROM t WHERE f = 2"), "A statement that is not canonical should not be in the cache");
+
+    // The placeholders should be replaced before the statements are parsed.
+    for (FakeInfo* pFake : parsed)
+    {
+        expect(pFake->sql.find('?') == std::string::npos, "A canonical statement was parsed");
+    }
+
+    delete this_thread.pInfo_cache;
+    this_thread.pInfo_cache = nullptr;
+    delete this_unit.pShared_cache;
+    this_unit.pShared_cache = nullptr;
+    this_unit.classifier = nullptr;
+
+    remove(path.c_str());
+    errors += check_references(parsed);
+
+    return errors;
+}
+}
+
+int main(int argc, char** argv)
+{
+    int rv = 0;
+
+    if (mxs_log_init(NULL, ".", MXS_LOG_TARGET_STDOUT))
+    {
+        set_cachedir(MXS_STRDUP_A("."));
+        config_get_global_options()->n_threads = 2;
+
+        test_concurrency();
+        test_persistence();
+
+        rv = errors == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+        mxs_log_finish();
+    }
+    else
+    {
+        rv = EXIT_FAILURE;
+    }
+
+    return rv;
+}
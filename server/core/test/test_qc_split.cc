@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2018 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2022-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+/**
+ * The statements that a client sends in one read are split off from the same
+ * buffer. Each of them must be classified on its own.
+ */
+
+#include <maxscale/ccdefs.hh>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <maxscale/alloc.h>
+#include <maxscale/modutil.h>
+#include <maxscale/paths.h>
+#include <maxscale/protocol/mysql.h>
+#include "../core/internal/query_classifier.hh"
+
+using namespace std;
+
+namespace
+{
+
+struct Statement
+{
+    const char* zStmt;
+    uint32_t    type_mask;
+};
+
+const Statement statements[] =
+{
+    {"SELECT a FROM t",          QUERY_TYPE_READ         },
+    {"UPDATE t SET a = 1",       QUERY_TYPE_WRITE        },
+    {"SELECT b FROM t",          QUERY_TYPE_READ         },
+    {"SET @x = 1",               QUERY_TYPE_USERVAR_WRITE},
+    {"INSERT INTO t VALUES (1)", QUERY_TYPE_WRITE        },
+};
+
+const int N_STATEMENTS = sizeof(statements) / sizeof(statements[0]);
+
+/**
+ * Create one buffer that contains all statements, as if they were read at once
+ */
+GWBUF* create_read()
+{
+    std::vector<uint8_t> data;
+
+    for (const Statement& s : statements)
+    {
+        size_t payload_len = strlen(s.zStmt) + 1;
+        data.push_back(payload_len);
+        data.push_back(payload_len >> 8);
+        data.push_back(payload_len >> 16);
+        data.push_back(0);
+        data.push_back(MXS_COM_QUERY);
+        data.insert(data.end(), s.zStmt, s.zStmt + payload_len - 1);
+    }
+
+    return gwbuf_alloc_and_load(data.size(), data.data());
+}
+
+int test(bool classify_all_first)
+{
+    int rv = 0;
+    GWBUF* pRead = create_read();
+    GWBUF* pStmts[N_STATEMENTS];
+
+    for (int i = 0; i < N_STATEMENTS; ++i)
+    {
+        pStmts[i] = modutil_get_next_MySQL_packet(&pRead);
+        mxb_assert(pStmts[i]);
+
+        if (!classify_all_first)
+        {
+            // Classify each statement as soon as it has been split off, while the
+            // rest of the read still refers to the same data.
+            qc_get_type_mask(pStmts[i]);
+        }
+    }
+
+    mxb_assert(pRead == NULL);
+
+    for (int i = 0; i < N_STATEMENTS; ++i)
+    {
+        uint32_t type_mask = qc_get_type_mask(pStmts[i]);
+
+        if (type_mask != statements[i].type_mask)
+        {
+            char* zType_mask = qc_typemask_to_string(type_mask);
+            char* zExpected = qc_typemask_to_string(statements[i].type_mask);
+            cout << "error: \"" << statements[i].zStmt << "\" was classified as "
+                 << zType_mask << ", expected " << zExpected << "." << endl;
+            MXS_FREE(zType_mask);
+            MXS_FREE(zExpected);
+            ++rv;
+        }
+
+        gwbuf_free(pStmts[i]);
+    }
+
+    return rv;
+}
+}
+
+int main(int argc, char* argv[])
+{
+    int rc = EXIT_FAILURE;
+
+    set_datadir(strdup("/tmp"));
+    set_langdir(strdup("."));
+    set_process_datadir(strdup("/tmp"));
+
+    if (mxs_log_init(NULL, ".", MXS_LOG_TARGET_DEFAULT))
+    {
+        set_libdir(strdup("../../../query_classifier/qc_sqlite"));
+
+        if (qc_init(NULL, QC_SQL_MODE_DEFAULT, "qc_sqlite", NULL))
+        {
+            int errors = 0;
+
+            errors += test(false);
+            errors += test(true);
+
+            rc = errors == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+
+            qc_end();
+        }
+        else
+        {
+            cerr << "error: Could not initialize qc_sqlite." << endl;
+        }
+
+        mxs_log_finish();
+    }
+    else
+    {
+        cerr << "error: Could not initialize log." << endl;
+    }
+
+    return rc;
+}
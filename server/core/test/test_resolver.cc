@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2018 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2022-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+#include <maxscale/resolver.hh>
+
+#include <atomic>
+#include <iostream>
+
+#include <maxbase/semaphore.hh>
+
+using namespace std;
+
+namespace
+{
+
+atomic<int> n_lookups(0);
+
+/** Stand-in for DNS: addresses starting with 10. have a hostname, others don't */
+bool local_lookup(const string& address, string* hostname)
+{
+    ++n_lookups;
+
+    if (address.compare(0, 3, "10.") == 0)
+    {
+        *hostname = "host-" + address;
+        return true;
+    }
+
+    return false;
+}
+
+int expect(bool condition, const char* zWhat)
+{
+    if (!condition)
+    {
+        cout << "error: " << zWhat << endl;
+    }
+
+    return condition ? 0 : 1;
+}
+
+void resolve(const string& address)
+{
+    mxb::Semaphore sem;
+    mxs::resolve_hostname(address, [&sem]() {
+                              sem.post();
+                          });
+    sem.wait();
+}
+
+int test_found()
+{
+    int rv = 0;
+    string hostname;
+
+    rv += expect(!mxs::cached_hostname("10.0.0.1", &hostname), "Address should not be cached");
+
+    resolve("10.0.0.1");
+    rv += expect(mxs::cached_hostname("10.0.0.1", &hostname), "Address should be cached");
+    rv += expect(hostname == "host-10.0.0.1", "Wrong hostname");
+
+    return rv;
+}
+
+int test_not_found()
+{
+    int rv = 0;
+    string hostname = "garbage";
+
+    resolve("192.168.0.1");
+    rv += expect(mxs::cached_hostname("192.168.0.1", &hostname), "Failed lookup should be cached");
+    rv += expect(hostname.empty(), "Failed lookup should have no hostname");
+
+    return rv;
+}
+
+int test_merged_lookups()
+{
+    int rv = 0;
+    mxb::Semaphore sem_lookup;
+    mxb::Semaphore sem_done;
+    int start = n_lookups;
+
+    mxs::set_reverse_lookup([&sem_lookup](const string& address, string* hostname) {
+                                // Block until both lookups have been requested
+                                sem_lookup.wait();
+                                return local_lookup(address, hostname);
+                            });
+
+    for (int i = 0; i < 2; i++)
+    {
+        mxs::resolve_hostname("10.0.0.2", [&sem_done]() {
+                                  sem_done.post();
+                              });
+    }
+
+    sem_lookup.post();
+    sem_done.wait();
+    sem_done.wait();
+
+    rv += expect(n_lookups - start == 1, "Concurrent lookups should be done only once");
+
+    mxs::set_reverse_lookup(local_lookup);
+    return rv;
+}
+
+int test_ttl()
+{
+    int rv = 0;
+    string hostname;
+
+    mxs::set_hostname_cache_ttl(std::chrono::seconds(0), std::chrono::seconds(0));
+    resolve("10.0.0.3");
+    resolve("192.168.0.3");
+    rv += expect(!mxs::cached_hostname("10.0.0.3", &hostname), "Entry should have expired");
+    rv += expect(!mxs::cached_hostname("192.168.0.3", &hostname), "Negative entry should have expired");
+
+    mxs::set_hostname_cache_ttl(std::chrono::seconds(300), std::chrono::seconds(60));
+    return rv;
+}
+}
+
+int main(int argc, char** argv)
+{
+    int rv = 0;
+
+    mxs::set_reverse_lookup(local_lookup);
+
+    rv += test_found();
+    rv += test_not_found();
+    rv += test_merged_lookups();
+    rv += test_ttl();
+
+    return rv;
+}
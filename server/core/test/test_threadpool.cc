@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2018 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2022-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+#include <maxscale/threadpool.hh>
+
+#include <atomic>
+#include <iostream>
+#include <thread>
+
+#include <maxbase/semaphore.hh>
+
+using namespace std;
+
+namespace
+{
+
+int expect(bool condition, const char* zWhat)
+{
+    if (!condition)
+    {
+        cout << "error: " << zWhat << endl;
+    }
+
+    return condition ? 0 : 1;
+}
+
+int test_execute()
+{
+    int rv = 0;
+    const int N_TASKS = 100;
+    mxs::ThreadPool pool(4);
+    mxb::Semaphore sem;
+    atomic<int> n_done(0);
+
+    for (int i = 0; i < N_TASKS; i++)
+    {
+        rv += expect(pool.execute([&]() {
+                                      // Not called from a worker, the callback is called directly
+                                      mxs::ThreadPool::post(nullptr, [&]() {
+                                                                ++n_done;
+                                                                sem.post();
+                                                            });
+                                  }),
+                     "A task should be queued");
+    }
+
+    sem.wait_n(N_TASKS);
+    rv += expect(n_done == N_TASKS, "All tasks should be executed");
+
+    return rv;
+}
+
+int test_stop()
+{
+    int rv = 0;
+    mxb::Semaphore started;
+    mxb::Semaphore blocked;
+    atomic<bool> completed(false);
+    atomic<bool> discarded(true);
+
+    mxs::ThreadPool pool(1);
+    pool.execute([&]() {
+                     started.post();
+                     blocked.wait();
+                     completed = true;
+                 });
+    pool.execute([&]() {
+                     discarded = false;
+                 });
+
+    started.wait();
+    thread stopper([&]() {
+                       pool.stop();
+                   });
+
+    // Once the pool accepts no more tasks, the queued ones have been discarded
+    while (pool.execute([]() {
+                        }))
+    {
+        this_thread::yield();
+    }
+
+    blocked.post();
+    stopper.join();
+
+    rv += expect(completed, "The task in progress should be completed");
+    rv += expect(discarded, "The queued tasks should be discarded");
+
+    return rv;
+}
+
+int test_stop_all()
+{
+    int rv = 0;
+    mxs::ThreadPool before(1);
+    mxb::Semaphore sem;
+
+    rv += expect(before.execute([&]() {
+                                    sem.post();
+                                }),
+                 "A task should be queued before stop_all()");
+    sem.wait();
+
+    mxs::ThreadPool::stop_all();
+    mxs::ThreadPool after(1);
+
+    rv += expect(!before.execute([]() {
+                                 }),
+                 "A pool should be stopped by stop_all()");
+    rv += expect(!after.execute([]() {
+                                }),
+                 "A pool created after stop_all() should be stopped");
+
+    return rv;
+}
+}
+
+int main(int argc, char** argv)
+{
+    int rv = 0;
+
+    rv += test_execute();
+    rv += test_stop();
+    rv += test_stop_all();
+
+    return rv == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
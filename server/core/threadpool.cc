@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2018 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2022-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+#include <maxscale/threadpool.hh>
+
+#include <unordered_set>
+
+namespace
+{
+
+struct
+{
+    std::mutex                                lock;
+    std::unordered_set<maxscale::ThreadPool*> pools;
+    bool                                      stopped = false;  /**< Whether stop_all() has been called */
+} this_unit;
+}
+
+namespace maxscale
+{
+
+ThreadPool::ThreadPool(int n_threads)
+    : m_n_threads(n_threads)
+{
+    mxb_assert(n_threads > 0);
+    std::lock_guard<std::mutex> guard(this_unit.lock);
+    this_unit.pools.insert(this);
+    m_stop = this_unit.stopped;
+}
+
+ThreadPool::~ThreadPool()
+{
+    std::unique_lock<std::mutex> guard(this_unit.lock);
+    this_unit.pools.erase(this);
+    guard.unlock();
+
+    stop();
+}
+
+bool ThreadPool::execute(Task task)
+{
+    std::lock_guard<std::mutex> guard(m_lock);
+
+    if (m_stop)
+    {
+        return false;
+    }
+
+    m_tasks.push_back(std::move(task));
+    m_cond.notify_one();
+
+    if (m_threads.empty())
+    {
+        for (int i = 0; i < m_n_threads; i++)
+        {
+            m_threads.emplace_back(&ThreadPool::run, this);
+        }
+    }
+
+    return true;
+}
+
+void ThreadPool::stop()
+{
+    std::unique_lock<std::mutex> guard(m_lock);
+    m_stop = true;
+    m_tasks.clear();
+    std::vector<std::thread> threads = std::move(m_threads);
+    m_threads.clear();
+    guard.unlock();
+    m_cond.notify_all();
+
+    for (auto& thr : threads)
+    {
+        thr.join();
+    }
+}
+
+// static
+void ThreadPool::post(mxb::Worker* pWorker, Task callback)
+{
+    if (pWorker)
+    {
+        pWorker->execute(std::move(callback), mxb::Worker::EXECUTE_QUEUED);
+    }
+    else
+    {
+        callback();
+    }
+}
+
+// static
+void ThreadPool::stop_all()
+{
+    std::lock_guard<std::mutex> guard(this_unit.lock);
+    this_unit.stopped = true;
+
+    for (ThreadPool* pPool : this_unit.pools)
+    {
+        pPool->stop();
+    }
+}
+
+void ThreadPool::run()
+{
+    std::unique_lock<std::mutex> guard(m_lock);
+
+    while (true)
+    {
+        m_cond.wait(guard, [this]() {
+                        return m_stop || !m_tasks.empty();
+                    });
+
+        if (m_stop)
+        {
+            break;
+        }
+
+        Task task = std::move(m_tasks.front());
+        m_tasks.pop_front();
+        guard.unlock();
+
+        task();
+
+        guard.lock();
+    }
+}
+}
@@ -1001,11 +1001,12 @@ bool configure_network_socket(int so, int type)
     return setnonblocking(so) == 0;
 }
 
-static bool configure_listener_socket(int so)
+static bool configure_listener_socket(int so, bool reuseport)
 {
     int one = 1;
 
     if (setsockopt(so, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) != 0
+        || (reuseport && setsockopt(so, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) != 0)
         || setsockopt(so, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)) != 0)
     {
         MXS_ERROR("Failed to set socket option: %d, %s.", errno, mxs_strerror(errno));
@@ -1039,7 +1040,9 @@ int open_network_socket(enum mxs_socket_type type,
                         const char* host,
                         uint16_t port)
 {
-    mxb_assert(type == MXS_SOCKET_NETWORK || type == MXS_SOCKET_LISTENER);
+    mxb_assert(type == MXS_SOCKET_NETWORK || type == MXS_SOCKET_LISTENER
+               || type == MXS_SOCKET_LISTENER_REUSEPORT);
+    bool listener = type != MXS_SOCKET_NETWORK;
     struct addrinfo* ai = NULL, hint = {};
     int so = 0, rc = 0;
     hint.ai_socktype = SOCK_STREAM;
@@ -1065,12 +1068,12 @@ int open_network_socket(enum mxs_socket_type type,
             set_port(addr, port);
 
             if ((type == MXS_SOCKET_NETWORK && !configure_network_socket(so, addr->ss_family))
-                || (type == MXS_SOCKET_LISTENER && !configure_listener_socket(so)))
+                || (listener && !configure_listener_socket(so, type == MXS_SOCKET_LISTENER_REUSEPORT)))
             {
                 close(so);
                 so = -1;
             }
-            else if (type == MXS_SOCKET_LISTENER && bind(so, (struct sockaddr*)addr, sizeof(*addr)) < 0)
+            else if (listener && bind(so, (struct sockaddr*)addr, sizeof(*addr)) < 0)
             {
                 MXS_ERROR("Failed to bind on '%s:%u': %d, %s",
                           host,
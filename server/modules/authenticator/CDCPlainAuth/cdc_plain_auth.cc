@@ -275,7 +275,7 @@ static int cdc_auth_authenticate(DCB* dcb)
         /* on successful authentication, set user into dcb field */
         if (CDC_STATE_AUTH_OK == auth_ret)
         {
-            dcb->user = MXS_STRDUP_A(client_data->user);
+            dcb_set_user(dcb, client_data->user);
         }
         else if (dcb->service->log_auth_warnings)
         {
@@ -18,9 +18,15 @@
 #include "mysql_auth.h"
 
 #include <ctype.h>
-#include <netdb.h>
 #include <stdio.h>
 
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
 #include <maxscale/alloc.h>
 #include <maxscale/dcb.h>
 #include <maxscale/log.h>
@@ -29,7 +35,9 @@
 #include <maxscale/paths.h>
 #include <maxscale/protocol/mysql.h>
 #include <maxscale/pcre2.h>
+#include <maxscale/resolver.hh>
 #include <maxscale/router.h>
+#include <maxscale/routingworker.h>
 #include <maxscale/secrets.h>
 #include <maxscale/service.h>
 #include <maxscale/users.h>
@@ -128,11 +136,10 @@ const char* mariadb_users_query
         // We only care about users that have a default role assigned
         "WHERE t.default_role = u.user %s;";
 
-static int    get_users(SERV_LISTENER* listener, bool skip_local);
+static int    get_users(SERV_LISTENER* listener, UserIndex* index, bool skip_local);
 static MYSQL* gw_mysql_init(void);
 static int    gw_mysql_set_timeouts(MYSQL* handle);
 static char*  mysql_format_user_entry(void* data);
-static bool   get_hostname(DCB* dcb, char* client_hostname, size_t size);
 
 static char* get_mariadb_102_users_query(bool include_root)
 {
@@ -184,9 +191,9 @@ static char* get_users_query(const char* server_version, int version, bool inclu
     return rval;
 }
 
-int replace_mysql_users(SERV_LISTENER* listener, bool skip_local)
+int replace_mysql_users(SERV_LISTENER* listener, UserIndex* users, bool skip_local)
 {
-    int i = get_users(listener, skip_local);
+    int i = get_users(listener, users, skip_local);
     return i;
 }
 
@@ -242,151 +249,63 @@ static bool check_password(const char* output,
     return memcmp(final_step, stored_token, stored_token_len) == 0;
 }
 
-/** Callback for check_database() */
-static int database_cb(void* data, int columns, char** rows, char** row_names)
-{
-    bool* rval = (bool*)data;
-    *rval = true;
-    return 0;
-}
-
-static bool check_database(MYSQL_AUTH* instance, sqlite3* handle, const char* database)
-{
-    bool rval = true;
-
-    if (*database)
-    {
-        rval = false;
-        const char* query = instance->lower_case_table_names ?
-            mysqlauth_validate_database_query_lower :
-            mysqlauth_validate_database_query;
-        size_t len = strlen(query) + strlen(database) + 1;
-        char sql[len];
-
-        sprintf(sql, query, database);
-
-        char* err;
-
-        if (sqlite3_exec(handle, sql, database_cb, &rval, &err) != SQLITE_OK)
-        {
-            MXS_ERROR("Failed to execute auth query: %s", err);
-            sqlite3_free(err);
-            rval = false;
-        }
-    }
-
-    return rval;
-}
-
 static bool no_password_required(const char* result, size_t tok_len)
 {
     return *result == '\0' && tok_len == 0;
 }
 
-/** Used to detect empty result sets */
-struct user_query_result
-{
-    bool ok;
-    char output[SHA_DIGEST_LENGTH * 2 + 1];
-};
-
-/** @brief Callback for sqlite3_exec() */
-static int auth_cb(void* data, int columns, char** rows, char** row_names)
-{
-    struct user_query_result* res = (struct user_query_result*)data;
-    strcpy(res->output, rows[0] ? rows[0] : "");
-    res->ok = true;
-    return 0;
-}
-
 int validate_mysql_user(MYSQL_AUTH* instance,
                         DCB* dcb,
                         MYSQL_session* session,
                         uint8_t* scramble,
                         size_t   scramble_len)
 {
-    sqlite3* handle = get_handle(instance);
-    const char* validate_query = instance->lower_case_table_names ?
-        mysqlauth_validate_user_query_lower :
-        mysqlauth_validate_user_query;
-    size_t len = strlen(validate_query) + 1 + strlen(session->user) * 2
-        + strlen(session->db) * 2 + MYSQL_HOST_MAXLEN + session->auth_token_len * 4 + 1;
-    char sql[len + 1];
+    const UserIndex* users = instance->users.get(mxs_rworker_get_current_id());
+    const UserIndex::Account* account = NULL;
     int rval = MXS_AUTH_FAILED;
-    char* err;
 
     if (instance->skip_auth)
     {
-        sprintf(sql, mysqlauth_skip_auth_query, session->user, session->db, session->db);
+        account = users->find(session->user, NULL, session->db);
     }
     else
     {
-        sprintf(sql,
-                validate_query,
-                session->user,
-                dcb->remote,
-                dcb->remote,
-                session->db,
-                session->db);
-    }
-
-    struct user_query_result res = {};
-
-    if (sqlite3_exec(handle, sql, auth_cb, &res, &err) != SQLITE_OK)
-    {
-        MXS_ERROR("Failed to execute auth query: %s", err);
-        sqlite3_free(err);
-    }
+        account = users->find(session->user, dcb->remote, session->db);
 
-    /** Check for IPv6 mapped IPv4 address */
-    if (!res.ok && strchr(dcb->remote, ':') && strchr(dcb->remote, '.'))
-    {
-        const char* ipv4 = strrchr(dcb->remote, ':') + 1;
-        sprintf(sql,
-                validate_query,
-                session->user,
-                ipv4,
-                ipv4,
-                session->db,
-                session->db);
-
-        if (sqlite3_exec(handle, sql, auth_cb, &res, &err) != SQLITE_OK)
+        /** Check for IPv6 mapped IPv4 address */
+        if (!account && strchr(dcb->remote, ':') && strchr(dcb->remote, '.'))
         {
-            MXS_ERROR("Failed to execute auth query: %s", err);
-            sqlite3_free(err);
+            account = users->find(session->user, strrchr(dcb->remote, ':') + 1, session->db);
         }
-    }
 
-    if (!res.ok)
-    {
-        /**
-         * Try authentication with the hostname instead of the IP. We do this only
-         * as a last resort so we avoid the high cost of the DNS lookup.
-         */
-        char client_hostname[MYSQL_HOST_MAXLEN] = "";
-        get_hostname(dcb, client_hostname, sizeof(client_hostname) - 1);
-
-        sprintf(sql,
-                validate_query,
-                session->user,
-                client_hostname,
-                client_hostname,
-                session->db,
-                session->db);
-
-        if (sqlite3_exec(handle, sql, auth_cb, &res, &err) != SQLITE_OK)
+        if (!account && users->has_user(session->user))
         {
-            MXS_ERROR("Failed to execute auth query: %s", err);
-            sqlite3_free(err);
+            /**
+             * Try authentication with the hostname instead of the IP. We do this only
+             * as a last resort so we avoid the high cost of the DNS lookup. The lookup
+             * itself is done in the background, see mysql_auth_authenticate().
+             */
+            std::string client_hostname;
+
+            if (!mxs::cached_hostname(dcb->remote, &client_hostname))
+            {
+                return MXS_AUTH_PENDING;
+            }
+
+            if (!client_hostname.empty())
+            {
+                account = users->find(session->user, client_hostname.c_str(), session->db);
+            }
         }
     }
 
-    if (res.ok)
+    if (account)
     {
-        /** Found a matching row */
+        /** Found a matching account */
+        const char* password = account->password.c_str();
 
-        if (no_password_required(res.output, session->auth_token_len)
-            || check_password(res.output,
+        if (no_password_required(password, session->auth_token_len)
+            || check_password(password,
                               session->auth_token,
                               session->auth_token_len,
                               scramble,
@@ -394,7 +313,7 @@ int validate_mysql_user(MYSQL_AUTH* instance,
                               session->client_sha1))
         {
             /** Password is OK, check that the database exists */
-            if (check_database(instance, handle, session->db))
+            if (users->has_database(session->db))
             {
                 rval = MXS_AUTH_SUCCEEDED;
             }
@@ -408,168 +327,6 @@ int validate_mysql_user(MYSQL_AUTH* instance,
     return rval;
 }
 
-/**
- * @brief Delete all users
- *
- * @param handle SQLite handle
- */
-static bool delete_mysql_users(sqlite3* handle)
-{
-    bool rval = true;
-    char* err;
-
-    if (sqlite3_exec(handle, delete_users_query, NULL, NULL, &err) != SQLITE_OK
-        || sqlite3_exec(handle, delete_databases_query, NULL, NULL, &err) != SQLITE_OK)
-    {
-        MXS_ERROR("Failed to delete old users: %s", err);
-        sqlite3_free(err);
-        rval = false;
-    }
-
-    return rval;
-}
-
-/**
- * If the hostname is of form a.b.c.d/e.f.g.h where e-h is 255 or 0, replace
- * the zeros in the first part with '%' and remove the second part. This does
- * not yet support netmasks completely, but should be sufficient for most
- * situations. In case of error, the hostname may end in an invalid state, which
- * will cause an error later on.
- *
- * @param host  The hostname, which is modified in-place. If merging is unsuccessful,
- *              it may end up garbled.
- */
-static void merge_netmask(char* host)
-{
-    char* delimiter_loc = strchr(host, '/');
-    if (delimiter_loc == NULL)
-    {
-        return;     // Nothing to do
-    }
-    /* If anything goes wrong, we put the '/' back in to ensure the hostname
-     * cannot be used.
-     */
-    *delimiter_loc = '\0';
-
-    char* ip_token_loc = host;
-    char* mask_token_loc = delimiter_loc + 1;   // This is at minimum a \0
-
-    while (ip_token_loc && mask_token_loc)
-    {
-        if (strncmp(mask_token_loc, "255", 3) == 0)
-        {
-            // Skip
-        }
-        else if (*mask_token_loc == '0' && *ip_token_loc == '0')
-        {
-            *ip_token_loc = '%';
-        }
-        else
-        {
-            /* Any other combination is considered invalid. This may leave the
-             * hostname in a partially modified state.
-             * TODO: handle more cases
-             */
-            *delimiter_loc = '/';
-            MXS_ERROR("Unrecognized IP-bytes in host/mask-combination. "
-                      "Merge incomplete: %s",
-                      host);
-            return;
-        }
-
-        ip_token_loc = strchr(ip_token_loc, '.');
-        mask_token_loc = strchr(mask_token_loc, '.');
-        if (ip_token_loc && mask_token_loc)
-        {
-            ip_token_loc++;
-            mask_token_loc++;
-        }
-    }
-    if (ip_token_loc || mask_token_loc)
-    {
-        *delimiter_loc = '/';
-        MXS_ERROR("Unequal number of IP-bytes in host/mask-combination. "
-                  "Merge incomplete: %s",
-                  host);
-    }
-}
-
-void add_mysql_user(sqlite3* handle,
-                    const char* user,
-                    const char* host,
-                    const char* db,
-                    bool anydb,
-                    const char* pw)
-{
-    size_t dblen = db && *db ? strlen(db) + 2 : sizeof(null_token);     /** +2 for single quotes */
-    char dbstr[dblen + 1];
-
-    if (db && *db)
-    {
-        sprintf(dbstr, "'%s'", db);
-    }
-    else
-    {
-        strcpy(dbstr, null_token);
-    }
-
-    size_t pwlen = pw && *pw ? strlen(pw) + 2 : sizeof(null_token);     /** +2 for single quotes */
-    char pwstr[pwlen + 1];
-
-    if (pw && *pw)
-    {
-        if (strlen(pw) == 16)
-        {
-            MXS_ERROR("The user %s@%s has on old password in the "
-                      "backend database. MaxScale does not support these "
-                      "old passwords. This user will not be able to connect "
-                      "via MaxScale. Update the users password to correct "
-                      "this.",
-                      user,
-                      host);
-            return;
-        }
-        else if (*pw == '*')
-        {
-            pw++;
-        }
-        sprintf(pwstr, "'%s'", pw);
-    }
-    else
-    {
-        strcpy(pwstr, null_token);
-    }
-
-    size_t len = sizeof(insert_user_query) + strlen(user) + strlen(host) + dblen + pwlen + 1;
-
-    char insert_sql[len + 1];
-    sprintf(insert_sql, insert_user_query, user, host, dbstr, anydb ? "1" : "0", pwstr);
-
-    char* err;
-    if (sqlite3_exec(handle, insert_sql, NULL, NULL, &err) != SQLITE_OK)
-    {
-        MXS_ERROR("Failed to insert user: %s", err);
-        sqlite3_free(err);
-    }
-
-    MXS_INFO("Added user: %s", insert_sql);
-}
-
-static void add_database(sqlite3* handle, const char* db)
-{
-    size_t len = sizeof(insert_database_query) + strlen(db) + 1;
-    char insert_sql[len + 1];
-
-    sprintf(insert_sql, insert_database_query, db);
-
-    char* err;
-    if (sqlite3_exec(handle, insert_sql, NULL, NULL, &err) != SQLITE_OK)
-    {
-        MXS_ERROR("Failed to insert database: %s", err);
-        sqlite3_free(err);
-    }
-}
-
 /**
  * Returns a MYSQL object suitably configured.
  *
@@ -864,59 +621,13 @@ bool check_service_permissions(SERVICE* service)
     return rval;
 }
 
-/**
- * @brief Get client hostname
- *
- * Queries the DNS server for the client's hostname.
- *
- * @param ip_address      Client IP address
- * @param client_hostname Output buffer for hostname
- *
- * @return True if the hostname query was successful
- */
-static bool get_hostname(DCB* dcb, char* client_hostname, size_t size)
-{
-    struct addrinfo* ai = NULL, hint = {};
-    hint.ai_flags = AI_ALL;
-    int rc;
-
-    if ((rc = getaddrinfo(dcb->remote, NULL, &hint, &ai)) != 0)
-    {
-        MXS_ERROR("Failed to obtain address for host %s, %s",
-                  dcb->remote,
-                  gai_strerror(rc));
-        return false;
-    }
-
-    /* Try to lookup the domain name of the given IP-address. This is a slow
-     * i/o-operation, which will stall the entire thread. TODO: cache results
-     * if this feature is used often. */
-    int lookup_result = getnameinfo(ai->ai_addr,
-                                    ai->ai_addrlen,
-                                    client_hostname,
-                                    size,
-                                    NULL,
-                                    0,              // No need for the port
-                                    NI_NAMEREQD);   // Text address only
-    freeaddrinfo(ai);
-
-    if (lookup_result != 0 && lookup_result != EAI_NONAME)
-    {
-        MXS_WARNING("Client hostname lookup failed for '%s', getnameinfo() returned: '%s'.",
-                    dcb->remote,
-                    gai_strerror(lookup_result));
-    }
-
-    return lookup_result == 0;
-}
-
 static bool roles_are_available(MYSQL* conn, SERVICE* service, SERVER* server)
 {
     bool rval = false;
 
     if (server->version >= 100101)
     {
-        static bool log_missing_privs = true;
+        static std::atomic<bool> log_missing_privs {true};
 
         if (mxs_mysql_query(conn, "SET @roles_are_available=(SELECT 1 FROM mysql.roles_mapping LIMIT 1)") == 0
             && mxs_mysql_query(conn,
@@ -924,9 +635,8 @@ static bool roles_are_available(MYSQL* conn, SERVICE* service, SERVER* server)
         {
             rval = true;
         }
-        else if (log_missing_privs)
+        else if (log_missing_privs.exchange(false))
         {
-            log_missing_privs = false;
             MXS_WARNING("The user for service '%s' might be missing the SELECT grant on "
                         "`mysql.roles_mapping` or `mysql.user`. Use of default roles is disabled "
                         "until the missing privileges are added. Error was: %s",
@@ -972,7 +682,7 @@ static bool have_mdev13453_problem(MYSQL* con, SERVER* server)
     return rval;
 }
 
-bool query_and_process_users(const char* query, MYSQL* con, sqlite3* handle, SERVICE* service, int* users)
+bool query_and_process_users(const char* query, MYSQL* con, UserIndex* index, SERVICE* service, int* users)
 {
     bool rval = false;
 
@@ -992,13 +702,7 @@ bool query_and_process_users(const char* query, MYSQL* con, sqlite3* handle, SER
                     strip_escape_chars(row[2]);
                 }
 
-                if (strchr(row[1], '/'))
-                {
-                    merge_netmask(row[1]);
-                }
-
-                add_mysql_user(handle, row[0], row[1], row[2],
-                               row[3] && strcmp(row[3], "Y") == 0, row[4]);
+                index->add_user(row[0], row[1], row[2], row[3] && strcmp(row[3], "Y") == 0, row[4]);
                 (*users)++;
             }
 
@@ -1010,7 +714,7 @@ bool query_and_process_users(const char* query, MYSQL* con, sqlite3* handle, SER
     return rval;
 }
 
-int get_users_from_server(MYSQL* con, SERVER_REF* server_ref, SERVICE* service, SERV_LISTENER* listener)
+int get_users_from_server(MYSQL* con, SERVER_REF* server_ref, SERVICE* service, UserIndex* index)
 {
     if (server_ref->server->version_string[0] == 0)
     {
@@ -1022,11 +726,9 @@ int get_users_from_server(MYSQL* con, SERVER_REF* server_ref, SERVICE* service,
                                   service->enable_root,
                                   roles_are_available(con, service, server_ref->server));
 
-    MYSQL_AUTH* instance = (MYSQL_AUTH*)listener->auth_instance;
-    sqlite3* handle = get_handle(instance);
     int users = 0;
 
-    bool rv = query_and_process_users(query, con, handle, service, &users);
+    bool rv = query_and_process_users(query, con, index, service, &users);
 
     if (!rv && have_mdev13453_problem(con, server_ref->server))
     {
@@ -1036,7 +738,7 @@ int get_users_from_server(MYSQL* con, SERVER_REF* server_ref, SERVICE* service,
          */
         MXS_FREE(query);
         query = get_users_query(server_ref->server->version_string, 100110, service->enable_root, true);
-        rv = query_and_process_users(query, con, handle, service, &users);
+        rv = query_and_process_users(query, con, index, service, &users);
     }
 
     if (!rv)
@@ -1055,7 +757,7 @@ int get_users_from_server(MYSQL* con, SERVER_REF* server_ref, SERVICE* service,
             MYSQL_ROW row;
             while ((row = mysql_fetch_row(result)))
             {
-                add_database(handle, row[0]);
+                index->add_database(row[0]);
             }
 
             mysql_free_result(result);
@@ -1070,14 +772,58 @@ int get_users_from_server(MYSQL* con, SERVER_REF* server_ref, SERVICE* service,
 }
 
 /**
- * Load the user/passwd form mysql.user table into the service users' hashtable
- * environment.
+ * Load the users from one server
  *
- * @param service   The current service
- * @param users     The users table into which to load the users
- * @return          -1 on any error or the number of users inserted
+ * @param server   The server to load the users from
+ * @param service  The service whose users are loaded
+ * @param user     The service user
+ * @param password The decrypted password of the service user
+ * @param index    The index into which to load the users
+ * @return         -1 if the server could not be connected to or the number of users inserted
  */
-static int get_users(SERV_LISTENER* listener, bool skip_local)
+static int load_server_users(SERVER_REF* server, SERVICE* service, const char* user,
+                             const char* password, UserIndex* index)
+{
+    int users = -1;
+    MYSQL* con = gw_mysql_init();
+
+    if (con)
+    {
+        if (mxs_mysql_real_connect(con, server->server, user, password) == NULL)
+        {
+            MXS_ERROR("Failure loading users data from backend "
+                      "[%s:%i] for service [%s]. MySQL error %i, %s",
+                      server->server->address,
+                      server->server->port,
+                      service->name,
+                      mysql_errno(con),
+                      mysql_error(con));
+        }
+        else
+        {
+            /** Successfully connected to a server */
+            users = get_users_from_server(con, server, service, index);
+        }
+
+        mysql_close(con);
+    }
+
+    return users;
+}
+
+/**
+ * Load the user/passwd form mysql.user table into the user index
+ *
+ * The users are loaded from all servers in parallel. If `auth_all_servers` is
+ * not enabled, only the users of the first server that responds in the order
+ * the servers are listed are used.
+ *
+ * @param listener   The listener whose users are loaded
+ * @param index      The index into which to load the users
+ * @param skip_local Skip loading of users on local MaxScale services
+ * @return           -1 on any error or the number of users inserted
+ */
+static int get_users(SERV_LISTENER* listener, UserIndex* index, bool skip_local)
 {
     const char* service_user = NULL;
     const char* service_passwd = NULL;
@@ -1092,68 +838,60 @@ static int get_users(SERV_LISTENER* listener, bool skip_local)
         return -1;
     }
 
-    /** Delete the old users */
-    MYSQL_AUTH* instance = (MYSQL_AUTH*)listener->auth_instance;
-    sqlite3* handle = get_handle(instance);
-    delete_mysql_users(handle);
-
-    SERVER_REF* server = service->dbref;
-    int total_users = -1;
-    bool no_active_servers = true;
+    std::vector<SERVER_REF*> servers;
 
-    for (server = service->dbref; !maxscale_is_shutting_down() && server; server = server->next)
+    for (SERVER_REF* server = service->dbref; server; server = server->next)
     {
-        if (!SERVER_REF_IS_ACTIVE(server) || !server_is_active(server->server)
-            || (skip_local && server_is_mxs_service(server->server))
-            || !server_is_running(server->server))
+        if (SERVER_REF_IS_ACTIVE(server) && server_is_active(server->server)
+            && (!skip_local || !server_is_mxs_service(server->server))
+            && server_is_running(server->server))
         {
-            continue;
+            servers.push_back(server);
         }
+    }
 
-        no_active_servers = false;
+    std::vector<std::unique_ptr<UserIndex>> results;
+    std::vector<int> counts(servers.size(), -1);
+    std::vector<std::thread> threads;
 
-        MYSQL* con = gw_mysql_init();
-        if (con)
-        {
-            if (mxs_mysql_real_connect(con, server->server, service_user, dpwd) == NULL)
-            {
-                MXS_ERROR("Failure loading users data from backend "
-                          "[%s:%i] for service [%s]. MySQL error %i, %s",
-                          server->server->address,
-                          server->server->port,
-                          service->name,
-                          mysql_errno(con),
-                          mysql_error(con));
-                mysql_close(con);
-            }
-            else
-            {
-                /** Successfully connected to a server */
-                int users = get_users_from_server(con, server, service, listener);
+    for (size_t i = 0; i < servers.size() && !maxscale_is_shutting_down(); i++)
+    {
+        results.emplace_back(new UserIndex(index->lower_case_table_names()));
+        threads.emplace_back([&, i]() {
+                                 counts[i] = load_server_users(servers[i], service, service_user,
+                                                               dpwd, results[i].get());
+                             });
+    }
 
-                if (users > total_users)
-                {
-                    total_users = users;
-                }
+    for (auto& thr : threads)
+    {
+        thr.join();
+    }
 
-                mysql_close(con);
+    MXS_FREE(dpwd);
 
-                if (!service->users_from_all)
-                {
-                    break;
-                }
+    int total_users = -1;
+
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        if (counts[i] >= 0)
+        {
+            index->merge(*results[i]);
+            total_users = std::max(total_users, counts[i]);
+
+            if (!service->users_from_all)
+            {
+                break;
             }
         }
     }
 
-    MXS_FREE(dpwd);
-
-    if (no_active_servers)
+    if (servers.empty())
     {
         // This service has no servers or all servers are local MaxScale services
         total_users = 0;
     }
-    else if (server == NULL && total_users == -1)
+    else if (total_users == -1 && !maxscale_is_shutting_down())
     {
         MXS_ERROR("Unable to get user data from backend database for service [%s]."
                   " Failed to connect to any of the backend databases.",
@@ -33,6 +33,7 @@
 #include <maxscale/event.hh>
 #include <maxscale/poll.h>
 #include <maxscale/paths.h>
+#include <maxscale/resolver.hh>
 #include <maxscale/secrets.h>
 #include <maxscale/utils.h>
 #include <maxscale/routingworker.h>
@@ -104,7 +105,7 @@ extern "C"
             MXS_AUTHENTICATOR_VERSION,
             "The MySQL client to MaxScale authenticator implementation",
             "V1.1.0",
-            ACAP_TYPE_ASYNC,
+            MXS_NO_MODULE_CAPABILITIES,
             &MyObject,
             NULL,   /* Process init. */
             NULL,   /* Process finish. */
@@ -119,45 +120,6 @@ extern "C"
     }
 }
 
-static bool open_instance_database(const char* path, sqlite3** handle)
-{
-    int rc = sqlite3_open_v2(path, handle, db_flags, NULL);
-
-    if (rc != SQLITE_OK)
-    {
-        MXS_ERROR("Failed to open SQLite3 handle: %d", rc);
-        return false;
-    }
-
-    char* err;
-
-    if (sqlite3_exec(*handle, users_create_sql, NULL, NULL, &err) != SQLITE_OK
-        || sqlite3_exec(*handle, databases_create_sql, NULL, NULL, &err) != SQLITE_OK
-        || sqlite3_exec(*handle, pragma_sql, NULL, NULL, &err) != SQLITE_OK)
-    {
-        MXS_ERROR("Failed to create database: %s", err);
-        sqlite3_free(err);
-        sqlite3_close_v2(*handle);
-        return false;
-    }
-
-    return true;
-}
-
-sqlite3* get_handle(MYSQL_AUTH* instance)
-{
-    int i = mxs_rworker_get_current_id();
-    mxb_assert(i >= 0);
-
-    if (instance->handles[i] == NULL)
-    {
-        MXB_AT_DEBUG(bool rval = ) open_instance_database(":memory:", &instance->handles[i]);
-        mxb_assert(rval);
-    }
-
-    return instance->handles[i];
-}
-
 /**
  * @brief Check if service permissions should be checked
  *
@@ -179,17 +141,11 @@ static bool should_check_permissions(MYSQL_AUTH* instance)
  */
 static void* mysql_auth_init(char** options)
 {
-    MYSQL_AUTH* instance = static_cast<MYSQL_AUTH*>(MXS_MALLOC(sizeof(*instance)));
+    MYSQL_AUTH* instance = new(std::nothrow) MYSQL_AUTH(config_threadcount());
 
-    if (instance
-        && (instance->handles = static_cast<sqlite3**>(MXS_CALLOC(config_threadcount(), sizeof(sqlite3*)))))
+    if (instance)
     {
         bool error = false;
-        instance->cache_dir = NULL;
-        instance->inject_service_user = true;
-        instance->skip_auth = false;
-        instance->check_permissions = true;
-        instance->lower_case_table_names = false;
 
         for (int i = 0; options[i]; i++)
         {
@@ -235,16 +191,10 @@ static void* mysql_auth_init(char** options)
         if (error)
         {
             MXS_FREE(instance->cache_dir);
-            MXS_FREE(instance->handles);
-            MXS_FREE(instance);
+            delete instance;
             instance = NULL;
         }
     }
-    else if (instance)
-    {
-        MXS_FREE(instance);
-        instance = NULL;
-    }
 
     return instance;
 }
@@ -302,11 +252,58 @@ static GWBUF* gen_auth_switch_request_packet(MySQLProtocol* proto, MYSQL_session
     *bufdata = '\0';
     return buffer;
 };
+/**
+ * @brief Resolve the hostname of the client in the background
+ *
+ * Once the hostname is in the cache, a read event is triggered on the client DCB
+ * which processes the authentication packet again.
+ *
+ * @param dcb Request handler DCB connected to the client
+ */
+static void resolve_client_hostname(DCB* dcb)
+{
+    uint64_t uid = dcb->m_uid;
+
+    mxs::resolve_hostname(dcb->remote, [dcb, uid]() {
+                              if (dcb_is_open(dcb, uid))
+                              {
+                                  poll_fake_read_event(dcb);
+                              }
+                          });
+}
+
+/**
+ * @brief Load the users in the background
+ *
+ * Once the users have been loaded, a read event is triggered on the client DCB
+ * which processes the authentication packet again.
+ *
+ * @param dcb Request handler DCB connected to the client
+ *
+ * @return True if the users will be loaded, false if the rate limit was exceeded
+ */
+static bool refresh_users_for_client(DCB* dcb)
+{
+    MYSQL_AUTH* instance = (MYSQL_AUTH*)dcb->listener->auth_instance;
+    SERV_LISTENER* port = dcb->listener;
+    uint64_t uid = dcb->m_uid;
+
+    return instance->refresh.request([port]() {
+                                         mysql_auth_load_users(port);
+                                     },
+                                     [dcb, uid]() {
+                                         if (dcb_is_open(dcb, uid))
+                                         {
+                                             poll_fake_read_event(dcb);
+                                         }
+                                     });
+}
+
 /**
  * @brief Authenticates a MySQL user who is a client to MaxScale.
  *
  * First call the SSL authentication function. Call other functions to validate
- * the user, reloading the user data if the first attempt fails.
+ * the user, reloading the user data in the background if the first attempt fails.
  *
  * @param dcb Request handler DCB connected to the client
  * @return Authentication status
@@ -346,21 +343,26 @@ static int mysql_auth_authenticate(DCB* dcb)
                                        protocol->scramble,
                                        sizeof(protocol->scramble));
 
-        if (auth_ret != MXS_AUTH_SUCCEEDED
-            && service_refresh_users(dcb->service) == 0)
+        if (auth_ret == MXS_AUTH_PENDING)
+        {
+            // The client's hostname is needed, the authentication continues once it is known
+            resolve_client_hostname(dcb);
+            return MXS_AUTH_PENDING;
+        }
+
+        if (auth_ret != MXS_AUTH_SUCCEEDED && !client_data->users_refreshed
+            && refresh_users_for_client(dcb))
         {
-            auth_ret = validate_mysql_user(instance,
-                                           dcb,
-                                           client_data,
-                                           protocol->scramble,
-                                           sizeof(protocol->scramble));
+            // The authentication is retried once the users have been loaded
+            client_data->users_refreshed = true;
+            return MXS_AUTH_PENDING;
         }
 
         /* on successful authentication, set user into dcb field */
         if (auth_ret == MXS_AUTH_SUCCEEDED)
         {
             auth_ret = MXS_AUTH_SUCCEEDED;
-            dcb->user = MXS_STRDUP_A(client_data->user);
+            dcb_set_user(dcb, client_data->user);
             /** Send an OK packet to the client */
         }
         else if (dcb->service->log_auth_warnings)
@@ -704,12 +706,13 @@ static void mysql_auth_free_client_data(DCB* dcb)
 }
 
 /**
- * @brief Inject the service user into the cache
+ * @brief Inject the service user into the users
  *
- * @param port Service listener
+ * @param port  Service listener
+ * @param users The users where the service user is added
  * @return True on success, false on error
  */
-static bool add_service_user(SERV_LISTENER* port)
+static bool add_service_user(SERV_LISTENER* port, UserIndex* users)
 {
     const char* user = NULL;
     const char* password = NULL;
@@ -725,10 +728,8 @@ static bool add_service_user(SERV_LISTENER* port)
 
         if (newpw)
         {
-            MYSQL_AUTH* inst = (MYSQL_AUTH*)port->auth_instance;
-            sqlite3* handle = get_handle(inst);
-            add_mysql_user(handle, user, "%", "", "Y", newpw);
-            add_mysql_user(handle, user, "localhost", "", "Y", newpw);
+            users->add_user(user, "%", "", true, newpw);
+            users->add_user(user, "localhost", "", true, newpw);
             MXS_FREE(newpw);
             rval = true;
         }
@@ -758,7 +759,9 @@ static bool service_has_servers(SERVICE* service)
 /**
  * @brief Load MySQL authentication users
  *
- * This function loads MySQL users from the backend database.
+ * This function loads MySQL users from the backend database. The users are
+ * collected into a new index which replaces the current one if the users have
+ * changed.
  *
  * @param port Listener definition
  * @return MXS_AUTH_LOADUSERS_OK on success, MXS_AUTH_LOADUSERS_ERROR and
@@ -783,7 +786,8 @@ static int mysql_auth_load_users(SERV_LISTENER* port)
         first_load = true;
     }
 
-    int loaded = replace_mysql_users(port, first_load);
+    auto users = std::make_shared<UserIndex>(instance->lower_case_table_names);
+    int loaded = replace_mysql_users(port, users.get(), first_load);
     bool injected = false;
 
     if (loaded <= 0)
@@ -801,7 +805,7 @@ static int mysql_auth_load_users(SERV_LISTENER* port)
         {
             /** Inject the service user as a 'backup' user that's available
              * if loading of the users fails */
-            if (!add_service_user(port))
+            if (!add_service_user(port, users.get()))
             {
                 MXS_ERROR("[%s] Failed to inject service user.", port->service->name);
             }
@@ -833,6 +837,21 @@ static int mysql_auth_load_users(SERV_LISTENER* port)
         MXS_NOTICE("[%s] Loaded %d MySQL users for listener %s.", service->name, loaded, port->name);
     }
 
+    SUserIndex current = instance->users.get();
+    UserIndex::Diff diff = users->diff(*current);
+
+    if (!diff.empty())
+    {
+        if (!first_load)
+        {
+            MXS_NOTICE("[%s] Users of listener %s changed: %lu added, %lu removed, %lu modified%s.",
+                       service->name, port->name, diff.added, diff.removed, diff.changed,
+                       diff.databases ? ", databases changed" : "");
+        }
+
+        instance->users.publish(users);
+    }
+
     return rc;
 }
 
@@ -857,9 +876,22 @@ int mysql_auth_reauthenticate(DCB* dcb,
     MYSQL_AUTH* instance = (MYSQL_AUTH*)dcb->listener->auth_instance;
     int rc = validate_mysql_user(instance, dcb, &temp, scramble, scramble_len);
 
-    if (rc != MXS_AUTH_SUCCEEDED && service_refresh_users(dcb->service) == 0)
+    if (rc == MXS_AUTH_PENDING)
     {
-        rc = validate_mysql_user(instance, dcb, &temp, scramble, scramble_len);
+        /** A COM_CHANGE_USER can't wait for the hostname lookup. Resolve it in
+         * the background so that it is available if the client tries again. */
+        mxs::resolve_hostname(dcb->remote, []() {
+                              });
+    }
+    else if (rc != MXS_AUTH_SUCCEEDED)
+    {
+        /** Nor can it wait for the users to be loaded */
+        SERV_LISTENER* port = dcb->listener;
+        instance->refresh.request([port]() {
+                                      mysql_auth_load_users(port);
+                                  },
+                                  []() {
+                                  });
     }
 
     if (rc == MXS_AUTH_SUCCEEDED)
@@ -871,58 +903,30 @@ int mysql_auth_reauthenticate(DCB* dcb,
     return rval;
 }
 
-int diag_cb(void* data, int columns, char** row, char** field_names)
-{
-    DCB* dcb = (DCB*)data;
-    dcb_printf(dcb, "%s@%s ", row[0], row[1]);
-    return 0;
-}
-
 void mysql_auth_diagnostic(DCB* dcb, SERV_LISTENER* port)
 {
     MYSQL_AUTH* instance = (MYSQL_AUTH*)port->auth_instance;
-    sqlite3* handle = get_handle(instance);
-    char* err;
-
-    if (sqlite3_exec(handle,
-                     "SELECT user, host FROM " MYSQLAUTH_USERS_TABLE_NAME,
-                     diag_cb,
-                     dcb,
-                     &err) != SQLITE_OK)
+    SUserIndex users = instance->users.get();
+
+    for (const auto& account : users->accounts())
     {
-        dcb_printf(dcb, "Could not access users: %s", err);
-        MXS_ERROR("Could not access users: %s", err);
-        sqlite3_free(err);
+        dcb_printf(dcb, "%s@%s ", account.first.c_str(), account.second.c_str());
     }
 }
 
-int diag_cb_json(void* data, int columns, char** row, char** field_names)
-{
-    json_t* obj = json_object();
-    json_object_set_new(obj, "user", json_string(row[0]));
-    json_object_set_new(obj, "host", json_string(row[1]));
-
-    json_t* arr = (json_t*)data;
-    json_array_append_new(arr, obj);
-    return 0;
-}
-
 json_t* mysql_auth_diagnostic_json(const SERV_LISTENER* port)
 {
     json_t* rval = json_array();
 
     MYSQL_AUTH* instance = (MYSQL_AUTH*)port->auth_instance;
-    char* err;
-    sqlite3* handle = get_handle(instance);
-
-    if (sqlite3_exec(handle,
-                     "SELECT user, host FROM " MYSQLAUTH_USERS_TABLE_NAME,
-                     diag_cb_json,
-                     rval,
-                     &err) != SQLITE_OK)
+    SUserIndex users = instance->users.get();
+
+    for (const auto& account : users->accounts())
     {
-        MXS_ERROR("Failed to print users: %s", err);
-        sqlite3_free(err);
+        json_t* obj = json_object();
+        json_object_set_new(obj, "user", json_string(account.first.c_str()));
+        json_object_set_new(obj, "host", json_string(account.second.c_str()));
+        json_array_append_new(rval, obj);
     }
 
     return rval;
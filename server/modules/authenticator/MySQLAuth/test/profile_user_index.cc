@@ -0,0 +1,315 @@
+/*
+ * Copyright (c) 2018 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2022-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+/**
+ * Measures the latency of the user lookup done when a client logs in.
+ *
+ * The lookup from the in-memory user index is compared to the SQLite based
+ * lookup that was used before it. Both use the same users and the same
+ * sequence of logins, the password check is not included as it's identical
+ * in both cases.
+ *
+ * Usage: profile_user_index [-u users] [-n logins]
+ */
+
+#include "user_index.hh"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <maxbase/log.hh>
+#include <maxbase/maxbase.hh>
+#include <maxscale/sqlite3.h>
+
+using namespace std;
+using Clock = chrono::steady_clock;
+
+namespace
+{
+
+char USAGE[] = "usage: profile_user_index [-u users] [-n logins]\n";
+
+const char PASSWORD[] = "*0123456789ABCDEF0123456789ABCDEF01234567";
+
+// The schema and the queries used by the SQLite based lookup
+const char CREATE_USERS[] =
+    "CREATE TABLE mysqlauth_users"
+    "(user varchar(255), host varchar(255), db varchar(255), anydb boolean, password text)";
+const char CREATE_DATABASES[] = "CREATE TABLE mysqlauth_databases(db varchar(255))";
+const char INSERT_USER[] = "INSERT INTO mysqlauth_users VALUES ('%s', '%s', %s, %s, '%s')";
+const char INSERT_DATABASE[] = "INSERT INTO mysqlauth_databases VALUES ('%s')";
+const char VALIDATE_USER[] =
+    "SELECT password FROM mysqlauth_users"
+    " WHERE user = '%s' AND ( '%s' = host OR '%s' LIKE host) AND (anydb = '1' OR '%s' = '' OR '%s' LIKE db)"
+    " LIMIT 1";
+const char VALIDATE_DATABASE[] = "SELECT * FROM mysqlauth_databases WHERE db = '%s' LIMIT 1";
+
+struct Grant
+{
+    string user;
+    string host;
+    string db;
+    bool   anydb;
+};
+
+struct Login
+{
+    string user;
+    string host;
+    string db;
+};
+
+/**
+ * Generate the grants. Every user has an account for a subnet with grants on
+ * two databases and a global wildcard account. Every tenth user has access to
+ * all databases.
+ */
+vector<Grant> create_grants(int n_users)
+{
+    vector<Grant> grants;
+
+    for (int i = 0; i < n_users; i++)
+    {
+        string user = "user" + to_string(i);
+        string subnet = "10." + to_string(i % 256) + ".%";
+        bool anydb = i % 10 == 0;
+
+        grants.push_back({user, subnet, "db" + to_string(i), anydb});
+        grants.push_back({user, subnet, "shared%", anydb});
+        grants.push_back({user, "%.example.com", "", anydb});
+    }
+
+    return grants;
+}
+
+vector<Login> create_logins(int n_users, int n_logins)
+{
+    mt19937 rng(4711);
+    uniform_int_distribution<int> dist(0, n_users - 1);
+    vector<Login> logins;
+
+    for (int i = 0; i < n_logins; i++)
+    {
+        int u = dist(rng);
+        string host = "10." + to_string(u % 256) + "." + to_string(i % 256) + ".1";
+        string db = i % 3 == 0 ? "" : i % 3 == 1 ? "db" + to_string(u) : "shared_data";
+        logins.push_back({"user" + to_string(u), host, db});
+    }
+
+    return logins;
+}
+
+void report(const char* zWhat, vector<Clock::duration>& latencies)
+{
+    sort(latencies.begin(), latencies.end());
+
+    auto usecs = [&latencies](double pct) {
+            size_t i = min(latencies.size() - 1, (size_t)(latencies.size() * pct));
+            return chrono::duration<double, micro>(latencies[i]).count();
+        };
+
+    cout << setw(8) << zWhat << ": " << fixed << setprecision(2)
+         << "p50 " << usecs(0.5) << "us, "
+         << "p90 " << usecs(0.9) << "us, "
+         << "p99 " << usecs(0.99) << "us, "
+         << "max " << usecs(1.0) << "us" << endl;
+}
+
+int exec(sqlite3* handle, const string& sql, int (* cb)(void*, int, char**, char**) = NULL, void* data = NULL)
+{
+    char* err = NULL;
+    int rc = sqlite3_exec(handle, sql.c_str(), cb, data, &err);
+
+    if (rc != SQLITE_OK)
+    {
+        cerr << "error: " << err << endl;
+        sqlite3_free(err);
+    }
+
+    return rc;
+}
+
+int found_cb(void* data, int columns, char** rows, char** row_names)
+{
+    *static_cast<bool*>(data) = true;
+    return 0;
+}
+
+bool sqlite_login(sqlite3* handle, const Login& login)
+{
+    char sql[sizeof(VALIDATE_USER) + 5 * 255];
+    const char* user = login.user.c_str();
+    const char* host = login.host.c_str();
+    const char* db = login.db.c_str();
+    bool found = false;
+
+    sprintf(sql, VALIDATE_USER, user, host, host, db, db);
+    exec(handle, sql, found_cb, &found);
+
+    if (found && *db)
+    {
+        found = false;
+        sprintf(sql, VALIDATE_DATABASE, db);
+        exec(handle, sql, found_cb, &found);
+    }
+
+    return found;
+}
+
+bool index_login(const UserIndex& index, const Login& login)
+{
+    return index.find(login.user.c_str(), login.host.c_str(), login.db.c_str())
+           && index.has_database(login.db.c_str());
+}
+
+int run(int n_users, int n_logins)
+{
+    vector<Grant> grants = create_grants(n_users);
+    vector<Login> logins = create_logins(n_users, n_logins);
+    vector<string> databases = {"shared_data"};
+
+    for (int i = 0; i < n_users; i++)
+    {
+        databases.push_back("db" + to_string(i));
+    }
+
+    sqlite3* handle;
+
+    if (sqlite3_open_v2(":memory:", &handle, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, NULL) != SQLITE_OK
+        || exec(handle, CREATE_USERS) != SQLITE_OK
+        || exec(handle, CREATE_DATABASES) != SQLITE_OK)
+    {
+        cerr << "error: Could not create the SQLite database." << endl;
+        return EXIT_FAILURE;
+    }
+
+    char sql[sizeof(INSERT_USER) + 5 * 255];
+    auto start = Clock::now();
+    exec(handle, "BEGIN");
+
+    for (const auto& g : grants)
+    {
+        string db = g.db.empty() ? "NULL" : "'" + g.db + "'";
+        sprintf(sql, INSERT_USER, g.user.c_str(), g.host.c_str(), db.c_str(), g.anydb ? "1" : "0", PASSWORD + 1);
+        exec(handle, sql);
+    }
+
+    for (const auto& db : databases)
+    {
+        sprintf(sql, INSERT_DATABASE, db.c_str());
+        exec(handle, sql);
+    }
+
+    exec(handle, "COMMIT");
+    chrono::duration<double> sqlite_load = Clock::now() - start;
+
+    start = Clock::now();
+    UserIndex index;
+
+    for (const auto& g : grants)
+    {
+        index.add_user(g.user.c_str(), g.host.c_str(), g.db.c_str(), g.anydb, PASSWORD);
+    }
+
+    for (const auto& db : databases)
+    {
+        index.add_database(db.c_str());
+    }
+
+    chrono::duration<double> index_load = Clock::now() - start;
+
+    cout << grants.size() << " grants, " << logins.size() << " logins" << endl;
+    cout << fixed << setprecision(3) << "Loading: sqlite " << sqlite_load.count() << "s, index "
+         << index_load.count() << "s" << endl;
+
+    vector<Clock::duration> sqlite_latencies;
+    vector<Clock::duration> index_latencies;
+    sqlite_latencies.reserve(logins.size());
+    index_latencies.reserve(logins.size());
+    int mismatches = 0;
+
+    for (const auto& login : logins)
+    {
+        start = Clock::now();
+        bool sqlite_ok = sqlite_login(handle, login);
+        auto mid = Clock::now();
+        bool index_ok = index_login(index, login);
+        auto end = Clock::now();
+
+        sqlite_latencies.push_back(mid - start);
+        index_latencies.push_back(end - mid);
+
+        if (sqlite_ok != index_ok)
+        {
+            ++mismatches;
+        }
+    }
+
+    report("sqlite", sqlite_latencies);
+    report("index", index_latencies);
+    sqlite3_close_v2(handle);
+
+    if (mismatches)
+    {
+        cerr << "error: " << mismatches << " logins had a different result." << endl;
+    }
+
+    return mismatches ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+}
+
+int main(int argc, char* argv[])
+{
+    int rc = EXIT_SUCCESS;
+    int n_users = 1000;
+    int n_logins = 100000;
+
+    int c;
+    while ((c = getopt(argc, argv, "u:n:")) != -1)
+    {
+        switch (c)
+        {
+        case 'u':
+            n_users = atoi(optarg);
+            break;
+
+        case 'n':
+            n_logins = atoi(optarg);
+            break;
+
+        default:
+            rc = EXIT_FAILURE;
+        }
+    }
+
+    if (rc == EXIT_SUCCESS && n_users > 0 && n_logins > 0)
+    {
+        maxbase::init();
+        maxbase::Log log(MXB_LOG_TARGET_STDOUT);
+
+        rc = run(n_users, n_logins);
+    }
+    else
+    {
+        cout << USAGE << endl;
+    }
+
+    return rc;
+}
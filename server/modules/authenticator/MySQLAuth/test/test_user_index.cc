@@ -0,0 +1,241 @@
+/*
+ * Copyright (c) 2018 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2022-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+#include "user_index.hh"
+
+#include <iostream>
+
+#include <maxbase/log.hh>
+#include <maxbase/maxbase.hh>
+
+using namespace std;
+
+namespace
+{
+
+int expect(bool condition, const string& what)
+{
+    if (!condition)
+    {
+        cout << "error: " << what << endl;
+    }
+
+    return condition ? 0 : 1;
+}
+
+int test_like()
+{
+    struct TestCase
+    {
+        const char* pattern;
+        const char* str;
+        bool        result;
+    };
+
+    TestCase cases[] =
+    {
+        {"%",           "anything",       true },
+        {"%",           "",               true },
+        {"localhost",   "localhost",      true },
+        {"localhost",   "LocalHost",      true },
+        {"localhost",   "localhost2",     false},
+        {"192.168.%",   "192.168.0.1",    true },
+        {"192.168.%",   "192.168.",       true },
+        {"192.168.%",   "192.169.0.1",    false},
+        {"%.example.com", "db.example.com", true },
+        {"%.example.com", "example.com",  false},
+        {"db_.example.com", "db1.example.com", true },
+        {"db_.example.com", "db.example.com", false},
+        {"a%b%c",       "aXbYc",          true },
+        {"a%b%c",       "abbbc",          true },
+        {"a%b%c",       "aXbY",           false},
+        {"%%",          "x",              true },
+        {"",            "",               true },
+        {"",            "x",              false},
+    };
+
+    int rv = 0;
+
+    for (const auto& c : cases)
+    {
+        rv += expect(LikePattern(c.pattern).matches(c.str) == c.result,
+                     string("'") + c.str + "' LIKE '" + c.pattern + "'");
+    }
+
+    return rv;
+}
+
+int test_host()
+{
+    int rv = 0;
+    HostPattern netmask("192.168.0.0/255.255.0.0");
+
+    rv += expect(netmask.matches("192.168.1.2"), "Address should be in the network");
+    rv += expect(!netmask.matches("192.169.1.2"), "Address should not be in the network");
+    rv += expect(!netmask.matches("db.example.com"), "Hostnames should not match a netmask");
+
+    HostPattern host_bits("192.168.0.1/255.255.255.0");
+    rv += expect(!host_bits.matches("192.168.0.1"), "Host bits outside of the netmask should never match");
+
+    HostPattern invalid("192.168.0.0/255.255");
+    rv += expect(!invalid.matches("192.168.0.0"), "Malformed netmask should not match");
+    rv += expect(!invalid.matches("192.168.0.0/255.255"), "Malformed netmask should not match itself");
+
+    rv += expect(HostPattern("10.0.0.%").matches("10.0.0.5"), "Wildcard host should match");
+
+    return rv;
+}
+
+int test_index()
+{
+    int rv = 0;
+    UserIndex index;
+
+    index.add_user("bob", "10.0.0.%", "test", false, "*0123456789ABCDEF0123456789ABCDEF01234567");
+    index.add_user("bob", "10.0.0.%", "shop%", false, "*0123456789ABCDEF0123456789ABCDEF01234567");
+    index.add_user("bob", "%", NULL, false, "*FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFF");
+    index.add_user("alice", "%", NULL, true, NULL);
+    index.add_user("old", "%", NULL, true, "0123456789ABCDEF");
+    index.add_database("test");
+    index.add_database("Shop1");
+
+    rv += expect(index.size() == 3, "Grants of the same account should be combined");
+    rv += expect(index.accounts().size() == 3, "Wrong number of accounts listed");
+    rv += expect(!index.has_user("old"), "Users with old passwords should be ignored");
+    rv += expect(!index.has_user("carol"), "Unknown user should not exist");
+
+    const UserIndex::Account* a = index.find("bob", "10.0.0.1", "test");
+    rv += expect(a && a->password == "0123456789ABCDEF0123456789ABCDEF01234567",
+                 "Database grant should match and the leading '*' should be removed");
+
+    a = index.find("bob", "10.0.0.1", "SHOP1");
+    rv += expect(a && a->host.str() == "10.0.0.%", "Database patterns should be case-insensitive");
+
+    a = index.find("bob", "10.0.0.1", "");
+    rv += expect(a && a->host.str() == "10.0.0.%", "No database should match the first account");
+
+    a = index.find("bob", "10.0.0.1", "other");
+    rv += expect(!a, "Database without grants should not match");
+
+    a = index.find("bob", "192.168.0.1", "");
+    rv += expect(a && a->host.str() == "%", "Host should match the second account");
+
+    a = index.find("bob", NULL, "test");
+    rv += expect(a && a->host.str() == "10.0.0.%", "The host should be ignored");
+
+    a = index.find("alice", "192.168.0.1", "anything");
+    rv += expect(a && a->password.empty(), "Global grants should match any database");
+
+    rv += expect(index.has_database("test"), "Database should exist");
+    rv += expect(index.has_database(""), "Empty database should always exist");
+    rv += expect(!index.has_database("TEST"), "Database names should be case-sensitive");
+
+    UserIndex lower(true);
+    lower.add_database("Shop1");
+    rv += expect(lower.has_database("SHOP1"), "Database names should be case-insensitive");
+
+    return rv;
+}
+
+int test_merge()
+{
+    int rv = 0;
+    UserIndex first;
+    UserIndex second;
+
+    first.add_user("bob", "%", "test", false, NULL);
+    first.add_database("test");
+    second.add_user("bob", "%", "shop", false, NULL);
+    second.add_user("alice", "%", NULL, true, NULL);
+    second.add_database("shop");
+
+    first.merge(second);
+    rv += expect(first.size() == 2, "Accounts in both indexes should be combined");
+    rv += expect(first.find("bob", "127.0.0.1", "test") && first.find("bob", "127.0.0.1", "shop"),
+                 "Grants of both indexes should be used");
+    rv += expect(first.has_user("alice"), "New users should be added");
+    rv += expect(first.has_database("test") && first.has_database("shop"), "Databases should be added");
+
+    return rv;
+}
+
+int test_diff()
+{
+    int rv = 0;
+    UserIndex old_users;
+    UserIndex new_users;
+
+    old_users.add_user("bob", "%", "test", false, "*0123456789ABCDEF0123456789ABCDEF01234567");
+    old_users.add_user("bob", "%", "shop", false, "*0123456789ABCDEF0123456789ABCDEF01234567");
+    old_users.add_user("alice", "%", NULL, true, NULL);
+    old_users.add_user("carol", "%", NULL, true, NULL);
+    old_users.add_database("test");
+
+    // Same grants in a different order
+    new_users.add_user("bob", "%", "shop", false, "*0123456789ABCDEF0123456789ABCDEF01234567");
+    new_users.add_user("bob", "%", "test", false, "*0123456789ABCDEF0123456789ABCDEF01234567");
+    new_users.add_user("alice", "%", NULL, true, "*FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFF");
+    new_users.add_user("dave", "%", NULL, true, NULL);
+    new_users.add_database("test");
+
+    UserIndex::Diff diff = new_users.diff(old_users);
+    rv += expect(diff.added == 1, "One account should be added");
+    rv += expect(diff.removed == 1, "One account should be removed");
+    rv += expect(diff.changed == 1, "One account should be changed");
+    rv += expect(!diff.databases, "Databases should not change");
+    rv += expect(old_users.diff(old_users).empty(), "Index should not differ from itself");
+
+    new_users.add_database("shop");
+    rv += expect(new_users.diff(old_users).databases, "Databases should change");
+
+    return rv;
+}
+
+int test_shared()
+{
+    int rv = 0;
+    SharedUserIndex shared(2);
+
+    const UserIndex* first = shared.get(0);
+    rv += expect(first && first->size() == 0, "Initial index should be empty");
+
+    auto users = std::make_shared<UserIndex>();
+    users->add_user("bob", "%", NULL, true, NULL);
+    shared.publish(users);
+
+    rv += expect(shared.get(0) == users.get(), "Worker should see the published index");
+    rv += expect(shared.get(1) == users.get(), "All workers should see the published index");
+    rv += expect(shared.get() == users, "The published index should be returned");
+
+    users.reset();
+    rv += expect(shared.get(0)->has_user("bob"), "Published index should be kept alive");
+
+    return rv;
+}
+}
+
+int main()
+{
+    maxbase::init();
+    maxbase::Log log;
+
+    int rv = 0;
+    rv += test_like();
+    rv += test_host();
+    rv += test_index();
+    rv += test_merge();
+    rv += test_diff();
+    rv += test_shared();
+
+    return rv;
+}
@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2018 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2022-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+#include "user_refresh.hh"
+
+#include <atomic>
+#include <iostream>
+
+#include <maxbase/log.hh>
+#include <maxbase/maxbase.hh>
+#include <maxscale/config.h>
+
+using namespace std;
+
+namespace
+{
+
+int expect(bool condition, const string& what)
+{
+    if (!condition)
+    {
+        cout << "error: " << what << endl;
+    }
+
+    return condition ? 0 : 1;
+}
+
+/**
+ * A load that blocks until it is released
+ */
+class Load
+{
+public:
+    std::function<void()> function()
+    {
+        return [this]() {
+                   std::unique_lock<std::mutex> guard(m_lock);
+                   ++m_started;
+                   m_cond.notify_all();
+                   m_cond.wait(guard, [this]() {
+                                   return m_released >= m_started;
+                               });
+               };
+    }
+
+    void wait_started(int n)
+    {
+        std::unique_lock<std::mutex> guard(m_lock);
+        m_cond.wait(guard, [this, n]() {
+                        return m_started >= n;
+                    });
+    }
+
+    void release()
+    {
+        std::lock_guard<std::mutex> guard(m_lock);
+        ++m_released;
+        m_cond.notify_all();
+    }
+
+    int started()
+    {
+        std::lock_guard<std::mutex> guard(m_lock);
+        return m_started;
+    }
+
+private:
+    std::mutex              m_lock;
+    std::condition_variable m_cond;
+    int                     m_started {0};
+    int                     m_released {0};
+};
+
+void wait_for(std::atomic<int>& value, int expected)
+{
+    while (value.load() < expected)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+int test_queued()
+{
+    int rv = 0;
+    Load load;
+    std::atomic<int> first {0};
+    std::atomic<int> second {0};
+    config_get_global_options()->users_refresh_time = 0;
+
+    {
+        UserRefresh refresh;
+
+        rv += expect(refresh.request(load.function(), [&]() {
+                                         ++first;
+                                     }),
+                     "The first request should start a load");
+        load.wait_started(1);
+
+        // The load in progress may have read the users before they changed
+        config_get_global_options()->users_refresh_time = 3600;
+        rv += expect(refresh.request(load.function(), [&]() {
+                                         ++second;
+                                     }),
+                     "A request during a load should be queued");
+        rv += expect(refresh.request(load.function(), [&]() {
+                                         ++second;
+                                     }),
+                     "Requests during a load should share the queued load");
+
+        load.release();
+        wait_for(first, 1);
+        load.wait_started(2);
+        rv += expect(second == 0, "The queued requests should wait for the queued load");
+
+        rv += expect(!refresh.request(load.function(), []() {
+                                      }),
+                     "A request during a queued load should be rate limited");
+
+        load.release();
+        wait_for(second, 2);
+        rv += expect(first == 1, "The first callback should be called once");
+        rv += expect(load.started() == 2, "Only one extra load should be done");
+    }
+
+    config_get_global_options()->users_refresh_time = 0;
+    return rv;
+}
+}
+
+int main()
+{
+    maxbase::init();
+    maxbase::Log log;
+
+    int rv = 0;
+    rv += test_queued();
+
+    return rv;
+}
@@ -0,0 +1,416 @@
+/*
+ * Copyright (c) 2018 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2022-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+#define MXS_MODULE_NAME "MySQLAuth"
+
+#include "user_index.hh"
+
+#include <arpa/inet.h>
+#include <string.h>
+#include <strings.h>
+
+#include <algorithm>
+
+#include <maxbase/assert.h>
+#include <maxscale/log.h>
+
+namespace
+{
+
+inline char ascii_lower(char c)
+{
+    return c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c;
+}
+
+/**
+ * Match a string against a LIKE pattern
+ *
+ * When a mismatch is found after a `%`, the matching is resumed from the
+ * character after the one the last `%` was first matched against.
+ */
+bool like_match(const char* pattern, const char* str)
+{
+    const char* wild_pattern = NULL;
+    const char* wild_str = NULL;
+
+    while (*str)
+    {
+        if (*pattern == '%')
+        {
+            wild_pattern = ++pattern;
+            wild_str = str;
+        }
+        else if (*pattern && (*pattern == '_' || ascii_lower(*pattern) == ascii_lower(*str)))
+        {
+            ++pattern;
+            ++str;
+        }
+        else if (wild_pattern)
+        {
+            pattern = wild_pattern;
+            str = ++wild_str;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    while (*pattern == '%')
+    {
+        ++pattern;
+    }
+
+    return *pattern == '\0';
+}
+
+bool parse_ipv4(const char* str, uint32_t* address)
+{
+    struct in_addr addr;
+    bool rval = inet_pton(AF_INET, str, &addr) == 1;
+
+    if (rval)
+    {
+        *address = ntohl(addr.s_addr);
+    }
+
+    return rval;
+}
+
+template<class Accounts>
+auto find_host(Accounts& accounts, const std::string& host) -> decltype(accounts.begin())
+{
+    return std::find_if(accounts.begin(), accounts.end(), [&host](const UserIndex::Account& a) {
+                            return a.host.str() == host;
+                        });
+}
+
+std::vector<std::string> sorted_databases(const UserIndex::Account& account)
+{
+    std::vector<std::string> rval;
+
+    for (const auto& db : account.databases)
+    {
+        rval.push_back(db.str());
+    }
+
+    std::sort(rval.begin(), rval.end());
+    return rval;
+}
+
+bool same_grants(const UserIndex::Account& lhs, const UserIndex::Account& rhs)
+{
+    return lhs.password == rhs.password && lhs.anydb == rhs.anydb
+           && sorted_databases(lhs) == sorted_databases(rhs);
+}
+
+std::string to_lower(const char* str)
+{
+    std::string rval(str);
+
+    for (auto& c : rval)
+    {
+        c = ascii_lower(c);
+    }
+
+    return rval;
+}
+}
+
+LikePattern::LikePattern(const std::string& pattern)
+    : m_pattern(pattern)
+{
+    size_t pos = pattern.find_first_of("%_");
+
+    if (pos == std::string::npos)
+    {
+        m_type = EXACT;
+    }
+    else if (pattern == "%")
+    {
+        m_type = ANY;
+    }
+    else if (pos == pattern.length() - 1 && pattern[pos] == '%')
+    {
+        m_type = PREFIX;
+    }
+    else
+    {
+        m_type = GENERIC;
+    }
+}
+
+bool LikePattern::matches(const char* str) const
+{
+    switch (m_type)
+    {
+    case ANY:
+        return true;
+
+    case EXACT:
+        return strcasecmp(str, m_pattern.c_str()) == 0;
+
+    case PREFIX:
+        return strncasecmp(str, m_pattern.c_str(), m_pattern.length() - 1) == 0;
+
+    case GENERIC:
+        return like_match(m_pattern.c_str(), str);
+    }
+
+    mxb_assert(!true);
+    return false;
+}
+
+HostPattern::HostPattern(const std::string& host)
+    : m_type(LIKE)
+    , m_like(host)
+    , m_address(0)
+    , m_mask(0)
+{
+    size_t pos = host.find('/');
+
+    if (pos != std::string::npos)
+    {
+        std::string address = host.substr(0, pos);
+        std::string mask = host.substr(pos + 1);
+
+        if (parse_ipv4(address.c_str(), &m_address) && parse_ipv4(mask.c_str(), &m_mask))
+        {
+            m_type = NETMASK;
+        }
+        else
+        {
+            MXS_ERROR("Malformed host/mask-combination, no client will match it: %s", host.c_str());
+            m_type = INVALID;
+        }
+    }
+}
+
+bool HostPattern::matches(const char* host) const
+{
+    switch (m_type)
+    {
+    case LIKE:
+        return m_like.matches(host);
+
+    case NETMASK:
+        {
+            uint32_t address;
+            return parse_ipv4(host, &address) && (address & m_mask) == m_address;
+        }
+
+    case INVALID:
+        return false;
+    }
+
+    mxb_assert(!true);
+    return false;
+}
+
+UserIndex::UserIndex(bool lower_case_table_names)
+    : m_lower_case_table_names(lower_case_table_names)
+{
+}
+
+void UserIndex::add_user(const char* user, const char* host, const char* db, bool anydb, const char* pw)
+{
+    if (pw && *pw)
+    {
+        if (strlen(pw) == 16)
+        {
+            MXS_ERROR("The user %s@%s has on old password in the "
+                      "backend database. MaxScale does not support these "
+                      "old passwords. This user will not be able to connect "
+                      "via MaxScale. Update the users password to correct "
+                      "this.",
+                      user,
+                      host);
+            return;
+        }
+        else if (*pw == '*')
+        {
+            pw++;
+        }
+    }
+    else
+    {
+        pw = "";
+    }
+
+    auto& accounts = m_users[user];
+    auto it = find_host(accounts, host);
+
+    if (it == accounts.end())
+    {
+        accounts.push_back({HostPattern(host), pw, anydb, {}});
+        it = std::prev(accounts.end());
+        m_size++;
+    }
+    else
+    {
+        // With roles, the grants of the same account can come from different rows
+        it->anydb = it->anydb || anydb;
+    }
+
+    if (db && *db)
+    {
+        it->databases.emplace_back(db);
+    }
+
+    MXS_INFO("Added user: %s@%s, database: %s, anydb: %s",
+             user, host, db ? db : "NULL", anydb ? "true" : "false");
+}
+
+void UserIndex::add_database(const char* db)
+{
+    m_databases.insert(m_lower_case_table_names ? to_lower(db) : std::string(db));
+}
+
+void UserIndex::merge(const UserIndex& other)
+{
+    for (const auto& user : other.m_users)
+    {
+        auto& accounts = m_users[user.first];
+
+        for (const auto& account : user.second)
+        {
+            auto it = find_host(accounts, account.host.str());
+
+            if (it == accounts.end())
+            {
+                accounts.push_back(account);
+                m_size++;
+            }
+            else
+            {
+                it->anydb = it->anydb || account.anydb;
+                it->databases.insert(it->databases.end(), account.databases.begin(), account.databases.end());
+            }
+        }
+    }
+
+    m_databases.insert(other.m_databases.begin(), other.m_databases.end());
+}
+
+UserIndex::Diff UserIndex::diff(const UserIndex& old) const
+{
+    Diff rval;
+
+    for (const auto& user : m_users)
+    {
+        auto old_user = old.m_users.find(user.first);
+
+        for (const auto& account : user.second)
+        {
+            if (old_user == old.m_users.end())
+            {
+                rval.added++;
+            }
+            else
+            {
+                auto it = find_host(old_user->second, account.host.str());
+
+                if (it == old_user->second.end())
+                {
+                    rval.added++;
+                }
+                else if (!same_grants(account, *it))
+                {
+                    rval.changed++;
+                }
+            }
+        }
+    }
+
+    // The accounts that are in both indexes were either changed or not
+    rval.removed = old.m_size - (m_size - rval.added);
+    rval.databases = m_databases != old.m_databases;
+
+    return rval;
+}
+
+const UserIndex::Account* UserIndex::find(const char* user, const char* host, const char* db) const
+{
+    auto it = m_users.find(user);
+
+    if (it != m_users.end())
+    {
+        for (const auto& account : it->second)
+        {
+            if ((!host || account.host.matches(host))
+                && (account.anydb || !*db
+                    || std::any_of(account.databases.begin(), account.databases.end(),
+                                   [db](const LikePattern& p) {
+                                       return p.matches(db);
+                                   })))
+            {
+                return &account;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+bool UserIndex::has_database(const char* db) const
+{
+    return !*db || m_databases.count(m_lower_case_table_names ? to_lower(db) : std::string(db));
+}
+
+std::vector<std::pair<std::string, std::string>> UserIndex::accounts() const
+{
+    std::vector<std::pair<std::string, std::string>> rval;
+    rval.reserve(m_size);
+
+    for (const auto& user : m_users)
+    {
+        for (const auto& account : user.second)
+        {
+            rval.emplace_back(user.first, account.host.str());
+        }
+    }
+
+    return rval;
+}
+
+SharedUserIndex::SharedUserIndex(int n_workers)
+    : m_index(std::make_shared<UserIndex>())
+    , m_snapshots(n_workers)
+{
+}
+
+void SharedUserIndex::publish(SUserIndex index)
+{
+    std::atomic_store(&m_index, std::move(index));
+    m_version.fetch_add(1, std::memory_order_release);
+}
+
+SUserIndex SharedUserIndex::get() const
+{
+    return std::atomic_load(&m_index);
+}
+
+const UserIndex* SharedUserIndex::get(int worker_id)
+{
+    mxb_assert(worker_id >= 0 && worker_id < (int)m_snapshots.size());
+    Snapshot& snapshot = m_snapshots[worker_id];
+    uint64_t version = m_version.load(std::memory_order_acquire);
+
+    if (snapshot.version != version)
+    {
+        snapshot.index = get();
+        snapshot.version = version;
+    }
+
+    return snapshot.index.get();
+}
@@ -0,0 +1,298 @@
+/*
+ * Copyright (c) 2018 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2022-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+#pragma once
+
+/**
+ * In-memory index of the MySQL user accounts
+ *
+ * The index is built once each time the users are loaded and is not modified
+ * after it has been published. This allows all routing workers to use the same
+ * index without any locking.
+ */
+
+#include <maxscale/ccdefs.hh>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+/**
+ * A precompiled SQL LIKE pattern
+ *
+ * The `%` character matches any sequence of characters and `_` matches exactly one
+ * character. The matching is case-insensitive for ASCII characters and escape
+ * characters are not supported.
+ */
+class LikePattern
+{
+public:
+    explicit LikePattern(const std::string& pattern);
+
+    /**
+     * Check if a string matches the pattern
+     *
+     * @param str String to match
+     *
+     * @return True if the string matches the pattern
+     */
+    bool matches(const char* str) const;
+
+    const std::string& str() const
+    {
+        return m_pattern;
+    }
+
+private:
+    enum Type
+    {
+        ANY,        /**< Matches everything, the pattern is `%` */
+        EXACT,      /**< No wildcards */
+        PREFIX,     /**< Only one wildcard which is a `%` at the end */
+        GENERIC     /**< Anything else */
+    };
+
+    Type        m_type;
+    std::string m_pattern;
+};
+
+/**
+ * The host part of a user account
+ *
+ * The host is either a LIKE pattern or an IPv4 address with a netmask, e.g.
+ * `192.168.0.0/255.255.0.0`. A netmask only matches IPv4 addresses.
+ */
+class HostPattern
+{
+public:
+    explicit HostPattern(const std::string& host);
+
+    /**
+     * Check if a client host matches the pattern
+     *
+     * @param host The IP address or the hostname of the client
+     *
+     * @return True if the host matches the pattern
+     */
+    bool matches(const char* host) const;
+
+    const std::string& str() const
+    {
+        return m_like.str();
+    }
+
+private:
+    enum Type
+    {
+        LIKE,
+        NETMASK,
+        INVALID     /**< Malformed netmask, never matches */
+    };
+
+    Type        m_type;
+    LikePattern m_like;
+    uint32_t    m_address;  /**< Network address in host byte order */
+    uint32_t    m_mask;     /**< Netmask in host byte order */
+};
+
+/**
+ * The user accounts and the databases of a service
+ */
+class UserIndex
+{
+public:
+    UserIndex(const UserIndex&) = delete;
+    UserIndex& operator=(const UserIndex&) = delete;
+
+    struct Account
+    {
+        HostPattern              host;
+        std::string              password;  /**< Hex encoded hash without the leading `*` */
+        bool                     anydb;     /**< Access to all databases */
+        std::vector<LikePattern> databases; /**< Database level grants */
+    };
+
+    /**
+     * @param lower_case_table_names Whether database names are case-insensitive
+     */
+    explicit UserIndex(bool lower_case_table_names = false);
+
+    /**
+     * Add a grant for a user
+     *
+     * The grants of the same user and host are combined into one account.
+     *
+     * @param user  Username
+     * @param host  Host pattern of the account
+     * @param db    Database of the grant, NULL or empty for none
+     * @param anydb Whether the user has access to all databases
+     * @param pw    The password hash, NULL or empty for no password
+     */
+    void add_user(const char* user, const char* host, const char* db, bool anydb, const char* pw);
+
+    /**
+     * Add an existing database
+     *
+     * @param db The database name
+     */
+    void add_database(const char* db);
+
+    /**
+     * Add the accounts and databases of another index
+     *
+     * Accounts that exist in both indexes are combined.
+     *
+     * @param other The index to add
+     */
+    void merge(const UserIndex& other);
+
+    /**
+     * Differences between two indexes
+     */
+    struct Diff
+    {
+        size_t added {0};           /**< Accounts that were added */
+        size_t removed {0};         /**< Accounts that were removed */
+        size_t changed {0};         /**< Accounts with a new password or grants */
+        bool   databases {false};   /**< Whether the databases changed */
+
+        bool empty() const
+        {
+            return added == 0 && removed == 0 && changed == 0 && !databases;
+        }
+    };
+
+    /**
+     * Compare to an older version of the index
+     *
+     * @param old The old index
+     *
+     * @return The changes from @c old to this index
+     */
+    Diff diff(const UserIndex& old) const;
+
+    /**
+     * Find the account of a user
+     *
+     * @param user Username
+     * @param host IP address or hostname of the client, NULL to ignore the host
+     * @param db   The default database, empty for none
+     *
+     * @return The first account that matches the host and has access to the
+     *         database or NULL if no such account exists
+     */
+    const Account* find(const char* user, const char* host, const char* db) const;
+
+    /**
+     * Check if there are accounts for a user
+     *
+     * @param user Username
+     *
+     * @return True if at least one account exists
+     */
+    bool has_user(const char* user) const
+    {
+        return m_users.find(user) != m_users.end();
+    }
+
+    /**
+     * Check if a database exists
+     *
+     * @param db Database name
+     *
+     * @return True if the database exists or if @c db is empty
+     */
+    bool has_database(const char* db) const;
+
+    /**
+     * @return The number of accounts
+     */
+    size_t size() const
+    {
+        return m_size;
+    }
+
+    bool lower_case_table_names() const
+    {
+        return m_lower_case_table_names;
+    }
+
+    /**
+     * @return The user and host of each account
+     */
+    std::vector<std::pair<std::string, std::string>> accounts() const;
+
+private:
+    std::unordered_map<std::string, std::vector<Account>> m_users;
+    std::unordered_set<std::string>                       m_databases;
+    bool                                                  m_lower_case_table_names;
+    size_t                                                m_size {0};
+};
+
+typedef std::shared_ptr<const UserIndex> SUserIndex;
+
+/**
+ * The user index currently in use
+ *
+ * A new index is taken into use by publishing it. Each routing worker keeps its
+ * own reference to the latest index which means that looking up the index does
+ * not touch any shared state unless a new one has been published.
+ */
+class SharedUserIndex
+{
+public:
+    SharedUserIndex(const SharedUserIndex&) = delete;
+    SharedUserIndex& operator=(const SharedUserIndex&) = delete;
+
+    /**
+     * @param n_workers Number of routing workers
+     */
+    explicit SharedUserIndex(int n_workers);
+
+    /**
+     * Take a new index into use
+     *
+     * @param index The new index
+     */
+    void publish(SUserIndex index);
+
+    /**
+     * Get the current index, can be called from any thread
+     *
+     * @return The current index
+     */
+    SUserIndex get() const;
+
+    /**
+     * Get the current index on a routing worker
+     *
+     * @param worker_id The ID of the calling routing worker
+     *
+     * @return The current index, valid until the worker calls this again
+     */
+    const UserIndex* get(int worker_id);
+
+private:
+    struct Snapshot
+    {
+        uint64_t   version {0};
+        SUserIndex index;
+    };
+
+    SUserIndex            m_index;
+    std::atomic<uint64_t> m_version {1};
+    std::vector<Snapshot> m_snapshots;  /**< Indexed by worker ID */
+};
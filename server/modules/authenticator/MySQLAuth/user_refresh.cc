@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2018 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2022-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+#define MXS_MODULE_NAME "MySQLAuth"
+
+#include "user_refresh.hh"
+
+#include <maxscale/config.h>
+#include <maxscale/log.h>
+
+UserRefresh::UserRefresh()
+    : m_pool(1)
+{
+}
+
+bool UserRefresh::request(std::function<void()> load, std::function<void()> callback)
+{
+    std::lock_guard<std::mutex> guard(m_lock);
+
+    if (m_waiters.empty())
+    {
+        time_t now = time(NULL);
+        time_t refresh_time = config_get_global_options()->users_refresh_time;
+
+        if (m_loading && !m_rerun)
+        {
+            // The load in progress may miss the changes, queue one more load
+            m_queued = true;
+        }
+        else if (now < m_last + refresh_time)
+        {
+            if (!m_warned)
+            {
+                MXS_WARNING("Refresh rate limit (once every %ld seconds) exceeded for "
+                            "load of users' table.", refresh_time);
+                m_warned = true;
+            }
+
+            return false;
+        }
+
+        m_last = now;
+        m_warned = false;
+        m_load = std::move(load);
+
+        if (!m_loading)
+        {
+            // A load in progress starts the next one when it completes
+            m_loading = true;
+            m_pool.execute([this]() {
+                               run();
+                           });
+        }
+    }
+
+    m_waiters.push_back({mxb::Worker::get_current(), std::move(callback)});
+    return true;
+}
+
+void UserRefresh::run()
+{
+    std::unique_lock<std::mutex> guard(m_lock);
+
+    while (!m_waiters.empty())
+    {
+        // Requests made from now on wait for the next load
+        m_rerun = m_queued;
+        m_queued = false;
+        std::function<void()> load = std::move(m_load);
+        std::vector<Waiter> waiters = std::move(m_waiters);
+        m_waiters.clear();
+        guard.unlock();
+
+        load();
+
+        for (auto& w : waiters)
+        {
+            mxs::ThreadPool::post(w.worker, std::move(w.callback));
+        }
+
+        guard.lock();
+    }
+
+    m_loading = false;
+}
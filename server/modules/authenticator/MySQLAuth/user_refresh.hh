@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2018 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2022-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+#pragma once
+
+#include <maxscale/ccdefs.hh>
+
+#include <ctime>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include <maxbase/worker.hh>
+#include <maxscale/threadpool.hh>
+
+/**
+ * Loads the users in a background thread
+ *
+ * This is used when a client fails to authenticate so that the routing worker
+ * does not block while the users are loaded. Requests made while the users are
+ * being loaded are combined into one more load that starts when the current one
+ * completes, as the load in progress may have read the users before they changed.
+ */
+class UserRefresh
+{
+public:
+    UserRefresh(const UserRefresh&) = delete;
+    UserRefresh& operator=(const UserRefresh&) = delete;
+
+    UserRefresh();
+
+    /**
+     * Request the users to be loaded
+     *
+     * A new load is started at most once every `users_refresh_time` seconds. A
+     * request made while a load is in progress is always queued for the next
+     * load, unless that load was itself queued this way. The callback is executed on the routing worker that called this function. If
+     * the function was not called from a worker, the callback is executed on the
+     * background thread.
+     *
+     * @param load     Function that loads the users, called if a new load is started
+     * @param callback Function to call once the users have been loaded
+     *
+     * @return True if the users will be loaded and @c callback will be called,
+     *         false if the rate limit was exceeded
+     */
+    bool request(std::function<void()> load, std::function<void()> callback);
+
+private:
+    struct Waiter
+    {
+        mxb::Worker*          worker;   /**< Worker that gets the callback, NULL for none */
+        std::function<void()> callback;
+    };
+
+    void run();
+
+    std::mutex              m_lock;
+    std::function<void()>   m_load;             /**< The next load */
+    std::vector<Waiter>     m_waiters;          /**< Waiting for the next load to complete */
+    bool                    m_loading {false};  /**< Whether a load is in progress or about to start */
+    bool                    m_queued {false};   /**< Whether the next load was queued during a load */
+    bool                    m_rerun {false};    /**< Whether the load in progress was queued */
+    time_t                  m_last {0};         /**< When the last load was started */
+    bool                    m_warned {false};   /**< Whether the rate limit warning was logged */
+    mxs::ThreadPool         m_pool;             /**< Stopped first, uses the above */
+};
@@ -27,7 +27,6 @@ const string FIELD_DB = "db";
 const string FIELD_ANYDB = "anydb";
 const string FIELD_AUTHSTR = "authentication_string";
 const string FIELD_PROXY = "proxy_grant";
-const int NUM_FIELDS = 6;
 
 /**
  * Initialize PAM authenticator
@@ -97,8 +96,9 @@ static bool pam_auth_connectssl(DCB* dcb)
  *
  * @param dcb Client DCB
  *
- * @return MXS_AUTH_INCOMPLETE if authentication is not yet complete. MXS_AUTH_SUCCEEDED
- * if authentication was successfully completed. MXS_AUTH_FAILED if authentication
+ * @return MXS_AUTH_INCOMPLETE if authentication is not yet complete. MXS_AUTH_PENDING
+ * if the password is being checked in the background. MXS_AUTH_SUCCEEDED if
+ * authentication was successfully completed. MXS_AUTH_FAILED if authentication
  * has failed.
  */
 static int pam_auth_authenticate(DCB* dcb)
@@ -153,6 +153,12 @@ static json_t* pam_auth_diagnostic_json(const SERV_LISTENER* listener)
     return inst->diagnostic_json();
 }
 
+static json_t* pam_auth_statistics_json(const SERV_LISTENER* listener)
+{
+    PamInstance* inst = static_cast<PamInstance*>(listener->auth_instance);
+    return inst->statistics_json();
+}
+
 extern "C"
 {
 /**
@@ -172,7 +178,8 @@ extern "C"
             pam_auth_load_users,        /* Load database users */
             pam_auth_diagnostic,        /* Default user diagnostic */
             pam_auth_diagnostic_json,   /* Default user diagnostic */
-            NULL                        /* No user reauthentication */
+            NULL,                       /* No user reauthentication */
+            pam_auth_statistics_json    /* Authentication thread statistics */
         };
 
         static MXS_MODULE info =
@@ -33,4 +33,3 @@ extern const string FIELD_DB;
 extern const string FIELD_ANYDB;
 extern const string FIELD_AUTHSTR;
 extern const string FIELD_PROXY;
-extern const int NUM_FIELDS;
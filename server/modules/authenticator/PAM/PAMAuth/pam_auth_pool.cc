@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2018 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2022-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+#include "pam_auth.hh"
+#include "pam_auth_pool.hh"
+
+#include <algorithm>
+#include <maxscale/log.h>
+
+using std::chrono::duration_cast;
+using std::chrono::microseconds;
+
+PamAuthPool::PamAuthPool(int n_threads, size_t max_queue)
+    : m_n_threads(n_threads)
+    , m_max_queue(max_queue)
+    , m_pool(n_threads)
+{
+}
+
+bool PamAuthPool::submit(std::function<bool()> auth, std::function<void(bool)> callback)
+{
+    std::lock_guard<std::mutex> guard(m_lock);
+
+    if (m_queued >= m_max_queue)
+    {
+        if (!m_warned)
+        {
+            MXS_WARNING("The PAM authentication queue is full (%lu authentications), rejecting "
+                        "clients until there is room in the queue.", m_queued);
+            m_warned = true;
+        }
+
+        ++m_rejected;
+        return false;
+    }
+
+    Job job {std::move(auth), std::move(callback), mxb::Worker::get_current(), Clock::now()};
+
+    if (!m_pool.execute([this, job]() mutable {
+                            run(job);
+                        }))
+    {
+        return false;
+    }
+
+    ++m_queued;
+    m_max_queued = std::max(m_max_queued, m_queued);
+
+    return true;
+}
+
+void PamAuthPool::run(Job& job)
+{
+    std::unique_lock<std::mutex> guard(m_lock);
+    --m_queued;
+    ++m_active;
+
+    if (m_queued == 0)
+    {
+        m_warned = false;
+    }
+
+    guard.unlock();
+
+    auto start = Clock::now();
+    bool result = job.auth();
+    auto end = Clock::now();
+
+    guard.lock();
+    uint64_t wait = duration_cast<microseconds>(start - job.queued).count();
+    uint64_t auth = duration_cast<microseconds>(end - start).count();
+    --m_active;
+    ++m_completed;
+    m_wait_total_us += wait;
+    m_wait_max_us = std::max(m_wait_max_us, wait);
+    m_auth_total_us += auth;
+    m_auth_max_us = std::max(m_auth_max_us, auth);
+    guard.unlock();
+
+    auto callback = std::move(job.callback);
+    mxs::ThreadPool::post(job.worker, [callback, result]() {
+                              callback(result);
+                          });
+}
+
+json_t* PamAuthPool::stats_json() const
+{
+    std::lock_guard<std::mutex> guard(m_lock);
+    json_t* rval = json_object();
+
+    json_object_set_new(rval, "threads", json_integer(m_n_threads));
+    json_object_set_new(rval, "max_queue", json_integer(m_max_queue));
+    json_object_set_new(rval, "queued", json_integer(m_queued));
+    json_object_set_new(rval, "max_queued", json_integer(m_max_queued));
+    json_object_set_new(rval, "active", json_integer(m_active));
+    json_object_set_new(rval, "completed", json_integer(m_completed));
+    json_object_set_new(rval, "rejected", json_integer(m_rejected));
+    json_object_set_new(rval, "avg_queue_time_us",
+                        json_integer(m_completed ? m_wait_total_us / m_completed : 0));
+    json_object_set_new(rval, "max_queue_time_us", json_integer(m_wait_max_us));
+    json_object_set_new(rval, "avg_auth_time_us",
+                        json_integer(m_completed ? m_auth_total_us / m_completed : 0));
+    json_object_set_new(rval, "max_auth_time_us", json_integer(m_auth_max_us));
+
+    return rval;
+}
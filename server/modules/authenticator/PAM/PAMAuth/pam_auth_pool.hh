@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2018 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2022-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+#pragma once
+
+#include <maxscale/ccdefs.hh>
+
+#include <chrono>
+#include <functional>
+#include <mutex>
+
+#include <maxscale/jansson.hh>
+#include <maxscale/threadpool.hh>
+
+/**
+ * Runs PAM authentications in a bounded pool of threads
+ *
+ * The PAM API is blocking and a PAM module can take seconds to reply, e.g. when
+ * it delays failed logins. The authentications are done by the pool so that the
+ * routing workers are never blocked by them.
+ */
+class PamAuthPool
+{
+public:
+    PamAuthPool(const PamAuthPool&) = delete;
+    PamAuthPool& operator=(const PamAuthPool&) = delete;
+
+    /**
+     * @param n_threads Number of authentication threads
+     * @param max_queue How many authentications can wait for a free thread
+     */
+    PamAuthPool(int n_threads, size_t max_queue);
+
+    /**
+     * Authenticate in the background
+     *
+     * The callback is executed on the routing worker that called this function. If
+     * the function was not called from a worker, the callback is executed on the
+     * authentication thread.
+     *
+     * @param auth     Function that does the authentication
+     * @param callback Function that is called with the result of @c auth
+     *
+     * @return True if the authentication was queued, false if the queue is full
+     */
+    bool submit(std::function<bool()> auth, std::function<void(bool)> callback);
+
+    /**
+     * @return Statistics about the queue and the authentication latency
+     */
+    json_t* stats_json() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Job
+    {
+        std::function<bool()>     auth;
+        std::function<void(bool)> callback;
+        mxb::Worker*              worker;   /**< Worker that gets the callback, NULL for none */
+        Clock::time_point         queued;
+    };
+
+    void run(Job& job);
+
+    mutable std::mutex m_lock;
+    const int          m_n_threads;
+    const size_t       m_max_queue;
+    bool               m_warned {false};    /**< Whether the full queue warning was logged */
+
+    // Statistics, protected by m_lock
+    size_t   m_queued {0};          /**< Authentications waiting for a thread */
+    size_t   m_active {0};          /**< Authentications in progress */
+    size_t   m_max_queued {0};      /**< Longest the queue has been */
+    uint64_t m_completed {0};
+    uint64_t m_rejected {0};        /**< Authentications rejected because the queue was full */
+    uint64_t m_wait_total_us {0};   /**< Time spent waiting in the queue */
+    uint64_t m_wait_max_us {0};
+    uint64_t m_auth_total_us {0};   /**< Time spent in the PAM API */
+    uint64_t m_auth_max_us {0};
+
+    mxs::ThreadPool m_pool;         /**< Stopped first, uses the above */
+};
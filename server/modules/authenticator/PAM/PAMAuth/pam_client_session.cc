@@ -16,6 +16,7 @@
 #include <sstream>
 #include <security/pam_appl.h>
 #include <maxscale/event.hh>
+#include <maxscale/poll.h>
 
 using maxscale::Buffer;
 using std::string;
@@ -49,41 +50,15 @@ bool store_client_password(DCB* dcb, GWBUF* buffer)
     return rval;
 }
 
-/**
- * Helper callback for PamClientSession::get_pam_user_services(). See SQLite3
- * documentation for more information.
- *
- * @param data Application data
- * @param columns Number of columns, must be 1
- * @param column_vals Column values
- * @param column_names Column names
- * @return Always 0
- */
-int user_services_cb(void* data, int columns, char** column_vals, char** column_names)
-{
-    mxb_assert(columns == 1);
-    PamClientSession::StringVector* results = static_cast<PamClientSession::StringVector*>(data);
-    if (column_vals[0])
-    {
-        results->push_back(column_vals[0]);
-    }
-    else
-    {
-        // Empty is a valid value.
-        results->push_back("");
-    }
-    return 0;
-}
-
 /** Used by the PAM conversation function */
 struct ConversationData
 {
-    DCB*   m_client;
+    string m_user;
     int    m_counter;
     string m_password;
 
-    ConversationData(DCB* client, int counter, const string& password)
-        : m_client(client)
+    ConversationData(const string& user, int counter, const string& password)
+        : m_user(user)
         , m_counter(counter)
         , m_password(password)
     {
@@ -108,7 +83,7 @@ int conversation_func(int num_msg,
     if (data->m_counter > 1)
     {
         MXS_ERROR("Multiple calls to conversation function for client '%s'. %s",
-                  data->m_client->user,
+                  data->m_user.c_str(),
                   GENERAL_ERRMSG);
     }
     else if (num_msg == 1)
@@ -149,15 +124,14 @@ int conversation_func(int num_msg,
  * @param user Username
  * @param password Password
  * @param service Which PAM service is the user logging to
- * @param client Client DCB
  * @return True if username & password are ok
  */
-bool validate_pam_password(const string& user, const string& password, const string& service, DCB* client)
+bool validate_pam_password(const string& user, const string& password, const string& service)
 {
     const char PAM_START_ERR_MSG[] = "Failed to start PAM authentication for user '%s': '%s'.";
     const char PAM_AUTH_ERR_MSG[] = "Pam authentication for user '%s' failed: '%s'.";
     const char PAM_ACC_ERR_MSG[] = "Pam account check for user '%s' failed: '%s'.";
-    ConversationData appdata(client, 0, password);
+    ConversationData appdata(user, 0, password);
     pam_conv conv_struct = {conversation_func, &appdata};
     bool authenticated = false;
     bool account_ok = false;
@@ -214,106 +188,114 @@ bool validate_pam_password(const string& user, const string& password, const str
     pam_end(pam_handle, pam_status);
     return account_ok;
 }
+
+/**
+ * @brief Check the client password against the PAM services of the user
+ *
+ * This is called by the PAM authentication threads.
+ *
+ * @param instance Authenticator instance
+ * @param service  The service the client is connecting to
+ * @param user     Username
+ * @param host     IP address of the client
+ * @param db       The default database, empty for none
+ * @param password Password
+ * @return True if the user was authenticated by one of the services
+ */
+bool validate_pam_user(PamInstance* instance, SERVICE* service, const string& user, const string& host,
+                       const string& db, const string& password)
+{
+    /*
+     * Authentication may be attempted twice: first with old user account info and then with
+     * updated info. Updating may fail if it has been attempted too often lately. The second password
+     * check is useless if the user services are same as on the first attempt.
+     */
+    bool authenticated = false;
+    PamUserIndex::StringVector services_old;
+    for (int loop = 0; loop < 2 && !authenticated; loop++)
+    {
+        if (loop == 0 || instance->refresh_users(service))
+        {
+            bool try_validate = true;
+            PamUserIndex::StringVector services = instance->users()->find_services(user, host, db);
+            if (loop == 0)
+            {
+                services_old = services;
+            }
+            else if (services == services_old)
+            {
+                try_validate = false;
+            }
+            if (try_validate)
+            {
+                for (auto iter = services.begin(); iter != services.end() && !authenticated; iter++)
+                {
+                    // The server PAM plugin uses "mysql" as the default service when authenticating
+                    // a user with no service.
+                    if (iter->empty())
+                    {
+                        *iter = "mysql";
+                    }
+                    if (validate_pam_password(user, password, *iter))
+                    {
+                        authenticated = true;
+                    }
+                }
+            }
+        }
+    }
+    return authenticated;
+}
 }
 
-PamClientSession::PamClientSession(sqlite3* dbhandle, const PamInstance& instance)
+PamClientSession::PamClientSession(PamInstance& instance)
     : m_state(PAM_AUTH_INIT)
     , m_sequence(0)
-    , m_dbhandle(dbhandle)
     , m_instance(instance)
 {
 }
 
-PamClientSession::~PamClientSession()
+PamClientSession* PamClientSession::create(PamInstance& inst)
 {
-    sqlite3_close_v2(m_dbhandle);
-}
-
-PamClientSession* PamClientSession::create(const PamInstance& inst)
-{
-    // This handle is only used from one thread, can define no_mutex.
-    sqlite3* dbhandle = NULL;
-    int db_flags = SQLITE_OPEN_READONLY | SQLITE_OPEN_SHAREDCACHE | SQLITE_OPEN_NOMUTEX;
-    if (sqlite3_open_v2(inst.m_dbname.c_str(), &dbhandle, db_flags, NULL) == SQLITE_OK)
-    {
-        sqlite3_busy_timeout(dbhandle, 1000);
-    }
-    else
-    {
-        MXS_ERROR("Failed to open SQLite3 handle.");
-    }
-    PamClientSession* rval = NULL;
-    if (!dbhandle || (rval = new(std::nothrow) PamClientSession(dbhandle, inst)) == NULL)
-    {
-        sqlite3_close_v2(dbhandle);
-    }
-    return rval;
+    return new(std::nothrow) PamClientSession(inst);
 }
 
 /**
- * Check which PAM services the session user has access to.
+ * Start the PAM authentication of the client
+ *
+ * The password is checked by the PAM authentication threads. Once the check is
+ * complete, the state of the session is updated and a read event is triggered on
+ * the client DCB which processes the authentication packet again.
  *
  * @param dcb Client DCB
  * @param session MySQL session
- * @param services_out Output for services
+ *
+ * @return True if the authentication was started, false if the queue is full
  */
-void PamClientSession::get_pam_user_services(const DCB* dcb, const MYSQL_session* session,
-                                             StringVector* services_out)
+bool PamClientSession::start_authentication(DCB* dcb, const MYSQL_session* session)
 {
-    string services_query = string("SELECT authentication_string FROM ") + m_instance.m_tablename + " WHERE "
-        + FIELD_USER + " = '" + session->user + "'"
-        + " AND '" + dcb->remote + "' LIKE " + FIELD_HOST
-        + " AND (" + FIELD_ANYDB + " = '1' OR '" + session->db + "' = '' OR '"
-        + session->db + "' LIKE " + FIELD_DB + ")"
-        + " AND " + FIELD_PROXY + " = '0' ORDER BY authentication_string;";
-    MXS_DEBUG("PAM services search sql: '%s'.", services_query.c_str());
-
-    char* err;
-    if (sqlite3_exec(m_dbhandle, services_query.c_str(), user_services_cb, services_out, &err) != SQLITE_OK)
-    {
-        MXS_ERROR("Failed to execute query: '%s'", err);
-        sqlite3_free(err);
-    }
+    PamInstance* instance = &m_instance;
+    SERVICE* service = dcb->service;
+    string user = session->user;
+    string host = dcb->remote;
+    string db = session->db;
+    string password((char*)session->auth_token, session->auth_token_len);
+    uint64_t uid = dcb->m_uid;
 
-    auto word_entry = [](size_t num) -> const char* {
-        return (num == 1) ? "entry" : "entries";
-    };
+    auto auth = [instance, service, user, host, db, password]() {
+            return validate_pam_user(instance, service, user, host, db, password);
+        };
 
-    if (!services_out->empty())
-    {
-        auto num_services = services_out->size();
-        MXS_INFO("Found %lu valid PAM user %s for '%s'@'%s'.",
-                 num_services, word_entry(num_services), session->user, dcb->remote);
-    }
-    else
-    {
-        // No service found for user with correct username & host.
-        // Check if a matching anonymous user exists.
-        const string anon_query = string("SELECT authentication_string FROM ") + m_instance.m_tablename
-            + " WHERE " + FIELD_USER + " = ''"
-            + " AND '" + dcb->remote + "' LIKE " + FIELD_HOST +
-            + " AND " + FIELD_PROXY + " = '1' ORDER BY authentication_string;";
-        MXS_DEBUG("PAM proxy user services search sql: '%s'.", anon_query.c_str());
-
-        if (sqlite3_exec(m_dbhandle, anon_query.c_str(), user_services_cb, services_out, &err) != SQLITE_OK)
-        {
-            MXS_ERROR("Failed to execute query: '%s'", err);
-            sqlite3_free(err);
-        }
-        else
-        {
-            auto num_services = services_out->size();
-            if (num_services == 0)
-            {
-                MXS_INFO("Found no PAM user entries for '%s'@'%s'.", session->user, dcb->remote);
-            }
-            else
+    auto callback = [dcb, uid](bool authenticated) {
+            if (dcb_is_open(dcb, uid))
             {
-                MXS_INFO("Found %lu matching anonymous PAM user %s for '%s'@'%s'.",
-                         num_services, word_entry(num_services), session->user, dcb->remote);
+                PamClientSession* pses = static_cast<PamClientSession*>(dcb->authenticator_data);
+                pses->m_state = authenticated ? PAM_AUTH_OK : PAM_AUTH_FAILED;
+                poll_fake_read_event(dcb);
             }
-        }
-    }
+        };
+
+    return m_instance.pool().submit(auth, callback);
 }
 
 /**
@@ -377,56 +359,22 @@ int PamClientSession::authenticate(DCB* dcb)
         else if (m_state == PAM_AUTH_DATA_SENT)
         {
             /** We sent the authentication change packet + plugin name and the client
-             * responded with the password. Try to continue authentication without more
-             * messages to client. */
-            string password((char*)ses->auth_token, ses->auth_token_len);
-            /*
-             * Authentication may be attempted twice: first with old user account info and then with
-             * updated info. Updating may fail if it has been attempted too often lately. The second password
-             * check is useless if the user services are same as on the first attempt.
-             */
-            bool authenticated = false;
-            StringVector services_old;
-            for (int loop = 0; loop < 2 && !authenticated; loop++)
+             * responded with the password. The password is checked in the background
+             * and the packet is processed again once the check is complete. */
+            if (start_authentication(dcb, ses))
             {
-                if (loop == 0 || service_refresh_users(dcb->service) == 0)
-                {
-                    bool try_validate = true;
-                    StringVector services;
-                    get_pam_user_services(dcb, ses, &services);
-                    if (loop == 0)
-                    {
-                        services_old = services;
-                    }
-                    else if (services == services_old)
-                    {
-                        try_validate = false;
-                    }
-                    if (try_validate)
-                    {
-                        for (StringVector::iterator iter = services.begin();
-                             iter != services.end() && !authenticated;
-                             iter++)
-                        {
-                            // The server PAM plugin uses "mysql" as the default service when authenticating
-                            // a user with no service.
-                            if (iter->empty())
-                            {
-                                *iter = "mysql";
-                            }
-                            if (validate_pam_password(ses->user, password, *iter, dcb))
-                            {
-                                authenticated = true;
-                            }
-                        }
-                    }
-                }
-            }
-            if (authenticated)
-            {
-                rval = MXS_AUTH_SUCCEEDED;
+                m_state = PAM_AUTH_PENDING;
+                rval = MXS_AUTH_PENDING;
             }
         }
+        else if (m_state == PAM_AUTH_PENDING)
+        {
+            rval = MXS_AUTH_PENDING;
+        }
+        else if (m_state == PAM_AUTH_OK)
+        {
+            rval = MXS_AUTH_SUCCEEDED;
+        }
     }
     return rval;
 }
@@ -451,6 +399,14 @@ bool PamClientSession::extract(DCB* dcb, GWBUF* buffer)
         }
         break;
 
+    case PAM_AUTH_PENDING:
+    case PAM_AUTH_OK:
+    case PAM_AUTH_FAILED:
+        // The packet is processed again once the PAM authentication is complete, the
+        // password has already been stored.
+        rval = true;
+        break;
+
     default:
         MXS_ERROR("Unexpected authentication state: %d", m_state);
         mxb_assert(!true);
@@ -16,7 +16,6 @@
 #include <stdint.h>
 #include <string>
 #include <vector>
-#include <maxscale/sqlite3.h>
 #include "pam_instance.hh"
 #include "../pam_auth_common.hh"
 
@@ -26,18 +25,15 @@ class PamClientSession
     PamClientSession(const PamClientSession& orig);
     PamClientSession& operator=(const PamClientSession&);
 public:
-    typedef std::vector<std::string> StringVector;
-    static PamClientSession* create(const PamInstance& inst);
-    ~PamClientSession();
+    static PamClientSession* create(PamInstance& inst);
     int  authenticate(DCB* client);
     bool extract(DCB* dcb, GWBUF* read_buffer);
 private:
-    PamClientSession(sqlite3* dbhandle, const PamInstance& instance);
-    void get_pam_user_services(const DCB* dcb, const MYSQL_session* session, StringVector* services_out);
+    PamClientSession(PamInstance& instance);
+    bool start_authentication(DCB* dcb, const MYSQL_session* session);
     maxscale::Buffer create_auth_change_packet() const;
 
-    pam_auth_state     m_state;     /**< Authentication state*/
-    uint8_t            m_sequence;  /**< The next packet seqence number */
-    sqlite3* const     m_dbhandle;  /**< SQLite3 database handle */
-    const PamInstance& m_instance;  /**< Authenticator instance */
+    pam_auth_state m_state;     /**< Authentication state*/
+    uint8_t        m_sequence;  /**< The next packet seqence number */
+    PamInstance&   m_instance;  /**< Authenticator instance */
 };
@@ -13,17 +13,25 @@
 
 #include "pam_instance.hh"
 
+#include <stdlib.h>
 #include <string>
 #include <string.h>
+#include <maxscale/config.h>
 #include <maxscale/jansson.hh>
 #include <maxscale/log.h>
 #include <maxscale/secrets.h>
 #include <maxscale/mysql_utils.h>
 
-#define DEFAULT_PAM_DATABASE_NAME "file:pam.db?mode=memory&cache=shared"
-#define DEFAULT_PAM_TABLE_NAME    "pam_users"
 using std::string;
 
+namespace
+{
+/** Default number of PAM authentication threads */
+const int DEFAULT_PAM_THREADS = 8;
+/** Default number of authentications that can wait for a thread */
+const size_t DEFAULT_PAM_MAX_QUEUE = 1024;
+}
+
 /**
  * Create an instance.
  *
@@ -32,169 +40,79 @@ using std::string;
  */
 PamInstance* PamInstance::create(char** options)
 {
-    /** Name of the in-memory database */
-    const string pam_db_name = DEFAULT_PAM_DATABASE_NAME;
-    /** The table name where we store the users */
-    const string pam_table_name = DEFAULT_PAM_TABLE_NAME;
-    /** Deletion statement for the in-memory table */
-    const string drop_sql = string("DROP TABLE IF EXISTS ") + pam_table_name + ";";
-    /** CREATE TABLE statement for the in-memory table */
-    const string create_sql = string("CREATE TABLE ") + pam_table_name
-        + " (" + FIELD_USER + " varchar(255), "
-        + FIELD_HOST + " varchar(255), "
-        + FIELD_DB + " varchar(255), "
-        + FIELD_ANYDB + " boolean, "
-        + FIELD_AUTHSTR + " text, "
-        + FIELD_PROXY + " boolean);";
-
-    if (sqlite3_threadsafe() == 0)
-    {
-        MXS_WARNING("SQLite3 was compiled with thread safety off. May cause "
-                    "corruption of in-memory database.");
-    }
-
+    int n_threads = DEFAULT_PAM_THREADS;
+    long max_queue = DEFAULT_PAM_MAX_QUEUE;
     bool error = false;
-    /* This handle may be used from multiple threads, set full mutex. */
-    sqlite3* dbhandle = NULL;
-    int db_flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE
-        | SQLITE_OPEN_SHAREDCACHE | SQLITE_OPEN_FULLMUTEX;
-    if (sqlite3_open_v2(pam_db_name.c_str(), &dbhandle, db_flags, NULL) != SQLITE_OK)
-    {
-        MXS_ERROR("Failed to open SQLite3 handle.");
-        error = true;
-    }
-
-    char* err;
-    if (!error && sqlite3_exec(dbhandle, drop_sql.c_str(), NULL, NULL, &err) != SQLITE_OK)
-    {
-        MXS_ERROR("Failed to drop table: '%s'", err);
-        sqlite3_free(err);
-        error = true;
-    }
-    if (!error && sqlite3_exec(dbhandle, create_sql.c_str(), NULL, NULL, &err) != SQLITE_OK)
-    {
-        MXS_ERROR("Failed to create table: '%s'", err);
-        sqlite3_free(err);
-        error = true;
-    }
 
-    PamInstance* instance = NULL;
-    if (!error
-        && ((instance = new(std::nothrow) PamInstance(dbhandle, pam_db_name, pam_table_name)) == NULL))
+    for (int i = 0; options && options[i]; i++)
     {
-        sqlite3_close_v2(dbhandle);
-    }
-    return instance;
-}
-
-/**
- * Constructor.
- *
- * @param dbhandle Database handle
- * @param dbname Text-form name of @c dbhandle
- * @param tablename Name of table where authentication data is saved
- */
-PamInstance::PamInstance(sqlite3* dbhandle, const string& dbname, const string& tablename)
-    : m_dbname(dbname)
-    , m_tablename(tablename)
-    , m_dbhandle(dbhandle)
-{
-}
+        char* value = strchr(options[i], '=');
+        char* end = NULL;
 
-/**
- * @brief Add new PAM user entry to the internal user database
- *
- * @param user   Username
- * @param host   Host
- * @param db     Database
- * @param anydb  Global access to databases
- * @param pam_service The PAM service used
- * @param proxy  Is the user anonymous with a proxy grant
- */
-void PamInstance::add_pam_user(const char* user, const char* host, const char* db, bool anydb,
-                               const char* pam_service, bool proxy)
-{
-    /**
-     * The insert query template which adds users to the pam_users table.
-     *
-     * Note that 'db' and 'pam_service' are strings that can be NULL and thus they have
-     * no quotes around them. The quotes for strings are added in this function.
-     */
-    const string insert_sql_template =
-        "INSERT INTO " + m_tablename + " VALUES ('%s', '%s', %s, '%s', %s, '%s')";
-
-    /** Used for NULL value creation in the INSERT query */
-    const char NULL_TOKEN[] = "NULL";
-    string db_str;
-
-    if (db)
-    {
-        db_str = string("'") + db + "'";
-    }
-    else
-    {
-        db_str = NULL_TOKEN;
-    }
-
-    string service_str;
-    if (pam_service && *pam_service)
-    {
-        service_str = string("'") + pam_service + "'";
-    }
-    else
-    {
-        service_str = NULL_TOKEN;
-    }
+        if (value)
+        {
+            *value++ = '\0';
 
-    size_t len = insert_sql_template.length() + strlen(user) + strlen(host) + db_str.length()
-        + service_str.length() + 1;
+            if (strcmp(options[i], "pam_threads") == 0)
+            {
+                n_threads = strtol(value, &end, 10);
 
-    char insert_sql[len + 1];
-    sprintf(insert_sql,
-            insert_sql_template.c_str(),
-            user, host,
-            db_str.c_str(), anydb ? "1" : "0",
-            service_str.c_str(),
-            proxy ? "1" : "0");
+                if (*end != '\0' || n_threads <= 0)
+                {
+                    MXS_ERROR("Invalid value for '%s': %s", options[i], value);
+                    error = true;
+                }
+            }
+            else if (strcmp(options[i], "pam_max_queue") == 0)
+            {
+                max_queue = strtol(value, &end, 10);
 
-    char* err;
-    if (sqlite3_exec(m_dbhandle, insert_sql, NULL, NULL, &err) != SQLITE_OK)
-    {
-        MXS_ERROR("Failed to insert user: %s", err);
-        sqlite3_free(err);
-    }
-    else
-    {
-        if (proxy)
-        {
-            MXS_INFO("Added anonymous PAM user ''@'%s' with proxy grants using service %s.",
-                     host, service_str.c_str());
+                if (*end != '\0' || max_queue < 0)
+                {
+                    MXS_ERROR("Invalid value for '%s': %s", options[i], value);
+                    error = true;
+                }
+            }
+            else
+            {
+                MXS_ERROR("Unknown authenticator option: %s", options[i]);
+                error = true;
+            }
         }
         else
         {
-            MXS_INFO("Added normal PAM user '%s'@'%s' using service %s.", user, host, service_str.c_str());
+            MXS_ERROR("Unknown authenticator option: %s", options[i]);
+            error = true;
         }
     }
+
+    return error ? NULL : new(std::nothrow) PamInstance(n_threads, max_queue);
 }
 
 /**
- * @brief Delete old users from the database
+ * Constructor.
+ *
+ * @param n_threads Number of PAM authentication threads
+ * @param max_queue How many authentications can wait for a thread
  */
-void PamInstance::delete_old_users()
+PamInstance::PamInstance(int n_threads, size_t max_queue)
+    : m_users(std::make_shared<PamUserIndex>())
+    , m_pool(n_threads, max_queue)
+    , m_last_refresh(0)
 {
-    /** Delete query used to clean up the database before loading new users */
-    const string delete_query = "DELETE FROM " + m_tablename;
-    char* err;
-    if (sqlite3_exec(m_dbhandle, delete_query.c_str(), NULL, NULL, &err) != SQLITE_OK)
-    {
-        MXS_ERROR("Failed to delete old users: %s", err);
-        sqlite3_free(err);
-    }
+}
+
+SPamUserIndex PamInstance::users() const
+{
+    return std::atomic_load(&m_users);
 }
 
 /**
  * @brief Populates the internal user database by reading from one of the backend servers
  *
+ * The users are read into a new index which replaces the current one once it is
+ * complete. This can be called from any thread.
+ *
  * @param service The service the users should be read from
  *
  * @return MXS_AUTH_LOADUSERS_OK on success, MXS_AUTH_LOADUSERS_ERROR on error
@@ -235,24 +153,25 @@ int PamInstance::load_users(SERVICE* service)
                 }
                 else
                 {
+                    auto users = std::make_shared<PamUserIndex>();
                     MYSQL_RES* res = mysql_store_result(mysql);
-                    delete_old_users();
                     if (res)
                     {
                         mxb_assert(mysql_num_fields(res) == PAM_USERS_QUERY_NUM_FIELDS);
                         MYSQL_ROW row;
                         while ((row = mysql_fetch_row(res)))
                         {
-                            add_pam_user(row[0], row[1], // user, host
-                                         row[2], row[3] && strcasecmp(row[3], "Y") == 0, // db, anydb
-                                         row[4], // pam service
-                                         false); // not a proxy
+                            users->add_user(row[0], row[1], // user, host
+                                            row[2], row[3] && strcasecmp(row[3], "Y") == 0, // db, anydb
+                                            row[4], // pam service
+                                            false); // not a proxy
                         }
                         mysql_free_result(res);
                     }
 
-                    if (fetch_anon_proxy_users(servers->server, mysql))
+                    if (fetch_anon_proxy_users(servers->server, mysql, users.get()))
                     {
+                        std::atomic_store(&m_users, SPamUserIndex(users));
                         rval = MXS_AUTH_LOADUSERS_OK;
                     }
                 }
@@ -269,62 +188,74 @@ int PamInstance::load_users(SERVICE* service)
     return rval;
 }
 
-void PamInstance::diagnostic(DCB* dcb)
+/**
+ * @brief Reload the users if they have not been reloaded recently
+ *
+ * The users are loaded at most once every `users_refresh_time` seconds. This is
+ * called by the PAM authentication threads, concurrent calls wait for the load
+ * that is in progress.
+ *
+ * @param service The service the users should be read from
+ *
+ * @return True if the users were loaded
+ */
+bool PamInstance::refresh_users(SERVICE* service)
 {
-    json_t* array = diagnostic_json();
-    mxb_assert(json_is_array(array));
+    std::lock_guard<std::mutex> guard(m_refresh_lock);
+    time_t now = time(NULL);
+    bool rval = false;
+
+    if (now >= m_last_refresh + config_get_global_options()->users_refresh_time)
+    {
+        m_last_refresh = now;
+        rval = load_users(service) == MXS_AUTH_LOADUSERS_OK;
+    }
+
+    return rval;
+}
 
+void PamInstance::diagnostic(DCB* dcb)
+{
+    // Only print user@host, as this should fit nicely on the console.
     string result, separator;
-    size_t index;
-    json_t* value;
-    json_array_foreach(array, index, value)
+    for (const auto& entry : users()->entries())
     {
-        // Only print user@host for the non-json version, as this should fit nicely on the console. Add the
-        // other fields if deemed useful.
-        const char* user = json_string_value(json_object_get(value, FIELD_USER.c_str()));
-        const char* host = json_string_value(json_object_get(value, FIELD_HOST.c_str()));
-        if (user && host)
-        {
-            result += separator + user + "@" + host;
-            separator = " ";
-        }
+        result += separator + entry.user + "@" + entry.host;
+        separator = " ";
     }
 
     if (!result.empty())
     {
         dcb_printf(dcb, "%s", result.c_str());
     }
-    json_decref(array);
 }
 
-static int diag_cb_json(void* data, int columns, char** row, char** field_names)
+json_t* PamInstance::diagnostic_json()
 {
-    mxb_assert(columns == NUM_FIELDS);
-    json_t* obj = json_object();
-    for (int i = 0; i < columns; i++)
+    json_t* arr = json_array();
+    for (const auto& entry : users()->entries())
     {
-        json_object_set_new(obj, field_names[i], json_string(row[i]));
+        json_t* obj = json_object();
+        json_object_set_new(obj, FIELD_USER.c_str(), json_string(entry.user.c_str()));
+        json_object_set_new(obj, FIELD_HOST.c_str(), json_string(entry.host.c_str()));
+        json_object_set_new(obj, FIELD_DB.c_str(), json_string(entry.db.c_str()));
+        json_object_set_new(obj, FIELD_ANYDB.c_str(), json_boolean(entry.anydb));
+        json_object_set_new(obj, FIELD_AUTHSTR.c_str(), json_string(entry.service.c_str()));
+        json_object_set_new(obj, FIELD_PROXY.c_str(), json_boolean(entry.proxy));
+        json_array_append_new(arr, obj);
     }
-    json_t* arr = static_cast<json_t*>(data);
-    json_array_append_new(arr, obj);
-    return 0;
+
+    return arr;
 }
 
-json_t* PamInstance::diagnostic_json()
+json_t* PamInstance::statistics_json()
 {
-    json_t* rval = json_array();
-    char* err;
-    string select = "SELECT * FROM " + m_tablename + ";";
-    if (sqlite3_exec(m_dbhandle, select.c_str(), diag_cb_json, rval, &err) != SQLITE_OK)
-    {
-        MXS_ERROR("Failed to print users: %s", err);
-        sqlite3_free(err);
-    }
-
+    json_t* rval = json_object();
+    json_object_set_new(rval, "authentication", m_pool.stats_json());
     return rval;
 }
 
-bool PamInstance::fetch_anon_proxy_users(SERVER* server, MYSQL* conn)
+bool PamInstance::fetch_anon_proxy_users(SERVER* server, MYSQL* conn, PamUserIndex* users)
 {
     bool success = true;
     const char ANON_USER_QUERY[] = "SELECT host,authentication_string FROM mysql.user WHERE "
@@ -382,9 +313,9 @@ bool PamInstance::fetch_anon_proxy_users(SERVER* server, MYSQL* conn)
                     {
                         if (row[0] && strncmp(row[0], GRANT_PROXY, sizeof(GRANT_PROXY) - 1) == 0)
                         {
-                            add_pam_user("", elem.first.c_str(), // user, host
-                                         NULL, false, // Unused
-                                         elem.second.c_str(), true); // service, proxy
+                            users->add_user("", elem.first.c_str(), // user, host
+                                            NULL, false, // Unused
+                                            elem.second.c_str(), true); // service, proxy
                             break;
                         }
                     }
@@ -13,9 +13,12 @@
 #pragma once
 #include "pam_auth.hh"
 
+#include <ctime>
+#include <mutex>
 #include <string>
 #include <maxscale/service.h>
-#include <maxscale/sqlite3.h>
+#include "pam_auth_pool.hh"
+#include "pam_user_index.hh"
 
 /** The instance class for the client side PAM authenticator, created in pam_auth_init() */
 class PamInstance
@@ -24,19 +27,30 @@ class PamInstance
     PamInstance& operator=(const PamInstance&);
 public:
     static PamInstance* create(char** options);
-    ~PamInstance();
     int     load_users(SERVICE* service);
+    bool    refresh_users(SERVICE* service);
     void    diagnostic(DCB* dcb);
     json_t* diagnostic_json();
+    json_t* statistics_json();
+
+    /**
+     * Get the current users, can be called from any thread
+     *
+     * @return The current user index
+     */
+    SPamUserIndex users() const;
+
+    PamAuthPool& pool()
+    {
+        return m_pool;
+    }
 
-    const std::string m_dbname;     /**< Name of the in-memory database */
-    const std::string m_tablename;  /**< The table where users are stored */
 private:
-    PamInstance(sqlite3* dbhandle, const std::string& m_dbname, const std::string& tablename);
-    void add_pam_user(const char* user, const char* host, const char* db, bool anydb,
-                      const char* pam_service, bool proxy);
-    void delete_old_users();
-    bool fetch_anon_proxy_users(SERVER* server, MYSQL* conn);
+    PamInstance(int n_threads, size_t max_queue);
+    bool fetch_anon_proxy_users(SERVER* server, MYSQL* conn, PamUserIndex* users);
 
-    sqlite3* const m_dbhandle;      /**< SQLite3 database handle */
+    SPamUserIndex m_users;          /**< The current users, accessed atomically */
+    PamAuthPool   m_pool;           /**< Runs the PAM authentications */
+    std::mutex    m_refresh_lock;   /**< Serializes refresh_users() */
+    time_t        m_last_refresh;   /**< When refresh_users() last loaded the users */
 };
@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2018 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2022-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+#include "pam_auth.hh"
+#include "pam_user_index.hh"
+
+#include <algorithm>
+#include <ctype.h>
+#include <maxscale/log.h>
+
+namespace
+{
+/**
+ * Match a string against an SQL LIKE pattern. As with SQLite, the matching is
+ * case-insensitive for ASCII characters and escape characters are not supported.
+ *
+ * @param pattern The pattern
+ * @param str     String to match
+ *
+ * @return True if the string matches the pattern
+ */
+bool like_match(const char* pattern, const char* str)
+{
+    const char* star_p = NULL;  // Position after the last '%' in the pattern
+    const char* star_s = NULL;  // Position in the string where that '%' started matching
+
+    while (*str)
+    {
+        if (*pattern == '%')
+        {
+            star_p = ++pattern;
+            star_s = str;
+        }
+        else if (*pattern == '_'
+                 || (*pattern && tolower((unsigned char)*pattern) == tolower((unsigned char)*str)))
+        {
+            ++pattern;
+            ++str;
+        }
+        else if (star_p)
+        {
+            // Let the last '%' match one more character
+            pattern = star_p;
+            str = ++star_s;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    while (*pattern == '%')
+    {
+        ++pattern;
+    }
+
+    return *pattern == '\0';
+}
+
+const char* word_entry(size_t num)
+{
+    return (num == 1) ? "entry" : "entries";
+}
+}
+
+void PamUserIndex::add_user(const char* user, const char* host, const char* db, bool anydb,
+                            const char* pam_service, bool proxy)
+{
+    m_entries.push_back({user, host, db ? db : "", anydb, pam_service ? pam_service : "", proxy});
+
+    if (proxy)
+    {
+        m_proxies.push_back(m_entries.size() - 1);
+        MXS_INFO("Added anonymous PAM user ''@'%s' with proxy grants using service '%s'.",
+                 host, m_entries.back().service.c_str());
+    }
+    else
+    {
+        m_users[user].push_back(m_entries.size() - 1);
+        MXS_INFO("Added normal PAM user '%s'@'%s' using service '%s'.",
+                 user, host, m_entries.back().service.c_str());
+    }
+}
+
+PamUserIndex::StringVector PamUserIndex::find_services(const std::string& user, const std::string& host,
+                                                       const std::string& db) const
+{
+    StringVector services;
+    auto it = m_users.find(user);
+
+    if (it != m_users.end())
+    {
+        for (size_t i : it->second)
+        {
+            const Entry& e = m_entries[i];
+
+            if (like_match(e.host.c_str(), host.c_str())
+                && (e.anydb || db.empty() || (!e.db.empty() && like_match(e.db.c_str(), db.c_str()))))
+            {
+                services.push_back(e.service);
+            }
+        }
+    }
+
+    if (!services.empty())
+    {
+        MXS_INFO("Found %lu valid PAM user %s for '%s'@'%s'.",
+                 services.size(), word_entry(services.size()), user.c_str(), host.c_str());
+    }
+    else
+    {
+        // No service found for user with correct username & host.
+        // Check if a matching anonymous user exists.
+        for (size_t i : m_proxies)
+        {
+            const Entry& e = m_entries[i];
+
+            if (e.user.empty() && like_match(e.host.c_str(), host.c_str()))
+            {
+                services.push_back(e.service);
+            }
+        }
+
+        if (services.empty())
+        {
+            MXS_INFO("Found no PAM user entries for '%s'@'%s'.", user.c_str(), host.c_str());
+        }
+        else
+        {
+            MXS_INFO("Found %lu matching anonymous PAM user %s for '%s'@'%s'.",
+                     services.size(), word_entry(services.size()), user.c_str(), host.c_str());
+        }
+    }
+
+    std::sort(services.begin(), services.end());
+    return services;
+}
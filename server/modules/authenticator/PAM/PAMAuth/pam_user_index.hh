@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2018 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2022-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+#pragma once
+
+#include <maxscale/ccdefs.hh>
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * In-memory index of the PAM user accounts
+ *
+ * The index is built when the users are loaded and is not modified after it has been
+ * taken into use, which allows it to be shared by all threads without locking.
+ */
+class PamUserIndex
+{
+public:
+    PamUserIndex(const PamUserIndex&) = delete;
+    PamUserIndex& operator=(const PamUserIndex&) = delete;
+
+    typedef std::vector<std::string> StringVector;
+
+    struct Entry
+    {
+        std::string user;
+        std::string host;       /**< Host pattern */
+        std::string db;         /**< Database pattern, empty for none */
+        bool        anydb;      /**< Access to all databases */
+        std::string service;    /**< The PAM service, empty for the default one */
+        bool        proxy;      /**< Anonymous user with a proxy grant */
+    };
+
+    PamUserIndex() = default;
+
+    /**
+     * Add a user entry
+     *
+     * @param user        Username
+     * @param host        Host pattern
+     * @param db          Database pattern, NULL for none
+     * @param anydb       Global access to databases
+     * @param pam_service The PAM service used, NULL for the default one
+     * @param proxy       Is the user anonymous with a proxy grant
+     */
+    void add_user(const char* user, const char* host, const char* db, bool anydb,
+                  const char* pam_service, bool proxy);
+
+    /**
+     * Find the PAM services of a user
+     *
+     * If the user has no matching entries, the services of the matching anonymous
+     * users with proxy grants are returned.
+     *
+     * @param user Username
+     * @param host IP address of the client
+     * @param db   The default database, empty for none
+     *
+     * @return The services in alphabetical order, empty for the default service
+     */
+    StringVector find_services(const std::string& user, const std::string& host,
+                               const std::string& db) const;
+
+    /**
+     * @return All entries, in the order they were added
+     */
+    const std::vector<Entry>& entries() const
+    {
+        return m_entries;
+    }
+
+private:
+    std::vector<Entry>                                   m_entries;
+    std::unordered_map<std::string, std::vector<size_t>> m_users;   /**< Indexes of the normal users */
+    std::vector<size_t>                                  m_proxies; /**< Indexes of the proxy users */
+};
+
+typedef std::shared_ptr<const PamUserIndex> SPamUserIndex;
@@ -0,0 +1,191 @@
+/*
+ * Copyright (c) 2018 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2022-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+#include "pam_auth_pool.hh"
+#include "pam_user_index.hh"
+
+#include <atomic>
+#include <iostream>
+#include <semaphore.h>
+
+#include <maxbase/log.hh>
+#include <maxbase/maxbase.hh>
+
+using namespace std;
+
+namespace
+{
+
+int expect(bool condition, const string& what)
+{
+    if (!condition)
+    {
+        cout << "error: " << what << endl;
+    }
+
+    return condition ? 0 : 1;
+}
+
+int test_index()
+{
+    int rv = 0;
+    PamUserIndex index;
+    PamUserIndex::StringVector services;
+
+    index.add_user("bob", "10.0.0.%", "test", false, "service_b", false);
+    index.add_user("bob", "10.0.0.%", "shop%", false, "service_a", false);
+    index.add_user("bob", "%", NULL, false, NULL, false);
+    index.add_user("alice", "%", NULL, true, "service_c", false);
+    index.add_user("", "192.168.%", NULL, false, "anon_b", true);
+    index.add_user("", "192.168.0._", NULL, false, "anon_a", true);
+
+    rv += expect(index.entries().size() == 6, "All entries should be listed");
+
+    services = index.find_services("bob", "10.0.0.1", "");
+    rv += expect(services == PamUserIndex::StringVector({"", "service_a", "service_b"}),
+                 "No database should match all entries and the services should be sorted");
+
+    services = index.find_services("bob", "10.0.0.1", "SHOP1");
+    rv += expect(services == PamUserIndex::StringVector({"service_a"}),
+                 "Database patterns should be case-insensitive");
+
+    services = index.find_services("bob", "10.0.0.1", "other");
+    rv += expect(services.empty(), "Database without grants should not match");
+
+    services = index.find_services("bob", "172.16.0.1", "");
+    rv += expect(services == PamUserIndex::StringVector({""}), "Only the wildcard host should match");
+
+    services = index.find_services("alice", "10.0.0.1", "anything");
+    rv += expect(services == PamUserIndex::StringVector({"service_c"}),
+                 "Global grants should match any database");
+
+    services = index.find_services("Alice", "10.0.0.1", "");
+    rv += expect(services.empty(), "Usernames should be case-sensitive");
+
+    services = index.find_services("carol", "192.168.0.1", "test");
+    rv += expect(services == PamUserIndex::StringVector({"anon_a", "anon_b"}),
+                 "Unknown users should use the anonymous users");
+
+    services = index.find_services("carol", "192.168.0.10", "");
+    rv += expect(services == PamUserIndex::StringVector({"anon_b"}),
+                 "Anonymous users should match by host");
+
+    services = index.find_services("bob", "192.168.0.1", "other");
+    rv += expect(services == PamUserIndex::StringVector({"anon_a", "anon_b"}),
+                 "Known users without a matching entry should use the anonymous users");
+
+    return rv;
+}
+
+int test_pool()
+{
+    int rv = 0;
+    const int N_AUTHS = 10;
+    sem_t done;
+    sem_init(&done, 0, 0);
+    std::atomic<int> succeeded {0};
+
+    {
+        PamAuthPool pool(2, N_AUTHS);
+
+        for (int i = 0; i < N_AUTHS; i++)
+        {
+            bool queued = pool.submit([i]() {
+                                          return i % 2 == 0;
+                                      },
+                                      [&](bool result) {
+                                          if (result)
+                                          {
+                                              ++succeeded;
+                                          }
+                                          sem_post(&done);
+                                      });
+            rv += expect(queued, "Authentication should be queued");
+        }
+
+        for (int i = 0; i < N_AUTHS; i++)
+        {
+            sem_wait(&done);
+        }
+
+        rv += expect(succeeded == N_AUTHS / 2, "The results should be passed to the callbacks");
+
+        json_t* stats = pool.stats_json();
+        rv += expect(json_integer_value(json_object_get(stats, "completed")) == N_AUTHS,
+                     "All authentications should be completed");
+        rv += expect(json_integer_value(json_object_get(stats, "queued")) == 0, "The queue should be empty");
+        json_decref(stats);
+    }
+
+    {
+        // The threads are blocked so that the queue fills up
+        sem_t blocked;
+        sem_init(&blocked, 0, 0);
+        PamAuthPool pool(1, 1);
+        auto block = [&]() {
+                sem_wait(&blocked);
+                return true;
+            };
+        auto post = [&](bool) {
+                sem_post(&done);
+            };
+
+        rv += expect(pool.submit(block, post), "First authentication should be queued");
+
+        // Wait until the thread has taken the first authentication
+        json_t* stats;
+        do
+        {
+            stats = pool.stats_json();
+            json_int_t active = json_integer_value(json_object_get(stats, "active"));
+            json_decref(stats);
+
+            if (active == 1)
+            {
+                break;
+            }
+            sched_yield();
+        }
+        while (true);
+
+        rv += expect(pool.submit(block, post), "Second authentication should be queued");
+        rv += expect(!pool.submit(block, post), "Third authentication should be rejected");
+
+        stats = pool.stats_json();
+        rv += expect(json_integer_value(json_object_get(stats, "rejected")) == 1,
+                     "Rejected authentication should be counted");
+        json_decref(stats);
+
+        sem_post(&blocked);
+        sem_post(&blocked);
+        sem_wait(&done);
+        sem_wait(&done);
+        sem_destroy(&blocked);
+    }
+
+    sem_destroy(&done);
+    return rv;
+}
+}
+
+int main()
+{
+    maxbase::init();
+    maxbase::Log log;
+
+    int rv = 0;
+    rv += test_index();
+    rv += test_pool();
+
+    return rv;
+}
@@ -28,6 +28,7 @@ enum pam_auth_state
 {
     PAM_AUTH_INIT = 0,
     PAM_AUTH_DATA_SENT,
+    PAM_AUTH_PENDING,   /**< Waiting for the PAM API */
     PAM_AUTH_OK,
     PAM_AUTH_FAILED
 };
@@ -555,7 +555,7 @@ MXS_MODULE* MXS_CREATE_MODULE()
         MXS_FILTER_VERSION,
         "Firewall Filter",
         "V1.2.0",
-        RCAP_TYPE_STMT_INPUT,
+        RCAP_TYPE_CONTIGUOUS_INPUT,
         &Dbfw::s_object,
         NULL,           /* Process init. */
         NULL,           /* Process finish. */
@@ -113,7 +113,7 @@ extern "C"
             MXS_FILTER_VERSION,
             "A filter that is capable of limiting the resultset number of rows.",
             "V1.0.0",
-            RCAP_TYPE_STMT_INPUT | RCAP_TYPE_STMT_OUTPUT,
+            RCAP_TYPE_CONTIGUOUS_INPUT | RCAP_TYPE_STMT_OUTPUT,
             &object,
             NULL,   /* Process init. */
             NULL,   /* Process finish. */
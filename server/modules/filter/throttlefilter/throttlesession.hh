@@ -38,7 +38,7 @@ private:
     maxbase::EventCount m_query_count;
     maxbase::StopWatch  m_first_sample;
     maxbase::StopWatch  m_last_sample;
-    uint32_t            m_delayed_call_id;  // there can be only one in flight
+    uint64_t            m_delayed_call_id;  // there can be only one in flight
 
     enum class State {MEASURING,
                       THROTTLING};
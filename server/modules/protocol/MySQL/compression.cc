@@ -0,0 +1,504 @@
+/*
+ * Copyright (c) 2018 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2022-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+#include <maxscale/protocol/compression.hh>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <string.h>
+#include <zlib.h>
+
+#include <maxbase/atomic.hh>
+#include <maxscale/config.h>
+#include <maxscale/listener.h>
+#include <maxscale/protocol/mysql.h>
+#include <maxscale/session.h>
+
+namespace
+{
+
+using namespace maxscale;
+
+/** Length of the header of a compressed packet */
+const size_t COMPRESSED_HEADER_LEN = 7;
+
+/** The largest payload a compressed packet can have */
+const size_t MAX_COMPRESSED_PAYLOAD = 0xffffff;
+
+class ZlibCodec : public CompressionCodec
+{
+public:
+    ~ZlibCodec()
+    {
+        if (m_deflate_ok)
+        {
+            deflateEnd(&m_deflate);
+        }
+
+        if (m_inflate_ok)
+        {
+            inflateEnd(&m_inflate);
+        }
+    }
+
+    static CompressionCodec* create()
+    {
+        ZlibCodec* pCodec = new(std::nothrow) ZlibCodec;
+
+        if (pCodec && !(pCodec->m_deflate_ok && pCodec->m_inflate_ok))
+        {
+            delete pCodec;
+            pCodec = nullptr;
+        }
+
+        return pCodec;
+    }
+
+    const char* name() const override
+    {
+        return "zlib";
+    }
+
+    size_t compress_bound(size_t len) override
+    {
+        return deflateBound(&m_deflate, len);
+    }
+
+    size_t compress(const uint8_t* pIn, size_t in_len, uint8_t* pOut, size_t out_len) override
+    {
+        // Resetting the stream is much cheaper than setting up a new one for every packet.
+        deflateReset(&m_deflate);
+        m_deflate.next_in = const_cast<Bytef*>(pIn);
+        m_deflate.avail_in = in_len;
+        m_deflate.next_out = pOut;
+        m_deflate.avail_out = out_len;
+
+        return deflate(&m_deflate, Z_FINISH) == Z_STREAM_END ? m_deflate.total_out : 0;
+    }
+
+    bool decompress(const uint8_t* pIn, size_t in_len, uint8_t* pOut, size_t out_len) override
+    {
+        inflateReset(&m_inflate);
+        m_inflate.next_in = const_cast<Bytef*>(pIn);
+        m_inflate.avail_in = in_len;
+        m_inflate.next_out = pOut;
+        m_inflate.avail_out = out_len;
+
+        return inflate(&m_inflate, Z_FINISH) == Z_STREAM_END && m_inflate.total_out == out_len;
+    }
+
+private:
+    ZlibCodec()
+    {
+        memset(&m_deflate, 0, sizeof(m_deflate));
+        memset(&m_inflate, 0, sizeof(m_inflate));
+        m_deflate_ok = deflateInit(&m_deflate, Z_DEFAULT_COMPRESSION) == Z_OK;
+        m_inflate_ok = inflateInit(&m_inflate) == Z_OK;
+    }
+
+    z_stream m_deflate;
+    z_stream m_inflate;
+    bool     m_deflate_ok;
+    bool     m_inflate_ok;
+};
+
+struct
+{
+    std::mutex                                               lock;
+    std::unordered_map<std::string, CompressionCodecFactory> factories {{"zlib", ZlibCodec::create}};
+} this_unit;
+
+thread_local struct
+{
+    std::unordered_map<std::string, std::unique_ptr<CompressionCodec>> codecs;
+} this_thread;
+
+/**
+ * Get the compression statistics a connection contributes to
+ *
+ * @param dcb  Client or backend DCB
+ *
+ * @return The statistics of the listener of the session or NULL if there is none
+ */
+LISTENER_COMPRESSION_STATS* stats_of(DCB* dcb)
+{
+    LISTENER_COMPRESSION_STATS* pStats = nullptr;
+
+    if (dcb->dcb_role == DCB_ROLE_CLIENT_HANDLER)
+    {
+        if (dcb->listener)
+        {
+            pStats = &dcb->listener->client_compression;
+        }
+    }
+    else if (dcb->session && !session_is_dummy(dcb->session)
+             && dcb->session->client_dcb && dcb->session->client_dcb->listener)
+    {
+        pStats = &dcb->session->client_dcb->listener->backend_compression;
+    }
+
+    return pStats;
+}
+
+int64_t nanoseconds_since(std::chrono::steady_clock::time_point start)
+{
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+}
+
+/**
+ * The codec of a DCB that uses the compressed protocol
+ */
+class CompressedStream : public DCB_CODEC
+{
+public:
+    CompressedStream(const CompressedStream&) = delete;
+    CompressedStream& operator=(const CompressedStream&) = delete;
+
+    CompressedStream(const char* zCodec, size_t threshold)
+        : m_codec_name(zCodec)
+        , m_threshold(threshold)
+        , m_pending(nullptr)
+        , m_pending_len(0)
+        , m_seq(0)
+        , m_packet_left(0)
+        , m_header_len(0)
+    {
+        DCB_CODEC::decode = &CompressedStream::decode;
+        DCB_CODEC::encode = &CompressedStream::encode;
+        DCB_CODEC::free = &CompressedStream::free;
+    }
+
+    ~CompressedStream()
+    {
+        gwbuf_free(m_pending);
+    }
+
+    GWBUF* decode(DCB* dcb, GWBUF* raw, bool* error);
+    GWBUF* encode(DCB* dcb, GWBUF* plain);
+
+private:
+    static GWBUF* decode(DCB_CODEC* pCodec, DCB* dcb, GWBUF* raw, bool* error)
+    {
+        return static_cast<CompressedStream*>(pCodec)->decode(dcb, raw, error);
+    }
+
+    static GWBUF* encode(DCB_CODEC* pCodec, DCB* dcb, GWBUF* plain)
+    {
+        return static_cast<CompressedStream*>(pCodec)->encode(dcb, plain);
+    }
+
+    static void free(DCB_CODEC* pCodec)
+    {
+        delete static_cast<CompressedStream*>(pCodec);
+    }
+
+    GWBUF* create_packet(CompressionCodec* pCodec, const uint8_t* pData, size_t len,
+                         LISTENER_COMPRESSION_STATS* pStats);
+
+    std::string       m_codec_name;     // The codec instances are per thread and sessions can move
+    size_t            m_threshold;      // Payloads shorter than this are not compressed
+    GWBUF*            m_pending;        // Incomplete compressed packet
+    size_t            m_pending_len;    // Length of m_pending
+    uint8_t           m_seq;            // Sequence number of the next packet written
+    size_t            m_packet_left;    // Bytes left of the MySQL packet being written
+    uint8_t           m_header[MYSQL_HEADER_LEN];   // Header of the MySQL packet being written
+    size_t            m_header_len;     // How much of the header has been written
+};
+
+GWBUF* CompressedStream::decode(DCB* dcb, GWBUF* raw, bool* error)
+{
+    m_pending_len += gwbuf_length(raw);
+    m_pending = gwbuf_append(m_pending, raw);
+
+    CompressionCodec* pCodec = get_compression_codec(m_codec_name.c_str());
+    LISTENER_COMPRESSION_STATS* pStats = stats_of(dcb);
+    GWBUF* decoded = nullptr;
+    uint8_t header[COMPRESSED_HEADER_LEN];
+
+    while (!*error
+           && m_pending_len >= COMPRESSED_HEADER_LEN
+           && gwbuf_copy_data(m_pending, 0, COMPRESSED_HEADER_LEN, header) == COMPRESSED_HEADER_LEN)
+    {
+        size_t payload_len = gw_mysql_get_byte3(header);
+        size_t plain_len = gw_mysql_get_byte3(header + 4);
+
+        if (m_pending_len < COMPRESSED_HEADER_LEN + payload_len)
+        {
+            // The rest of the packet has not arrived yet.
+            break;
+        }
+
+        m_pending = gwbuf_consume(m_pending, COMPRESSED_HEADER_LEN);
+        GWBUF* payload = gwbuf_split(&m_pending, payload_len);
+        m_pending_len -= COMPRESSED_HEADER_LEN + payload_len;
+
+        // The replies to what we write continue the sequence of what we read.
+        m_seq = header[3] + 1;
+
+        if (plain_len == 0)
+        {
+            // Sent without compression.
+            decoded = gwbuf_append(decoded, payload);
+            plain_len = payload_len;
+        }
+        else
+        {
+            auto start = std::chrono::steady_clock::now();
+            payload = gwbuf_make_contiguous(payload);
+            GWBUF* plain = gwbuf_alloc(plain_len);
+
+            if (pCodec && payload && plain
+                && pCodec->decompress(GWBUF_DATA(payload), payload_len, GWBUF_DATA(plain), plain_len))
+            {
+                plain->server = dcb->server;
+                decoded = gwbuf_append(decoded, plain);
+            }
+            else
+            {
+                MXS_ERROR("Could not decompress a packet of %lu bytes from '%s' with %s.",
+                          payload_len, dcb->remote ? dcb->remote : "<unknown>", m_codec_name.c_str());
+                gwbuf_free(plain);
+                *error = true;
+            }
+
+            gwbuf_free(payload);
+
+            if (pStats)
+            {
+                mxb::atomic::add(&pStats->decompress_ns, nanoseconds_since(start), mxb::atomic::RELAXED);
+            }
+        }
+
+        if (pStats)
+        {
+            mxb::atomic::add(&pStats->plain_bytes, plain_len, mxb::atomic::RELAXED);
+            mxb::atomic::add(&pStats->wire_bytes, COMPRESSED_HEADER_LEN + payload_len, mxb::atomic::RELAXED);
+        }
+    }
+
+    return decoded;
+}
+
+GWBUF* CompressedStream::encode(DCB* dcb, GWBUF* plain)
+{
+    plain = gwbuf_make_contiguous(plain);
+
+    if (!plain)
+    {
+        return nullptr;
+    }
+
+    CompressionCodec* pCodec = get_compression_codec(m_codec_name.c_str());
+    LISTENER_COMPRESSION_STATS* pStats = stats_of(dcb);
+    const uint8_t* pData = GWBUF_DATA(plain);
+    size_t len = GWBUF_LENGTH(plain);
+
+    // A new command written to a server must start a new compressed packet with
+    // the sequence number 0, as that is what the server expects. The sequence
+    // numbers of the packets of a LOAD DATA LOCAL INFILE, or of any reply to a
+    // client, may wrap around to 0 without starting anything new.
+    bool may_start_command = dcb->dcb_role == DCB_ROLE_BACKEND_HANDLER
+        && !(dcb->session && session_is_load_active(dcb->session));
+
+    GWBUF* encoded = nullptr;
+    size_t start = 0;
+    size_t pos = 0;
+    bool ok = true;
+
+    while (ok && pos < len)
+    {
+        if (m_packet_left == 0)
+        {
+            // At the header of a MySQL packet, possibly started by the previous write.
+            if (m_header_len == 0 && may_start_command
+                && len - pos >= MYSQL_HEADER_LEN && pData[pos + 3] == 0)
+            {
+                if (pos > start)
+                {
+                    GWBUF* packet = create_packet(pCodec, pData + start, pos - start, pStats);
+                    ok = packet != nullptr;
+                    encoded = gwbuf_append(encoded, packet);
+                    start = pos;
+                }
+
+                m_seq = 0;
+            }
+
+            size_t n = std::min(MYSQL_HEADER_LEN - m_header_len, len - pos);
+            memcpy(m_header + m_header_len, pData + pos, n);
+            m_header_len += n;
+            pos += n;
+
+            if (m_header_len == MYSQL_HEADER_LEN)
+            {
+                m_packet_left = gw_mysql_get_byte3(m_header);
+                m_header_len = 0;
+            }
+        }
+        else
+        {
+            size_t n = std::min(m_packet_left, len - pos);
+            m_packet_left -= n;
+            pos += n;
+        }
+
+        while (ok && pos - start >= MAX_COMPRESSED_PAYLOAD)
+        {
+            GWBUF* packet = create_packet(pCodec, pData + start, MAX_COMPRESSED_PAYLOAD, pStats);
+            ok = packet != nullptr;
+            encoded = gwbuf_append(encoded, packet);
+            start += MAX_COMPRESSED_PAYLOAD;
+        }
+    }
+
+    if (ok && start < len)
+    {
+        GWBUF* packet = create_packet(pCodec, pData + start, len - start, pStats);
+        ok = packet != nullptr;
+        encoded = gwbuf_append(encoded, packet);
+    }
+
+    gwbuf_free(plain);
+
+    if (!ok)
+    {
+        gwbuf_free(encoded);
+        encoded = nullptr;
+    }
+
+    return encoded;
+}
+
+GWBUF* CompressedStream::create_packet(CompressionCodec* pCodec, const uint8_t* pData, size_t len,
+                                       LISTENER_COMPRESSION_STATS* pStats)
+{
+    GWBUF* packet = nullptr;
+    size_t payload_len = 0;
+
+    if (pCodec && len >= m_threshold)
+    {
+        auto start = std::chrono::steady_clock::now();
+        size_t bound = pCodec->compress_bound(len);
+
+        if ((packet = gwbuf_alloc(COMPRESSED_HEADER_LEN + bound)))
+        {
+            uint8_t* pHeader = GWBUF_DATA(packet);
+            payload_len = pCodec->compress(pData, len, pHeader + COMPRESSED_HEADER_LEN, bound);
+
+            if (payload_len != 0 && payload_len < len)
+            {
+                gw_mysql_set_byte3(pHeader, payload_len);
+                pHeader[3] = m_seq++;
+                gw_mysql_set_byte3(pHeader + 4, len);
+                GWBUF_RTRIM(packet, bound - payload_len);
+            }
+            else
+            {
+                // Does not compress, it is sent as such.
+                gwbuf_free(packet);
+                packet = nullptr;
+            }
+        }
+
+        if (pStats)
+        {
+            mxb::atomic::add(&pStats->compress_ns, nanoseconds_since(start), mxb::atomic::RELAXED);
+        }
+    }
+
+    if (!packet && (packet = gwbuf_alloc(COMPRESSED_HEADER_LEN + len)))
+    {
+        uint8_t* pHeader = GWBUF_DATA(packet);
+        gw_mysql_set_byte3(pHeader, len);
+        pHeader[3] = m_seq++;
+        gw_mysql_set_byte3(pHeader + 4, 0);
+        memcpy(pHeader + COMPRESSED_HEADER_LEN, pData, len);
+        payload_len = len;
+    }
+
+    if (packet && pStats)
+    {
+        mxb::atomic::add(&pStats->plain_bytes, len, mxb::atomic::RELAXED);
+        mxb::atomic::add(&pStats->wire_bytes, COMPRESSED_HEADER_LEN + payload_len, mxb::atomic::RELAXED);
+    }
+
+    return packet;
+}
+}
+
+namespace maxscale
+{
+
+bool register_compression_codec(const char* zName, CompressionCodecFactory factory)
+{
+    std::lock_guard<std::mutex> guard(this_unit.lock);
+    return this_unit.factories.emplace(zName, factory).second;
+}
+
+CompressionCodec* get_compression_codec(const char* zName)
+{
+    auto it = this_thread.codecs.find(zName);
+
+    if (it == this_thread.codecs.end())
+    {
+        CompressionCodecFactory factory = nullptr;
+
+        {
+            std::lock_guard<std::mutex> guard(this_unit.lock);
+            auto jt = this_unit.factories.find(zName);
+
+            if (jt != this_unit.factories.end())
+            {
+                factory = jt->second;
+            }
+        }
+
+        if (!factory)
+        {
+            return nullptr;
+        }
+
+        it = this_thread.codecs.emplace(zName, std::unique_ptr<CompressionCodec>(factory())).first;
+    }
+
+    return it->second.get();
+}
+
+bool enable_mysql_compression(DCB* dcb, const char* zCodec)
+{
+    bool rval = false;
+    CompressionCodec* pCodec = get_compression_codec(zCodec);
+
+    if (pCodec)
+    {
+        size_t threshold = config_get_global_options()->compression_threshold;
+        CompressedStream* pStream = new(std::nothrow) CompressedStream(zCodec, threshold);
+
+        if (pStream)
+        {
+            rval = dcb_set_codec(dcb, pStream);
+        }
+    }
+    else
+    {
+        MXS_ERROR("The compression codec '%s' is not available.", zCodec);
+    }
+
+    return rval;
+}
+}
@@ -97,6 +97,8 @@ void LocalClient::process(uint32_t events)
             {
                 if (gw_decode_mysql_server_handshake(&m_protocol, GWBUF_DATA(buf) + MYSQL_HEADER_LEN) == 0)
                 {
+                    // The local client does not implement the compressed protocol.
+                    m_protocol.server_capabilities &= ~GW_MYSQL_CAPABILITIES_COMPRESS;
                     GWBUF* response = gw_generate_auth_response(&m_client, &m_protocol, false, false, 0);
                     m_queue.push_front(response);
                     m_state = VC_RESPONSE_SENT;
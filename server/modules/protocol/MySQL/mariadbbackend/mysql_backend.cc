@@ -13,6 +13,7 @@
 
 #define MXS_MODULE_NAME "mariadbbackend"
 
+#include <chrono>
 #include <maxscale/alloc.h>
 #include <maxscale/limits.h>
 #include <maxscale/log.h>
@@ -20,6 +21,7 @@
 #include <maxscale/modutil.h>
 #include <maxscale/poll.h>
 #include <maxscale/protocol.h>
+#include <maxscale/protocol/compression.hh>
 #include <maxscale/protocol/mysql.h>
 #include <maxscale/router.h>
 #include <maxscale/server.hh>
@@ -140,6 +142,32 @@ static char* gw_backend_default_auth()
  *******************************************************************************
  ******************************************************************************/
 
+/**
+ * @return The current time of the monotonic clock in nanoseconds
+ */
+static uint64_t monotonic_ns()
+{
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+}
+
+/**
+ * Record the time it took for a requested connection to become usable
+ *
+ * @param dcb    The backend DCB
+ * @param reset  True if a pooled connection was reset, false if a new one was created
+ */
+static void connection_ready(DCB* dcb, bool reset)
+{
+    MySQLProtocol* proto = static_cast<MySQLProtocol*>(dcb->protocol);
+
+    if (proto->acquire_start)
+    {
+        server_add_connection_wait(dcb->server, monotonic_ns() - proto->acquire_start, reset);
+        proto->acquire_start = 0;
+    }
+}
+
 /*
  * Create a new backend connection.
  *
@@ -171,6 +199,8 @@ static int gw_create_backend_connection(DCB* backend_dcb,
         goto return_fd;
     }
 
+    protocol->acquire_start = monotonic_ns();
+
     /** Copy client flags to backend protocol */
     if (backend_dcb->session->client_dcb->protocol)
     {
@@ -178,6 +208,7 @@ static int gw_create_backend_connection(DCB* backend_dcb,
         protocol->client_capabilities = client->client_capabilities;
         protocol->charset = client->charset;
         protocol->extra_capabilities = client->extra_capabilities;
+        backend_dcb->pool_capabilities = backend_dcb->session->client_dcb->pool_capabilities;
     }
     else
     {
@@ -427,6 +458,13 @@ static inline void prepare_for_write(DCB* dcb, GWBUF* buffer)
             if (!proto->large_query && !session_is_load_active(dcb->session))
             {
                 proto->current_command = (mxs_mysql_cmd_t)MYSQL_GET_COMMAND(data);
+
+                // A COM_STMT_EXECUTE with non-zero flags opens a cursor
+                uint8_t flags = 0;
+                bool opening_cursor = proto->current_command == MXS_COM_STMT_EXECUTE
+                    && gwbuf_copy_data(buffer, MYSQL_PS_ID_OFFSET + MYSQL_PS_ID_SIZE, 1, &flags) == 1
+                    && flags != 0;
+                mxs_mysql_reply_start(&proto->reply, proto->current_command, opening_cursor);
             }
 
             /**
@@ -553,11 +591,18 @@ static int gw_read_backend_event(DCB* dcb)
                 proto->protocol_auth_state = handle_server_response(dcb, readbuf);
             }
 
-            if (proto->protocol_auth_state == MXS_AUTH_STATE_COMPLETE)
+            if (proto->protocol_auth_state == MXS_AUTH_STATE_COMPLETE
+                && proto->compress && !mxs::enable_mysql_compression(dcb))
+            {
+                proto->protocol_auth_state = MXS_AUTH_STATE_FAILED;
+                gw_reply_on_error(dcb, proto->protocol_auth_state);
+            }
+            else if (proto->protocol_auth_state == MXS_AUTH_STATE_COMPLETE)
             {
                 /** Authentication completed successfully */
                 GWBUF* localq = dcb->delayq;
                 dcb->delayq = NULL;
+                connection_ready(dcb, false);
 
                 if (localq)
                 {
@@ -725,6 +770,34 @@ static inline bool collecting_resultset(MySQLProtocol* proto, uint64_t capabilit
            || proto->collect_result;
 }
 
+/**
+ * Whether a collected result is detected with the reply tracked in the protocol
+ *
+ * The reply is tracked only for statement based routers, as the command is
+ * known only for them. The other routers count the EOF packets of the result.
+ */
+static inline bool tracking_reply(MySQLProtocol* proto, uint64_t capabilities)
+{
+    return collecting_resultset(proto, capabilities)
+           && rcap_type_required(capabilities, RCAP_TYPE_STMT_INPUT)
+           && proto->ignore_replies == 0
+           && (expecting_text_result(proto) || expecting_ps_response(proto));
+}
+
+/**
+ * Store the tracked reply with the collected result, for mxs_mysql_get_reply()
+ */
+static void attach_reply(GWBUF* buffer, const MXS_MYSQL_REPLY* reply)
+{
+    MXS_MYSQL_REPLY* copy = (MXS_MYSQL_REPLY*)MXS_MALLOC(sizeof(*copy));
+
+    if (copy)
+    {
+        *copy = *reply;
+        gwbuf_add_buffer_object(buffer, GWBUF_REPLY_INFO, copy, mxs_free);
+    }
+}
+
 /**
  * Helpers for checking OK and ERR packets specific to COM_CHANGE_USER
  */
@@ -816,12 +889,25 @@ static int gw_read_and_write(DCB* dcb)
     uint64_t capabilities = service_get_capabilities(session->service);
     bool result_collected = false;
     MySQLProtocol* proto = (MySQLProtocol*)dcb->protocol;
+    bool reply_tracked = tracking_reply(proto, capabilities);
 
     if (rcap_type_required(capabilities, RCAP_TYPE_PACKET_OUTPUT)
         || rcap_type_required(capabilities, RCAP_TYPE_CONTIGUOUS_OUTPUT)
         || proto->collect_result
         || proto->ignore_replies != 0)
     {
+        if (reply_tracked)
+        {
+            // What was read earlier is at the front of the buffer and has already been processed
+            mxs_mysql_reply_process(&proto->reply, read_buffer, proto->reply.size);
+
+            if (!mxs_mysql_reply_is_complete(&proto->reply))
+            {
+                dcb_readq_set(dcb, read_buffer);
+                return 0;
+            }
+        }
+
         GWBUF* tmp = modutil_get_complete_packets(&read_buffer);
         /* Put any residue into the read queue */
 
@@ -864,22 +950,19 @@ static int gw_read_and_write(DCB* dcb)
 
             if (collecting_resultset(proto, capabilities))
             {
-                if (expecting_text_result(proto))
+                if (reply_tracked)
                 {
-                    if (mxs_mysql_is_result_set(read_buffer))
+                    // The reply was found to be complete above
+                }
+                else if (expecting_text_result(proto) && mxs_mysql_is_result_set(read_buffer))
+                {
+                    bool more = false;
+                    int eof_cnt = modutil_count_signal_packets(read_buffer, 0, &more, NULL);
+                    if (more || eof_cnt % 2 != 0)
                     {
-                        bool more = false;
-                        int eof_cnt = modutil_count_signal_packets(read_buffer, 0, &more, NULL);
-                        if (more || eof_cnt % 2 != 0)
-                        {
-                            dcb_readq_prepend(dcb, read_buffer);
-                            return 0;
-                        }
+                        dcb_readq_prepend(dcb, read_buffer);
+                        return 0;
                     }
-
-                    // Collected the complete result
-                    proto->collect_result = false;
-                    result_collected = true;
                 }
                 else if (expecting_ps_response(proto)
                          && mxs_mysql_is_prep_stmt_ok(read_buffer)
@@ -888,12 +971,10 @@ static int gw_read_and_write(DCB* dcb)
                     dcb_readq_prepend(dcb, read_buffer);
                     return 0;
                 }
-                else
-                {
-                    // Collected the complete result
-                    proto->collect_result = false;
-                    result_collected = true;
-                }
+
+                // Collected the complete result
+                proto->collect_result = false;
+                result_collected = true;
             }
         }
     }
@@ -943,6 +1024,7 @@ static int gw_read_and_write(DCB* dcb)
         if (result == MYSQL_REPLY_OK)
         {
             MXS_INFO("Response to COM_CHANGE_USER is OK, writing stored query");
+            connection_ready(dcb, true);
             rval = query ? dcb->func.write(dcb, query) : 1;
         }
         else if (auth_change_requested(reply))
@@ -1009,6 +1091,11 @@ static int gw_read_and_write(DCB* dcb)
             stmt = read_buffer;
             read_buffer = NULL;
             gwbuf_set_type(stmt, GWBUF_TYPE_RESULT);
+
+            if (reply_tracked)
+            {
+                attach_reply(stmt, &proto->reply);
+            }
         }
         else if (rcap_type_required(capabilities, RCAP_TYPE_STMT_OUTPUT)
                  && !rcap_type_required(capabilities, RCAP_TYPE_RESULTSET_OUTPUT))
@@ -1182,6 +1269,7 @@ static int gw_MySQLWrite_backend(DCB* dcb, GWBUF* queue)
         if (dcb_write(dcb, buf))
         {
             MXS_INFO("Sent COM_CHANGE_USER");
+            backend_protocol->acquire_start = monotonic_ns();
             backend_protocol->ignore_replies++;
             backend_protocol->stored_query = queue;
             rc = 1;
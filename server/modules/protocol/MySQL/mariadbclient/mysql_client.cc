@@ -26,11 +26,13 @@
 
 #include <maxscale/alloc.h>
 #include <maxscale/authenticator.h>
+#include <maxscale/config.h>
 #include <maxscale/log.h>
 #include <maxscale/modinfo.h>
 #include <maxscale/modutil.h>
 #include <maxscale/poll.h>
 #include <maxscale/protocol.h>
+#include <maxscale/protocol/compression.hh>
 #include <maxscale/protocol/mysql.h>
 #include <maxscale/query_classifier.h>
 #include <maxscale/router.h>
@@ -361,6 +363,11 @@ int MySQLSendHandshake(DCB* dcb)
     mysql_server_capabilities_one[0] = (uint8_t)GW_MYSQL_CAPABILITIES_SERVER;
     mysql_server_capabilities_one[1] = (uint8_t)(GW_MYSQL_CAPABILITIES_SERVER >> 8);
 
+    if (config_get_global_options()->client_compression)
+    {
+        mysql_server_capabilities_one[0] |= (uint8_t)GW_MYSQL_CAPABILITIES_COMPRESS;
+    }
+
     if (is_maria)
     {
         /** A MariaDB 10.2 server doesn't send the CLIENT_MYSQL capability
@@ -760,6 +767,14 @@ static int gw_read_do_authentication(DCB* dcb, GWBUF* read_buffer, int nbytes_re
 
     MySQLProtocol* protocol = (MySQLProtocol*)dcb->protocol;
 
+    if (MXS_AUTH_PENDING == auth_val)
+    {
+        /** The authenticator is waiting for something to complete in the background.
+         * Store the packet so that it's processed again on the next read event. */
+        dcb_readq_prepend(dcb, read_buffer);
+        return 0;
+    }
+
     /**
      * At this point, if the auth_val return code indicates success
      * the user authentication has been successfully completed.
@@ -774,7 +789,7 @@ static int gw_read_do_authentication(DCB* dcb, GWBUF* read_buffer, int nbytes_re
         {
             /** User authentication complete, copy the username to the DCB */
             MYSQL_session* ses = (MYSQL_session*)dcb->data;
-            if ((dcb->user = MXS_STRDUP(ses->user)) == NULL)
+            if (!dcb_set_user(dcb, ses->user))
             {
                 dcb_close(dcb);
                 gwbuf_free(read_buffer);
@@ -783,6 +798,9 @@ static int gw_read_do_authentication(DCB* dcb, GWBUF* read_buffer, int nbytes_re
         }
 
         protocol->protocol_auth_state = MXS_AUTH_STATE_RESPONSE_SENT;
+        dcb->pool_capabilities = mxs_mysql_pool_capabilities(protocol->client_capabilities,
+                                                             protocol->extra_capabilities,
+                                                             dcb->service->capabilities);
         /**
          * Create session, and a router session for it.
          * If successful, there will be backend connection(s)
@@ -804,6 +822,20 @@ static int gw_read_do_authentication(DCB* dcb, GWBUF* read_buffer, int nbytes_re
             mxb_assert(check);
             mxs_mysql_send_ok(dcb, next_sequence, 0, NULL);
 
+            // The OK is the last uncompressed packet.
+            if ((protocol->client_capabilities & GW_MYSQL_CAPABILITIES_COMPRESS)
+                && config_get_global_options()->client_compression)
+            {
+                protocol->compress = mxs::enable_mysql_compression(dcb);
+
+                if (!protocol->compress)
+                {
+                    dcb_close(dcb);
+                    gwbuf_free(read_buffer);
+                    return 0;
+                }
+            }
+
             if (dcb->readq)
             {
                 // The user has already send more data, process it
@@ -1446,9 +1478,12 @@ static void gw_process_one_new_client(DCB* client_dcb)
     /**
      * The worker who owns the DCB is chosen here, before any epoll events for it can be processed.
      * This guarantees that the first event for the DCB is processed only after the following
-     * task has been processed by the owning thread.
+     * task has been processed by the owning thread. If the listener has a socket per
+     * worker, the kernel has already balanced the connection and it stays on this worker.
      */
-    mxs::RoutingWorker* worker = mxs::RoutingWorker::pick_worker();
+    mxs::RoutingWorker* worker = client_dcb->listener->listener->worker_listeners ?
+        mxs::RoutingWorker::get_current() :
+        mxs::RoutingWorker::pick_worker();
 
     worker->execute([=]() {
                         client_dcb->protocol = mysql_protocol_init(client_dcb, client_dcb->fd);
@@ -1678,11 +1713,25 @@ static int route_by_statement(MXS_SESSION* session, uint64_t capabilities, GWBUF
 
         if (packetbuf != NULL)
         {
-            // TODO: Do this only when RCAP_TYPE_CONTIGUOUS_INPUT is requested
-            packetbuf = gwbuf_make_contiguous(packetbuf);
-            session_retain_statement(session, packetbuf);
-
             MySQLProtocol* proto = (MySQLProtocol*)session->client_dcb->protocol;
+            session->stats.packets++;
+
+            /**
+             * The packet shares the data of the read buffer. It is copied only if
+             * it spans several buffers and either a module needs contiguous input
+             * or the packet takes part in a COM_CHANGE_USER, which is processed
+             * by the protocol modules.
+             */
+            if (packetbuf->next
+                && (rcap_type_required(capabilities, RCAP_TYPE_CONTIGUOUS_INPUT)
+                    || proto->changing_user
+                    || mxs_mysql_get_command(packetbuf) == MXS_COM_CHANGE_USER))
+            {
+                packetbuf = gwbuf_make_contiguous(packetbuf);
+                session->stats.copied++;
+            }
+
+            session_retain_statement(session, packetbuf);
 
             /**
              * Update the currently command being executed.
@@ -17,16 +17,19 @@
 
 #include <netinet/tcp.h>
 
+#include <algorithm>
 #include <set>
 #include <sstream>
 #include <map>
 
 #include <maxscale/alloc.h>
 #include <maxscale/clock.h>
+#include <maxscale/config.h>
 #include <maxscale/log.h>
 #include <maxscale/modutil.h>
 #include <maxscale/mysql_utils.h>
 #include <maxscale/protocol/mysql.h>
+#include <maxscale/query_classifier.h>
 #include <maxscale/utils.h>
 #include <maxscale/protocol/mariadb_client.hh>
 #include <maxscale/poll.h>
@@ -46,7 +49,7 @@ MySQLProtocol* mysql_protocol_init(DCB* dcb, int fd)
 {
     MySQLProtocol* p;
 
-    p = (MySQLProtocol*) MXS_CALLOC(1, sizeof(MySQLProtocol));
+    p = (MySQLProtocol*) dcb_alloc_protocol(dcb, sizeof(MySQLProtocol));
     mxb_assert(p != NULL);
 
     if (p == NULL)
@@ -64,6 +67,8 @@ MySQLProtocol* mysql_protocol_init(DCB* dcb, int fd)
     p->num_eof_packets = 0;
     p->large_query = false;
     p->track_state = false;
+    p->compress = false;
+    p->acquire_start = 0;
     /*< Assign fd with protocol */
     p->fd = fd;
     p->owner_dcb = dcb;
@@ -806,19 +811,55 @@ static uint8_t* load_hashed_password(uint8_t* scramble, uint8_t* payload, uint8_
     return payload + GW_MYSQL_SCRAMBLE_SIZE;
 }
 
+/**
+ * Get the capabilities of a backend connection that depend on the client and the service
+ *
+ * @param client_capabilities   The capabilities of the client
+ * @param service_capabilities  The routing capabilities of the service
+ *
+ * @return Bit mask (32 bits)
+ */
+static uint32_t session_capabilities(uint32_t client_capabilities, uint64_t service_capabilities)
+{
+    /** Copy client's flags to backend but with the known capabilities mask */
+    uint32_t final_capabilities = (client_capabilities & (uint32_t)GW_MYSQL_CAPABILITIES_CLIENT);
+
+    if (rcap_type_required(service_capabilities, RCAP_TYPE_SESSION_STATE_TRACKING))
+    {
+        /** add session track */
+        final_capabilities |= (uint32_t)GW_MYSQL_CAPABILITIES_SESSION_TRACK;
+    }
+
+    /** support multi statments  */
+    final_capabilities |= (uint32_t)GW_MYSQL_CAPABILITIES_MULTI_STATEMENTS;
+    final_capabilities |= (int)GW_MYSQL_CAPABILITIES_PLUGIN_AUTH;
+
+    return final_capabilities;
+}
+
+uint64_t mxs_mysql_pool_capabilities(uint32_t client_capabilities,
+                                     uint32_t extra_capabilities,
+                                     uint64_t service_capabilities)
+{
+    // The default database is set again when the connection is reset
+    uint32_t capabilities = session_capabilities(client_capabilities, service_capabilities)
+        & ~(uint32_t)GW_MYSQL_CAPABILITIES_CONNECT_WITH_DB;
+
+    return ((uint64_t)extra_capabilities << 32) | capabilities;
+}
+
 /**
  * @brief Computes the capabilities bit mask for connecting to backend DB
  *
  * We start by taking the default bitmask and removing any bits not set in
  * the bitmask contained in the connection structure. Then add SSL flag if
  * the connection requires SSL (set from the MaxScale configuration). The
- * compression flag may be set, although compression is NOT SUPPORTED. If a
- * database name has been specified in the function call, the relevant flag
- * is set.
+ * compression flag is set if backend compression is enabled and the server
+ * supports it. If a database name has been specified in the function call,
+ * the relevant flag is set.
  *
  * @param conn  The MySQLProtocol structure for the connection
  * @param db_specified Whether the connection request specified a database
- * @param compress Whether compression is requested - NOT SUPPORTED
  * @return Bit mask (32 bits)
  * @note Capability bits are defined in maxscale/protocol/mysql.h
  */
@@ -827,10 +868,7 @@ static uint32_t create_capabilities(MySQLProtocol* conn,
                                     bool db_specified,
                                     uint64_t capabilities)
 {
-    uint32_t final_capabilities;
-
-    /** Copy client's flags to backend but with the known capabilities mask */
-    final_capabilities = (conn->client_capabilities & (uint32_t)GW_MYSQL_CAPABILITIES_CLIENT);
+    uint32_t final_capabilities = session_capabilities(conn->client_capabilities, capabilities);
 
     if (with_ssl)
     {
@@ -842,15 +880,6 @@ static uint32_t create_capabilities(MySQLProtocol* conn,
          */
     }
 
-    if (rcap_type_required(capabilities, RCAP_TYPE_SESSION_STATE_TRACKING))
-    {
-        /** add session track */
-        final_capabilities |= (uint32_t)GW_MYSQL_CAPABILITIES_SESSION_TRACK;
-    }
-
-    /** support multi statments  */
-    final_capabilities |= (uint32_t)GW_MYSQL_CAPABILITIES_MULTI_STATEMENTS;
-
     if (db_specified)
     {
         /* With database specified */
@@ -862,7 +891,11 @@ static uint32_t create_capabilities(MySQLProtocol* conn,
         final_capabilities &= ~(int)GW_MYSQL_CAPABILITIES_CONNECT_WITH_DB;
     }
 
-    final_capabilities |= (int)GW_MYSQL_CAPABILITIES_PLUGIN_AUTH;
+    if (config_get_global_options()->backend_compression
+        && (conn->server_capabilities & GW_MYSQL_CAPABILITIES_COMPRESS))
+    {
+        final_capabilities |= (uint32_t)GW_MYSQL_CAPABILITIES_COMPRESS;
+    }
 
     return final_capabilities;
 }
@@ -883,6 +916,7 @@ GWBUF* gw_generate_auth_response(MYSQL_session* client,
 
     uint32_t capabilities = create_capabilities(conn, with_ssl, client->db[0], service_capabilities);
     gw_mysql_set_byte4(client_capabilities, capabilities);
+    conn->compress = capabilities & GW_MYSQL_CAPABILITIES_COMPRESS;
 
     /**
      * Use the default authentication plugin name. If the server is using a
@@ -1341,6 +1375,360 @@ bool mxs_mysql_command_will_respond(uint8_t cmd)
 namespace
 {
 
+inline bool is_eof(const uint8_t* payload, uint32_t len)
+{
+    return len == MYSQL_EOF_PACKET_LEN - MYSQL_HEADER_LEN && payload[0] == MYSQL_REPLY_EOF;
+}
+
+/**
+ * Get the server status of an EOF packet
+ *
+ * MySQL 5.6 and 5.7 have a "feature" that doesn't set the SERVER_MORE_RESULTS_EXIST
+ * flag in the last EOF packet of a result set if the SERVER_PS_OUT_PARAMS flag
+ * was set in the first one. The flag is added here in that case.
+ */
+uint16_t eof_status(MXS_MYSQL_REPLY* reply, const uint8_t* payload)
+{
+    uint16_t status = gw_mysql_get_byte2(payload + 3);
+
+    if (status & SERVER_PS_OUT_PARAMS)
+    {
+        reply->ps_out_params = true;
+    }
+    else if (reply->ps_out_params)
+    {
+        status |= SERVER_MORE_RESULTS_EXIST;
+        reply->ps_out_params = false;
+    }
+
+    reply->server_status = status;
+    return status;
+}
+
+void end_result(MXS_MYSQL_REPLY* reply, uint16_t status)
+{
+    ++reply->results;
+    reply->state = (status & SERVER_MORE_RESULTS_EXIST) ? REPLY_STATE_START : REPLY_STATE_DONE;
+}
+
+void process_reply_start(MXS_MYSQL_REPLY* reply, const uint8_t* payload, uint32_t len)
+{
+    uint8_t cmd = len > 0 ? payload[0] : 0;
+    reply->local_infile = false;
+
+    if (reply->command == MXS_COM_STATISTICS)
+    {
+        // COM_STATISTICS returns a single string
+        end_result(reply, 0);
+        return;
+    }
+
+    switch (cmd)
+    {
+    case MYSQL_REPLY_OK:
+        if (reply->command == MXS_COM_STMT_PREPARE)
+        {
+            // The OK packet is followed by the parameter and the column definitions, each ending in an EOF
+            uint16_t params = gw_mysql_get_byte2(payload + 7);
+            reply->columns = gw_mysql_get_byte2(payload + 5);
+            reply->defs_left = (params ? params + 1 : 0) + (reply->columns ? reply->columns + 1 : 0);
+
+            if (reply->defs_left > 0)
+            {
+                reply->state = REPLY_STATE_PS_DEFS;
+            }
+            else
+            {
+                end_result(reply, 0);
+            }
+        }
+        else
+        {
+            const uint8_t* ptr = payload + 1;
+            ptr += mxs_leint_bytes(ptr);    // Affected rows
+            ptr += mxs_leint_bytes(ptr);    // Last insert ID
+            reply->server_status = gw_mysql_get_byte2(ptr);
+            reply->warnings += gw_mysql_get_byte2(ptr + 2);
+            end_result(reply, reply->server_status);
+        }
+        break;
+
+    case MYSQL_REPLY_LOCAL_INFILE:
+        reply->local_infile = true;
+        reply->state = REPLY_STATE_DONE;
+        break;
+
+    case MYSQL_REPLY_ERR:
+        // Nothing ever follows an error packet
+        reply->error = true;
+        reply->error_code = gw_mysql_get_byte2(payload + 1);
+        reply->state = REPLY_STATE_DONE;
+        break;
+
+    case MYSQL_REPLY_EOF:
+        // EOF packets are never expected as the first response
+        mxb_assert(!true);
+        break;
+
+    default:
+        if (reply->command == MXS_COM_FIELD_LIST)
+        {
+            // COM_FIELD_LIST sends a strange kind of a result set
+            reply->state = REPLY_STATE_RSET_ROWS;
+        }
+        else
+        {
+            // Start of a result set
+            reply->columns = mxs_leint_value(payload);
+            reply->defs_left = reply->columns;
+            reply->state = REPLY_STATE_RSET_COLDEF;
+        }
+        break;
+    }
+}
+
+/**
+ * Process a packet whose header and the start of whose payload are in reply->packet
+ */
+void process_packet(MXS_MYSQL_REPLY* reply)
+{
+    uint32_t len = MYSQL_GET_PAYLOAD_LEN(reply->packet);
+    const uint8_t* payload = reply->packet + MYSQL_HEADER_LEN;
+
+    // Ignore the tail end of a large packet. Only resultsets can generate packets this large
+    // and we don't care what the contents are and thus it is safe to ignore it.
+    bool skip_next = reply->skip_next;
+    reply->skip_next = len == GW_MYSQL_MAX_PACKET_LEN;
+
+    if (skip_next)
+    {
+        return;
+    }
+
+    switch (reply->state)
+    {
+    case REPLY_STATE_START:
+        process_reply_start(reply, payload, len);
+        break;
+
+    case REPLY_STATE_DONE:
+        // This should never happen
+        MXS_ERROR("Unexpected result state. cmd: 0x%02hhx, len: %u", len > 0 ? payload[0] : 0, len);
+        mxb_assert(!true);
+        break;
+
+    case REPLY_STATE_RSET_COLDEF:
+        mxb_assert(reply->defs_left > 0);
+
+        if (--reply->defs_left == 0)
+        {
+            reply->state = REPLY_STATE_RSET_COLDEF_EOF;
+        }
+        break;
+
+    case REPLY_STATE_RSET_COLDEF_EOF:
+        mxb_assert(is_eof(payload, len));
+        eof_status(reply, payload);
+        reply->state = REPLY_STATE_RSET_ROWS;
+
+        if (reply->opening_cursor)
+        {
+            // The rows are fetched with COM_STMT_FETCH
+            reply->opening_cursor = false;
+            MXS_INFO("Cursor successfully opened");
+            end_result(reply, 0);
+        }
+        break;
+
+    case REPLY_STATE_RSET_ROWS:
+        if (is_eof(payload, len))
+        {
+            reply->warnings += gw_mysql_get_byte2(payload + 1);
+            end_result(reply, eof_status(reply, payload));
+        }
+        else if (len > 0 && payload[0] == MYSQL_REPLY_ERR)
+        {
+            reply->error = true;
+            reply->error_code = gw_mysql_get_byte2(payload + 1);
+            reply->state = REPLY_STATE_DONE;
+        }
+        else
+        {
+            ++reply->rows;
+        }
+        break;
+
+    case REPLY_STATE_PS_DEFS:
+        mxb_assert(reply->defs_left > 0);
+
+        if (--reply->defs_left == 0)
+        {
+            end_result(reply, 0);
+        }
+        break;
+    }
+}
+}
+
+void mxs_mysql_reply_start(MXS_MYSQL_REPLY* reply, uint8_t cmd, bool opening_cursor)
+{
+    memset(reply, 0, sizeof(*reply));
+    reply->command = cmd;
+    reply->opening_cursor = opening_cursor;
+    // The response to a COM_STMT_FETCH consists of the rows and an EOF packet
+    reply->state = cmd == MXS_COM_STMT_FETCH ? REPLY_STATE_RSET_ROWS : REPLY_STATE_START;
+}
+
+void mxs_mysql_reply_process(MXS_MYSQL_REPLY* reply, GWBUF* buffer, size_t offset)
+{
+    for (; buffer; buffer = buffer->next)
+    {
+        size_t buflen = GWBUF_LENGTH(buffer);
+
+        if (offset >= buflen)
+        {
+            offset -= buflen;
+            continue;
+        }
+
+        uint8_t* ptr = GWBUF_DATA(buffer) + offset;
+        uint8_t* end = GWBUF_DATA(buffer) + buflen;
+        reply->size += end - ptr;
+        offset = 0;
+
+        while (ptr < end)
+        {
+            if (reply->skip > 0)
+            {
+                // The rest of the payload is of no interest
+                uint32_t n = std::min<size_t>(reply->skip, end - ptr);
+                reply->skip -= n;
+                ptr += n;
+                continue;
+            }
+
+            uint32_t wanted = reply->have < MYSQL_HEADER_LEN ?
+                MYSQL_HEADER_LEN : MYSQL_HEADER_LEN + reply->want;
+            uint32_t n = std::min<size_t>(wanted - reply->have, end - ptr);
+            memcpy(reply->packet + reply->have, ptr, n);
+            reply->have += n;
+            ptr += n;
+
+            if (reply->have == MYSQL_HEADER_LEN)
+            {
+                reply->want = std::min<uint32_t>(MYSQL_GET_PAYLOAD_LEN(reply->packet), MXS_REPLY_PREFIX_LEN);
+            }
+
+            if (reply->have >= MYSQL_HEADER_LEN && reply->have == MYSQL_HEADER_LEN + reply->want)
+            {
+                process_packet(reply);
+                reply->skip = MYSQL_GET_PAYLOAD_LEN(reply->packet) - reply->want;
+                reply->have = 0;
+            }
+        }
+    }
+}
+
+namespace
+{
+
+/** Functions that read the state left by the previous statement */
+const char* NEXT_STATEMENT_FUNCTIONS[] =
+{
+    "found_rows",
+    "last_insert_id",
+    "row_count",
+};
+
+/** Functions that take a lock that is held until it is released or the connection is reset */
+const char* SESSION_FUNCTIONS[] =
+{
+    "get_lock",
+};
+
+const size_t N_NEXT_STATEMENT_FUNCTIONS = sizeof(NEXT_STATEMENT_FUNCTIONS) / sizeof(NEXT_STATEMENT_FUNCTIONS[0]);
+const size_t N_SESSION_FUNCTIONS = sizeof(SESSION_FUNCTIONS) / sizeof(SESSION_FUNCTIONS[0]);
+
+int compare_name(const void* left, const void* right)
+{
+    return strcasecmp((const char*)left, *(const char**)right);
+}
+
+inline bool uses_name(const char* name, const char** names, size_t n_names)
+{
+    return bsearch(name, names, n_names, sizeof(const char*), compare_name) != NULL;
+}
+
+/**
+ * Check whether a statement contains a keyword, ignoring case
+ */
+bool contains_keyword(const char* sql, int len, const char* keyword)
+{
+    const char* end = sql + len;
+    auto eq = [](char a, char b) {
+            return toupper(a) == toupper(b);
+        };
+
+    return std::search(sql, end, keyword, keyword + strlen(keyword), eq) != end;
+}
+
+/**
+ * Check whether a statement begins with a keyword, ignoring case
+ */
+bool starts_with_keyword(const char* sql, int len, const char* keyword)
+{
+    const char* start = modutil_MySQL_bypass_whitespace((char*)sql, len);
+    size_t n = strlen(keyword);
+
+    return (size_t)(sql + len - start) > n
+           && strncasecmp(start, keyword, n) == 0
+           && isspace(start[n]);
+}
+}
+
+mxs_mysql_binding_t mxs_mysql_get_binding(GWBUF* buffer, uint32_t type)
+{
+    mxs_mysql_binding_t rval = qc_query_is_type(type, QUERY_TYPE_WRITE) ? MXS_BINDING_NEXT : MXS_BINDING_NONE;
+    char* sql;
+    int len;
+
+    if (mxs_mysql_get_command(buffer) == MXS_COM_QUERY && modutil_extract_SQL(buffer, &sql, &len))
+    {
+        const QC_FUNCTION_INFO* infos;
+        size_t n_infos;
+        qc_get_function_info(buffer, &infos, &n_infos);
+
+        for (size_t i = 0; i < n_infos; i++)
+        {
+            if (uses_name(infos[i].name, SESSION_FUNCTIONS, N_SESSION_FUNCTIONS))
+            {
+                rval = MXS_BINDING_SESSION;
+            }
+            else if (rval == MXS_BINDING_NONE
+                     && uses_name(infos[i].name, NEXT_STATEMENT_FUNCTIONS, N_NEXT_STATEMENT_FUNCTIONS))
+            {
+                rval = MXS_BINDING_NEXT;
+            }
+        }
+
+        if (rval == MXS_BINDING_NONE && qc_get_operation(buffer) == QUERY_OP_SELECT
+            && contains_keyword(sql, len, "SQL_CALC_FOUND_ROWS"))
+        {
+            rval = MXS_BINDING_NEXT;
+        }
+        else if (qc_query_is_type(type, QUERY_TYPE_WRITE) && starts_with_keyword(sql, len, "LOCK"))
+        {
+            // LOCK TABLES, the locks are released with UNLOCK TABLES or when the connection is reset
+            rval = MXS_BINDING_SESSION;
+        }
+    }
+
+    return rval;
+}
+
+namespace
+{
+
 // Servers and queries to execute on them
 typedef std::map<SERVER*, std::string> TargetList;
 
@@ -1369,13 +1757,15 @@ static bool kill_func(DCB* dcb, void* data);
 
 struct ConnKillInfo : public KillInfo
 {
-    ConnKillInfo(uint64_t id, std::string query, MXS_SESSION* ses)
+    ConnKillInfo(uint64_t id, std::string query, MXS_SESSION* ses, MXS_SESSION* target)
         : KillInfo(query, ses, kill_func)
         , target_id(id)
+        , target(target)
     {
     }
 
-    uint64_t target_id;
+    uint64_t     target_id;
+    MXS_SESSION* target;    // A reference to the session to be killed
 };
 
 static bool kill_user_func(DCB* dcb, void* data);
@@ -1430,11 +1820,8 @@ static bool kill_user_func(DCB* dcb, void* data)
     return true;
 }
 
-static void worker_func(int thread_id, void* data)
+static void execute_kill(KillInfo* info)
 {
-    KillInfo* info = static_cast<KillInfo*>(data);
-    dcb_foreach_local(info->cb, info);
-
     for (TargetList::iterator it = info->targets.begin();
          it != info->targets.end(); it++)
     {
@@ -1446,7 +1833,33 @@ static void worker_func(int thread_id, void* data)
         // The LocalClient needs to delete itself once the queries are done
         client->self_destruct();
     }
+}
+
+static void worker_func(int thread_id, void* data)
+{
+    KillInfo* info = static_cast<KillInfo*>(data);
+    dcb_foreach_local(info->cb, info);
+    execute_kill(info);
+    delete info;
+}
+
+static void conn_kill_worker_func(int thread_id, void* data)
+{
+    ConnKillInfo* info = static_cast<ConnKillInfo*>(data);
+    MXB_WORKER* owner = info->target->client_dcb->poll.owner;
+
+    if (session_is_moving(info->target) || owner != mxs_rworker_get_current())
+    {
+        // The session was moved to another worker, follow it there.
+        if (mxb_worker_post_message(owner, MXB_WORKER_MSG_CALL, (intptr_t)conn_kill_worker_func, (intptr_t)info))
+        {
+            return;
+        }
+    }
 
+    session_foreach_backend_dcb(info->target, info->cb, info);
+    session_put_ref(info->target);
+    execute_kill(info);
     delete info;
 }
 }
@@ -1458,14 +1871,22 @@ void mxs_mysql_execute_kill(MXS_SESSION* issuer, uint64_t target_id, kill_type_t
     std::stringstream ss;
     ss << "KILL " << hard << query;
 
-    for (int i = 0; i < config_threadcount(); i++)
+    // Only the worker that owns the session needs to be involved.
+    MXS_SESSION* target = session_get_by_id(target_id);
+
+    if (target)
     {
-        MXB_WORKER* worker = mxs_rworker_get(i);
-        mxb_assert(worker);
-        mxb_worker_post_message(worker,
-                                MXB_WORKER_MSG_CALL,
-                                (intptr_t)worker_func,
-                                (intptr_t) new ConnKillInfo(target_id, ss.str(), issuer));
+        MXB_WORKER* worker = target->client_dcb->poll.owner;
+        ConnKillInfo* info = new ConnKillInfo(target_id, ss.str(), issuer, target);
+
+        if (!mxb_worker_post_message(worker,
+                                     MXB_WORKER_MSG_CALL,
+                                     (intptr_t)conn_kill_worker_func,
+                                     (intptr_t)info))
+        {
+            session_put_ref(target);
+            delete info;
+        }
     }
 
     mxs_mysql_send_ok(issuer->client_dcb, 1, 0, NULL);
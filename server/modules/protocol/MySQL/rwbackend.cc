@@ -17,377 +17,368 @@
 #include <maxscale/protocol/mysql.h>
 #include <maxscale/log.h>
 
-using Iter = mxs::Buffer::iterator;
+namespace
+{
+/** Maximum number of closed statements kept prepared on one connection */
+const size_t PS_CACHE_MAX_IDLE = 100;
+}
 
 namespace maxscale
 {
 
-RWBackend::RWBackend(SERVER_REF* ref)
-    : mxs::Backend(ref)
-    , m_reply_state(REPLY_STATE_DONE)
-    , m_modutil_state{0}
-    , m_command(0)
-    , m_opening_cursor(false)
-    , m_expected_rows(0)
-    , m_local_infile_requested(false)
+PSCache::PSCache(size_t max_idle)
+    : m_max_idle(max_idle)
 {
 }
 
-RWBackend::~RWBackend()
+PSCache::~PSCache()
 {
+    clear();
 }
 
-bool RWBackend::execute_session_command()
+void PSCache::add(uint32_t handle, const std::string& sql, GWBUF* response)
 {
-    m_command = next_session_command()->get_command();
-    bool expect_response = mxs_mysql_command_will_respond(m_command);
-    bool rval = mxs::Backend::execute_session_command();
+    auto it = m_stmts.find(handle);
 
-    if (rval && expect_response)
+    if (it != m_stmts.end())
     {
-        set_reply_state(REPLY_STATE_START);
+        // The server reuses the handles of closed statements
+        erase_idle(it);
+        gwbuf_free(it->second.response);
+        m_stmts.erase(it);
     }
 
-    return rval;
+    Statement stmt;
+    stmt.sql = sql;
+    stmt.response = gwbuf_deep_clone(response);
+    stmt.reusable = stmt.response != NULL;
+    stmt.lru = m_lru.end();
+    m_stmts.emplace(handle, stmt);
 }
 
-bool RWBackend::continue_session_command(GWBUF* buffer)
+void PSCache::taint(uint32_t handle)
 {
-    return Backend::write(buffer, NO_RESPONSE);
-}
+    auto it = m_stmts.find(handle);
 
-void RWBackend::add_ps_handle(uint32_t id, uint32_t handle)
-{
-    m_ps_handles[id] = handle;
-    MXS_INFO("PS response for %s: %u -> %u", name(), id, handle);
+    if (it != m_stmts.end())
+    {
+        it->second.reusable = false;
+    }
 }
 
-uint32_t RWBackend::get_ps_handle(uint32_t id) const
+std::vector<uint32_t> PSCache::release(uint32_t handle)
 {
-    BackendHandleMap::const_iterator it = m_ps_handles.find(id);
+    std::vector<uint32_t> rval;
+    auto it = m_stmts.find(handle);
 
-    if (it != m_ps_handles.end())
+    if (it == m_stmts.end() || !it->second.reusable || m_max_idle == 0 || contains(it->second.sql))
     {
-        return it->second;
-    }
-
-    return 0;
-}
+        // The statement can't be kept or an identical one already is
+        if (it != m_stmts.end())
+        {
+            gwbuf_free(it->second.response);
+            m_stmts.erase(it);
+        }
 
-bool RWBackend::write(GWBUF* buffer, response_type type)
-{
-    if (type == mxs::Backend::EXPECT_RESPONSE)
+        rval.push_back(handle);
+    }
+    else
     {
-        /** The server will reply to this command */
-        set_reply_state(REPLY_STATE_START);
+        m_idle[it->second.sql] = handle;
+        it->second.lru = m_lru.insert(m_lru.end(), handle);
+
+        while (m_idle.size() > m_max_idle)
+        {
+            uint32_t oldest = m_lru.front();
+            auto old = m_stmts.find(oldest);
+            mxb_assert(old != m_stmts.end());
+            erase_idle(old);
+            gwbuf_free(old->second.response);
+            m_stmts.erase(old);
+            rval.push_back(oldest);
+        }
     }
 
-    uint8_t cmd = mxs_mysql_get_command(buffer);
+    return rval;
+}
 
-    m_command = cmd;
+uint32_t PSCache::acquire(const std::string& sql, GWBUF** ppResponse)
+{
+    uint32_t rval = 0;
+    auto idle = m_idle.find(sql);
 
-    if (mxs_mysql_is_ps_command(cmd))
+    if (idle != m_idle.end())
     {
-        uint32_t id = mxs_mysql_extract_ps_id(buffer);
-        BackendHandleMap::iterator it = m_ps_handles.find(id);
+        rval = idle->second;
+        auto it = m_stmts.find(rval);
+        mxb_assert(it != m_stmts.end());
+        erase_idle(it);
 
-        if (it != m_ps_handles.end())
+        if (ppResponse)
         {
-            /** Replace the client handle with the real PS handle */
-            uint8_t* ptr = GWBUF_DATA(buffer) + MYSQL_PS_ID_OFFSET;
-            gw_mysql_set_byte4(ptr, it->second);
-
-            if (cmd == MXS_COM_STMT_EXECUTE)
-            {
-                // Extract the flag byte after the statement ID
-                uint8_t flags = 0;
-                gwbuf_copy_data(buffer, MYSQL_PS_ID_OFFSET + MYSQL_PS_ID_SIZE, 1, &flags);
-
-                // Any non-zero flag value means that we have an open cursor
-                m_opening_cursor = flags != 0;
-            }
-            else if (cmd == MXS_COM_STMT_CLOSE)
-            {
-                m_ps_handles.erase(it);
-            }
-            else if (cmd == MXS_COM_STMT_FETCH)
-            {
-                // Number of rows to fetch is a 4 byte integer after the ID
-                uint8_t buf[4];
-                gwbuf_copy_data(buffer, MYSQL_PS_ID_OFFSET + MYSQL_PS_ID_SIZE, 4, buf);
-                m_expected_rows = gw_mysql_get_byte4(buf);
-            }
+            *ppResponse = gwbuf_deep_clone(it->second.response);
         }
     }
 
-    return mxs::Backend::write(buffer, type);
-}
-
-void RWBackend::close(close_type type)
-{
-    m_reply_state = REPLY_STATE_DONE;
-    mxs::Backend::close(type);
+    return rval;
 }
 
-bool RWBackend::consume_fetched_rows(GWBUF* buffer)
+std::vector<uint32_t> PSCache::clear_idle()
 {
-    bool rval = false;
-    bool more = false;
-    int n_eof = modutil_count_signal_packets(buffer, 0, &more, &m_modutil_state);
+    std::vector<uint32_t> rval(m_lru.begin(), m_lru.end());
 
-    // If the server responded with an error, n_eof > 0
-    if (n_eof > 0)
-    {
-        rval = true;
-    }
-    else
+    for (uint32_t handle : rval)
     {
-        m_expected_rows -= modutil_count_packets(buffer);
-        mxb_assert(m_expected_rows >= 0);
-        rval = m_expected_rows == 0;
+        auto it = m_stmts.find(handle);
+        mxb_assert(it != m_stmts.end());
+        gwbuf_free(it->second.response);
+        m_stmts.erase(it);
     }
 
+    m_idle.clear();
+    m_lru.clear();
     return rval;
 }
 
-static inline bool have_next_packet(GWBUF* buffer)
+void PSCache::clear()
 {
-    uint32_t len = MYSQL_GET_PAYLOAD_LEN(GWBUF_DATA(buffer)) + MYSQL_HEADER_LEN;
-    return gwbuf_length(buffer) > len;
+    for (auto& a : m_stmts)
+    {
+        gwbuf_free(a.second.response);
+    }
+
+    m_stmts.clear();
+    m_idle.clear();
+    m_lru.clear();
 }
 
-uint64_t get_encoded_int(Iter it)
+void PSCache::take_ownership()
 {
-    uint64_t len = *it++;
-
-    switch (len)
+    for (auto& a : m_stmts)
     {
-    case 0xfc:
-        len = *it++;
-        len |= ((uint64_t)*it++) << 8;
-        break;
-
-    case 0xfd:
-        len = *it++;
-        len |= ((uint64_t)*it++) << 8;
-        len |= ((uint64_t)*it++) << 16;
-        break;
-
-    case 0xfe:
-        len = *it++;
-        len |= ((uint64_t)*it++) << 8;
-        len |= ((uint64_t)*it++) << 16;
-        len |= ((uint64_t)*it++) << 24;
-        len |= ((uint64_t)*it++) << 32;
-        len |= ((uint64_t)*it++) << 40;
-        len |= ((uint64_t)*it++) << 48;
-        len |= ((uint64_t)*it++) << 56;
-        break;
-
-    default:
-        break;
+        gwbuf_take_ownership(a.second.response);
     }
-
-    return len;
 }
 
-Iter skip_encoded_int(Iter it)
+void PSCache::erase_idle(std::unordered_map<uint32_t, Statement>::iterator it)
 {
-    switch (*it)
+    if (it->second.lru != m_lru.end())
     {
-    case 0xfc:
-        std::advance(it, 3);
-        break;
-
-    case 0xfd:
-        std::advance(it, 4);
-        break;
-
-    case 0xfe:
-        std::advance(it, 9);
-        break;
-
-    default:
-        std::advance(it, 1);
-        break;
+        m_idle.erase(it->second.sql);
+        m_lru.erase(it->second.lru);
+        it->second.lru = m_lru.end();
     }
-
-    return it;
 }
 
-bool is_last_ok(Iter it)
+RWBackend::RWBackend(SERVER_REF* ref)
+    : mxs::Backend(ref)
+    , m_reply()
+    , m_ps_cache(PS_CACHE_MAX_IDLE)
+    , m_command(0)
 {
-    ++it;                       // Skip the command byte
-    it = skip_encoded_int(it);  // Affected rows
-    it = skip_encoded_int(it);  // Last insert ID
-    uint16_t status = *it++;
-    status |= (*it++) << 8;
-    return (status & SERVER_MORE_RESULTS_EXIST) == 0;
+    m_reply.state = REPLY_STATE_DONE;
 }
 
-bool is_last_eof(Iter it)
+RWBackend::~RWBackend()
 {
-    std::advance(it, 3);    // Skip the command byte and warning count
-    uint16_t status = *it++;
-    status |= (*it++) << 8;
-    return (status & SERVER_MORE_RESULTS_EXIST) == 0;
 }
 
-void RWBackend::process_reply_start(Iter it)
+bool RWBackend::execute_session_command()
 {
-    uint8_t cmd = *it;
-    m_local_infile_requested = false;
+    bool rval;
 
-    switch (cmd)
+    do
     {
-    case MYSQL_REPLY_OK:
-        if (is_last_ok(it))
+        if (GWBUF* reused = reuse_prepared())
         {
-            // No more results
-            set_reply_state(REPLY_STATE_DONE);
+            gwbuf_free(reused);
+            rval = true;
+            continue;
         }
-        break;
-
-    case MYSQL_REPLY_LOCAL_INFILE:
-        m_local_infile_requested = true;
-        set_reply_state(REPLY_STATE_DONE);
-        break;
 
-    case MYSQL_REPLY_ERR:
-        // Nothing ever follows an error packet
-        set_reply_state(REPLY_STATE_DONE);
-        break;
+        m_command = next_session_command()->get_command();
 
-    case MYSQL_REPLY_EOF:
-        // EOF packets are never expected as the first response
-        mxb_assert(!true);
-        break;
-
-    default:
-        if (current_command() == MXS_COM_FIELD_LIST)
+        if (m_command != MXS_COM_STMT_PREPARE && !mxs_mysql_is_ps_command(m_command)
+            && m_ps_cache.size() && in_use())
         {
-            // COM_FIELD_LIST sends a strange kind of a result set
-            set_reply_state(REPLY_STATE_RSET_ROWS);
+            /** The command can change the default database or other state that
+             * the statements were prepared with, don't reuse them afterwards */
+            close_ps_handles(m_ps_cache.clear_idle());
         }
-        else
+
+        bool expect_response = mxs_mysql_command_will_respond(m_command);
+        rval = mxs::Backend::execute_session_command();
+
+        if (rval && expect_response)
         {
-            // Start of a result set
-            m_num_coldefs = get_encoded_int(it);
-            set_reply_state(REPLY_STATE_RSET_COLDEF);
+            mxs_mysql_reply_start(&m_reply, m_command, false);
         }
+    }
+    while (rval && !is_waiting_result() && has_session_commands());
+
+    return rval;
+}
+
+bool RWBackend::continue_session_command(GWBUF* buffer)
+{
+    return Backend::write(buffer, NO_RESPONSE);
+}
 
-        break;
+void RWBackend::take_ownership()
+{
+    Backend::take_ownership();
+    m_ps_cache.take_ownership();
+}
+
+void RWBackend::add_ps_handle(uint32_t id, uint32_t handle)
+{
+    m_ps_handles[id] = handle;
+    MXS_INFO("PS response for %s: %u -> %u", name(), id, handle);
+}
+
+void RWBackend::add_ps_handle(uint32_t id, uint32_t handle, const std::string& sql, GWBUF* response)
+{
+    add_ps_handle(id, handle);
+    m_ps_cache.add(handle, sql, response);
+}
+
+GWBUF* RWBackend::reuse_prepared()
+{
+    GWBUF* rval = NULL;
+
+    uint32_t handle;
+
+    if (m_ps_cache.size() && !is_waiting_result() && has_session_commands()
+        && next_session_command()->get_command() == MXS_COM_STMT_PREPARE
+        && (handle = m_ps_cache.acquire(next_session_command()->to_string(), &rval)))
+    {
+        uint64_t id = complete_session_command();
+        MXS_INFO("Reusing prepared statement %u on %s", handle, name());
+        add_ps_handle(id, handle);
     }
+
+    return rval;
 }
 
-void RWBackend::process_packets(GWBUF* result)
+bool RWBackend::close_ps_handles(const std::vector<uint32_t>& handles)
 {
-    mxs::Buffer buffer(result);
-    auto it = buffer.begin();
+    bool rval = true;
 
-    while (it != buffer.end())
+    for (uint32_t handle : handles)
     {
-        // Extract packet length and command byte
-        uint32_t len = *it++;
-        len |= (*it++) << 8;
-        len |= (*it++) << 16;
-        ++it;   // Skip the sequence
-        mxb_assert(it != buffer.end());
-        auto end = std::next(it, len);
-        uint8_t cmd = *it;
-
-        // Ignore the tail end of a large packet large packet. Only resultsets can generate packets this large
-        // and we don't care what the contents are and thus it is safe to ignore it.
-        bool skip_next = m_skip_next;
-        m_skip_next = len == GW_MYSQL_MAX_PACKET_LEN;
-
-        if (skip_next)
+        uint8_t data[MYSQL_HEADER_LEN + 1 + MYSQL_PS_ID_SIZE];
+        gw_mysql_set_byte3(data, sizeof(data) - MYSQL_HEADER_LEN);
+        data[3] = 0;
+        data[MYSQL_HEADER_LEN] = MXS_COM_STMT_CLOSE;
+        gw_mysql_set_byte4(data + MYSQL_PS_ID_OFFSET, handle);
+        MXS_INFO("Closing unused prepared statement %u on %s", handle, name());
+
+        if (!mxs::Backend::write(gwbuf_alloc_and_load(sizeof(data), data), NO_RESPONSE))
         {
-            it = end;
-            continue;
+            rval = false;
         }
+    }
 
-        switch (m_reply_state)
-        {
-        case REPLY_STATE_START:
-            process_reply_start(it);
-            break;
+    return rval;
+}
 
-        case REPLY_STATE_DONE:
-            // This should never happen
-            MXS_ERROR("Unexpected result state. cmd: 0x%02hhx, len: %u", cmd, len);
-            mxb_assert(!true);
-            break;
+uint32_t RWBackend::get_ps_handle(uint32_t id) const
+{
+    BackendHandleMap::const_iterator it = m_ps_handles.find(id);
 
-        case REPLY_STATE_RSET_COLDEF:
-            mxb_assert(m_num_coldefs > 0);
-            --m_num_coldefs;
+    if (it != m_ps_handles.end())
+    {
+        return it->second;
+    }
 
-            if (m_num_coldefs == 0)
-            {
-                set_reply_state(REPLY_STATE_RSET_COLDEF_EOF);
-                // Skip this state when DEPRECATE_EOF capability is supported
-            }
-            break;
+    return 0;
+}
+
+bool RWBackend::write(GWBUF* buffer, response_type type)
+{
+    uint8_t cmd = mxs_mysql_get_command(buffer);
+    bool opening_cursor = false;
+
+    m_command = cmd;
+
+    if (mxs_mysql_is_ps_command(cmd))
+    {
+        uint32_t id = mxs_mysql_extract_ps_id(buffer);
+        BackendHandleMap::iterator it = m_ps_handles.find(id);
 
-        case REPLY_STATE_RSET_COLDEF_EOF:
-            mxb_assert(cmd == MYSQL_REPLY_EOF && len == MYSQL_EOF_PACKET_LEN - MYSQL_HEADER_LEN);
-            set_reply_state(REPLY_STATE_RSET_ROWS);
+        if (it != m_ps_handles.end())
+        {
+            /** Replace the client handle with the real PS handle */
+            uint8_t* ptr = GWBUF_DATA(buffer) + MYSQL_PS_ID_OFFSET;
+            gw_mysql_set_byte4(ptr, it->second);
 
-            if (is_opening_cursor())
+            if (cmd == MXS_COM_STMT_EXECUTE)
             {
-                set_cursor_opened();
-                MXS_INFO("Cursor successfully opened");
-                set_reply_state(REPLY_STATE_DONE);
-            }
-            break;
+                // Extract the flag byte after the statement ID
+                uint8_t flags = 0;
+                gwbuf_copy_data(buffer, MYSQL_PS_ID_OFFSET + MYSQL_PS_ID_SIZE, 1, &flags);
 
-        case REPLY_STATE_RSET_ROWS:
-            if (cmd == MYSQL_REPLY_EOF && len == MYSQL_EOF_PACKET_LEN - MYSQL_HEADER_LEN)
+                // Any non-zero flag value means that we have an open cursor
+                opening_cursor = flags != 0;
+
+                if (opening_cursor)
+                {
+                    m_ps_cache.taint(it->second);
+                }
+            }
+            else if (cmd == MXS_COM_STMT_SEND_LONG_DATA)
             {
-                set_reply_state(is_last_eof(it) ? REPLY_STATE_DONE : REPLY_STATE_START);
+                m_ps_cache.taint(it->second);
             }
-            else if (cmd == MYSQL_REPLY_ERR)
+            else if (cmd == MXS_COM_STMT_CLOSE)
             {
-                set_reply_state(REPLY_STATE_DONE);
+                uint32_t handle = it->second;
+                m_ps_handles.erase(it);
+                std::vector<uint32_t> handles = m_ps_cache.release(handle);
+
+                if (handles.empty() || handles.front() != handle)
+                {
+                    // The statement stays prepared for reuse, only the evicted ones are closed
+                    MXS_INFO("Keeping prepared statement %u on %s", handle, name());
+                    gwbuf_free(buffer);
+                    return close_ps_handles(handles);
+                }
             }
-            break;
         }
+    }
 
-        it = end;
+    if (type == mxs::Backend::EXPECT_RESPONSE)
+    {
+        /** The server will reply to this command */
+        mxs_mysql_reply_start(&m_reply, cmd, opening_cursor);
     }
 
-    buffer.release();
+    return mxs::Backend::write(buffer, type);
+}
+
+void RWBackend::close(close_type type)
+{
+    m_reply.state = REPLY_STATE_DONE;
+    m_ps_handles.clear();
+    m_ps_cache.clear();
+    mxs::Backend::close(type);
 }
 
-/**
- * @brief Process a possibly partial response from the backend
- *
- * @param buffer  Buffer containing the response
- */
 void RWBackend::process_reply(GWBUF* buffer)
 {
-    if (current_command() == MXS_COM_STMT_FETCH)
-    {
-        // If the server responded with an error, n_eof > 0
-        if (consume_fetched_rows(buffer))
-        {
-            set_reply_state(REPLY_STATE_DONE);
-        }
-    }
-    else if (current_command() == MXS_COM_STATISTICS || GWBUF_IS_COLLECTED_RESULT(buffer))
+    const MXS_MYSQL_REPLY* reply;
+
+    if (GWBUF_IS_COLLECTED_RESULT(buffer) && (reply = mxs_mysql_get_reply(buffer)))
     {
-        // COM_STATISTICS returns a single string and thus requires special handling.
-        // Collected result are all in one buffer and need no processing.
-        set_reply_state(REPLY_STATE_DONE);
+        // The protocol already parsed the collected result
+        m_reply = *reply;
     }
     else
     {
-        // Normal result, process it one packet at a time
-        process_packets(buffer);
+        mxs_mysql_reply_process(&m_reply, buffer, 0);
     }
 
-    if (get_reply_state() == REPLY_STATE_DONE)
+    if (reply_is_complete())
     {
         ack_write();
     }
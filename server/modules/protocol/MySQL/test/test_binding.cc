@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2018 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2022-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+/**
+ * Tests which statements keep a multiplexed session on its backend connection
+ */
+
+#include <iostream>
+#include <maxscale/alloc.h>
+#include <maxscale/buffer.h>
+#include <maxscale/log.h>
+#include <maxscale/modutil.h>
+#include <maxscale/paths.h>
+#include <maxscale/protocol/mysql.h>
+#include <maxscale/query_classifier.h>
+
+using namespace std;
+
+namespace
+{
+
+struct
+{
+    const char*         zStmt;
+    mxs_mysql_binding_t binding;
+} test_cases[] =
+{
+    {"SELECT 1",                                         MXS_BINDING_NONE   },
+    {"SELECT a FROM t1 WHERE b = 2",                     MXS_BINDING_NONE   },
+    {"INSERT INTO t1 VALUES (1)",                        MXS_BINDING_NEXT   },
+    {"UPDATE t1 SET a = 1",                              MXS_BINDING_NEXT   },
+    {"DELETE FROM t1",                                   MXS_BINDING_NEXT   },
+    {"SELECT LAST_INSERT_ID()",                          MXS_BINDING_NEXT   },
+    {"SELECT last_insert_id() + 1",                      MXS_BINDING_NEXT   },
+    {"SELECT SQL_CALC_FOUND_ROWS a FROM t1 LIMIT 10",    MXS_BINDING_NEXT   },
+    {"select sql_calc_found_rows * from t1 limit 1",     MXS_BINDING_NEXT   },
+    {"SELECT FOUND_ROWS()",                              MXS_BINDING_NEXT   },
+    {"SELECT ROW_COUNT()",                               MXS_BINDING_NEXT   },
+    {"SELECT GET_LOCK('lock', 10)",                      MXS_BINDING_SESSION},
+    {"SELECT a FROM t1 WHERE GET_LOCK('lock', 0) = 1",   MXS_BINDING_SESSION},
+    {"LOCK TABLES t1 WRITE",                             MXS_BINDING_SESSION},
+    {"  LOCK TABLE t1 READ",                             MXS_BINDING_SESSION},
+};
+
+const size_t N_TEST_CASES = sizeof(test_cases) / sizeof(test_cases[0]);
+
+const char* to_string(mxs_mysql_binding_t binding)
+{
+    switch (binding)
+    {
+    case MXS_BINDING_NONE:
+        return "none";
+
+    case MXS_BINDING_NEXT:
+        return "next statement";
+
+    case MXS_BINDING_SESSION:
+        return "session";
+    }
+
+    return "unknown";
+}
+
+int test(const char* zStmt, mxs_mysql_binding_t expected)
+{
+    int rv = 0;
+    GWBUF* pStmt = modutil_create_query(zStmt);
+    mxs_mysql_binding_t binding = mxs_mysql_get_binding(pStmt, qc_get_type_mask(pStmt));
+
+    if (binding != expected)
+    {
+        cout << "error: \"" << zStmt << "\": expected " << to_string(expected)
+             << ", got " << to_string(binding) << "." << endl;
+        rv = 1;
+    }
+
+    gwbuf_free(pStmt);
+    return rv;
+}
+
+int test_commands()
+{
+    int rv = 0;
+    uint8_t ping[] = {1, 0, 0, 0, MXS_COM_PING};
+    GWBUF* pPing = gwbuf_alloc_and_load(sizeof(ping), ping);
+
+    if (mxs_mysql_get_binding(pPing, 0) != MXS_BINDING_NONE)
+    {
+        cout << "error: COM_PING should not keep the connection." << endl;
+        rv = 1;
+    }
+
+    gwbuf_free(pPing);
+    return rv;
+}
+}
+
+int main(int argc, char** argv)
+{
+    int rv = EXIT_FAILURE;
+
+    set_libdir(MXS_STRDUP_A("../../../../../query_classifier/qc_sqlite/"));
+
+    if (mxs_log_init(NULL, ".", MXS_LOG_TARGET_STDOUT))
+    {
+        if (qc_init(NULL, QC_SQL_MODE_DEFAULT, NULL, NULL))
+        {
+            int failures = 0;
+
+            for (size_t i = 0; i < N_TEST_CASES; ++i)
+            {
+                failures += test(test_cases[i].zStmt, test_cases[i].binding);
+            }
+
+            failures += test_commands();
+
+            rv = failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+            qc_end();
+        }
+        else
+        {
+            cerr << "error: Could not initialize the query classifier." << endl;
+        }
+
+        mxs_log_finish();
+    }
+
+    return rv;
+}
@@ -0,0 +1,230 @@
+/*
+ * Copyright (c) 2018 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2022-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+#include <maxscale/protocol/compression.hh>
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <maxscale/config.h>
+#include <maxscale/modutil.h>
+#include <maxscale/protocol/mysql.h>
+
+using namespace std;
+
+namespace
+{
+
+const size_t COMPRESSED_HEADER_LEN = 7;
+
+vector<uint8_t> to_vector(GWBUF* buffer)
+{
+    vector<uint8_t> data(gwbuf_length(buffer));
+    gwbuf_copy_data(buffer, 0, data.size(), data.data());
+    return data;
+}
+
+GWBUF* from_vector(const vector<uint8_t>& data, size_t offset, size_t len)
+{
+    GWBUF* buffer = gwbuf_alloc(len);
+    memcpy(GWBUF_DATA(buffer), data.data() + offset, len);
+    return buffer;
+}
+
+/**
+ * Writes queries through one compressing DCB and reads them back through another.
+ */
+class Connection
+{
+public:
+    Connection()
+        : m_writer()
+        , m_reader()
+    {
+        m_writer.dcb_role = DCB_ROLE_BACKEND_HANDLER;
+        m_reader.dcb_role = DCB_ROLE_CLIENT_HANDLER;
+        mxs::enable_mysql_compression(&m_writer);
+        mxs::enable_mysql_compression(&m_reader);
+    }
+
+    ~Connection()
+    {
+        dcb_set_codec(&m_writer, NULL);
+        dcb_set_codec(&m_reader, NULL);
+    }
+
+    GWBUF* encode(GWBUF* plain)
+    {
+        return m_writer.codec->encode(m_writer.codec, &m_writer, plain);
+    }
+
+    GWBUF* decode(GWBUF* raw, bool* error)
+    {
+        return m_reader.codec->decode(m_reader.codec, &m_reader, raw, error);
+    }
+
+private:
+    DCB m_writer;
+    DCB m_reader;
+};
+
+vector<uint8_t> create_query(const string& query)
+{
+    GWBUF* buffer = modutil_create_query(query.c_str());
+    vector<uint8_t> data = to_vector(buffer);
+    gwbuf_free(buffer);
+    return data;
+}
+
+/**
+ * Create a query that does not fit into one MySQL packet
+ */
+vector<uint8_t> create_large_query()
+{
+    vector<uint8_t> data(MYSQL_HEADER_LEN + GW_MYSQL_MAX_PACKET_LEN, 'x');
+    gw_mysql_set_byte3(&data[0], GW_MYSQL_MAX_PACKET_LEN);
+    data[3] = 0;
+    data[4] = MXS_COM_QUERY;
+
+    uint8_t header[MYSQL_HEADER_LEN] = {10, 0, 0, 1};
+    data.insert(data.end(), header, header + MYSQL_HEADER_LEN);
+    data.insert(data.end(), 10, 'y');
+
+    return data;
+}
+
+int test_roundtrip(const vector<uint8_t>& original, size_t chunk)
+{
+    int rv = 0;
+    Connection conn;
+
+    vector<uint8_t> wire = to_vector(conn.encode(from_vector(original, 0, original.size())));
+
+    // The data arrives in chunks of the given size.
+    GWBUF* decoded = NULL;
+    bool error = false;
+
+    for (size_t i = 0; i < wire.size() && !error; i += chunk)
+    {
+        decoded = gwbuf_append(decoded, conn.decode(from_vector(wire, i, min(chunk, wire.size() - i)),
+                                                    &error));
+    }
+
+    if (error || to_vector(decoded) != original)
+    {
+        cout << "error: A query of " << original.size() << " bytes read in chunks of " << chunk
+             << " bytes did not survive compression." << endl;
+        rv = 1;
+    }
+
+    gwbuf_free(decoded);
+    return rv;
+}
+
+int test_threshold()
+{
+    int rv = 0;
+    Connection conn;
+
+    // A short query is sent as such, the uncompressed length in the header is 0.
+    vector<uint8_t> wire = to_vector(conn.encode(modutil_create_query("SELECT 1")));
+
+    if (wire.size() < COMPRESSED_HEADER_LEN || gw_mysql_get_byte3(&wire[4]) != 0)
+    {
+        cout << "error: A query shorter than the threshold was compressed." << endl;
+        rv = 1;
+    }
+
+    // A long and repetitive one is compressed.
+    string query = "SELECT '" + string(1000, 'a') + "'";
+    wire = to_vector(conn.encode(modutil_create_query(query.c_str())));
+
+    if (wire.size() < COMPRESSED_HEADER_LEN || gw_mysql_get_byte3(&wire[4]) == 0
+        || wire.size() >= query.length())
+    {
+        cout << "error: A compressible query was not compressed." << endl;
+        rv = 1;
+    }
+
+    return rv;
+}
+
+int test_sequence()
+{
+    int rv = 0;
+    Connection conn;
+
+    // Every command written to a server starts again from sequence number 0.
+    for (int i = 0; i < 3; i++)
+    {
+        vector<uint8_t> wire = to_vector(conn.encode(modutil_create_query("SELECT 1")));
+
+        if (wire.size() < COMPRESSED_HEADER_LEN || wire[3] != 0)
+        {
+            cout << "error: Command " << i << " did not start with sequence number 0." << endl;
+            rv = 1;
+        }
+    }
+
+    // Two commands written at once are put into separate compressed packets.
+    GWBUF* both = gwbuf_append(modutil_create_query("SELECT 1"), modutil_create_query("SELECT 2"));
+    vector<uint8_t> wire = to_vector(conn.encode(both));
+    size_t first = COMPRESSED_HEADER_LEN + gw_mysql_get_byte3(&wire[0]);
+
+    if (first >= wire.size() || wire[3] != 0 || wire[first + 3] != 0)
+    {
+        cout << "error: Two commands were not sent as separate packets." << endl;
+        rv = 1;
+    }
+
+    return rv;
+}
+
+int test_corrupt()
+{
+    int rv = 0;
+    Connection conn;
+
+    string query = "SELECT '" + string(1000, 'a') + "'";
+    vector<uint8_t> wire = to_vector(conn.encode(modutil_create_query(query.c_str())));
+    wire[COMPRESSED_HEADER_LEN + 2] ^= 0xff;
+
+    bool error = false;
+    gwbuf_free(conn.decode(from_vector(wire, 0, wire.size()), &error));
+
+    if (!error)
+    {
+        cout << "error: Corrupt data was not detected." << endl;
+        rv = 1;
+    }
+
+    return rv;
+}
+}
+
+int main(int argc, char** argv)
+{
+    int rv = 0;
+
+    config_get_global_options()->compression_threshold = DEFAULT_COMPRESSION_THRESHOLD;
+
+    rv += test_roundtrip(create_query("SELECT 1"), 1);
+    rv += test_roundtrip(create_query("SELECT '" + string(1000, 'a') + "'"), 1);
+    rv += test_roundtrip(create_query("SELECT '" + string(100000, 'b') + "'"), 4096);
+    rv += test_roundtrip(create_large_query(), 1 << 20);
+    rv += test_threshold();
+    rv += test_sequence();
+    rv += test_corrupt();
+
+    return rv == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
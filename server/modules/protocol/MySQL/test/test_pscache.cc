@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) 2018 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2022-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+/**
+ * Tests the reuse of closed prepared statements of a backend connection
+ */
+
+#include <iostream>
+#include <maxscale/buffer.h>
+#include <maxscale/log.h>
+#include <maxscale/protocol/rwbackend.hh>
+
+using namespace std;
+using mxs::PSCache;
+
+namespace
+{
+
+int failures = 0;
+
+void expect(bool value, const char* zWhat)
+{
+    if (!value)
+    {
+        cout << "error: " << zWhat << endl;
+        ++failures;
+    }
+}
+
+GWBUF* create_response(uint32_t handle)
+{
+    uint8_t data[] = {8, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0};
+    gw_mysql_set_byte4(data + MYSQL_PS_ID_OFFSET, handle);
+    return gwbuf_alloc_and_load(sizeof(data), data);
+}
+
+void add(PSCache& cache, uint32_t handle, const char* zSql)
+{
+    GWBUF* pResponse = create_response(handle);
+    cache.add(handle, zSql, pResponse);
+    gwbuf_free(pResponse);
+}
+
+bool released(const vector<uint32_t>& handles, vector<uint32_t> expected)
+{
+    return handles == expected;
+}
+
+void test_reuse()
+{
+    PSCache cache(10);
+    add(cache, 1, "SELECT 1");
+
+    expect(!cache.contains("SELECT 1"), "A statement in use should not be reused");
+    expect(released(cache.release(1), {}), "A closed statement should be kept");
+    expect(cache.contains("SELECT 1"), "A closed statement should be reused");
+    expect(!cache.contains("SELECT 2"), "Only statements with the same text should be reused");
+
+    GWBUF* pResponse = NULL;
+    expect(cache.acquire("SELECT 1", &pResponse) == 1, "The handle of the closed statement should be returned");
+    expect(pResponse && gw_mysql_get_byte4(GWBUF_DATA(pResponse) + MYSQL_PS_ID_OFFSET) == 1,
+           "The response of the closed statement should be returned");
+    gwbuf_free(pResponse);
+
+    expect(cache.size() == 0, "A statement in use should not be in the cache");
+    expect(cache.acquire("SELECT 1") == 0, "A statement should be used by one client statement only");
+    expect(released(cache.release(1), {}), "A reused statement should be kept when closed");
+    expect(cache.acquire("SELECT 1") == 1, "A reused statement should be reused again");
+}
+
+void test_taint()
+{
+    PSCache cache(10);
+    add(cache, 1, "SELECT ?");
+    cache.taint(1);
+    expect(released(cache.release(1), {1}), "A statement that used a cursor should be closed");
+    expect(!cache.contains("SELECT ?"), "A statement that used a cursor should not be reused");
+
+    expect(released(cache.release(2), {2}), "An unknown statement should be closed");
+}
+
+void test_duplicates()
+{
+    PSCache cache(10);
+    add(cache, 1, "SELECT 1");
+    add(cache, 2, "SELECT 1");
+    expect(released(cache.release(1), {}), "The first copy should be kept");
+    expect(released(cache.release(2), {2}), "The second copy should be closed");
+    expect(cache.size() == 1, "Only one copy should be kept");
+}
+
+void test_eviction()
+{
+    PSCache cache(2);
+    add(cache, 1, "SELECT 1");
+    add(cache, 2, "SELECT 2");
+    add(cache, 3, "SELECT 3");
+
+    expect(released(cache.release(1), {}), "The first statement should be kept");
+    expect(released(cache.release(2), {}), "The second statement should be kept");
+    expect(cache.acquire("SELECT 1") == 1, "The first statement should be reused");
+    expect(released(cache.release(1), {}), "The first statement should be kept again");
+    expect(released(cache.release(3), {2}), "The least recently closed statement should be closed");
+    expect(cache.contains("SELECT 1") && cache.contains("SELECT 3") && !cache.contains("SELECT 2"),
+           "The most recently closed statements should be kept");
+
+    PSCache none(0);
+    add(none, 1, "SELECT 1");
+    expect(released(none.release(1), {1}), "No statements should be kept with an empty cache");
+}
+
+void test_clear()
+{
+    PSCache cache(10);
+    add(cache, 1, "SELECT 1");
+    add(cache, 2, "SELECT 2");
+    add(cache, 3, "SELECT 3");
+    cache.release(1);
+    cache.release(2);
+
+    vector<uint32_t> handles = cache.clear_idle();
+    expect(handles.size() == 2 && cache.size() == 0, "All closed statements should be closed");
+    expect(released(cache.release(3), {}), "Statements in use should not be removed");
+
+    cache.clear();
+    expect(cache.size() == 0 && !cache.contains("SELECT 3"), "All statements should be removed");
+    expect(released(cache.release(3), {3}), "A removed statement should be closed");
+
+    // The server can reuse the handles of closed statements
+    add(cache, 4, "SELECT 4");
+    cache.release(4);
+    add(cache, 4, "SELECT 5");
+    expect(!cache.contains("SELECT 4"), "A statement should be replaced when the handle is reused");
+    expect(released(cache.release(4), {}) && cache.contains("SELECT 5"),
+           "The new statement should be kept");
+}
+}
+
+int main(int argc, char** argv)
+{
+    int rv = EXIT_FAILURE;
+
+    if (mxs_log_init(NULL, ".", MXS_LOG_TARGET_STDOUT))
+    {
+        test_reuse();
+        test_taint();
+        test_duplicates();
+        test_eviction();
+        test_clear();
+
+        rv = failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+        mxs_log_finish();
+    }
+
+    return rv;
+}
@@ -0,0 +1,317 @@
+/*
+ * Copyright (c) 2018 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2022-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <maxscale/alloc.h>
+#include <maxscale/buffer.h>
+#include <maxscale/protocol/mysql.h>
+
+using namespace std;
+
+namespace
+{
+
+typedef vector<uint8_t> Data;
+
+void add_packet(Data& data, const Data& payload)
+{
+    uint8_t header[MYSQL_HEADER_LEN];
+    gw_mysql_set_byte3(header, payload.size());
+    header[3] = 0;
+    data.insert(data.end(), header, header + MYSQL_HEADER_LEN);
+    data.insert(data.end(), payload.begin(), payload.end());
+}
+
+void add_ok(Data& data, uint16_t status, uint16_t warnings = 0)
+{
+    add_packet(data, {MYSQL_REPLY_OK, 0, 0, (uint8_t)status, (uint8_t)(status >> 8),
+                      (uint8_t)warnings, (uint8_t)(warnings >> 8)});
+}
+
+void add_eof(Data& data, uint16_t status, uint16_t warnings = 0)
+{
+    add_packet(data, {MYSQL_REPLY_EOF, (uint8_t)warnings, (uint8_t)(warnings >> 8),
+                      (uint8_t)status, (uint8_t)(status >> 8)});
+}
+
+void add_err(Data& data, uint16_t code)
+{
+    add_packet(data, {MYSQL_REPLY_ERR, (uint8_t)code, (uint8_t)(code >> 8), '#', 'H', 'Y', '0', '0', '0'});
+}
+
+void add_definitions(Data& data, int n)
+{
+    for (int i = 0; i < n; i++)
+    {
+        add_packet(data, {3, 'd', 'e', 'f', 0, 0, 0, 1, 'a', 0, 0x0c, 0x3f, 0, 1, 0, 0, 0, 3, 0, 0, 0, 0, 0});
+    }
+
+    add_eof(data, 0);
+}
+
+void add_resultset(Data& data, int columns, int rows, uint16_t status, uint16_t warnings = 0)
+{
+    add_packet(data, {(uint8_t)columns});
+    add_definitions(data, columns);
+
+    for (int i = 0; i < rows; i++)
+    {
+        add_packet(data, {1, (uint8_t)('0' + i % 10)});
+    }
+
+    add_eof(data, status, warnings);
+}
+
+/**
+ * Feed the data in chunks of the given size, checking that the reply is
+ * complete only once all of it has been processed
+ */
+bool feed(MXS_MYSQL_REPLY* reply, const Data& data, size_t chunk)
+{
+    bool ok = true;
+
+    for (size_t i = 0; i < data.size() && ok; i += chunk)
+    {
+        ok = !mxs_mysql_reply_is_complete(reply);
+
+        // Split the chunk between two buffers to exercise chains
+        size_t len = min(chunk, data.size() - i);
+        size_t half = len / 2;
+        GWBUF* buffer = gwbuf_alloc_and_load(len - half, &data[i]);
+
+        if (half > 0)
+        {
+            buffer = gwbuf_append(buffer, gwbuf_alloc_and_load(half, &data[i + len - half]));
+        }
+
+        mxs_mysql_reply_process(reply, buffer, 0);
+        gwbuf_free(buffer);
+    }
+
+    return ok && mxs_mysql_reply_is_complete(reply) && reply->size == data.size();
+}
+
+int check(const char* zWhat, uint8_t cmd, const Data& data, bool cursor,
+          uint32_t results, uint64_t columns, uint64_t rows, uint16_t error_code = 0)
+{
+    int rv = 0;
+    size_t chunks[] = {1, 2, 7, 100, data.size()};
+
+    for (size_t chunk : chunks)
+    {
+        MXS_MYSQL_REPLY reply;
+        mxs_mysql_reply_start(&reply, cmd, cursor);
+
+        if (!feed(&reply, data, chunk))
+        {
+            cout << "error: " << zWhat << ": The reply was not complete at its end when read in chunks of "
+                 << chunk << " bytes." << endl;
+            rv = 1;
+        }
+        else if (reply.results != results || reply.columns != columns || reply.rows != rows
+                 || reply.error != (error_code != 0) || reply.error_code != error_code)
+        {
+            cout << "error: " << zWhat << ": Expected " << results << " results, " << columns
+                 << " columns and " << rows << " rows, got " << reply.results << ", "
+                 << reply.columns << " and " << reply.rows << " when read in chunks of "
+                 << chunk << " bytes." << endl;
+            rv = 1;
+        }
+    }
+
+    return rv;
+}
+
+int test_ok()
+{
+    Data data;
+    add_ok(data, 0);
+    return check("OK", MXS_COM_QUERY, data, false, 1, 0, 0);
+}
+
+int test_resultset()
+{
+    Data data;
+    add_resultset(data, 3, 25, 0);
+    return check("Resultset", MXS_COM_QUERY, data, false, 1, 3, 25);
+}
+
+int test_multi_result()
+{
+    Data data;
+    add_resultset(data, 2, 5, SERVER_MORE_RESULTS_EXIST);
+    add_ok(data, SERVER_MORE_RESULTS_EXIST);
+    add_resultset(data, 1, 3, SERVER_MORE_RESULTS_EXIST);
+    add_ok(data, 0);
+    return check("Multi-result", MXS_COM_QUERY, data, false, 4, 1, 8);
+}
+
+int test_error()
+{
+    Data data;
+    add_packet(data, {2});
+    add_definitions(data, 2);
+    add_packet(data, {1, 'a', 1, 'b'});
+    add_err(data, 1317);
+    return check("Error", MXS_COM_QUERY, data, false, 0, 2, 1, 1317);
+}
+
+int test_prepare()
+{
+    Data data;
+    add_packet(data, {MYSQL_REPLY_OK, 1, 0, 0, 0, 3, 0, 2, 0, 0, 0, 0});
+    add_definitions(data, 2);
+    add_definitions(data, 3);
+    return check("Prepare", MXS_COM_STMT_PREPARE, data, false, 1, 3, 0);
+}
+
+int test_cursor()
+{
+    Data data;
+    add_packet(data, {2});
+    add_definitions(data, 2);
+
+    int rv = check("Cursor", MXS_COM_STMT_EXECUTE, data, true, 1, 2, 0);
+
+    data.clear();
+    add_packet(data, {0, 0, 1, 0, 0, 0});
+    add_packet(data, {0, 0, 2, 0, 0, 0});
+    add_eof(data, SERVER_STATUS_CURSOR_EXISTS);
+    rv += check("Fetch", MXS_COM_STMT_FETCH, data, false, 1, 0, 2);
+
+    return rv;
+}
+
+int test_large_row()
+{
+    Data data;
+    add_packet(data, {1});
+    add_definitions(data, 1);
+
+    // A row that does not fit into one packet, its second part looks like an EOF packet
+    Data row(GW_MYSQL_MAX_PACKET_LEN, 'x');
+    row[0] = 0xfe;
+    add_packet(data, row);
+    add_packet(data, {MYSQL_REPLY_EOF, 0, 0, 0, 0});
+    add_eof(data, 0);
+
+    MXS_MYSQL_REPLY reply;
+    mxs_mysql_reply_start(&reply, MXS_COM_QUERY, false);
+    int rv = 0;
+
+    if (!feed(&reply, data, 1 << 20) || reply.rows != 1)
+    {
+        cout << "error: The continuation of a large row was not skipped." << endl;
+        rv = 1;
+    }
+
+    return rv;
+}
+
+int test_warnings()
+{
+    int rv = 0;
+    Data data;
+    add_ok(data, 0);
+
+    MXS_MYSQL_REPLY reply;
+    mxs_mysql_reply_start(&reply, MXS_COM_QUERY, false);
+
+    if (!feed(&reply, data, 1) || mxs_mysql_reply_has_diagnostics(&reply))
+    {
+        cout << "error: A reply without warnings was reported to have diagnostics." << endl;
+        rv = 1;
+    }
+
+    data.clear();
+    add_resultset(data, 1, 2, SERVER_MORE_RESULTS_EXIST, 1);
+    add_ok(data, 0, 2);
+
+    for (size_t chunk : {1, 7, 100})
+    {
+        mxs_mysql_reply_start(&reply, MXS_COM_QUERY, false);
+
+        if (!feed(&reply, data, chunk) || reply.warnings != 3 || !mxs_mysql_reply_has_diagnostics(&reply))
+        {
+            cout << "error: Expected 3 warnings, got " << reply.warnings << " when read in chunks of "
+                 << chunk << " bytes." << endl;
+            rv = 1;
+        }
+    }
+
+    data.clear();
+    add_err(data, 1064);
+    mxs_mysql_reply_start(&reply, MXS_COM_QUERY, false);
+
+    if (!feed(&reply, data, 3) || !mxs_mysql_reply_has_diagnostics(&reply))
+    {
+        cout << "error: An error was not reported as a diagnostic." << endl;
+        rv = 1;
+    }
+
+    return rv;
+}
+
+int test_collected()
+{
+    int rv = 0;
+    Data data;
+    add_resultset(data, 2, 10, 0);
+
+    MXS_MYSQL_REPLY* reply = (MXS_MYSQL_REPLY*)MXS_MALLOC(sizeof(*reply));
+    mxs_mysql_reply_start(reply, MXS_COM_QUERY, false);
+    GWBUF* buffer = gwbuf_alloc_and_load(data.size(), &data[0]);
+    mxs_mysql_reply_process(reply, buffer, 0);
+
+    if (mxs_mysql_get_reply(buffer))
+    {
+        cout << "error: A buffer without a stored reply returned one." << endl;
+        rv = 1;
+    }
+
+    // Stored the way the backend protocol does it for a collected result
+    gwbuf_set_type(buffer, GWBUF_TYPE_RESULT);
+    gwbuf_add_buffer_object(buffer, GWBUF_REPLY_INFO, reply, mxs_free);
+    GWBUF* clone = gwbuf_clone(buffer);
+    const MXS_MYSQL_REPLY* stored = mxs_mysql_get_reply(clone);
+
+    if (!stored || !mxs_mysql_reply_is_complete(stored) || stored->columns != 2 || stored->rows != 10)
+    {
+        cout << "error: The stored reply of a collected result was not found." << endl;
+        rv = 1;
+    }
+
+    gwbuf_free(clone);
+    gwbuf_free(buffer);
+    return rv;
+}
+}
+
+int main(int argc, char** argv)
+{
+    int rv = 0;
+
+    rv += test_ok();
+    rv += test_resultset();
+    rv += test_multi_result();
+    rv += test_error();
+    rv += test_prepare();
+    rv += test_cursor();
+    rv += test_large_row();
+    rv += test_warnings();
+    rv += test_collected();
+
+    return rv == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -98,7 +98,7 @@ static bool authenticate_unix_socket(MAXSCALED* protocol, DCB* dcb)
             {
                 dcb_printf(dcb, MAXADMIN_AUTH_SUCCESS_REPLY);
                 protocol->state = MAXSCALED_STATE_DATA;
-                dcb->user = strdup(protocol->username);
+                dcb_set_user(dcb, protocol->username);
             }
             else
             {
@@ -249,7 +249,7 @@ static int maxscaled_read_event(DCB* dcb)
                         memcpy(user, GWBUF_DATA(head), len);
                         user[len] = '\0';
                         maxscaled->username = MXS_STRDUP_A(user);
-                        dcb->user = MXS_STRDUP_A(user);
+                        dcb_set_user(dcb, user);
                         maxscaled->state = MAXSCALED_STATE_PASSWD;
                         dcb_printf(dcb, MAXADMIN_AUTH_PASSWORD_PROMPT);
                         gwbuf_free(head);
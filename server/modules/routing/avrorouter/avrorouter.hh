@@ -131,7 +131,7 @@ public:
     uint64_t    trx_target; /*< Number of transactions that trigger a flush */
     uint64_t    row_count;  /*< Row events processed */
     uint64_t    row_target; /*< Number of row events that trigger a flush */
-    uint32_t    task_handle;/**< Delayed task handle */
+    uint64_t    task_handle;/**< Delayed task handle */
     Rpl         handler;
 
 private:
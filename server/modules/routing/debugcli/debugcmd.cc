@@ -2709,8 +2709,8 @@ static void show_qc_all(DCB* dcb)
 
     mxs::RoutingWorker::get_qc_stats(all_stats);
 
-    dcb_printf(dcb, " ID | Size       | Inserts    | Hits       | Misses     | Evictions  |\n");
-    dcb_printf(dcb, "----+------------+------------+------------+------------+------------+\n");
+    dcb_printf(dcb, " ID | Size       | Inserts    | Hits       | Misses     | Evictions  | Shared hits |\n");
+    dcb_printf(dcb, "----+------------+------------+------------+------------+------------+-------------+\n");
 
     int id = 0;
     for (const auto& stats : all_stats)
@@ -2721,13 +2721,15 @@ static void show_qc_all(DCB* dcb)
                                  " %10" PRIi64 " |"
                                                " %10" PRIi64 " |"
                                                              " %10" PRIi64 " |"
-                                                                           " %10" PRIi64 " |\n",
+                                                                           " %10" PRIi64 " |"
+                                                                                         " %11" PRIi64 " |\n",
                    id,
                    stats.size,
                    stats.inserts,
                    stats.hits,
                    stats.misses,
-                   stats.evictions);
+                   stats.evictions,
+                   stats.shared_hits);
     }
 
     dcb_printf(dcb, "\n");
@@ -31,17 +31,22 @@
 #include <maxscale/dcb.h>
 #include <maxscale/service.h>
 #include <maxscale/router.h>
+#include <maxscale/protocol/rwbackend.hh>
 
 /**
  * The client session structure used within this router.
  */
 struct ROUTER_CLIENT_SES : MXS_ROUTER_SESSION
 {
-    SERVER_REF* backend;    /*< Backend used by the client session */
-    DCB*        backend_dcb;/*< DCB Connection to the backend      */
-    DCB*        client_dcb; /**< Client DCB */
-    uint32_t    bitmask;    /*< Bitmask to apply to server->status */
-    uint32_t    bitvalue;   /*< Session specific required value of server->status */
+    SERVER_REF*      backend;       /*< Backend used by the client session */
+    DCB*             backend_dcb;   /*< DCB Connection to the backend      */
+    DCB*             client_dcb;    /**< Client DCB */
+    uint32_t         bitmask;       /*< Bitmask to apply to server->status */
+    uint32_t         bitvalue;      /*< Session specific required value of server->status */
+    mxs::RWBackend*  mux;           /**< The backend connection, if connections are multiplexed */
+    bool             pinned;        /**< Session state ties the session to its current connection */
+    mxs_mysql_binding_t binding;    /**< Whether the state left by the latest statement must be kept */
+    bool             large_query;   /**< The next packet continues the previous one */
 };
 
 /**
@@ -60,5 +65,6 @@ struct ROUTER_INSTANCE : public MXS_ROUTER
 {
     SERVICE*     service;               /*< Pointer to the service using this router */
     uint64_t     bitmask_and_bitvalue;  /*< Lower 32-bits for bitmask and upper for bitvalue */
+    bool         multiplex;             /**< Release idle connections to the pool, fixed at creation */
     ROUTER_STATS stats;                 /*< Statistics for this router               */
 };
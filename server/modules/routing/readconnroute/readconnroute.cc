@@ -87,6 +87,8 @@
 #include <maxscale/log.h>
 #include <maxscale/protocol/mysql.h>
 #include <maxscale/modutil.h>
+#include <maxscale/query_classifier.h>
+#include <maxscale/session.h>
 #include <maxscale/utils.hh>
 
 /* The router entry points */
@@ -153,6 +155,7 @@ extern "C" MXS_MODULE* MXS_CREATE_MODULE()
         NULL,   /* Thread init. */
         NULL,   /* Thread finish. */
         {
+            {"multiplex_connections", MXS_MODULE_PARAM_BOOL, "false"},
             {MXS_END_MODULE_PARAMS}
         }
     };
@@ -246,6 +249,8 @@ static MXS_ROUTER* createInstance(SERVICE* service, MXS_CONFIG_PARAMETER* params
 
         inst->service = service;
         inst->bitmask_and_bitvalue = 0;
+        // The capabilities of the service can't change, so neither can this
+        inst->multiplex = config_get_bool(params, "multiplex_connections");
 
         if (!configureInstance((MXS_ROUTER*)inst, params))
         {
@@ -411,19 +416,36 @@ static MXS_ROUTER_SESSION* newSession(MXS_ROUTER* instance, MXS_SESSION* session
      */
     client_rses->backend = candidate;
 
-    /** Open the backend connection */
-    client_rses->backend_dcb = dcb_connect(candidate->server,
-                                           session,
-                                           candidate->server->protocol);
-
-    if (client_rses->backend_dcb == NULL)
+    if (inst->multiplex)
     {
-        /** The failure is reported in dcb_connect() */
-        MXS_FREE(client_rses);
-        return NULL;
+        /** The backend keeps the connection count of the server */
+        client_rses->mux = new(std::nothrow) mxs::RWBackend(candidate);
+
+        if (!client_rses->mux || !client_rses->mux->connect(session))
+        {
+            delete client_rses->mux;
+            MXS_FREE(client_rses);
+            return NULL;
+        }
+
+        client_rses->backend_dcb = client_rses->mux->dcb();
     }
+    else
+    {
+        /** Open the backend connection */
+        client_rses->backend_dcb = dcb_connect(candidate->server,
+                                               session,
+                                               candidate->server->protocol);
+
+        if (client_rses->backend_dcb == NULL)
+        {
+            /** The failure is reported in dcb_connect() */
+            MXS_FREE(client_rses);
+            return NULL;
+        }
 
-    mxb::atomic::add(&candidate->connections, 1, mxb::atomic::RELAXED);
+        mxb::atomic::add(&candidate->connections, 1, mxb::atomic::RELAXED);
+    }
 
     inst->stats.n_sessions++;
 
@@ -456,10 +478,17 @@ static void freeSession(MXS_ROUTER* router_instance, MXS_ROUTER_SESSION* router_
     ROUTER_INSTANCE* router = (ROUTER_INSTANCE*) router_instance;
     ROUTER_CLIENT_SES* router_cli_ses = (ROUTER_CLIENT_SES*) router_client_ses;
 
-    MXB_AT_DEBUG(int prev_val = ) mxb::atomic::add(&router_cli_ses->backend->connections,
-                                                   -1,
-                                                   mxb::atomic::RELAXED);
-    mxb_assert(prev_val > 0);
+    if (router_cli_ses->mux)
+    {
+        delete router_cli_ses->mux;
+    }
+    else
+    {
+        MXB_AT_DEBUG(int prev_val = ) mxb::atomic::add(&router_cli_ses->backend->connections,
+                                                       -1,
+                                                       mxb::atomic::RELAXED);
+        mxb_assert(prev_val > 0);
+    }
 
     MXS_FREE(router_cli_ses);
 }
@@ -474,8 +503,19 @@ static void freeSession(MXS_ROUTER* router_instance, MXS_ROUTER_SESSION* router_
 static void closeSession(MXS_ROUTER* instance, MXS_ROUTER_SESSION* router_session)
 {
     ROUTER_CLIENT_SES* router_cli_ses = (ROUTER_CLIENT_SES*) router_session;
-    mxb_assert(router_cli_ses->backend_dcb);
-    dcb_close(router_cli_ses->backend_dcb);
+
+    if (router_cli_ses->mux)
+    {
+        if (router_cli_ses->mux->in_use())
+        {
+            router_cli_ses->mux->close();
+        }
+    }
+    else
+    {
+        mxb_assert(router_cli_ses->backend_dcb);
+        dcb_close(router_cli_ses->backend_dcb);
+    }
 }
 
 /** Log routing failure due to closed session */
@@ -542,6 +582,130 @@ static inline bool connection_is_valid(ROUTER_INSTANCE* inst, ROUTER_CLIENT_SES*
     return rval;
 }
 
+/**
+ * Check whether a command changes the state of the session in a way that can't
+ * be restored on another connection
+ *
+ * @param command  The command
+ * @param queue    Buffer containing the command
+ *
+ * @return True if the session must keep its current connection
+ */
+static bool pins_connection(mxs_mysql_cmd_t command, GWBUF* queue)
+{
+    bool rval = false;
+
+    switch (command)
+    {
+    case MXS_COM_INIT_DB:
+    case MXS_COM_CHANGE_USER:
+    case MXS_COM_STMT_PREPARE:
+    case MXS_COM_SET_OPTION:
+        rval = true;
+        break;
+
+    case MXS_COM_QUERY:
+        {
+            uint32_t type = qc_get_type_mask(queue);
+
+            rval = qc_query_is_type(type, QUERY_TYPE_SESSION_WRITE)
+                || qc_query_is_type(type, QUERY_TYPE_USERVAR_WRITE)
+                || qc_query_is_type(type, QUERY_TYPE_ENABLE_AUTOCOMMIT)
+                || qc_query_is_type(type, QUERY_TYPE_DISABLE_AUTOCOMMIT)
+                || qc_query_is_type(type, QUERY_TYPE_CREATE_TMP_TABLE)
+                || qc_query_is_type(type, QUERY_TYPE_PREPARE_NAMED_STMT)
+                || qc_query_is_type(type, QUERY_TYPE_PREPARE_STMT)
+                || qc_get_operation(queue) == QUERY_OP_CALL;
+        }
+        break;
+
+    default:
+        break;
+    }
+
+    return rval;
+}
+
+/**
+ * Route a packet to a multiplexed backend connection
+ *
+ * If the connection was released to the pool, a new one is taken. Until the
+ * session is pinned to its connection, the replies are tracked so that the
+ * connection can be released again once the session is idle and the next
+ * statement no longer needs the state left by the previous one.
+ *
+ * @param router_cli_ses  Router session
+ * @param mysql_command   The current command of the client
+ * @param queue           The packet to route
+ *
+ * @return 1 on success, 0 on error
+ */
+static int route_multiplexed(ROUTER_CLIENT_SES* router_cli_ses,
+                             mxs_mysql_cmd_t mysql_command,
+                             GWBUF* queue)
+{
+    mxs::RWBackend* backend = router_cli_ses->mux;
+
+    if (!backend->in_use())
+    {
+        if (mysql_command == MXS_COM_QUIT)
+        {
+            /** The connection is already back in the pool */
+            gwbuf_free(queue);
+            return 1;
+        }
+
+        if (!backend->connect(router_cli_ses->client_dcb->session))
+        {
+            MXS_ERROR("Failed to take a connection to '%s' back into use.", backend->name());
+            gwbuf_free(queue);
+            return 0;
+        }
+
+        router_cli_ses->backend_dcb = backend->dcb();
+    }
+
+    bool continues = router_cli_ses->large_query;
+    router_cli_ses->large_query = gwbuf_length(queue) == MYSQL_HEADER_LEN + GW_MYSQL_MAX_PACKET_LEN;
+
+    if (!continues && !router_cli_ses->pinned)
+    {
+        uint32_t type = mysql_command == MXS_COM_QUERY ? qc_get_type_mask(queue) : 0;
+        router_cli_ses->binding = mxs_mysql_get_binding(queue, type);
+
+        if (backend->is_waiting_result() || pins_connection(mysql_command, queue)
+            || router_cli_ses->binding == MXS_BINDING_SESSION)
+        {
+            /** From now on the data is streamed as such, like without multiplexing */
+            MXS_INFO("Session is pinned to '%s'", backend->name());
+            router_cli_ses->pinned = true;
+        }
+    }
+
+    DCB* backend_dcb = backend->dcb();
+    int rc;
+
+    if (continues)
+    {
+        rc = backend->continue_write(queue);
+    }
+    else if (mysql_command == MXS_COM_CHANGE_USER)
+    {
+        rc = backend_dcb->func.auth(backend_dcb, NULL, backend_dcb->session, queue);
+    }
+    else if (router_cli_ses->pinned)
+    {
+        rc = backend->continue_write(queue);
+    }
+    else
+    {
+        rc = backend->write(queue, mxs_mysql_command_will_respond(mysql_command) ?
+                            mxs::Backend::EXPECT_RESPONSE : mxs::Backend::NO_RESPONSE);
+    }
+
+    return rc;
+}
+
 /**
  * We have data from the client, we must route it to the backend.
  * This is simply a case of sending it to the connection that was
@@ -565,8 +729,6 @@ static int routeQuery(MXS_ROUTER* instance, MXS_ROUTER_SESSION* router_session,
     // Due to the streaming nature of readconnroute, this is not accurate
     mxb::atomic::add(&router_cli_ses->backend->server->stats.packets, 1, mxb::atomic::RELAXED);
 
-    DCB* backend_dcb = router_cli_ses->backend_dcb;
-    mxb_assert(backend_dcb);
     char* trc = NULL;
 
     if (!connection_is_valid(inst, router_cli_ses))
@@ -576,6 +738,14 @@ static int routeQuery(MXS_ROUTER* instance, MXS_ROUTER_SESSION* router_session,
         return rc;
     }
 
+    if (router_cli_ses->mux)
+    {
+        return route_multiplexed(router_cli_ses, mysql_command, queue);
+    }
+
+    DCB* backend_dcb = router_cli_ses->backend_dcb;
+    mxb_assert(backend_dcb);
+
     switch (mysql_command)
     {
     case MXS_COM_CHANGE_USER:
@@ -686,7 +856,43 @@ static void clientReply(MXS_ROUTER* instance,
                         DCB*   backend_dcb)
 {
     mxb_assert(backend_dcb->session->client_dcb != NULL);
-    MXS_SESSION_ROUTE_REPLY(backend_dcb->session, queue);
+    ROUTER_CLIENT_SES* router_cli_ses = (ROUTER_CLIENT_SES*) router_session;
+    mxs::RWBackend* backend = router_cli_ses->mux;
+
+    if (!backend || router_cli_ses->pinned || backend->reply_is_complete())
+    {
+        /** Not tracked or not a reply to a tracked command */
+        MXS_SESSION_ROUTE_REPLY(backend_dcb->session, queue);
+        return;
+    }
+
+    backend->process_reply(queue);
+
+    if (backend->local_infile_requested())
+    {
+        /** The client will stream the file to this connection */
+        router_cli_ses->pinned = true;
+    }
+
+    if (backend->reply_is_complete() && mxs_mysql_reply_has_diagnostics(&backend->reply()))
+    {
+        /** Keep the connection for a SHOW WARNINGS or SHOW ERRORS */
+        router_cli_ses->binding = MXS_BINDING_NEXT;
+    }
+
+    MXS_SESSION* session = backend_dcb->session;
+    MXS_SESSION_ROUTE_REPLY(session, queue);
+
+    if (!router_cli_ses->pinned
+        && router_cli_ses->binding == MXS_BINDING_NONE
+        && backend->reply_is_complete()
+        && (!session_trx_is_active(session) || session_trx_is_ending(session))
+        && backend->can_release())
+    {
+        MXS_INFO("Releasing idle connection to '%s'", backend->name());
+        backend->close(mxs::Backend::CLOSE_RELEASE);
+        router_cli_ses->backend_dcb = NULL;
+    }
 }
 
 /**
@@ -721,7 +927,21 @@ static void handleError(MXS_ROUTER* instance,
 
 static uint64_t getCapabilities(MXS_ROUTER* instance)
 {
-    return RCAP_TYPE_RUNTIME_CONFIG;
+    ROUTER_INSTANCE* inst = (ROUTER_INSTANCE*) instance;
+    uint64_t rval = RCAP_TYPE_RUNTIME_CONFIG;
+
+    if (inst->multiplex)
+    {
+        /** Releasing a connection requires knowing when the reply and the transaction end */
+        rval |= RCAP_TYPE_TRANSACTION_TRACKING | RCAP_TYPE_PACKET_OUTPUT;
+    }
+    else
+    {
+        /** A session keeps only its connection, which moves with it */
+        rval |= RCAP_TYPE_MOVABLE_SESSIONS;
+    }
+
+    return rval;
 }
 
 /*
@@ -235,6 +235,13 @@ RWSplit* RWSplit::create(SERVICE* service, MXS_CONFIG_PARAMETER* params)
         return NULL;
     }
 
+    if (config.multiplex_connections && config.disable_sescmd_history)
+    {
+        MXS_ERROR("Both 'multiplex_connections' and 'disable_sescmd_history' are enabled: "
+                  "Released connections cannot be restored without session command history.");
+        return NULL;
+    }
+
     return new(std::nothrow) RWSplit(service, config);
 }
 
@@ -303,6 +310,12 @@ void RWSplit::diagnostics(DCB* dcb)
     dcb_printf(dcb,
                "\tdelayed_retry_timeout:       %lu\n",
                cnf.delayed_retry_timeout);
+    dcb_printf(dcb,
+               "\tmultiplex_connections:       %s\n",
+               cnf.multiplex_connections ? "true" : "false");
+    dcb_printf(dcb,
+               "\tlazy_prepare:       %s\n",
+               cnf.lazy_prepare ? "true" : "false");
 
     dcb_printf(dcb, "\n");
 
@@ -343,6 +356,9 @@ void RWSplit::diagnostics(DCB* dcb)
     dcb_printf(dcb,
                "\tNumber of replayed transactions:        %" PRIu64 "\n",
                stats().n_trx_replay);
+    dcb_printf(dcb,
+               "\tNumber of prepares avoided:             %" PRIu64 "\n",
+               stats().n_ps_avoided);
 
     if (*weightby)
     {
@@ -403,6 +419,7 @@ json_t* RWSplit::diagnostics_json() const
     json_object_set_new(rval, "rw_transactions", json_integer(stats().n_rw_trx));
     json_object_set_new(rval, "ro_transactions", json_integer(stats().n_ro_trx));
     json_object_set_new(rval, "replayed_transactions", json_integer(stats().n_trx_replay));
+    json_object_set_new(rval, "prepares_avoided", json_integer(stats().n_ps_avoided));
 
     const char* weightby = serviceGetWeightingParameter(service());
 
@@ -439,7 +456,7 @@ uint64_t RWSplit::getCapabilities()
 {
     return RCAP_TYPE_STMT_INPUT | RCAP_TYPE_TRANSACTION_TRACKING
            | RCAP_TYPE_PACKET_OUTPUT | RCAP_TYPE_SESSION_STATE_TRACKING
-           | RCAP_TYPE_RUNTIME_CONFIG;
+           | RCAP_TYPE_RUNTIME_CONFIG | RCAP_TYPE_MOVABLE_SESSIONS;
 }
 
 bool RWSplit::configure(MXS_CONFIG_PARAMETER* params)
@@ -476,7 +493,8 @@ extern "C" MXS_MODULE* MXS_CREATE_MODULE()
         | RCAP_TYPE_TRANSACTION_TRACKING
         | RCAP_TYPE_PACKET_OUTPUT
         | RCAP_TYPE_SESSION_STATE_TRACKING
-        | RCAP_TYPE_RUNTIME_CONFIG,
+        | RCAP_TYPE_RUNTIME_CONFIG
+        | RCAP_TYPE_MOVABLE_SESSIONS,
         &RWSplit::s_object,
         NULL,
         NULL,
@@ -522,6 +540,8 @@ extern "C" MXS_MODULE* MXS_CREATE_MODULE()
             {"transaction_replay",         MXS_MODULE_PARAM_BOOL,    "false"        },
             {"transaction_replay_max_size",MXS_MODULE_PARAM_SIZE,    "1Mi"          },
             {"optimistic_trx",             MXS_MODULE_PARAM_BOOL,    "false"        },
+            {"multiplex_connections",      MXS_MODULE_PARAM_BOOL,    "false"        },
+            {"lazy_prepare",               MXS_MODULE_PARAM_BOOL,    "false"        },
             {MXS_END_MODULE_PARAMS}
         }
     };
@@ -169,6 +169,8 @@ struct Config
         , transaction_replay(config_get_bool(params, "transaction_replay"))
         , trx_max_size(config_get_size(params, "transaction_replay_max_size"))
         , optimistic_trx(config_get_bool(params, "optimistic_trx"))
+        , multiplex_connections(config_get_bool(params, "multiplex_connections"))
+        , lazy_prepare(config_get_bool(params, "lazy_prepare"))
     {
         if (causal_reads)
         {
@@ -197,6 +199,12 @@ struct Config
             master_reconnection = true;
             master_failure_mode = RW_FAIL_ON_WRITE;
         }
+
+        if (multiplex_connections)
+        {
+            // Released connections are taken back into use by reconnecting
+            master_reconnection = true;
+        }
     }
 
     select_criteria_t     slave_selection_criteria;     /**< The slave selection criteria */
@@ -227,6 +235,8 @@ struct Config
     bool        transaction_replay;     /**< Replay failed transactions */
     size_t      trx_max_size;           /**< Max transaction size for replaying */
     bool        optimistic_trx;         /**< Enable optimistic transactions */
+    bool        multiplex_connections;  /**< Release idle connections to the pool */
+    bool        lazy_prepare;           /**< Prepare statements only when needed */
 };
 
 /**
@@ -242,6 +252,7 @@ struct Stats
     uint64_t n_trx_replay = 0;      /**< Number of replayed transactions */
     uint64_t n_ro_trx = 0;          /**< Read-only transaction count */
     uint64_t n_rw_trx = 0;          /**< Read-write transaction count */
+    uint64_t n_ps_avoided = 0;      /**< Prepares that were never sent to a server */
 };
 
 using maxscale::ServerStats;
@@ -127,6 +127,13 @@ uint32_t extract_binary_ps_id(GWBUF* buffer)
     uint8_t* ptr = GWBUF_DATA(buffer) + MYSQL_PS_ID_OFFSET;
     return gw_mysql_get_byte4(ptr);
 }
+
+bool ps_opens_cursor(GWBUF* buffer)
+{
+    uint8_t flags = 0;
+    gwbuf_copy_data(buffer, MYSQL_PS_ID_OFFSET + MYSQL_PS_ID_SIZE, 1, &flags);
+    return flags != 0;
+}
 }
 
 bool RWSplitSession::have_connected_slaves() const
@@ -142,6 +149,70 @@ bool RWSplitSession::have_connected_slaves() const
     return false;
 }
 
+bool RWSplitSession::have_connections() const
+{
+    for (const auto& b : m_backends)
+    {
+        if (b->in_use())
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * Take a connection back into use after all of them were released to the pools
+ *
+ * The master is preferred so that the following writes do not need another
+ * connection. If the session command history needs to be replayed first, the
+ * query is queued until it completes.
+ *
+ * @return True if the session can continue
+ */
+bool RWSplitSession::reacquire_connection(route_target_t route_target,
+                                          GWBUF* querybuf,
+                                          uint8_t command,
+                                          uint32_t qtype)
+{
+    if (command == MXS_COM_QUIT)
+    {
+        // Nothing to close, the connections are already back in the pools
+        return true;
+    }
+
+    SRWBackend target;
+
+    if (m_current_master && m_current_master->is_master() && m_current_master->can_connect())
+    {
+        target = m_current_master;
+    }
+    else
+    {
+        target = get_slave_backend(get_max_replication_lag());
+    }
+
+    bool rval = false;
+
+    if (!target || !prepare_target(target, route_target))
+    {
+        MXS_ERROR("Could not take a connection back into use for a session command.");
+    }
+    else if (target->has_session_commands())
+    {
+        m_query_queue.emplace_back(gwbuf_clone(querybuf));
+        MXS_INFO("Queuing session command until '%s' has restored the session state", target->name());
+        rval = true;
+    }
+    else
+    {
+        rval = handle_target_is_all(route_target, querybuf, command, qtype);
+    }
+
+    return rval;
+}
+
 bool RWSplitSession::should_try_trx_on_slave(route_target_t route_target) const
 {
     return m_config.optimistic_trx          // Optimistic transactions are enabled
@@ -200,9 +271,20 @@ bool RWSplitSession::route_single_stmt(GWBUF* querybuf)
     uint32_t qtype = info.type_mask();
     route_target_t route_target = info.target();
 
+    if (m_config.multiplex_connections && m_binding != MXS_BINDING_SESSION)
+    {
+        // The state left by the previous statement is no longer needed once this one is done
+        m_binding = mxs_mysql_get_binding(querybuf, qtype);
+    }
+
     SRWBackend target;
 
-    if (TARGET_IS_ALL(route_target))
+    if (TARGET_IS_ALL(route_target) && m_config.multiplex_connections && !have_connections())
+    {
+        // All connections were released, take one back into use for the session command
+        succp = reacquire_connection(route_target, querybuf, command, qtype);
+    }
+    else if (TARGET_IS_ALL(route_target))
     {
         succp = handle_target_is_all(route_target, querybuf, command, qtype);
     }
@@ -317,6 +399,12 @@ bool RWSplitSession::route_single_stmt(GWBUF* querybuf)
                 // The connection to target was down and we failed to reconnect
                 succp = false;
             }
+            else if (target->has_session_commands() && !target->is_waiting_result()
+                     && !execute_lazy_prepares(target))
+            {
+                // Statements were prepared lazily but preparing them on the target failed
+                succp = false;
+            }
             else if (target->has_session_commands())
             {
                 // We need to wait until the session commands are executed
@@ -330,11 +418,20 @@ bool RWSplitSession::route_single_stmt(GWBUF* querybuf)
 
                 if (succp && command == MXS_COM_STMT_EXECUTE && !is_locked_to_master())
                 {
-                    /** Track the targets of the COM_STMT_EXECUTE statements. This
-                     * information is used to route all COM_STMT_FETCH commands
-                     * to the same server where the COM_STMT_EXECUTE was done. */
-                    m_exec_map[stmt_id] = target;
-                    MXS_INFO("COM_STMT_EXECUTE on %s: %s", target->name(), target->uri());
+                    if (m_config.multiplex_connections && !ps_opens_cursor(querybuf))
+                    {
+                        /** No COM_STMT_FETCH can follow, don't keep the target
+                         * connected only because of this statement. */
+                        m_exec_map.erase(stmt_id);
+                    }
+                    else
+                    {
+                        /** Track the targets of the COM_STMT_EXECUTE statements. This
+                         * information is used to route all COM_STMT_FETCH commands
+                         * to the same server where the COM_STMT_EXECUTE was done. */
+                        m_exec_map[stmt_id] = target;
+                        MXS_INFO("COM_STMT_EXECUTE on %s: %s", target->name(), target->uri());
+                    }
                 }
             }
         }
@@ -458,6 +555,16 @@ bool RWSplitSession::route_session_write(GWBUF* querybuf, uint8_t command, uint3
     bool expecting_response = mxs_mysql_command_will_respond(command);
     int nsucc = 0;
     uint64_t lowest_pos = id;
+    uint32_t stmt_id = m_qc.current_route_info().stmt_id();
+    GWBUF* reused = NULL;
+    SRWBackend prepare_target;
+
+    if (command == MXS_COM_STMT_PREPARE && m_config.lazy_prepare)
+    {
+        /** With lazy_prepare, the statement is prepared on only one server and
+         * on the others when a query is routed to them. */
+        prepare_target = get_prepare_target(sescmd->to_string());
+    }
 
     if (expecting_response)
     {
@@ -485,21 +592,49 @@ bool RWSplitSession::route_session_write(GWBUF* querybuf, uint8_t command, uint3
         if (backend->in_use())
         {
             attempted_write = true;
-            backend->append_session_command(sescmd);
+            bool discarded = command == MXS_COM_STMT_CLOSE && backend->discard_session_command(stmt_id);
 
-            uint64_t current_pos = backend->next_session_command()->get_position();
+            if (!discarded)
+            {
+                backend->append_session_command(sescmd);
+            }
 
-            if (current_pos < lowest_pos)
+            if (backend->has_session_commands())
             {
-                lowest_pos = current_pos;
+                uint64_t current_pos = backend->next_session_command()->get_position();
+
+                if (current_pos < lowest_pos)
+                {
+                    lowest_pos = current_pos;
+                }
             }
 
-            if (backend->execute_session_command())
+            if (discarded)
+            {
+                /** The statement was never prepared on this server, the pending
+                 * COM_STMT_PREPARE was removed instead of closing the statement */
+                MXS_INFO("Statement %u was never prepared on '%s'", stmt_id, backend->name());
+                mxb::atomic::add(&m_router->stats().n_ps_avoided, 1, mxb::atomic::RELAXED);
+                nsucc += 1;
+            }
+            else if (prepare_target && backend != prepare_target)
+            {
+                MXS_INFO("Deferring COM_STMT_PREPARE on '%s'", backend->name());
+            }
+            else if (prepare_target && backend->next_session_command()->get_position() == id
+                     && (reused = backend->reuse_prepared()))
+            {
+                /** The statement is already prepared on the server, the stored
+                 * response is returned to the client */
+                mxb::atomic::add(&m_router->stats().n_ps_avoided, 1, mxb::atomic::RELAXED);
+                nsucc += 1;
+            }
+            else if (backend->execute_session_command())
             {
                 nsucc += 1;
                 mxb::atomic::add(&backend->server()->stats.packets, 1, mxb::atomic::RELAXED);
-                m_server_stats[backend->server()].total++;
-                m_server_stats[backend->server()].read++;
+                (*m_server_stats)[backend->server()].total++;
+                (*m_server_stats)[backend->server()].read++;
 
                 if (expecting_response)
                 {
@@ -571,6 +706,16 @@ bool RWSplitSession::route_session_write(GWBUF* querybuf, uint8_t command, uint3
              * completed session command count */
             m_recv_sescmd++;
         }
+        else if (reused)
+        {
+            /** The response was not generated by a server, the command is
+             * already complete */
+            m_recv_sescmd++;
+            m_sescmd_responses[id] = MYSQL_REPLY_OK;
+            m_qc.ps_id_internal_put(id, id);
+            MXS_SESSION_ROUTE_REPLY(m_pSession, set_prepare_response_id(reused, id));
+            reused = NULL;
+        }
     }
     else
     {
@@ -664,8 +809,16 @@ SRWBackend RWSplitSession::get_slave_backend(int max_rlag)
             && backend->can_connect()
             && counts.second < m_router->max_slave_count();
 
+        // With multiplexing, the master may have been released between transactions
+        bool can_take_master_into_use = m_config.multiplex_connections
+            && backend == m_current_master
+            && backend->is_master()
+            && !backend->in_use()
+            && can_recover_servers()
+            && backend->can_connect();
+
         bool master_or_slave = backend->is_master() || backend->is_slave();
-        bool is_usable = backend->in_use() || can_take_slave_into_use;
+        bool is_usable = backend->in_use() || can_take_slave_into_use || can_take_master_into_use;
         bool rlag_ok = rpl_lag_is_ok(backend, max_rlag);
 
         if (master_or_slave && is_usable)
@@ -730,6 +883,52 @@ SRWBackend RWSplitSession::get_last_used_backend()
     return m_prev_target ? m_prev_target : get_master_backend();
 }
 
+/**
+ * Select the server where a lazily prepared statement is prepared first
+ *
+ * A server where the same statement is already prepared and unused is preferred,
+ * the master over the slaves. Otherwise the statement is prepared on the master
+ * or, if the session has no master, on the first server in use.
+ *
+ * @param sql The text of the statement
+ *
+ * @return The server that returns the response to the client
+ */
+SRWBackend RWSplitSession::get_prepare_target(const std::string& sql)
+{
+    SRWBackend rval;
+
+    for (auto& backend : m_backends)
+    {
+        if (backend->in_use() && !backend->has_session_commands() && !backend->is_waiting_result()
+            && backend->can_reuse_prepared(sql) && (!rval || backend == m_current_master))
+        {
+            rval = backend;
+        }
+    }
+
+    if (!rval)
+    {
+        if (m_current_master && m_current_master->in_use())
+        {
+            rval = m_current_master;
+        }
+        else
+        {
+            auto it = std::find_if(m_backends.begin(), m_backends.end(), [](const SRWBackend& backend) {
+                                       return backend->in_use();
+                                   });
+
+            if (it != m_backends.end())
+            {
+                rval = *it;
+            }
+        }
+    }
+
+    return rval;
+}
+
 /**
  * Provide the router with a reference to a suitable backend
  *
@@ -933,7 +1132,7 @@ SRWBackend RWSplitSession::handle_slave_is_target(uint8_t cmd, uint32_t stmt_id)
     if (target)
     {
         mxb::atomic::add(&m_router->stats().n_slave, 1, mxb::atomic::RELAXED);
-        m_server_stats[target->server()].read++;
+        (*m_server_stats)[target->server()].read++;
         mxb_assert(target->in_use() || target->can_connect());
     }
     else
@@ -1070,7 +1269,7 @@ bool RWSplitSession::handle_master_is_target(SRWBackend* dest)
     if (target && target == m_current_master)
     {
         mxb::atomic::add(&m_router->stats().n_master, 1, mxb::atomic::RELAXED);
-        m_server_stats[target->server()].write++;
+        (*m_server_stats)[target->server()].write++;
     }
     else
     {
@@ -1251,7 +1450,7 @@ bool RWSplitSession::handle_got_target(GWBUF* querybuf, SRWBackend& target, bool
 
         mxb::atomic::add(&m_router->stats().n_queries, 1, mxb::atomic::RELAXED);
         mxb::atomic::add(&target->server()->stats.packets, 1, mxb::atomic::RELAXED);
-        m_server_stats[target->server()].total++;
+        (*m_server_stats)[target->server()].total++;
 
         if (!m_qc.large_query() && response == mxs::Backend::EXPECT_RESPONSE)
         {
@@ -100,7 +100,16 @@ void RWSplitSession::process_sescmd_response(SRWBackend& backend, GWBUF** ppPack
             // This should never fail or the backend protocol is broken
             MXB_AT_DEBUG(bool b = ) mxs_mysql_extract_ps_response(*ppPacket, &resp);
             mxb_assert(b);
-            backend->add_ps_handle(id, resp.id);
+
+            if (m_config.lazy_prepare)
+            {
+                // Keep the statement prepared for other statements with the same text
+                backend->add_ps_handle(id, resp.id, sescmd->to_string(), *ppPacket);
+            }
+            else
+            {
+                backend->add_ps_handle(id, resp.id);
+            }
         }
 
         if (m_recv_sescmd < m_sent_sescmd && id == m_recv_sescmd + 1)
@@ -122,6 +131,13 @@ void RWSplitSession::process_sescmd_response(SRWBackend& backend, GWBUF** ppPack
                              id,
                              extract_error(*ppPacket).c_str());
                 }
+                else if (command == MXS_COM_STMT_PREPARE && m_config.lazy_prepare)
+                {
+                    /** The servers can share their handles between statements,
+                     * the client gets the internal ID */
+                    *ppPacket = set_prepare_response_id(*ppPacket, id);
+                    m_qc.ps_id_internal_put(id, id);
+                }
                 else if (command == MXS_COM_STMT_PREPARE)
                 {
                     /** Map the returned response to the internal ID */
@@ -190,3 +206,50 @@ void RWSplitSession::process_sescmd_response(SRWBackend& backend, GWBUF** ppPack
         }
     }
 }
+
+/**
+ * Execute the session commands that were left pending on a server
+ *
+ * With lazy_prepare, the COM_STMT_PREPARE commands are sent to only one server
+ * when the client prepares the statement. They are executed on the other servers
+ * here when a query is routed to them. Statements that are already prepared on
+ * the server are reused.
+ *
+ * @param backend Backend with pending session commands
+ *
+ * @return True if the commands were written successfully
+ */
+bool RWSplitSession::execute_lazy_prepares(SRWBackend& backend)
+{
+    mxb_assert(backend->has_session_commands() && !backend->is_waiting_result());
+    MXS_INFO("Executing %lu pending session commands on '%s'",
+             backend->session_command_count(),
+             backend->name());
+
+    while (GWBUF* reused = backend->reuse_prepared())
+    {
+        gwbuf_free(reused);
+        mxb::atomic::add(&m_router->stats().n_ps_avoided, 1, mxb::atomic::RELAXED);
+    }
+
+    bool rval = !backend->has_session_commands() || backend->execute_session_command();
+
+    if (rval && backend->is_waiting_result())
+    {
+        m_expected_responses++;
+    }
+
+    return rval;
+}
+
+GWBUF* set_prepare_response_id(GWBUF* buffer, uint32_t id)
+{
+    if (GWBUF_LENGTH(buffer) < MYSQL_PS_ID_OFFSET + MYSQL_PS_ID_SIZE)
+    {
+        buffer = gwbuf_make_contiguous(buffer);
+    }
+
+    // The ID is stored in the same place as in the COM_STMT commands
+    gw_mysql_set_byte4(GWBUF_DATA(buffer) + MYSQL_PS_ID_OFFSET, id);
+    return buffer;
+}
@@ -13,6 +13,7 @@
 
 #include "rwsplitsession.hh"
 
+#include <algorithm>
 #include <cmath>
 
 #include <maxscale/modutil.hh>
@@ -44,7 +45,7 @@ RWSplitSession::RWSplitSession(RWSplit* instance,
     , m_retry_duration(0)
     , m_is_replay_active(false)
     , m_can_replay_trx(true)
-    , m_server_stats(instance->local_server_stats())
+    , m_server_stats(&instance->local_server_stats())
 {
     if (m_config.rw_max_slave_conn_percent)
     {
@@ -84,7 +85,7 @@ RWSplitSession* RWSplitSession::create(RWSplit* router, MXS_SESSION* session)
 
             for (auto& b : backends)
             {
-                rses->m_server_stats[b->server()].start_session();
+                (*rses->m_server_stats)[b->server()].start_session();
             }
         }
     }
@@ -122,12 +123,41 @@ void RWSplitSession::close()
         }
         backend->response_stat().reset();
 
-        m_server_stats[backend->server()].end_session(backend->session_timer().split(),
-                                                      backend->select_timer().total(),
-                                                      backend->num_selects());
+        (*m_server_stats)[backend->server()].end_session(backend->session_timer().split(),
+                                                         backend->select_timer().total(),
+                                                         backend->num_selects());
     }
 }
 
+void RWSplitSession::moved()
+{
+    // The statistics are kept per worker.
+    m_server_stats = &m_router->local_server_stats();
+
+    for (auto& backend : m_backends)
+    {
+        backend->take_ownership();
+    }
+
+    for (auto& sescmd : m_sescmd_list)
+    {
+        sescmd->take_ownership();
+    }
+
+    for (auto& query : m_query_queue)
+    {
+        gwbuf_take_ownership(query.get());
+    }
+
+    gwbuf_take_ownership(m_current_query.get());
+    gwbuf_take_ownership(m_interrupted_query.get());
+    gwbuf_take_ownership(m_orig_stmt.get());
+
+    m_trx.take_ownership();
+    m_replayed_trx.take_ownership();
+    m_orig_trx.take_ownership();
+}
+
 int32_t RWSplitSession::routeQuery(GWBUF* querybuf)
 {
     int rval = 0;
@@ -575,6 +605,57 @@ void RWSplitSession::close_stale_connections()
     }
 }
 
+/**
+ * Check whether the session is in a state where its backend connections can be
+ * returned to the persistent pools
+ *
+ * The connections are released only between transactions and only if the session
+ * state of the connections can be fully restored from the session command history.
+ * State that only lives on the connection, like LAST_INSERT_ID() after a write or
+ * a named lock, keeps the connections until it is no longer needed.
+ *
+ * @return True if the connections can be released
+ */
+bool RWSplitSession::can_release_connections() const
+{
+    return m_expected_responses == 0
+           && m_query_queue.empty()
+           && (!session_trx_is_active(m_client->session) || session_trx_is_ending(m_client->session))
+           && !m_target_node
+           && !is_locked_to_master()
+           && !m_qc.have_tmp_tables()
+           && !m_qc.large_query()
+           && m_qc.load_data_state() == QueryClassifier::LOAD_DATA_INACTIVE
+           && !m_is_replay_active
+           && m_otrx_state == OTRX_INACTIVE
+           && m_wait_gtid == NONE
+           && m_binding == MXS_BINDING_NONE
+           && can_recover_servers();
+}
+
+void RWSplitSession::release_idle_connections()
+{
+    if (!can_release_connections())
+    {
+        return;
+    }
+
+    for (auto& backend : m_backends)
+    {
+        // A server with an open cursor must remain connected for the COM_STMT_FETCH
+        auto is_exec_target = [&backend](const ExecMap::value_type& a) {
+                return a.second == backend;
+            };
+
+        if (backend->can_release()
+            && std::none_of(m_exec_map.begin(), m_exec_map.end(), is_exec_target))
+        {
+            MXS_INFO("Releasing idle connection to '%s'", backend->name());
+            backend->close(mxs::Backend::CLOSE_RELEASE);
+        }
+    }
+}
+
 void RWSplitSession::clientReply(GWBUF* writebuf, DCB* backend_dcb)
 {
     DCB* client_dcb = backend_dcb->session->client_dcb;
@@ -662,6 +743,13 @@ void RWSplitSession::clientReply(GWBUF* writebuf, DCB* backend_dcb)
             m_wait_gtid = NONE;
         }
 
+        if (m_config.multiplex_connections && m_binding == MXS_BINDING_NONE
+            && mxs_mysql_reply_has_diagnostics(&backend->reply()))
+        {
+            // Keep the connections for a SHOW WARNINGS or SHOW ERRORS
+            m_binding = MXS_BINDING_NEXT;
+        }
+
         if (backend->local_infile_requested())
         {
             // Server requested a local file, go into data streaming mode
@@ -741,8 +829,9 @@ void RWSplitSession::clientReply(GWBUF* writebuf, DCB* backend_dcb)
             m_expected_responses++;
         }
     }
-    else if (m_expected_responses == 0 && !m_query_queue.empty()
-             && (!m_is_replay_active || processed_sescmd))
+
+    if (m_expected_responses == 0 && !m_query_queue.empty()
+        && (!m_is_replay_active || processed_sescmd))
     {
         /**
          * All replies received, route any stored queries. This should be done
@@ -767,6 +856,11 @@ void RWSplitSession::clientReply(GWBUF* writebuf, DCB* backend_dcb)
          * before all responses have been received.
          */
         close_stale_connections();
+
+        if (m_config.multiplex_connections)
+        {
+            release_idle_connections();
+        }
     }
 }
 
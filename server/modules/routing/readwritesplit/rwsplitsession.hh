@@ -97,6 +97,11 @@ public:
      */
     void close();
 
+    /**
+     * Called in the new worker when the session has been moved to another worker.
+     */
+    void moved();
+
     /**
      * Called when a packet being is routed to the backend. The router should
      * forward the packet to the appropriate server(s).
@@ -169,7 +174,9 @@ public:
 
     otrx_state m_otrx_state = OTRX_INACTIVE;    /**< Optimistic trx state*/
 
-    SrvStatMap& m_server_stats;     /**< The server stats local to this thread, cached in the session object.
+    mxs_mysql_binding_t m_binding = MXS_BINDING_NONE;   /**< Whether the connection state must be kept */
+
+    SrvStatMap* m_server_stats;     /**< The server stats local to this thread, cached in the session object.
                                      * This avoids the lookup involved in getting the worker-local value from
                                      * the worker's container.*/
 
@@ -181,6 +188,7 @@ private:
 
     void process_sescmd_response(mxs::SRWBackend& backend, GWBUF** ppPacket);
     void compress_history(mxs::SSessionCommand& sescmd);
+    bool execute_lazy_prepares(mxs::SRWBackend& backend);
 
     void prune_to_position(uint64_t pos);
     bool route_session_write(GWBUF* querybuf, uint8_t command, uint32_t type);
@@ -188,11 +196,14 @@ private:
     bool route_single_stmt(GWBUF* querybuf);
     bool route_stored_query();
     void close_stale_connections();
+    bool can_release_connections() const;
+    void release_idle_connections();
 
     mxs::SRWBackend get_hinted_backend(char* name);
     mxs::SRWBackend get_slave_backend(int max_rlag);
     mxs::SRWBackend get_master_backend();
     mxs::SRWBackend get_last_used_backend();
+    mxs::SRWBackend get_prepare_target(const std::string& sql);
     mxs::SRWBackend get_target_backend(backend_type_t btype, char* name, int max_rlag);
 
     bool handle_target_is_all(route_target_t route_target,
@@ -231,6 +242,15 @@ private:
     // Do we have at least one open slave connection
     bool have_connected_slaves() const;
 
+    // Do we have at least one open connection
+    bool have_connections() const;
+
+    // Take a released connection back into use for a session command
+    bool reacquire_connection(route_target_t route_target,
+                              GWBUF* querybuf,
+                              uint8_t command,
+                              uint32_t qtype);
+
     /**
      * Start the replaying of the latest transaction
      *
@@ -324,6 +344,16 @@ private:
  */
 uint32_t get_internal_ps_id(RWSplitSession* rses, GWBUF* buffer);
 
+/**
+ * @brief Replace the statement ID in a COM_STMT_PREPARE response
+ *
+ * @param buffer Buffer containing the response
+ * @param id     The ID returned to the client
+ *
+ * @return The modified buffer
+ */
+GWBUF* set_prepare_response_id(GWBUF* buffer, uint32_t id);
+
 static inline const char* route_target_to_string(route_target_t target)
 {
     if (TARGET_IS_MASTER(target))
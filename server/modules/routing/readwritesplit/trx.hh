@@ -148,6 +148,17 @@ public:
         return m_checksum;
     }
 
+    /**
+     * Take over the stored statements after the session moved to another worker
+     */
+    void take_ownership()
+    {
+        for (auto& buf : m_log)
+        {
+            gwbuf_take_ownership(buf.get());
+        }
+    }
+
 private:
     mxs::SHA1Checksum m_checksum;   /**< Checksum of the transaction */
     TrxLog            m_log;        /**< The transaction contents */